@@ -22,13 +22,135 @@
 #include "xalgo_local.h"
 
 #include <QCryptographicHash>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QtEndian>
 #include <algorithm>
 #include <cstdlib>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#define ALGO_UTILS_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
 namespace {
 const qint32 N_ALGO_UTILS_BUFFER_SIZE = 65536;
+const qint64 N_ALGO_UTILS_MAP_MIN_SIZE = 0x10000;  // Mapping small inputs costs more than copying them
 ISzAlloc g_lzmaAlloc = {Algo_utils::szAlloc, Algo_utils::szFree};
 ISzAlloc g_ppmdAlloc = {Algo_utils::szAlloc, Algo_utils::szFree};
+
+const qint32 N_ALGO_UTILS_DEFLATE_BLOCK_SIZE = 0x20000;         // Input per block of the parallel deflate
+const qint32 N_ALGO_UTILS_DEFLATE_DICTIONARY_SIZE = 0x8000;     // Window primed from the previous block
+const qint64 N_ALGO_UTILS_DEFLATE_PARALLEL_MIN_SIZE = 0x400000;  // Below this one stream on one core is as fast
+
+quint32 g_nCPUFeatureMask = 0xFFFFFFFF;
+
+enum DEFLATE_CHECK {
+    DEFLATE_CHECK_NONE = 0,
+    DEFLATE_CHECK_ADLER32,
+    DEFLATE_CHECK_CRC32
+};
+
+// One block of a parallel deflate: a raw stream primed with the preceding input and ended with a
+// sync flush (or Z_FINISH for the last block), so the block outputs concatenate into one stream
+class DeflateBlockRunnable : public QRunnable {
+public:
+    DeflateBlockRunnable(const QByteArray &baInput, const QByteArray &baDictionary, bool bLast, int nCompressionLevel, int nWindowBits, int nMemLevel,
+                         int nStrategy, DEFLATE_CHECK check)
+        : m_baInput(baInput),
+          m_baDictionary(baDictionary),
+          m_bLast(bLast),
+          m_nCompressionLevel(nCompressionLevel),
+          m_nWindowBits(nWindowBits),
+          m_nMemLevel(nMemLevel),
+          m_nStrategy(nStrategy),
+          m_check(check),
+          m_nCheck(0),
+          m_bSuccess(false)
+    {
+        setAutoDelete(false);
+    }
+
+    const QByteArray &getOutput() const
+    {
+        return m_baOutput;
+    }
+
+    qint64 getInputSize() const
+    {
+        return m_baInput.size();
+    }
+
+    quint32 getCheck() const
+    {
+        return m_nCheck;
+    }
+
+    bool isSuccess() const
+    {
+        return m_bSuccess;
+    }
+
+    void run() override
+    {
+        z_stream stream = {};
+
+        if (X_deflateInit2(&stream, m_nCompressionLevel, Z_DEFLATED, m_nWindowBits, m_nMemLevel, m_nStrategy) == Z_OK) {
+            bool bInit = m_baDictionary.isEmpty() ||
+                         (X_deflateSetDictionary(&stream, (const Bytef *)m_baDictionary.constData(), (uInt)m_baDictionary.size()) == Z_OK);
+
+            if (bInit) {
+                char outputBuffer[N_ALGO_UTILS_BUFFER_SIZE];
+                int nFlush = m_bLast ? Z_FINISH : Z_SYNC_FLUSH;
+                int ret = Z_OK;
+
+                stream.next_in = (Bytef *)m_baInput.constData();
+                stream.avail_in = (uInt)m_baInput.size();
+
+                do {
+                    stream.next_out = (Bytef *)outputBuffer;
+                    stream.avail_out = N_ALGO_UTILS_BUFFER_SIZE;
+
+                    ret = X_deflate(&stream, nFlush);
+
+                    if (ret == Z_STREAM_ERROR) {
+                        break;
+                    }
+
+                    m_baOutput.append(outputBuffer, N_ALGO_UTILS_BUFFER_SIZE - stream.avail_out);
+                } while (stream.avail_out == 0);
+
+                m_bSuccess = (stream.avail_in == 0) && (m_bLast ? (ret == Z_STREAM_END) : (ret != Z_STREAM_ERROR));
+            }
+
+            X_deflateEnd(&stream);
+        }
+
+        if (m_check == DEFLATE_CHECK_ADLER32) {
+            m_nCheck = (quint32)X_adler32(1, (const Bytef *)m_baInput.constData(), (uInt)m_baInput.size());
+        } else if (m_check == DEFLATE_CHECK_CRC32) {
+            m_nCheck = (quint32)X_crc32(0, (const Bytef *)m_baInput.constData(), (uInt)m_baInput.size());
+        }
+    }
+
+private:
+    QByteArray m_baInput;
+    QByteArray m_baDictionary;
+    QByteArray m_baOutput;
+    bool m_bLast;
+    int m_nCompressionLevel;
+    int m_nWindowBits;
+    int m_nMemLevel;
+    int m_nStrategy;
+    DEFLATE_CHECK m_check;
+    quint32 m_nCheck;
+    bool m_bSuccess;
+};
 }  // namespace
 
 void Algo_utils::seekToStart(XBinary::DATAPROCESS_STATE *pState)
@@ -63,6 +185,74 @@ qint32 Algo_utils::getReadChunkSize(const XBinary::DATAPROCESS_STATE *pState, qi
     return nResult;
 }
 
+bool Algo_utils::mapInput(XBinary::DATAPROCESS_STATE *pState, MAPPED_INPUT *pMappedInput)
+{
+    *pMappedInput = {};
+
+    QFileDevice *pFile = qobject_cast<QFileDevice *>(pState->pDeviceInput);
+
+    if (pFile && (!pFile->isSequential()) && (pState->nInputOffset >= 0)) {
+        qint64 nFileSize = pFile->size();
+        qint64 nSize = pState->nInputLimit;
+
+        if (nSize == -1) {
+            nSize = nFileSize - pState->nInputOffset;
+        }
+
+        if ((nSize >= N_ALGO_UTILS_MAP_MIN_SIZE) && (pState->nInputOffset + nSize <= nFileSize)) {
+            uchar *pMemory = pFile->map(pState->nInputOffset, nSize);
+
+            if (pMemory) {
+                pMappedInput->pFile = pFile;
+                pMappedInput->pMemory = pMemory;
+                pMappedInput->nOffset = pState->nInputOffset;
+                pMappedInput->nSize = nSize;
+            }
+        }
+    }
+
+    return (pMappedInput->pMemory != nullptr);
+}
+
+void Algo_utils::unmapInput(MAPPED_INPUT *pMappedInput)
+{
+    if (pMappedInput->pMemory) {
+        pMappedInput->pFile->unmap(pMappedInput->pMemory);
+    }
+
+    *pMappedInput = {};
+}
+
+const char *Algo_utils::readSpan(XBinary::DATAPROCESS_STATE *pState, const MAPPED_INPUT *pMappedInput, char *pBuffer, qint32 nMaxSize, qint32 *pnSize)
+{
+    const char *pResult = pBuffer;
+
+    if (pMappedInput->pMemory) {
+        // Keep the file position and nCountInput in step, as a buffered read would
+        qint64 nFilePos = pMappedInput->pFile->pos();
+        qint64 nDelta = nFilePos - pMappedInput->nOffset;
+        qint32 nSize = 0;
+
+        if ((nDelta >= 0) && (nDelta <= pMappedInput->nSize) && (nMaxSize > 0)) {
+            nSize = (qint32)(std::min)((qint64)nMaxSize, pMappedInput->nSize - nDelta);
+
+            if ((nSize > 0) && (!pMappedInput->pFile->seek(nFilePos + nSize))) {
+                pState->bReadError = true;
+                nSize = 0;
+            }
+
+            pResult = (const char *)pMappedInput->pMemory + nDelta;
+        }
+
+        pState->nCountInput += nSize;
+        *pnSize = nSize;
+    } else {
+        *pnSize = XBinary::_readDevice(pBuffer, nMaxSize, pState);
+    }
+
+    return pResult;
+}
+
 int Algo_utils::ascii85ReadByte(XBinary::DATAPROCESS_STATE *pState)
 {
     char c = 0;
@@ -114,7 +304,8 @@ bool Algo_utils::decompressLZMA(CLzmaDec *pState, XBinary::DATAPROCESS_STATE *pD
     qint64 nExpectedOutput = pDecompressState->mapProperties.value(XBinary::FPART_PROP_UNCOMPRESSEDSIZE, (qint64)-1).toLongLong();
     qint64 nTotalOutput = 0;
 
-    char *bufferIn = new char[_nBufferSize];
+    MAPPED_INPUT mappedInput = {};
+    char *bufferIn = mapInput(pDecompressState, &mappedInput) ? nullptr : new char[_nBufferSize];
     char *bufferOut = new char[_nBufferSize];
 
     ELzmaStatus lastStatus = LZMA_STATUS_NOT_FINISHED;
@@ -125,8 +316,10 @@ bool Algo_utils::decompressLZMA(CLzmaDec *pState, XBinary::DATAPROCESS_STATE *pD
         if (nBufferSize <= 0) {
             break;
         }
-        qint32 nSize = XBinary::_readDevice(bufferIn, nBufferSize, pDecompressState);
+        qint32 nSize = 0;
+        const char *pInput = readSpan(pDecompressState, &mappedInput, bufferIn, nBufferSize, &nSize);
         if (nSize < 0) {
+            unmapInput(&mappedInput);
             delete[] bufferIn;
             delete[] bufferOut;
             return false;
@@ -148,6 +341,7 @@ bool Algo_utils::decompressLZMA(CLzmaDec *pState, XBinary::DATAPROCESS_STATE *pD
                 qint64 nRemainingOutput = nExpectedOutput - nTotalOutput;
 
                 if (nRemainingOutput < 0) {
+                    unmapInput(&mappedInput);
                     delete[] bufferIn;
                     delete[] bufferOut;
                     return false;
@@ -164,9 +358,10 @@ bool Algo_utils::decompressLZMA(CLzmaDec *pState, XBinary::DATAPROCESS_STATE *pD
                 }
             }
 
-            SRes ret = X_LzmaDec_DecodeToBuf(pState, (Byte *)bufferOut, &outProcessed, (Byte *)(bufferIn + nPos), &inProcessed, finishMode, &status);
+            SRes ret = X_LzmaDec_DecodeToBuf(pState, (Byte *)bufferOut, &outProcessed, (const Byte *)(pInput + nPos), &inProcessed, finishMode, &status);
 
             if (ret != 0) {
+                unmapInput(&mappedInput);
                 delete[] bufferIn;
                 delete[] bufferOut;
                 return false;
@@ -176,6 +371,7 @@ bool Algo_utils::decompressLZMA(CLzmaDec *pState, XBinary::DATAPROCESS_STATE *pD
 
             if (outProcessed > 0) {
                 if (!XBinary::_writeDevice((char *)bufferOut, (qint32)outProcessed, pDecompressState)) {
+                    unmapInput(&mappedInput);
                     delete[] bufferIn;
                     delete[] bufferOut;
                     return false;
@@ -213,6 +409,7 @@ bool Algo_utils::decompressLZMA(CLzmaDec *pState, XBinary::DATAPROCESS_STATE *pD
         }
     }
 
+    unmapInput(&mappedInput);
     delete[] bufferIn;
     delete[] bufferOut;
 
@@ -228,7 +425,8 @@ bool Algo_utils::decompressLZMA2(CLzma2Dec *pState, XBinary::DATAPROCESS_STATE *
 {
     qint32 _nBufferSize = XBinary::getBufferSize(pPdStruct);
 
-    char *bufferIn = new char[_nBufferSize];
+    MAPPED_INPUT mappedInput = {};
+    char *bufferIn = mapInput(pDecompressState, &mappedInput) ? nullptr : new char[_nBufferSize];
     char *bufferOut = new char[_nBufferSize];
 
     ELzmaStatus lastStatus = LZMA_STATUS_NOT_FINISHED;
@@ -238,8 +436,10 @@ bool Algo_utils::decompressLZMA2(CLzma2Dec *pState, XBinary::DATAPROCESS_STATE *
         if (nBufferSize <= 0) {
             break;
         }
-        qint32 nSize = XBinary::_readDevice(bufferIn, nBufferSize, pDecompressState);
+        qint32 nSize = 0;
+        const char *pInput = readSpan(pDecompressState, &mappedInput, bufferIn, nBufferSize, &nSize);
         if (nSize < 0) {
+            unmapInput(&mappedInput);
             delete[] bufferIn;
             delete[] bufferOut;
             return false;
@@ -253,9 +453,10 @@ bool Algo_utils::decompressLZMA2(CLzma2Dec *pState, XBinary::DATAPROCESS_STATE *
             SizeT inProcessed = nSize - nPos;
             SizeT outProcessed = _nBufferSize;
 
-            SRes ret = X_Lzma2Dec_DecodeToBuf(pState, (Byte *)bufferOut, &outProcessed, (Byte *)(bufferIn + nPos), &inProcessed, LZMA_FINISH_ANY, &status);
+            SRes ret = X_Lzma2Dec_DecodeToBuf(pState, (Byte *)bufferOut, &outProcessed, (const Byte *)(pInput + nPos), &inProcessed, LZMA_FINISH_ANY, &status);
 
             if (ret != 0) {
+                unmapInput(&mappedInput);
                 delete[] bufferIn;
                 delete[] bufferOut;
                 return false;
@@ -265,6 +466,7 @@ bool Algo_utils::decompressLZMA2(CLzma2Dec *pState, XBinary::DATAPROCESS_STATE *
 
             if (outProcessed > 0) {
                 if (!XBinary::_writeDevice((char *)bufferOut, (qint32)outProcessed, pDecompressState)) {
+                    unmapInput(&mappedInput);
                     delete[] bufferIn;
                     delete[] bufferOut;
                     return false;
@@ -292,6 +494,7 @@ bool Algo_utils::decompressLZMA2(CLzma2Dec *pState, XBinary::DATAPROCESS_STATE *
         }
     }
 
+    unmapInput(&mappedInput);
     delete[] bufferIn;
     delete[] bufferOut;
 
@@ -417,13 +620,18 @@ int Algo_utils::deflate64WriteFunc(void *pOutDesc, unsigned char *pBuffer, unsig
     return pDecompressState->bWriteError ? 1 : 0;
 }
 
-bool Algo_utils::compressDeflate(XBinary::DATAPROCESS_STATE *pCompressState, XBinary::PDSTRUCT *pPdStruct, int nCompressionLevel, int nWindowBits)
+bool Algo_utils::compressDeflate(XBinary::DATAPROCESS_STATE *pCompressState, XBinary::PDSTRUCT *pPdStruct, int nCompressionLevel, int nWindowBits,
+                                 bool bParallel)
 {
     bool bResult = false;
 
     if (pCompressState && pCompressState->pDeviceInput && pCompressState->pDeviceOutput) {
         prepareState(pCompressState);
 
+        if (bParallel && isDeflateParallel(pCompressState->nInputLimit, nWindowBits)) {
+            return compressDeflateParallel(pCompressState, pPdStruct, nCompressionLevel, nWindowBits);
+        }
+
         z_stream stream;
         stream.zalloc = Z_NULL;
         stream.zfree = Z_NULL;
@@ -503,6 +711,277 @@ bool Algo_utils::compressDeflate(XBinary::DATAPROCESS_STATE *pCompressState, XBi
     return bResult;
 }
 
+quint32 Algo_utils::combineCRC32(quint32 nCRC1, quint32 nCRC2, qint64 nSize2)
+{
+    return (quint32)X_crc32_combine(nCRC1, nCRC2, nSize2);
+}
+
+#ifdef ALGO_UTILS_X86
+static void algo_utils_cpuid(quint32 nLeaf, quint32 nSubLeaf, quint32 *pRegs)
+{
+#ifdef _MSC_VER
+    int aInfo[4] = {};
+    __cpuidex(aInfo, (int)nLeaf, (int)nSubLeaf);
+
+    for (qint32 i = 0; i < 4; i++) {
+        pRegs[i] = (quint32)aInfo[i];
+    }
+#else
+    unsigned int nEAX = 0, nEBX = 0, nECX = 0, nEDX = 0;
+
+    if (__get_cpuid_max(0, nullptr) >= nLeaf) {
+        __cpuid_count(nLeaf, nSubLeaf, nEAX, nEBX, nECX, nEDX);
+    }
+
+    pRegs[0] = nEAX;
+    pRegs[1] = nEBX;
+    pRegs[2] = nECX;
+    pRegs[3] = nEDX;
+#endif
+}
+
+static quint32 algo_utils_getCPUFeatures()
+{
+    quint32 aLeaf1[4] = {};
+    quint32 aLeaf7[4] = {};
+    algo_utils_cpuid(1, 0, aLeaf1);
+    algo_utils_cpuid(7, 0, aLeaf7);
+
+    quint32 nResult = 0;
+
+    if (aLeaf1[2] & (1 << 9)) {
+        nResult |= Algo_utils::CPU_FEATURE_SSSE3;
+    }
+
+    if (aLeaf1[2] & (1 << 19)) {
+        nResult |= Algo_utils::CPU_FEATURE_SSE41;
+    }
+
+    if (aLeaf1[2] & (1 << 25)) {
+        nResult |= Algo_utils::CPU_FEATURE_AES;
+    }
+
+    if (aLeaf7[1] & (1 << 29)) {
+        nResult |= Algo_utils::CPU_FEATURE_SHA;
+    }
+
+    bool bOSXSAVE = (aLeaf1[2] & (1 << 27)) != 0;
+    bool bAVX = (aLeaf1[2] & (1 << 28)) != 0;
+    bool bAVX2 = (aLeaf7[1] & (1 << 5)) != 0;
+
+    if (bOSXSAVE && bAVX && bAVX2) {
+        // The OS has to save the YMM registers on context switches
+#ifdef _MSC_VER
+        quint64 nXCR0 = _xgetbv(0);
+#else
+        quint32 nLow = 0, nHigh = 0;
+        __asm__ volatile("xgetbv" : "=a"(nLow), "=d"(nHigh) : "c"(0));
+        quint64 nXCR0 = ((quint64)nHigh << 32) | nLow;
+#endif
+        if ((nXCR0 & 6) == 6) {
+            nResult |= Algo_utils::CPU_FEATURE_AVX2;
+        }
+    }
+
+    return nResult;
+}
+#endif
+
+bool Algo_utils::isCPUFeatureSupported(quint32 nFeatures)
+{
+#ifdef ALGO_UTILS_X86
+    static const quint32 nCPUFeatures = algo_utils_getCPUFeatures();
+
+    return (nCPUFeatures & g_nCPUFeatureMask & nFeatures) == nFeatures;
+#else
+    Q_UNUSED(nFeatures)
+
+    return false;
+#endif
+}
+
+void Algo_utils::setCPUFeatureMask(quint32 nMask)
+{
+    g_nCPUFeatureMask = nMask;
+}
+
+bool Algo_utils::isDeflateParallel(qint64 nInputSize, int nWindowBits)
+{
+    // Raw, zlib and gzip streams; the wrappers are written around the joined raw stream. A window of
+    // 8 is left to the serial path: zlib rejects it for raw blocks and silently widens it to 9 for zlib
+    bool bWindowBits = ((nWindowBits >= -15) && (nWindowBits <= -9)) || ((nWindowBits >= 9) && (nWindowBits <= 15)) || ((nWindowBits >= 25) && (nWindowBits <= 31));
+
+    return bWindowBits && (nInputSize >= N_ALGO_UTILS_DEFLATE_PARALLEL_MIN_SIZE) && (QThread::idealThreadCount() > 1);
+}
+
+bool Algo_utils::compressDeflateParallel(XBinary::DATAPROCESS_STATE *pCompressState, XBinary::PDSTRUCT *pPdStruct, int nCompressionLevel, int nWindowBits,
+                                         int nMemLevel, int nStrategy)
+{
+    bool bResult = false;
+
+    if (pCompressState && pCompressState->pDeviceInput && pCompressState->pDeviceOutput && (pCompressState->nInputLimit > 0)) {
+        // The output is written from its current position
+        pCompressState->bReadError = false;
+        pCompressState->bWriteError = false;
+        pCompressState->nCountInput = 0;
+        pCompressState->nCountOutput = 0;
+
+        int nRawWindowBits = nWindowBits;
+        DEFLATE_CHECK check = DEFLATE_CHECK_NONE;
+        QByteArray baHeader;
+
+        if (nWindowBits > 15) {
+            // gzip member without name and time
+            nRawWindowBits = -(nWindowBits - 16);
+            check = DEFLATE_CHECK_CRC32;
+
+            char nXFL = (nCompressionLevel == 9) ? 2 : ((nCompressionLevel == 1) ? 4 : 0);
+
+            baHeader = QByteArray("\x1f\x8b\x08\x00\x00\x00\x00\x00", 8);
+            baHeader.append(nXFL);
+            baHeader.append((char)0xFF);  // Unknown OS
+        } else if (nWindowBits > 0) {
+            nRawWindowBits = -nWindowBits;
+            check = DEFLATE_CHECK_ADLER32;
+
+            // FLEVEL as deflate() sets it; the default level is 6
+            quint32 nLevelFlags = 2;
+
+            if ((nStrategy >= Z_HUFFMAN_ONLY) || ((nCompressionLevel >= 0) && (nCompressionLevel < 2))) {
+                nLevelFlags = 0;
+            } else if ((nCompressionLevel >= 2) && (nCompressionLevel < 6)) {
+                nLevelFlags = 1;
+            } else if (nCompressionLevel > 6) {
+                nLevelFlags = 3;
+            }
+
+            quint32 nHeader = (((quint32)(Z_DEFLATED + ((nWindowBits - 8) << 4))) << 8) | (nLevelFlags << 6);
+            nHeader += 31 - (nHeader % 31);
+
+            baHeader.append((char)(nHeader >> 8));
+            baHeader.append((char)(nHeader & 0xFF));
+        }
+
+        if (pCompressState->pDeviceOutput->write(baHeader) == baHeader.size()) {
+            pCompressState->nCountOutput += baHeader.size();
+        } else {
+            pCompressState->bWriteError = true;
+        }
+
+        MAPPED_INPUT mappedInput = {};
+
+        if (!mapInput(pCompressState, &mappedInput)) {
+            pCompressState->pDeviceInput->seek(pCompressState->nInputOffset);
+        }
+
+        QThreadPool threadPool;
+        threadPool.setMaxThreadCount(QThread::idealThreadCount());
+
+        qint32 nBatchSize = 2 * threadPool.maxThreadCount();
+        qint64 nInputSize = pCompressState->nInputLimit;
+        qint64 nOffset = 0;
+        quint32 nCheck = (check == DEFLATE_CHECK_ADLER32) ? 1 : 0;
+        QByteArray baDictionary;
+        bool bBlockError = false;  // zlib failed on a block; neither device is at fault
+
+        while ((nOffset < nInputSize) && (!pCompressState->bReadError) && (!pCompressState->bWriteError) && (!bBlockError) &&
+               XBinary::isPdStructNotCanceled(pPdStruct)) {
+            // 1. Cut a batch of blocks; each is primed with the 32 KiB of input before it
+            QList<DeflateBlockRunnable *> listTasks;
+
+            while ((listTasks.count() < nBatchSize) && (nOffset < nInputSize)) {
+                qint32 nBlockSize = (qint32)(std::min)((qint64)N_ALGO_UTILS_DEFLATE_BLOCK_SIZE, nInputSize - nOffset);
+                QByteArray baBlock;
+
+                if (mappedInput.pMemory) {
+                    baBlock = QByteArray::fromRawData((const char *)mappedInput.pMemory + nOffset, nBlockSize);
+                } else {
+                    baBlock = pCompressState->pDeviceInput->read(nBlockSize);
+
+                    if (baBlock.size() != nBlockSize) {
+                        pCompressState->bReadError = true;
+                        break;
+                    }
+                }
+
+                bool bLast = ((nOffset + nBlockSize) == nInputSize);
+
+                listTasks.append(
+                    new DeflateBlockRunnable(baBlock, baDictionary, bLast, nCompressionLevel, nRawWindowBits, nMemLevel, nStrategy, check));
+
+                baDictionary = baBlock.right(N_ALGO_UTILS_DEFLATE_DICTIONARY_SIZE);
+                nOffset += nBlockSize;
+            }
+
+            if (!pCompressState->bReadError) {
+                for (qint32 i = 0; i < listTasks.count(); i++) {
+                    threadPool.start(listTasks.at(i));
+                }
+
+                threadPool.waitForDone();
+
+                // 2. Join in input order: sync flushes leave every block byte aligned
+                for (qint32 i = 0; (i < listTasks.count()) && (!pCompressState->bWriteError); i++) {
+                    DeflateBlockRunnable *pTask = listTasks.at(i);
+                    const QByteArray &baOutput = pTask->getOutput();
+
+                    if (!pTask->isSuccess()) {
+                        bBlockError = true;
+                        break;
+                    }
+
+                    if (pCompressState->pDeviceOutput->write(baOutput) != baOutput.size()) {
+                        pCompressState->bWriteError = true;
+                        break;
+                    }
+
+                    if (check == DEFLATE_CHECK_ADLER32) {
+                        nCheck = (quint32)X_adler32_combine(nCheck, pTask->getCheck(), pTask->getInputSize());
+                    } else if (check == DEFLATE_CHECK_CRC32) {
+                        nCheck = (quint32)X_crc32_combine(nCheck, pTask->getCheck(), pTask->getInputSize());
+                    }
+
+                    pCompressState->nCountInput += pTask->getInputSize();
+                    pCompressState->nCountOutput += baOutput.size();
+                }
+            }
+
+            qDeleteAll(listTasks);
+        }
+
+        if (mappedInput.pMemory) {
+            // Leave the file position where a buffered read would
+            mappedInput.pFile->seek(pCompressState->nInputOffset + pCompressState->nCountInput);
+            unmapInput(&mappedInput);
+        }
+
+        bool bComplete = (!pCompressState->bReadError) && (!pCompressState->bWriteError) && (!bBlockError) && (pCompressState->nCountInput == nInputSize) &&
+                         XBinary::isPdStructNotCanceled(pPdStruct);
+
+        if (bComplete) {
+            QByteArray baTrailer;
+
+            if (check == DEFLATE_CHECK_CRC32) {
+                baTrailer.resize(8);
+                qToLittleEndian<quint32>(nCheck, baTrailer.data());
+                qToLittleEndian<quint32>((quint32)nInputSize, baTrailer.data() + 4);
+            } else if (check == DEFLATE_CHECK_ADLER32) {
+                baTrailer.resize(4);
+                qToBigEndian<quint32>(nCheck, baTrailer.data());
+            }
+
+            if (pCompressState->pDeviceOutput->write(baTrailer) == baTrailer.size()) {
+                pCompressState->nCountOutput += baTrailer.size();
+                bResult = true;
+            } else {
+                pCompressState->bWriteError = true;
+            }
+        }
+    }
+
+    return bResult;
+}
+
 bool Algo_utils::getUclMethodFromState(const XBinary::DATAPROCESS_STATE *pDecompressState, XUCLDecoder::METHOD *pMethod)
 {
     QVariant vMethod = pDecompressState->mapProperties.value(XBinary::FPART_PROP_TYPE);
@@ -26,6 +26,7 @@
 #include "xbinary.h"
 
 #include <QIODevice>
+#include <QFileDevice>
 #include <QByteArray>
 
 class Algo_utils {
@@ -42,6 +43,19 @@ public:
     static void prepareState(XBinary::DATAPROCESS_STATE *pState);
     static qint32 getReadChunkSize(const XBinary::DATAPROCESS_STATE *pState, qint32 nBufferSize);
 
+    // Read-only mapping of the input range, set when the input is a random-access file
+    struct MAPPED_INPUT {
+        QFileDevice *pFile;
+        uchar *pMemory;
+        qint64 nOffset;  // File offset of pMemory
+        qint64 nSize;
+    };
+
+    static bool mapInput(XBinary::DATAPROCESS_STATE *pState, MAPPED_INPUT *pMappedInput);
+    static void unmapInput(MAPPED_INPUT *pMappedInput);
+    // Like XBinary::_readDevice(), but returns a span of the mapping instead of copying into pBuffer
+    static const char *readSpan(XBinary::DATAPROCESS_STATE *pState, const MAPPED_INPUT *pMappedInput, char *pBuffer, qint32 nMaxSize, qint32 *pnSize);
+
     static int ascii85ReadByte(XBinary::DATAPROCESS_STATE *pState);
     static void ascii85WriteBytes(XBinary::DATAPROCESS_STATE *pState, const unsigned char *pBuffer, int nSize);
 
@@ -56,7 +70,32 @@ public:
 
     static unsigned deflate64ReadFunc(void *pInDesc, unsigned char **ppBuffer);
     static int deflate64WriteFunc(void *pOutDesc, unsigned char *pBuffer, unsigned nSize);
-    static bool compressDeflate(XBinary::DATAPROCESS_STATE *pCompressState, XBinary::PDSTRUCT *pPdStruct, int nCompressionLevel, int nWindowBits);
+    // bParallel allows compressDeflateParallel for large inputs; callers already running on a pool thread leave it off
+    static bool compressDeflate(XBinary::DATAPROCESS_STATE *pCompressState, XBinary::PDSTRUCT *pPdStruct, int nCompressionLevel, int nWindowBits,
+                                bool bParallel = false);
+    // pigz-style: 128 KiB blocks deflated concurrently, each primed with the previous 32 KiB and
+    // joined by sync flushes into one standard stream; the zlib/gzip check is combined per block
+    static bool isDeflateParallel(qint64 nInputSize, int nWindowBits);
+    static bool compressDeflateParallel(XBinary::DATAPROCESS_STATE *pCompressState, XBinary::PDSTRUCT *pPdStruct, int nCompressionLevel, int nWindowBits,
+                                        int nMemLevel = 8, int nStrategy = Z_DEFAULT_STRATEGY);
+
+    // CRC-32 (EDB88320) of the concatenation A+B from crc(A), crc(B) and the size of B
+    static quint32 combineCRC32(quint32 nCRC1, quint32 nCRC2, qint64 nSize2);
+
+    enum CPU_FEATURE {
+        CPU_FEATURE_SSSE3 = 0x01,
+        CPU_FEATURE_SSE41 = 0x02,
+        CPU_FEATURE_AES = 0x04,
+        CPU_FEATURE_SHA = 0x08,
+        CPU_FEATURE_AVX2 = 0x10  // Only set when the OS also saves the YMM registers
+    };
+
+    // True when every CPU_FEATURE in nFeatures is present. The x86-64 CPUID/XGETBV probe runs once
+    // per process; other targets report no features
+    static bool isCPUFeatureSupported(quint32 nFeatures);
+    // Hides the features outside nMask from isCPUFeatureSupported, so the scalar fallbacks can be
+    // measured on the same machine; set it before any hashing or decoding starts
+    static void setCPUFeatureMask(quint32 nMask);
 
     static bool getUclMethodFromState(const XBinary::DATAPROCESS_STATE *pDecompressState, XUCLDecoder::METHOD *pMethod);
     static bool readInputData(XBinary::DATAPROCESS_STATE *pDecompressState, QByteArray *pbaInput, XBinary::PDSTRUCT *pPdStruct);
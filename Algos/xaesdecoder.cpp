@@ -23,13 +23,119 @@
 #include <QBuffer>
 #include <QCryptographicHash>
 #include <QDebug>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QRandomGenerator>
 #include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define XAES_AESNI
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define XAES_TARGET_AESNI
+#else
+#define XAES_TARGET_AESNI __attribute__((target("aes,sse2")))
+#endif
+#endif
+
+namespace {
+
+// Process-wide cache of KDF results. The folders and records of one encrypted archive normally share
+// the password and often the salt, so the expensive derivation only has to run once.
+enum KEYCACHE_METHOD {
+    KEYCACHE_METHOD_7Z = 1,
+    KEYCACHE_METHOD_ZIPAES,
+    KEYCACHE_METHOD_RAR5
+};
+
+const qint32 N_KEYCACHE_MAX_RECORDS = 64;
+
+struct KEYCACHE_RECORD {
+    QByteArray baId;
+    QByteArray baKeys;
+};
+
+QMutex g_keyCacheMutex;
+QList<KEYCACHE_RECORD> g_listKeyCache;  // Most recently used first
+
+// The password only enters the id as a SHA-256 digest
+QByteArray keyCacheId(KEYCACHE_METHOD method, const QByteArray &baPassword, const QByteArray &baSalt, quint32 nCost)
+{
+    QByteArray baResult(5 + 32, 0);
+    baResult[0] = (char)method;
+    baResult[1] = (char)(nCost & 0xFF);
+    baResult[2] = (char)((nCost >> 8) & 0xFF);
+    baResult[3] = (char)((nCost >> 16) & 0xFF);
+    baResult[4] = (char)((nCost >> 24) & 0xFF);
+
+    XSha256Decoder::Context sha;
+    XSha256Decoder::init(&sha);
+    XSha256Decoder::update(&sha, reinterpret_cast<const quint8 *>(baPassword.constData()), baPassword.size());
+    XSha256Decoder::final(&sha, reinterpret_cast<quint8 *>(baResult.data()) + 5);
+
+    baResult.append(baSalt);
+
+    return baResult;
+}
+
+bool keyCacheFind(const QByteArray &baId, quint8 *pKeys, qint32 nSize)
+{
+    QMutexLocker locker(&g_keyCacheMutex);
+
+    for (qint32 i = 0; i < g_listKeyCache.count(); i++) {
+        if (g_listKeyCache.at(i).baId == baId) {
+            if (g_listKeyCache.at(i).baKeys.size() != nSize) {
+                return false;
+            }
+
+            memcpy(pKeys, g_listKeyCache.at(i).baKeys.constData(), nSize);
+
+            if (i) {
+                g_listKeyCache.move(i, 0);
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void keyCacheInsert(const QByteArray &baId, const quint8 *pKeys, qint32 nSize)
+{
+    QMutexLocker locker(&g_keyCacheMutex);
+
+    KEYCACHE_RECORD record = {};
+    record.baId = baId;
+    record.baKeys = QByteArray(reinterpret_cast<const char *>(pKeys), nSize);
+
+    g_listKeyCache.prepend(record);
+
+    while (g_listKeyCache.count() > N_KEYCACHE_MAX_RECORDS) {
+        g_listKeyCache.last().baKeys.fill('\0');
+        g_listKeyCache.removeLast();
+    }
+}
+
+}  // namespace
 
 XAESDecoder::XAESDecoder(QObject *parent) : QObject(parent)
 {
 }
 
+void XAESDecoder::clearKeyCache()
+{
+    QMutexLocker locker(&g_keyCacheMutex);
+
+    for (qint32 i = 0; i < g_listKeyCache.count(); i++) {
+        g_listKeyCache[i].baKeys.fill('\0');
+    }
+
+    g_listKeyCache.clear();
+}
+
 void XAESDecoder::deriveKey(const QString &sPassword, const QByteArray &baSalt, quint8 nNumCyclesPower, quint8 *pKey)
 {
     // Note: tiny-AES-c does not require table initialization
@@ -43,6 +149,12 @@ void XAESDecoder::deriveKey(const QString &sPassword, const QByteArray &baSalt,
         baPassword.append(static_cast<char>((ch >> 8) & 0xFF));
     }
 
+    QByteArray baCacheId = keyCacheId(KEYCACHE_METHOD_7Z, baPassword, baSalt, nNumCyclesPower);
+
+    if (keyCacheFind(baCacheId, pKey, 32)) {
+        return;
+    }
+
     // Note: Test code removed to reduce debug output
     // AES-256-CBC and SHA256 implementations verified correct with NIST test vectors
 
@@ -82,6 +194,8 @@ void XAESDecoder::deriveKey(const QString &sPassword, const QByteArray &baSalt,
 
     // Finalize and get the key
     XSha256Decoder::final(&sha, pKey);
+
+    keyCacheInsert(baCacheId, pKey, 32);
 }
 
 bool XAESDecoder::decrypt(XBinary::DATAPROCESS_STATE *pDecryptState, const QByteArray &baProperties, const QString &sPassword, XBinary::PDSTRUCT *pPdStruct)
@@ -353,7 +467,7 @@ bool XAESDecoder::decrypt(XBinary::DATAPROCESS_STATE *pDecompressState, const QB
         QByteArray baAESKey;
         QByteArray baHMACKey;
         QByteArray baPasswordVerifyKey;
-        if (!deriveKeys(baPassword, baSalt, nKeySize, baAESKey, baPasswordVerifyKey, baHMACKey, pPdStruct)) {
+        if (!deriveKeys(baPassword, baSalt, nKeySize, baAESKey, baPasswordVerifyKey, baHMACKey, true, pPdStruct)) {
             return false;
         }
 
@@ -465,20 +579,37 @@ void XAESDecoder::pbkdf2(const QByteArray &baPassword, const QByteArray &baSalt,
 }
 
 bool XAESDecoder::deriveKeys(const QByteArray &baPassword, const QByteArray &baSalt, qint32 nKeySize, QByteArray &baAESKey, QByteArray &baPasswordVerify,
-                            QByteArray &baHMACKey, XBinary::PDSTRUCT *pPdStruct)
+                            QByteArray &baHMACKey, bool bUseCache, XBinary::PDSTRUCT *pPdStruct)
 {
     Q_UNUSED(pPdStruct)
 
     qint32 nPasswordVerifyAlignedSize = (N_PASSWORD_VERIFY_SIZE + 3) & ~3;
     qint32 nTotalKeySize = 2 * nKeySize + nPasswordVerifyAlignedSize;
-
-    QByteArray baDerivedKeys;
-    pbkdf2(baPassword, baSalt, N_PBKDF2_ITERATIONS, nTotalKeySize, baDerivedKeys);
-
-    if (baDerivedKeys.size() != nTotalKeySize) {
-        return false;
-    }
-
+
+    QByteArray baCacheId;
+    QByteArray baDerivedKeys;
+
+    if (bUseCache) {
+        baCacheId = keyCacheId(KEYCACHE_METHOD_ZIPAES, baPassword, baSalt, nKeySize);
+        baDerivedKeys.resize(nTotalKeySize);
+
+        if (!keyCacheFind(baCacheId, reinterpret_cast<quint8 *>(baDerivedKeys.data()), nTotalKeySize)) {
+            baDerivedKeys.clear();
+        }
+    }
+
+    if (baDerivedKeys.isEmpty()) {
+        pbkdf2(baPassword, baSalt, N_PBKDF2_ITERATIONS, nTotalKeySize, baDerivedKeys);
+
+        if (baDerivedKeys.size() != nTotalKeySize) {
+            return false;
+        }
+
+        if (bUseCache) {
+            keyCacheInsert(baCacheId, reinterpret_cast<const quint8 *>(baDerivedKeys.constData()), nTotalKeySize);
+        }
+    }
+
     const qint32 nPasswordVerifyOffset = 2 * nKeySize;
 
     baAESKey = baDerivedKeys.left(nKeySize);
@@ -756,6 +887,105 @@ static void custom_aes_decrypt_block(const quint8 *pInput, quint8 *pOutput, cons
     }
 }
 
+//------------------------------------------------------------------------------
+// AES-NI backend (x86-64, selected at runtime)
+//------------------------------------------------------------------------------
+
+#ifdef XAES_AESNI
+static const qint32 N_AESNI_LANES = 8;            // Independent blocks kept in flight to hide the aesenc/aesdec latency
+static const qint64 N_AESNI_CTR_CHUNK = 0x10000;  // CTR bytes processed between cancel checks
+
+// The round keys of CUSTOM_AES_KEY are stored in byte order, so they load directly as AES-NI round keys
+static XAES_TARGET_AESNI void aesni_decryptCBC(const CUSTOM_AES_KEY *pKey, const quint8 *pIV, const quint8 *pInput, quint8 *pOutput, qint64 nBlocks)
+{
+    const qint32 nRounds = pKey->rounds;
+    __m128i aKeys[15];
+
+    // Equivalent inverse cipher: reversed schedule with InvMixColumns applied to the inner round keys
+    aKeys[0] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pKey->rd_key + 4 * nRounds));
+
+    for (qint32 i = 1; i < nRounds; i++) {
+        aKeys[i] = _mm_aesimc_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pKey->rd_key + 4 * (nRounds - i))));
+    }
+
+    aKeys[nRounds] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pKey->rd_key));
+
+    __m128i prev = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pIV));
+
+    for (qint64 nBlock = 0; nBlock < nBlocks; nBlock += N_AESNI_LANES) {
+        qint32 nLanes = (qint32)qMin((qint64)N_AESNI_LANES, nBlocks - nBlock);
+        __m128i aInput[N_AESNI_LANES];
+        __m128i aState[N_AESNI_LANES];
+
+        // All input blocks are loaded first, so decrypting in place is safe
+        for (qint32 j = 0; j < nLanes; j++) {
+            aInput[j] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pInput + (nBlock + j) * AES_BLOCK_SIZE));
+            aState[j] = _mm_xor_si128(aInput[j], aKeys[0]);
+        }
+
+        for (qint32 i = 1; i < nRounds; i++) {
+            for (qint32 j = 0; j < nLanes; j++) {
+                aState[j] = _mm_aesdec_si128(aState[j], aKeys[i]);
+            }
+        }
+
+        for (qint32 j = 0; j < nLanes; j++) {
+            aState[j] = _mm_aesdeclast_si128(aState[j], aKeys[nRounds]);
+            aState[j] = _mm_xor_si128(aState[j], j ? aInput[j - 1] : prev);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(pOutput + (nBlock + j) * AES_BLOCK_SIZE), aState[j]);
+        }
+
+        prev = aInput[nLanes - 1];
+    }
+}
+
+// ZIP AES counter mode: the first 8 bytes of pCounter are a little-endian block counter, advanced by nBlocks
+static XAES_TARGET_AESNI void aesni_cryptCTR(const CUSTOM_AES_KEY *pKey, quint8 *pCounter, const quint8 *pInput, quint8 *pOutput, qint64 nBlocks)
+{
+    const qint32 nRounds = pKey->rounds;
+    __m128i aKeys[15];
+
+    for (qint32 i = 0; i <= nRounds; i++) {
+        aKeys[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pKey->rd_key + 4 * i));
+    }
+
+    quint64 nCounter = 0;
+    quint64 nCounterHigh = 0;
+
+    for (qint32 i = 0; i < 8; i++) {
+        nCounter |= (quint64)pCounter[i] << (8 * i);
+        nCounterHigh |= (quint64)pCounter[8 + i] << (8 * i);
+    }
+
+    for (qint64 nBlock = 0; nBlock < nBlocks; nBlock += N_AESNI_LANES) {
+        qint32 nLanes = (qint32)qMin((qint64)N_AESNI_LANES, nBlocks - nBlock);
+        __m128i aState[N_AESNI_LANES];
+
+        for (qint32 j = 0; j < nLanes; j++) {
+            aState[j] = _mm_set_epi64x((long long)nCounterHigh, (long long)(nCounter++));
+            aState[j] = _mm_xor_si128(aState[j], aKeys[0]);
+        }
+
+        for (qint32 i = 1; i < nRounds; i++) {
+            for (qint32 j = 0; j < nLanes; j++) {
+                aState[j] = _mm_aesenc_si128(aState[j], aKeys[i]);
+            }
+        }
+
+        for (qint32 j = 0; j < nLanes; j++) {
+            const quint8 *pBlockInput = pInput + (nBlock + j) * AES_BLOCK_SIZE;
+            aState[j] = _mm_aesenclast_si128(aState[j], aKeys[nRounds]);
+            aState[j] = _mm_xor_si128(aState[j], _mm_loadu_si128(reinterpret_cast<const __m128i *>(pBlockInput)));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(pOutput + (nBlock + j) * AES_BLOCK_SIZE), aState[j]);
+        }
+    }
+
+    for (qint32 i = 0; i < 8; i++) {
+        pCounter[i] = (quint8)(nCounter >> (8 * i));
+    }
+}
+#endif
+
 bool XAESDecoder::decryptAESCBC(const QByteArray &baKey, const QByteArray &baIV, const quint8 *pInputData, quint8 *pOutputData, qint64 nSize)
 {
     if (!pInputData || !pOutputData || nSize <= 0 || (nSize % N_AES_BLOCK_SIZE) != 0) {
@@ -770,6 +1000,13 @@ bool XAESDecoder::decryptAESCBC(const QByteArray &baKey, const QByteArray &baIV,
         return false;
     }
 
+#ifdef XAES_AESNI
+    if (Algo_utils::isCPUFeatureSupported(Algo_utils::CPU_FEATURE_AES)) {
+        aesni_decryptCBC(&customKey, reinterpret_cast<const quint8 *>(baIV.constData()), pInputData, pOutputData, nSize / N_AES_BLOCK_SIZE);
+        return true;
+    }
+#endif
+
     quint8 prevBlock[N_AES_BLOCK_SIZE];
     memcpy(prevBlock, baIV.constData(), N_AES_BLOCK_SIZE);
 
@@ -807,8 +1044,20 @@ bool XAESDecoder::decryptAESCTR(const QByteArray &baKey, const QByteArray &baNon
 
     qint64 nOffset = 0;
     unsigned char encryptedCounter[N_AES_BLOCK_SIZE];
+#ifdef XAES_AESNI
+    bool bAESNI = Algo_utils::isCPUFeatureSupported(Algo_utils::CPU_FEATURE_AES);
+#endif
 
     while ((nOffset < nSize) && XBinary::isPdStructNotCanceled(pPdStruct)) {
+#ifdef XAES_AESNI
+        if (bAESNI && ((nSize - nOffset) >= N_AES_BLOCK_SIZE)) {
+            qint64 nChunkSize = qMin(N_AESNI_CTR_CHUNK, nSize - nOffset) & ~((qint64)N_AES_BLOCK_SIZE - 1);
+            aesni_cryptCTR(&customKey, counter, reinterpret_cast<const quint8 *>(pInputData + nOffset), reinterpret_cast<quint8 *>(pOutputData + nOffset),
+                           nChunkSize / N_AES_BLOCK_SIZE);
+            nOffset += nChunkSize;
+            continue;
+        }
+#endif
         custom_aes_encrypt(counter, encryptedCounter, &customKey);
 
         qint64 nBlockSize = qMin((qint64)N_AES_BLOCK_SIZE, nSize - nOffset);
@@ -848,8 +1097,20 @@ bool XAESDecoder::encryptAESCTR(const QByteArray &baKey, const QByteArray &baNon
 
     qint64 nOffset = 0;
     unsigned char encryptedCounter[N_AES_BLOCK_SIZE];
+#ifdef XAES_AESNI
+    bool bAESNI = Algo_utils::isCPUFeatureSupported(Algo_utils::CPU_FEATURE_AES);
+#endif
 
     while ((nOffset < nSize) && XBinary::isPdStructNotCanceled(pPdStruct)) {
+#ifdef XAES_AESNI
+        if (bAESNI && ((nSize - nOffset) >= N_AES_BLOCK_SIZE)) {
+            qint64 nChunkSize = qMin(N_AESNI_CTR_CHUNK, nSize - nOffset) & ~((qint64)N_AES_BLOCK_SIZE - 1);
+            aesni_cryptCTR(&customKey, counter, reinterpret_cast<const quint8 *>(pInputData + nOffset), reinterpret_cast<quint8 *>(pOutputData + nOffset),
+                           nChunkSize / N_AES_BLOCK_SIZE);
+            nOffset += nChunkSize;
+            continue;
+        }
+#endif
         custom_aes_encrypt(counter, encryptedCounter, &customKey);
 
         qint64 nBlockSize = qMin((qint64)N_AES_BLOCK_SIZE, nSize - nOffset);
@@ -926,7 +1187,8 @@ bool XAESDecoder::encrypt(XBinary::DATAPROCESS_STATE *pCompressState, const QByt
             baPasswordVerify.fill('\0');
         };
 
-        if (!deriveKeys(baPassword, baSalt, nKeySize, baAESKey, baPasswordVerify, baHMACKey, pPdStruct)) {
+        // Salts are fresh for every encrypted entry, caching them would only evict useful keys
+        if (!deriveKeys(baPassword, baSalt, nKeySize, baAESKey, baPasswordVerify, baHMACKey, false, pPdStruct)) {
             clearZipKeys();
             return false;
         }
@@ -1035,6 +1297,18 @@ void XAESDecoder::hmacSha256Final(XSha256Decoder::Context *pInnerCtx, XSha256Dec
 // Follows the RAR5 spec: 2^nCnt main iterations, then 16 extra per additional key
 void XAESDecoder::deriveRar5Keys(const QByteArray &baPassword, const quint8 *pSalt, quint8 nCnt, quint8 *pAesKey, quint8 *pHashKey, quint8 *pPswCheck)
 {
+    // Archive headers and every file record usually share the password, salt and count
+    QByteArray baCacheId = keyCacheId(KEYCACHE_METHOD_RAR5, baPassword, QByteArray(reinterpret_cast<const char *>(pSalt), 16), nCnt);
+    quint8 aKeys[96];
+
+    if (keyCacheFind(baCacheId, aKeys, sizeof(aKeys))) {
+        memcpy(pAesKey, aKeys, 32);
+        memcpy(pHashKey, aKeys + 32, 32);
+        memcpy(pPswCheck, aKeys + 64, 32);
+        memset(aKeys, 0, sizeof(aKeys));
+        return;
+    }
+
     // Set up base HMAC context with password as key
     XSha256Decoder::Context baseInner, baseOuter;
     hmacSha256SetKey(&baseInner, &baseOuter, reinterpret_cast<const quint8 *>(baPassword.constData()), baPassword.size());
@@ -1085,6 +1359,12 @@ void XAESDecoder::deriveRar5Keys(const QByteArray &baPassword, const quint8 *pSa
 
     memset(aU, 0, 32);
     memset(aKey, 0, 32);
+
+    memcpy(aKeys, pAesKey, 32);
+    memcpy(aKeys + 32, pHashKey, 32);
+    memcpy(aKeys + 64, pPswCheck, 32);
+    keyCacheInsert(baCacheId, aKeys, sizeof(aKeys));
+    memset(aKeys, 0, sizeof(aKeys));
 }
 
 QByteArray XAESDecoder::deriveRar5HeaderKey(const QString &sPassword, const QByteArray &baSalt, quint8 nKdfCount)
@@ -64,6 +64,9 @@ public:
     // RAR5 header key derivation (returns 32-byte AES key for encrypted-headers archives)
     static QByteArray deriveRar5HeaderKey(const QString &sPassword, const QByteArray &baSalt, quint8 nKdfCount);
 
+    // Wipes the process-wide cache of derived keys, e.g. when the application forgets its passwords
+    static void clearKeyCache();
+
     // Custom AES block cipher
     static qint32 custom_aes_set_encrypt_key(const quint8 *pUserKey, qint32 nBits, CUSTOM_AES_KEY *pKey);
     static void custom_aes_encrypt(const quint8 *pInput, quint8 *pOutput, const CUSTOM_AES_KEY *pKey);
@@ -75,7 +78,7 @@ private:
     // ZIP key derivation helpers (PBKDF2-HMAC-SHA1)
     static void pbkdf2(const QByteArray &baPassword, const QByteArray &baSalt, qint32 nIterations, qint32 nKeyLength, QByteArray &baResult);
     static bool deriveKeys(const QByteArray &baPassword, const QByteArray &baSalt, qint32 nKeySize, QByteArray &baAESKey, QByteArray &baPasswordVerify,
-                           QByteArray &baHMACKey, XBinary::PDSTRUCT *pPdStruct);
+                           QByteArray &baHMACKey, bool bUseCache, XBinary::PDSTRUCT *pPdStruct);
     static bool decryptAESCTR(const QByteArray &baKey, const QByteArray &baNonce, const char *pInputData, char *pOutputData, qint64 nSize, XBinary::PDSTRUCT *pPdStruct);
     static bool encryptAESCTR(const QByteArray &baKey, const QByteArray &baNonce, const char *pInputData, char *pOutputData, qint64 nSize, XBinary::PDSTRUCT *pPdStruct);
 
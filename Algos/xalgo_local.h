@@ -4921,9 +4921,17 @@ int X_Ppmd8g_DecodeSymbol(CPpmd8 *p);
 int z_deflateInit2_(z_streamp strm, int level, int method, int windowBits, int memLevel, int strategy, const char *version, int stream_size);
 int z_deflate(z_streamp strm, int flush);
 int z_deflateEnd(z_streamp strm);
+int z_deflateSetDictionary(z_streamp strm, const Bytef *dictionary, uInt dictLength);
+uLong z_adler32(uLong adler, const Bytef *buf, uInt len);
+uLong z_adler32_combine64(uLong adler1, uLong adler2, z_off64_t len2);
+uLong z_crc32(uLong crc, const Bytef *buf, uInt len);
+uLong z_crc32_combine64(uLong crc1, uLong crc2, z_off64_t len2);
 int z_inflateInit2_(z_streamp strm, int windowBits, const char *version, int stream_size);
 int z_inflate(z_streamp strm, int flush);
 int z_inflateEnd(z_streamp strm);
+int z_inflatePrime(z_streamp strm, int bits, int value);
+int z_inflateReset(z_streamp strm);
+int z_inflateSetDictionary(z_streamp strm, const Bytef *dictionary, uInt dictLength);
 
 #ifdef __cplusplus
 }
@@ -4937,9 +4945,17 @@ int z_inflateEnd(z_streamp strm);
     z_deflateInit2_((strm), (level), (method), (windowBits), (memLevel), (strategy), ZLIB_VERSION, (int)sizeof(z_stream))
 #define X_deflate z_deflate
 #define X_deflateEnd z_deflateEnd
+#define X_deflateSetDictionary z_deflateSetDictionary
+#define X_adler32 z_adler32
+#define X_adler32_combine z_adler32_combine64
+#define X_crc32 z_crc32
+#define X_crc32_combine z_crc32_combine64
 
 #define X_inflateInit2(strm, windowBits) z_inflateInit2_((strm), (windowBits), ZLIB_VERSION, (int)sizeof(z_stream))
 #define X_inflate z_inflate
 #define X_inflateEnd z_inflateEnd
+#define X_inflatePrime z_inflatePrime
+#define X_inflateReset z_inflateReset
+#define X_inflateSetDictionary z_inflateSetDictionary
 
 #endif  // XALGO_LOCAL_H
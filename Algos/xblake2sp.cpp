@@ -20,10 +20,24 @@
  */
 
 #include "xblake2sp.h"
+#include "algo_utils.h"
 
 #include <algorithm>
 #include <cstring>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#define XBLAKE2SP_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define XBLAKE2SP_TARGET_SSE41
+#define XBLAKE2SP_TARGET_AVX2
+#else
+#define XBLAKE2SP_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define XBLAKE2SP_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
 // BLAKE2s IV constants (same as SHA-256 initial values)
 static const quint32 g_blake2s_IV[8] = {0x6A09E667UL, 0xBB67AE85UL, 0x3C6EF372UL, 0xA54FF53AUL, 0x510E527FUL, 0x9B05688CUL, 0x1F83D9ABUL, 0x5BE0CD19UL};
 
@@ -115,6 +129,174 @@ void XBlake2sp::_blake2sCompress(Blake2sState *pState, const quint8 *pBlock, boo
     }
 }
 
+//------------------------------------------------------------------------------
+// Lane-parallel leaf compression: vector lane j carries leaf j (x86-64, selected at runtime)
+//------------------------------------------------------------------------------
+
+#ifdef XBLAKE2SP_X86
+// G over all lanes; the VADD/VXOR/VROTR* operations are defined by each backend
+#define BLAKE2SP_VG(r, i, a, b, c, d)                                             \
+    do {                                                                          \
+        a = BLAKE2SP_VADD(BLAKE2SP_VADD(a, b), m[g_blake2s_sigma[r][2 * i + 0]]); \
+        d = BLAKE2SP_VROTR16(BLAKE2SP_VXOR(d, a));                                \
+        c = BLAKE2SP_VADD(c, d);                                                  \
+        b = BLAKE2SP_VROTR12(BLAKE2SP_VXOR(b, c));                                \
+        a = BLAKE2SP_VADD(BLAKE2SP_VADD(a, b), m[g_blake2s_sigma[r][2 * i + 1]]); \
+        d = BLAKE2SP_VROTR8(BLAKE2SP_VXOR(d, a));                                 \
+        c = BLAKE2SP_VADD(c, d);                                                  \
+        b = BLAKE2SP_VROTR7(BLAKE2SP_VXOR(b, c));                                 \
+    } while (0)
+
+#define BLAKE2SP_VROUND(r)                           \
+    do {                                             \
+        BLAKE2SP_VG(r, 0, v[0], v[4], v[8], v[12]);  \
+        BLAKE2SP_VG(r, 1, v[1], v[5], v[9], v[13]);  \
+        BLAKE2SP_VG(r, 2, v[2], v[6], v[10], v[14]); \
+        BLAKE2SP_VG(r, 3, v[3], v[7], v[11], v[15]); \
+        BLAKE2SP_VG(r, 4, v[0], v[5], v[10], v[15]); \
+        BLAKE2SP_VG(r, 5, v[1], v[6], v[11], v[12]); \
+        BLAKE2SP_VG(r, 6, v[2], v[7], v[8], v[13]);  \
+        BLAKE2SP_VG(r, 7, v[3], v[4], v[9], v[14]);  \
+    } while (0)
+
+#define BLAKE2SP_VADD(x, y) _mm256_add_epi32((x), (y))
+#define BLAKE2SP_VXOR(x, y) _mm256_xor_si256((x), (y))
+#define BLAKE2SP_VROTR16(x) _mm256_shuffle_epi8((x), rot16)
+#define BLAKE2SP_VROTR12(x) _mm256_or_si256(_mm256_srli_epi32((x), 12), _mm256_slli_epi32((x), 20))
+#define BLAKE2SP_VROTR8(x) _mm256_shuffle_epi8((x), rot8)
+#define BLAKE2SP_VROTR7(x) _mm256_or_si256(_mm256_srli_epi32((x), 7), _mm256_slli_epi32((x), 25))
+
+static XBLAKE2SP_TARGET_AVX2 void blake2sp_compressAVX2(XBlake2sp::Blake2sState *pStates, const quint8 *const *ppBlocks)
+{
+    const __m256i rot16 = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13, 2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    const __m256i rot8 = _mm256_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12, 1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+
+    __m256i m[16];
+    __m256i v[16];
+    __m256i h[8];
+    quint32 aWords[8];
+
+    for (qint32 i = 0; i < 16; i++) {
+        for (qint32 j = 0; j < 8; j++) {
+            memcpy(&aWords[j], ppBlocks[j] + i * 4, 4);  // Little-endian words, as the host
+        }
+
+        m[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(aWords));
+    }
+
+    for (qint32 i = 0; i < 8; i++) {
+        for (qint32 j = 0; j < 8; j++) {
+            aWords[j] = pStates[j].h[i];
+        }
+
+        h[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(aWords));
+        v[i] = h[i];
+    }
+
+    for (qint32 i = 0; i < 4; i++) {
+        v[8 + i] = _mm256_set1_epi32((int)g_blake2s_IV[i]);
+    }
+
+    for (qint32 i = 0; i < 4; i++) {
+        for (qint32 j = 0; j < 8; j++) {
+            aWords[j] = ((i < 2) ? pStates[j].t[i] : pStates[j].f[i - 2]) ^ g_blake2s_IV[4 + i];
+        }
+
+        v[12 + i] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(aWords));
+    }
+
+    for (qint32 r = 0; r < 10; r++) {
+        BLAKE2SP_VROUND(r);
+    }
+
+    for (qint32 i = 0; i < 8; i++) {
+        h[i] = _mm256_xor_si256(h[i], _mm256_xor_si256(v[i], v[i + 8]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(aWords), h[i]);
+
+        for (qint32 j = 0; j < 8; j++) {
+            pStates[j].h[i] = aWords[j];
+        }
+    }
+}
+
+#undef BLAKE2SP_VADD
+#undef BLAKE2SP_VXOR
+#undef BLAKE2SP_VROTR16
+#undef BLAKE2SP_VROTR12
+#undef BLAKE2SP_VROTR8
+#undef BLAKE2SP_VROTR7
+
+#define BLAKE2SP_VADD(x, y) _mm_add_epi32((x), (y))
+#define BLAKE2SP_VXOR(x, y) _mm_xor_si128((x), (y))
+#define BLAKE2SP_VROTR16(x) _mm_shuffle_epi8((x), rot16)
+#define BLAKE2SP_VROTR12(x) _mm_or_si128(_mm_srli_epi32((x), 12), _mm_slli_epi32((x), 20))
+#define BLAKE2SP_VROTR8(x) _mm_shuffle_epi8((x), rot8)
+#define BLAKE2SP_VROTR7(x) _mm_or_si128(_mm_srli_epi32((x), 7), _mm_slli_epi32((x), 25))
+
+// Four leaves per call
+static XBLAKE2SP_TARGET_SSE41 void blake2sp_compressSSE41(XBlake2sp::Blake2sState *pStates, const quint8 *const *ppBlocks)
+{
+    const __m128i rot16 = _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    const __m128i rot8 = _mm_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+
+    __m128i m[16];
+    __m128i v[16];
+    __m128i h[8];
+    quint32 aWords[4];
+
+    for (qint32 i = 0; i < 16; i++) {
+        for (qint32 j = 0; j < 4; j++) {
+            memcpy(&aWords[j], ppBlocks[j] + i * 4, 4);  // Little-endian words, as the host
+        }
+
+        m[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(aWords));
+    }
+
+    for (qint32 i = 0; i < 8; i++) {
+        for (qint32 j = 0; j < 4; j++) {
+            aWords[j] = pStates[j].h[i];
+        }
+
+        h[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(aWords));
+        v[i] = h[i];
+    }
+
+    for (qint32 i = 0; i < 4; i++) {
+        v[8 + i] = _mm_set1_epi32((int)g_blake2s_IV[i]);
+    }
+
+    for (qint32 i = 0; i < 4; i++) {
+        for (qint32 j = 0; j < 4; j++) {
+            aWords[j] = ((i < 2) ? pStates[j].t[i] : pStates[j].f[i - 2]) ^ g_blake2s_IV[4 + i];
+        }
+
+        v[12 + i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(aWords));
+    }
+
+    for (qint32 r = 0; r < 10; r++) {
+        BLAKE2SP_VROUND(r);
+    }
+
+    for (qint32 i = 0; i < 8; i++) {
+        h[i] = _mm_xor_si128(h[i], _mm_xor_si128(v[i], v[i + 8]));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(aWords), h[i]);
+
+        for (qint32 j = 0; j < 4; j++) {
+            pStates[j].h[i] = aWords[j];
+        }
+    }
+}
+
+#undef BLAKE2SP_VADD
+#undef BLAKE2SP_VXOR
+#undef BLAKE2SP_VROTR16
+#undef BLAKE2SP_VROTR12
+#undef BLAKE2SP_VROTR8
+#undef BLAKE2SP_VROTR7
+#undef BLAKE2SP_VROUND
+#undef BLAKE2SP_VG
+#endif
+
 void XBlake2sp::_blake2sInit(Blake2sState *pState, quint32 nOutLen, const quint8 *pParams)
 {
     memset(pState, 0, sizeof(Blake2sState));
@@ -184,6 +366,53 @@ void XBlake2sp::_blake2sFinal(Blake2sState *pState, quint8 *pDigest, quint32 nOu
     memcpy(pDigest, buffer, nOutLen);
 }
 
+void XBlake2sp::_compressLeaves(Blake2sState *pStates, const quint8 *const *ppBlocks)
+{
+    for (qint32 i = 0; i < PARALLEL_DEGREE; i++) {
+        pStates[i].t[0] += BLOCK_SIZE;
+        if (pStates[i].t[0] < (quint32)BLOCK_SIZE) {
+            pStates[i].t[1]++;
+        }
+    }
+
+#ifdef XBLAKE2SP_X86
+    if (Algo_utils::isCPUFeatureSupported(Algo_utils::CPU_FEATURE_AVX2)) {
+        blake2sp_compressAVX2(pStates, ppBlocks);
+        return;
+    }
+
+    if (Algo_utils::isCPUFeatureSupported(Algo_utils::CPU_FEATURE_SSE41)) {
+        blake2sp_compressSSE41(pStates, ppBlocks);
+        blake2sp_compressSSE41(pStates + 4, ppBlocks + 4);
+        return;
+    }
+#endif
+
+    for (qint32 i = 0; i < PARALLEL_DEGREE; i++) {
+        _blake2sCompress(&pStates[i], ppBlocks[i], false);
+    }
+}
+
+void XBlake2sp::_updateLeaves(const quint8 *pChunk)
+{
+    // A leaf holds back its latest block until more data arrives, as that block may be the last one.
+    // Whole chunks reach every leaf, so all of them hold a block or none does.
+    if (m_states[0].bufLen == (quint32)BLOCK_SIZE) {
+        const quint8 *apBlocks[PARALLEL_DEGREE];
+
+        for (qint32 i = 0; i < PARALLEL_DEGREE; i++) {
+            apBlocks[i] = m_states[i].buf;
+        }
+
+        _compressLeaves(m_states, apBlocks);
+    }
+
+    for (qint32 i = 0; i < PARALLEL_DEGREE; i++) {
+        memcpy(m_states[i].buf, pChunk + i * BLOCK_SIZE, BLOCK_SIZE);
+        m_states[i].bufLen = BLOCK_SIZE;
+    }
+}
+
 XBlake2sp::XBlake2sp()
 {
     m_nBufLen = 0;
@@ -234,16 +463,19 @@ void XBlake2sp::update(const quint8 *pData, qint64 nSize)
     while (nSize > 0) {
         qint64 nSpace = (qint64)(PARALLEL_DEGREE * BLOCK_SIZE) - m_nBufLen;
 
-        if (nSize >= nSpace) {
+        if ((m_nBufLen == 0) && (nSize >= nSpace)) {
+            // Whole 512-byte block straight from the input
+            _updateLeaves(pData);
+            pData += nSpace;
+            nSize -= nSpace;
+        } else if (nSize >= nSpace) {
             // Fill buffer to 512 bytes
             memcpy(m_buf + m_nBufLen, pData, (size_t)nSpace);
             pData += nSpace;
             nSize -= nSpace;
 
             // Distribute: leaf i gets bytes [i*64 .. (i+1)*64)
-            for (qint32 i = 0; i < PARALLEL_DEGREE; i++) {
-                _blake2sUpdate(&m_states[i], m_buf + i * BLOCK_SIZE, BLOCK_SIZE);
-            }
+            _updateLeaves(m_buf);
 
             m_nBufLen = 0;
         } else {
@@ -325,8 +557,9 @@ QByteArray XBlake2sp::hash(QIODevice *pDevice)
         qint64 nPos = pDevice->pos();
         bool bSuccess = pDevice->seek(0);
 
-        const qint32 nBufSize = 4096;
-        quint8 buf[4096];
+        const qint32 nBufSize = 0x10000;
+        QByteArray baBuffer(nBufSize, 0);
+        quint8 *buf = (quint8 *)baBuffer.data();
 
         if (bSuccess) {
             while (!pDevice->atEnd()) {
@@ -366,3 +599,56 @@ QByteArray XBlake2sp::hash(const QByteArray &baData)
 
     return QByteArray((const char *)digest, DIGEST_SIZE);
 }
+
+XBlake2spOutputDevice::XBlake2spOutputDevice(QIODevice *pOutputDevice) : m_pOutputDevice(pOutputDevice)
+{
+    m_blake2sp.init();
+}
+
+bool XBlake2spOutputDevice::isSequential() const
+{
+    return true;
+}
+
+bool XBlake2spOutputDevice::open(OpenMode mode)
+{
+    m_blake2sp.init();
+    m_baDigest.clear();
+
+    return QIODevice::open(mode);
+}
+
+QByteArray XBlake2spOutputDevice::getDigest()
+{
+    if (m_baDigest.isEmpty()) {
+        quint8 digest[XBlake2sp::DIGEST_SIZE];
+        m_blake2sp.final(digest);
+
+        m_baDigest = QByteArray((const char *)digest, XBlake2sp::DIGEST_SIZE);
+    }
+
+    return m_baDigest;
+}
+
+qint64 XBlake2spOutputDevice::readData(char *pData, qint64 nMaxSize)
+{
+    Q_UNUSED(pData)
+    Q_UNUSED(nMaxSize)
+
+    return -1;
+}
+
+qint64 XBlake2spOutputDevice::writeData(const char *pData, qint64 nMaxSize)
+{
+    if (!m_pOutputDevice || !m_baDigest.isEmpty()) {
+        return -1;
+    }
+
+    qint64 nWritten = m_pOutputDevice->write(pData, nMaxSize);
+
+    if (nWritten > 0) {
+        m_blake2sp.update((const quint8 *)pData, nWritten);
+    }
+
+    return nWritten;
+}
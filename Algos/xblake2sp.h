@@ -54,6 +54,9 @@ private:
     static void _blake2sCompress(Blake2sState *pState, const quint8 *pBlock, bool bLast);
     static void _blake2sFinal(Blake2sState *pState, quint8 *pDigest, quint32 nOutLen);
     static void _blake2sUpdate(Blake2sState *pState, const quint8 *pData, quint32 nSize);
+    // Compresses one non-final block for each of the eight leaves, lane-parallel where the CPU allows
+    static void _compressLeaves(Blake2sState *pStates, const quint8 *const *ppBlocks);
+    void _updateLeaves(const quint8 *pChunk);
 
     static quint32 _rotr32(quint32 nValue, quint32 nBits);
     static quint32 _load32le(const quint8 *pData);
@@ -64,4 +67,25 @@ private:
     qint64 m_nBufLen;
 };
 
+// Write-through device that hashes everything written to the wrapped output, so a decoder's
+// result is verified as it is produced instead of in a second pass over the output device
+class XBlake2spOutputDevice : public QIODevice {
+public:
+    explicit XBlake2spOutputDevice(QIODevice *pOutputDevice);
+
+    bool isSequential() const override;
+    bool open(OpenMode mode) override;
+    // Finishes the hash on the first call, so it belongs after the last write
+    QByteArray getDigest();
+
+protected:
+    qint64 readData(char *pData, qint64 nMaxSize) override;
+    qint64 writeData(const char *pData, qint64 nMaxSize) override;
+
+private:
+    QIODevice *m_pOutputDevice;
+    XBlake2sp m_blake2sp;
+    QByteArray m_baDigest;
+};
+
 #endif  // XBLAKE2SP_H
@@ -53,7 +53,8 @@ bool XBrotliDecoder::decompress(XBinary::DATAPROCESS_STATE *pDecompressState, XB
     if (pDecompressState && pDecompressState->pDeviceInput && pDecompressState->pDeviceOutput) {
         qint32 _nBufferSize = XBinary::getBufferSize(pPdStruct);
 
-        char *bufferIn = new char[_nBufferSize];
+        Algo_utils::MAPPED_INPUT mappedInput = {};
+        char *bufferIn = Algo_utils::mapInput(pDecompressState, &mappedInput) ? nullptr : new char[_nBufferSize];
         char *bufferOut = new char[_nBufferSize];
 
         Algo_utils::seekToStart(pDecompressState);
@@ -71,10 +72,12 @@ bool XBrotliDecoder::decompress(XBinary::DATAPROCESS_STATE *pDecompressState, XB
                     qint32 nBufferSize = Algo_utils::getReadChunkSize(pDecompressState, _nBufferSize);
 
                     if (nBufferSize > 0) {
-                        nAvailIn = XBinary::_readDevice(bufferIn, nBufferSize, pDecompressState);
+                        qint32 nInputSize = 0;
+                        const char *pInput = Algo_utils::readSpan(pDecompressState, &mappedInput, bufferIn, nBufferSize, &nInputSize);
 
-                        if (nAvailIn > 0) {
-                            pNextIn = (const uint8_t *)bufferIn;
+                        if (nInputSize > 0) {
+                            nAvailIn = nInputSize;
+                            pNextIn = (const uint8_t *)pInput;
                         } else {
                             bReadMore = false;
                         }
@@ -128,6 +131,7 @@ bool XBrotliDecoder::decompress(XBinary::DATAPROCESS_STATE *pDecompressState, XB
             }
         }
 
+        Algo_utils::unmapInput(&mappedInput);
         delete[] bufferIn;
         delete[] bufferOut;
     }
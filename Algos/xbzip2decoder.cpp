@@ -21,6 +21,12 @@
 #include "xbzip2decoder.h"
 #include "algo_utils.h"
 
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+
 extern "C" {
 
 /*-------------------------------------------------------------*/
@@ -1861,6 +1867,344 @@ save_state_and_return:
 
 /* ===== End embedded bzip2 helper sources ===== */
 
+namespace {
+
+const quint64 BZ2_BLOCK_MAGIC = 0x314159265359ULL;
+const quint64 BZ2_EOS_MAGIC = 0x177245385090ULL;
+const quint64 BZ2_MAGIC_MASK = 0xFFFFFFFFFFFFULL;
+const qint64 BZ2_PARALLEL_MIN_INPUT = 0x40000;  // Smaller inputs rarely hold more than one block
+
+// Appends nBits of nValue (MSB first) at bit position *pnBitPos
+void bz2AppendBits(QByteArray *pbaData, qint64 *pnBitPos, quint64 nValue, qint32 nBits)
+{
+    for (qint32 i = nBits - 1; i >= 0; i--) {
+        qint64 nByte = (*pnBitPos) / 8;
+
+        if (nByte >= pbaData->size()) {
+            pbaData->append((char)0);
+        }
+
+        if ((nValue >> i) & 1) {
+            (*pbaData)[(qint32)nByte] = (char)((quint8)pbaData->at((qint32)nByte) | (0x80 >> ((*pnBitPos) % 8)));
+        }
+
+        (*pnBitPos)++;
+    }
+}
+
+// Wraps one block (nBits starting nShift bits into baSegment, block magic included) into a
+// standalone single-block stream whose combined CRC is the block CRC.
+QByteArray bz2MakeBlockStream(const QByteArray &baSegment, qint32 nShift, qint64 nBits, char cLevel, quint32 *pnBlockCRC)
+{
+    QByteArray baResult("BZh");
+    baResult.append(cLevel);
+
+    qint32 nBytes = (qint32)((nBits + 7) / 8);
+    const quint8 *pIn = (const quint8 *)baSegment.constData();
+    qint32 nInSize = baSegment.size();
+
+    baResult.resize(4 + nBytes);
+    quint8 *pOut = (quint8 *)baResult.data() + 4;
+
+    for (qint32 i = 0; i < nBytes; i++) {
+        quint8 nByte0 = (i < nInSize) ? pIn[i] : 0;
+        quint8 nByte1 = ((i + 1) < nInSize) ? pIn[i + 1] : 0;
+
+        pOut[i] = nShift ? (quint8)((nByte0 << nShift) | (nByte1 >> (8 - nShift))) : nByte0;
+    }
+
+    if (nBits % 8) {
+        pOut[nBytes - 1] &= (quint8)(0xFF << (8 - (nBits % 8)));
+    }
+
+    // Block magic occupies bytes 4..9, the stored block CRC follows (big-endian)
+    *pnBlockCRC = ((quint32)pOut[6] << 24) | ((quint32)pOut[7] << 16) | ((quint32)pOut[8] << 8) | (quint32)pOut[9];
+
+    qint64 nBitPos = 32 + nBits;
+    bz2AppendBits(&baResult, &nBitPos, BZ2_EOS_MAGIC, 48);
+    bz2AppendBits(&baResult, &nBitPos, *pnBlockCRC, 32);
+
+    return baResult;
+}
+
+bool bz2DecodeStream(const QByteArray &baStream, QByteArray *pbaOutput)
+{
+    bz_stream strm = {};
+
+    if (X_BZ2_bzDecompressInit(&strm, 0, 0) != BZ_OK) {
+        return false;
+    }
+
+    const qint32 nChunkSize = 0x100000;
+
+    strm.next_in = (char *)baStream.constData();
+    strm.avail_in = baStream.size();
+
+    qint32 ret = BZ_OK;
+
+    while (ret == BZ_OK) {
+        qint32 nOldSize = pbaOutput->size();
+        pbaOutput->resize(nOldSize + nChunkSize);
+        strm.next_out = pbaOutput->data() + nOldSize;
+        strm.avail_out = nChunkSize;
+
+        ret = X_BZ2_bzDecompress(&strm);
+
+        pbaOutput->resize(nOldSize + nChunkSize - (qint32)strm.avail_out);
+
+        if ((ret == BZ_OK) && (strm.avail_in == 0) && (strm.avail_out > 0)) {
+            ret = BZ_UNEXPECTED_EOF;  // Input exhausted before the end of stream
+        }
+    }
+
+    X_BZ2_bzDecompressEnd(&strm);
+
+    return (ret == BZ_STREAM_END);
+}
+
+class BZip2BlockRunnable : public QRunnable {
+public:
+    BZip2BlockRunnable(qint32 nShift, qint64 nBits, char cLevel) : m_nShift(nShift), m_nBits(nBits), m_cLevel(cLevel), m_nBlockCRC(0), m_bSuccess(false)
+    {
+        setAutoDelete(false);
+    }
+
+    QByteArray *getSegment()
+    {
+        return &m_baSegment;
+    }
+
+    const QByteArray &getOutput() const
+    {
+        return m_baOutput;
+    }
+
+    quint32 getBlockCRC() const
+    {
+        return m_nBlockCRC;
+    }
+
+    bool isSuccess() const
+    {
+        return m_bSuccess;
+    }
+
+    void run() override
+    {
+        QByteArray baStream = bz2MakeBlockStream(m_baSegment, m_nShift, m_nBits, m_cLevel, &m_nBlockCRC);
+        m_baSegment.clear();
+        m_bSuccess = bz2DecodeStream(baStream, &m_baOutput);
+    }
+
+private:
+    qint32 m_nShift;
+    qint64 m_nBits;
+    char m_cLevel;
+    QByteArray m_baSegment;
+    QByteArray m_baOutput;
+    quint32 m_nBlockCRC;
+    bool m_bSuccess;
+};
+
+// Splits the first stream at its block magics and decodes the blocks on a thread pool.
+// A magic match is only a candidate split: a segment that fails to decode is merged with
+// the next one and retried, since the match may lie inside compressed data. *pbHandled
+// stays false (with the output rewound) when the input does not qualify or the splits
+// cannot be validated, so the caller can decode serially.
+bool bz2DecompressParallel(XBinary::DATAPROCESS_STATE *pDecompressState, XBinary::PDSTRUCT *pPdStruct, bool *pbHandled)
+{
+    *pbHandled = false;
+
+    if (pDecompressState->pDeviceOutput->isSequential()) {
+        return false;  // The output cannot be rewound for the serial fallback
+    }
+
+    QIODevice *pDevice = pDecompressState->pDeviceInput;
+    qint64 nInputOffset = pDecompressState->nInputOffset;
+    qint64 nInputSize = pDecompressState->nInputLimit;
+
+    if (nInputSize == -1) {
+        nInputSize = pDevice->size() - nInputOffset;
+    }
+
+    if ((nInputSize < BZ2_PARALLEL_MIN_INPUT) || (QThread::idealThreadCount() < 2)) {
+        return false;
+    }
+
+    if (!pDevice->seek(nInputOffset)) {
+        return false;
+    }
+
+    QByteArray baHeader = pDevice->read(4);
+    if ((baHeader.size() != 4) || !baHeader.startsWith("BZh") || (baHeader.at(3) < '1') || (baHeader.at(3) > '9')) {
+        return false;
+    }
+
+    char cLevel = baHeader.at(3);
+
+    // 1. Locate the block magics and the end-of-stream magic of the first stream
+    QList<qint64> listBlockBits;
+    qint64 nEndBit = -1;
+    quint64 nRegister = 0;
+    qint64 nBitsIn = 0;
+
+    if (!pDevice->seek(nInputOffset)) {
+        return false;
+    }
+
+    qint32 nBufferSize = XBinary::getBufferSize(pPdStruct);
+    qint64 nRead = 0;
+
+    while ((nRead < nInputSize) && (nEndBit == -1) && XBinary::isPdStructNotCanceled(pPdStruct)) {
+        QByteArray baChunk = pDevice->read((std::min)((qint64)nBufferSize, nInputSize - nRead));
+
+        if (baChunk.isEmpty()) {
+            break;
+        }
+
+        const quint8 *pData = (const quint8 *)baChunk.constData();
+        qint32 nChunkSize = baChunk.size();
+
+        for (qint32 i = 0; (i < nChunkSize) && (nEndBit == -1); i++) {
+            nRegister = (nRegister << 8) | pData[i];
+            nBitsIn += 8;
+
+            if (nBitsIn < 56) {
+                continue;
+            }
+
+            for (qint32 k = 7; k >= 0; k--) {
+                quint64 nValue = (nRegister >> k) & BZ2_MAGIC_MASK;
+
+                if (nValue == BZ2_BLOCK_MAGIC) {
+                    listBlockBits.append(nBitsIn - k - 48);
+                } else if (nValue == BZ2_EOS_MAGIC) {
+                    nEndBit = nBitsIn - k - 48;
+                    break;
+                }
+            }
+        }
+
+        nRead += nChunkSize;
+    }
+
+    if ((nEndBit == -1) || (listBlockBits.count() < 2) || (listBlockBits.first() != 32) || !XBinary::isPdStructNotCanceled(pPdStruct)) {
+        return false;
+    }
+
+    // Stored combined CRC follows the end-of-stream magic
+    qint64 nCRCBit = nEndBit + 48;
+    QByteArray baCRC;
+
+    if (pDevice->seek(nInputOffset + nCRCBit / 8)) {
+        baCRC = pDevice->read(5);
+    }
+
+    if (baCRC.size() < (((nCRCBit % 8) ? 5 : 4))) {
+        return false;
+    }
+
+    baCRC.resize(5);
+    quint64 nCRCBits = 0;
+
+    for (qint32 i = 0; i < 5; i++) {
+        nCRCBits = (nCRCBits << 8) | (quint8)baCRC.at(i);
+    }
+
+    quint32 nStoredCombinedCRC = (quint32)((nCRCBits >> (8 - (nCRCBit % 8))) & 0xFFFFFFFF);
+
+    // 2. Decode the blocks in batches and write them out in order
+    qint64 nOutputStart = pDecompressState->pDeviceOutput->pos();
+    qint64 nCountOutputStart = pDecompressState->nCountOutput;
+
+    qint32 nNumberOfThreads = QThread::idealThreadCount();
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(nNumberOfThreads);
+
+    quint32 nCombinedCRC = 0;
+    bool bResult = true;
+    bool bFallback = false;
+    qint32 i = 0;
+
+    while ((i < listBlockBits.count()) && bResult && !bFallback && XBinary::isPdStructNotCanceled(pPdStruct)) {
+        qint32 nNumberOfBlocks = listBlockBits.count();
+        qint32 nBatchCount = (std::min)(nNumberOfThreads, nNumberOfBlocks - i);
+        QList<BZip2BlockRunnable *> listTasks;
+
+        for (qint32 j = 0; j < nBatchCount; j++) {
+            qint64 nStartBit = listBlockBits.at(i + j);
+            qint64 nEndBlockBit = ((i + j + 1) < nNumberOfBlocks) ? listBlockBits.at(i + j + 1) : nEndBit;
+            qint64 nStartByte = nStartBit / 8;
+            qint64 nEndByte = (nEndBlockBit + 7) / 8;
+
+            BZip2BlockRunnable *pTask = new BZip2BlockRunnable((qint32)(nStartBit % 8), nEndBlockBit - nStartBit, cLevel);
+
+            if (pDevice->seek(nInputOffset + nStartByte)) {
+                *(pTask->getSegment()) = pDevice->read(nEndByte - nStartByte);
+            }
+
+            listTasks.append(pTask);
+            threadPool.start(pTask);
+        }
+
+        threadPool.waitForDone();
+
+        qint32 nFailed = -1;
+
+        for (qint32 j = 0; j < listTasks.count(); j++) {
+            BZip2BlockRunnable *pTask = listTasks.at(j);
+
+            if (bResult && (nFailed == -1)) {
+                if (pTask->isSuccess()) {
+                    nCombinedCRC = (nCombinedCRC << 1) | (nCombinedCRC >> 31);
+                    nCombinedCRC ^= pTask->getBlockCRC();
+
+                    const QByteArray &baOutput = pTask->getOutput();
+
+                    if (!baOutput.isEmpty() && !XBinary::_writeDevice((char *)baOutput.constData(), baOutput.size(), pDecompressState)) {
+                        bResult = false;
+                    }
+                } else {
+                    nFailed = j;
+                }
+            }
+
+            delete pTask;
+        }
+
+        if (nFailed == -1) {
+            i += nBatchCount;
+        } else if ((i + nFailed + 1) < listBlockBits.count()) {
+            // The segment did not end on a real block boundary: drop that split and retry
+            i += nFailed;
+            listBlockBits.removeAt(i + 1);
+        } else {
+            bFallback = true;
+        }
+    }
+
+    if (bResult && !bFallback && XBinary::isPdStructNotCanceled(pPdStruct)) {
+        if (nCombinedCRC == nStoredCombinedCRC) {
+            *pbHandled = true;
+            pDecompressState->nCountInput = (nEndBit + 48 + 32 + 7) / 8;
+            return true;
+        }
+
+        bFallback = true;
+    }
+
+    if (bFallback && pDecompressState->pDeviceOutput->seek(nOutputStart)) {
+        pDecompressState->nCountOutput = nCountOutputStart;
+        return false;
+    }
+
+    *pbHandled = true;
+
+    return false;
+}
+
+}  // namespace
+
 XBZIP2Decoder::XBZIP2Decoder(QObject *parent) : QObject(parent)
 {
 }
@@ -1870,9 +2214,19 @@ bool XBZIP2Decoder::decompress(XBinary::DATAPROCESS_STATE *pDecompressState, XBi
     bool bResult = false;
 
     if (pDecompressState && pDecompressState->pDeviceInput && pDecompressState->pDeviceOutput) {
+        Algo_utils::seekToStart(pDecompressState);
+
+        bool bHandled = false;
+        bResult = bz2DecompressParallel(pDecompressState, pPdStruct, &bHandled);
+
+        if (bHandled) {
+            return bResult;
+        }
+
         qint32 _nBufferSize = XBinary::getBufferSize(pPdStruct);
 
-        char *bufferIn = new char[_nBufferSize];
+        Algo_utils::MAPPED_INPUT mappedInput = {};
+        char *bufferIn = Algo_utils::mapInput(pDecompressState, &mappedInput) ? nullptr : new char[_nBufferSize];
         char *bufferOut = new char[_nBufferSize];
 
         Algo_utils::seekToStart(pDecompressState);
@@ -1890,10 +2244,12 @@ bool XBZIP2Decoder::decompress(XBinary::DATAPROCESS_STATE *pDecompressState, XBi
                     qint32 nBufferSize = Algo_utils::getReadChunkSize(pDecompressState, _nBufferSize);
 
                     if (nBufferSize > 0) {
-                        strm.avail_in = XBinary::_readDevice(bufferIn, nBufferSize, pDecompressState);
+                        qint32 nInputSize = 0;
+                        const char *pInput = Algo_utils::readSpan(pDecompressState, &mappedInput, bufferIn, nBufferSize, &nInputSize);
 
-                        if (strm.avail_in > 0) {
-                            strm.next_in = bufferIn;
+                        if (nInputSize > 0) {
+                            strm.avail_in = nInputSize;
+                            strm.next_in = (char *)pInput;
                         } else {
                             // No more data available from device - signal to stop reading
                             bReadMore = false;
@@ -1944,6 +2300,7 @@ bool XBZIP2Decoder::decompress(XBinary::DATAPROCESS_STATE *pDecompressState, XBi
             }
         }
 
+        Algo_utils::unmapInput(&mappedInput);
         delete[] bufferIn;
         delete[] bufferOut;
     }
@@ -9483,6 +9483,8 @@ uLong ZEXPORT adler32_combine64(uLong adler1, uLong adler2, z_off64_t len2)
 #include "algo_utils.h"
 #include "xalgo_local.h"
 
+#include <algorithm>
+
 #ifdef deflate
 #undef deflate
 #endif
@@ -10415,7 +10417,8 @@ bool XDeflateDecoder::decompress(XBinary::DATAPROCESS_STATE *pDecompressState, X
 
         qint32 _nBufferSize = XBinary::getBufferSize(pPdStruct);
 
-        char *bufferIn = new char[_nBufferSize];
+        Algo_utils::MAPPED_INPUT mappedInput = {};
+        char *bufferIn = Algo_utils::mapInput(pDecompressState, &mappedInput) ? nullptr : new char[_nBufferSize];
         char *bufferOut = new char[_nBufferSize];
 
         z_stream strm;
@@ -10430,14 +10433,16 @@ bool XDeflateDecoder::decompress(XBinary::DATAPROCESS_STATE *pDecompressState, X
         if (X_inflateInit2(&strm, -MAX_WBITS) == Z_OK) {
             do {
                 qint32 nBufferSize = Algo_utils::getReadChunkSize(pDecompressState, _nBufferSize);
-                strm.avail_in = XBinary::_readDevice(bufferIn, nBufferSize, pDecompressState);
+                qint32 nInputSize = 0;
+                const char *pInput = Algo_utils::readSpan(pDecompressState, &mappedInput, bufferIn, nBufferSize, &nInputSize);
 
-                if (strm.avail_in == 0) {
+                if (nInputSize <= 0) {
                     ret = Z_ERRNO;
                     break;
                 }
 
-                strm.next_in = (quint8 *)bufferIn;
+                strm.avail_in = nInputSize;
+                strm.next_in = (quint8 *)pInput;
 
                 do {
                     strm.avail_out = _nBufferSize;
@@ -10480,6 +10485,7 @@ bool XDeflateDecoder::decompress(XBinary::DATAPROCESS_STATE *pDecompressState, X
             bResult = (ret == Z_STREAM_END);
         }
 
+        Algo_utils::unmapInput(&mappedInput);
         delete[] bufferIn;
         delete[] bufferOut;
     }
@@ -10487,6 +10493,378 @@ bool XDeflateDecoder::decompress(XBinary::DATAPROCESS_STATE *pDecompressState, X
     return bResult;
 }
 
+bool XDeflateDecoder::decompressCheckpoint(XBinary::DATAPROCESS_STATE *pDecompressState, QList<CHECKPOINT> *pListCheckpoints, qint64 nSpan, XBinary::PDSTRUCT *pPdStruct)
+{
+    bool bResult = false;
+
+    if (pDecompressState && pDecompressState->pDeviceInput && pDecompressState->pDeviceOutput && pListCheckpoints) {
+        const qint32 nWindowSize = 0x8000;  // Deflate back-references reach at most 32 KiB
+
+        QIODevice *pDeviceInput = pDecompressState->pDeviceInput;
+        qint64 nInputSize = pDecompressState->nInputLimit;
+
+        if (nInputSize == -1) {
+            nInputSize = pDeviceInput->size() - pDecompressState->nInputOffset;
+        }
+
+        qint64 nWriteFrom = (std::max)(pDecompressState->nProcessedOffset, (qint64)0);
+        qint64 nWriteEnd = (pDecompressState->nProcessedLimit == -1) ? -1 : (nWriteFrom + pDecompressState->nProcessedLimit);
+
+        // Resume from the last checkpoint at or before the window
+        CHECKPOINT checkpoint = {};
+
+        for (qint32 i = 0; i < pListCheckpoints->count(); i++) {
+            if (pListCheckpoints->at(i).nOutputOffset > nWriteFrom) {
+                break;
+            }
+
+            checkpoint = pListCheckpoints->at(i);
+        }
+
+        qint32 _nBufferSize = XBinary::getBufferSize(pPdStruct);
+
+        char *bufferIn = new char[_nBufferSize];
+        char *bufferWindow = new char[nWindowSize];
+
+        memset(bufferWindow, 0, nWindowSize);
+
+        z_stream strm;
+        strm.zalloc = nullptr;
+        strm.zfree = nullptr;
+        strm.opaque = nullptr;
+        strm.avail_in = 0;
+        strm.next_in = nullptr;
+
+        if (X_inflateInit2(&strm, -MAX_WBITS) == Z_OK) {
+            qint32 ret = Z_OK;
+            qint64 nTotalIn = checkpoint.nInputOffset;
+            qint64 nTotalOut = checkpoint.nOutputOffset;
+
+            if (checkpoint.nBits) {
+                // The block starts inside the byte before nInputOffset
+                char cByte = 0;
+
+                if (pDeviceInput->seek(pDecompressState->nInputOffset + nTotalIn - 1) && (pDeviceInput->read(&cByte, 1) == 1)) {
+                    ret = X_inflatePrime(&strm, checkpoint.nBits, ((quint8)cByte) >> (8 - checkpoint.nBits));
+                } else {
+                    ret = Z_ERRNO;
+                }
+            }
+
+            if ((ret == Z_OK) && (!checkpoint.baWindow.isEmpty())) {
+                // The window is stored oldest byte first, which is also the circular order
+                // of bufferWindow when next_out points at its start
+                qint32 nDictSize = checkpoint.baWindow.size();
+                memcpy(bufferWindow + nWindowSize - nDictSize, checkpoint.baWindow.constData(), nDictSize);
+                ret = X_inflateSetDictionary(&strm, (const Bytef *)checkpoint.baWindow.constData(), nDictSize);
+            }
+
+            if ((ret == Z_OK) && (!pDeviceInput->seek(pDecompressState->nInputOffset + nTotalIn))) {
+                ret = Z_ERRNO;
+            }
+
+            strm.avail_out = 0;
+
+            while ((ret == Z_OK) && XBinary::isPdStructNotCanceled(pPdStruct)) {
+                if (strm.avail_in == 0) {
+                    qint64 nToRead = (std::min)((qint64)_nBufferSize, nInputSize - (nTotalIn));
+
+                    if (nToRead <= 0) {
+                        ret = Z_BUF_ERROR;
+                        break;
+                    }
+
+                    qint64 nRead = pDeviceInput->read(bufferIn, nToRead);
+
+                    if (nRead <= 0) {
+                        pDecompressState->bReadError = true;
+                        ret = Z_ERRNO;
+                        break;
+                    }
+
+                    strm.avail_in = (uInt)nRead;
+                    strm.next_in = (quint8 *)bufferIn;
+                }
+
+                if (strm.avail_out == 0) {
+                    strm.avail_out = nWindowSize;
+                    strm.next_out = (quint8 *)bufferWindow;
+                }
+
+                quint8 *pOutStart = strm.next_out;
+                uInt nAvailIn = strm.avail_in;
+                uInt nAvailOut = strm.avail_out;
+
+                ret = X_inflate(&strm, Z_BLOCK);
+
+                if ((ret == Z_DATA_ERROR) || (ret == Z_MEM_ERROR) || (ret == Z_NEED_DICT)) {
+                    break;
+                }
+
+                qint64 nProduced = nAvailOut - strm.avail_out;
+
+                nTotalIn += nAvailIn - strm.avail_in;
+
+                // Forward the part of the produced bytes that falls into the window
+                qint64 nChunkFrom = (std::max)(nTotalOut, nWriteFrom);
+                qint64 nChunkEnd = nTotalOut + nProduced;
+
+                if (nWriteEnd != -1) {
+                    nChunkEnd = (std::min)(nChunkEnd, nWriteEnd);
+                }
+
+                if (nChunkEnd > nChunkFrom) {
+                    qint64 nToWrite = nChunkEnd - nChunkFrom;
+
+                    if (pDecompressState->pDeviceOutput->write((char *)pOutStart + (nChunkFrom - nTotalOut), nToWrite) != nToWrite) {
+                        pDecompressState->bWriteError = true;
+                        ret = Z_ERRNO;
+                        break;
+                    }
+
+                    pDecompressState->nCountOutput += nToWrite;
+                }
+
+                nTotalOut += nProduced;
+
+                if (ret == Z_STREAM_END) {
+                    break;
+                }
+
+                if ((nWriteEnd != -1) && (nTotalOut >= nWriteEnd)) {
+                    break;
+                }
+
+                // Record a checkpoint at a block boundary (bit 7 of data_type) that is not past the
+                // last block (bit 6) once nSpan bytes were produced since the last one
+                if ((strm.data_type & 128) && !(strm.data_type & 64)) {
+                    qint64 nLastOutput = pListCheckpoints->isEmpty() ? 0 : pListCheckpoints->last().nOutputOffset;
+
+                    if ((nTotalOut > nLastOutput) && ((nTotalOut - nLastOutput) >= nSpan)) {
+                        CHECKPOINT record = {};
+                        record.nInputOffset = nTotalIn;
+                        record.nBits = strm.data_type & 7;
+                        record.nOutputOffset = nTotalOut;
+
+                        qint32 nDictSize = (qint32)(std::min)(nTotalOut, (qint64)nWindowSize);
+                        qint32 nLeft = strm.avail_out;
+
+                        // Unroll the circular window so that the oldest byte comes first
+                        QByteArray baWindow(bufferWindow + nWindowSize - nLeft, nLeft);
+                        baWindow.append(bufferWindow, nWindowSize - nLeft);
+                        record.baWindow = baWindow.right(nDictSize);
+
+                        pListCheckpoints->append(record);
+                    }
+                }
+            }
+
+            X_inflateEnd(&strm);
+
+            pDecompressState->nCountInput = nTotalIn;
+
+            bResult = (ret == Z_STREAM_END) || ((ret == Z_OK) && (nWriteEnd != -1) && (nTotalOut >= nWriteEnd));
+        }
+
+        delete[] bufferIn;
+        delete[] bufferWindow;
+    }
+
+    return bResult;
+}
+
+bool XDeflateDecoder::initWindowStream(WINDOW_STREAM *pStream)
+{
+    pStream->strm.zalloc = nullptr;
+    pStream->strm.zfree = nullptr;
+    pStream->strm.opaque = nullptr;
+    pStream->strm.avail_in = 0;
+    pStream->strm.next_in = nullptr;
+    pStream->baWindow.clear();
+    pStream->bAllocated = (X_inflateInit2(&(pStream->strm), -MAX_WBITS) == Z_OK);
+
+    return pStream->bAllocated;
+}
+
+bool XDeflateDecoder::inflateWindowStream(WINDOW_STREAM *pStream, const char *pInput, qint32 nInputSize, char *pOutput, qint32 nOutputSize)
+{
+    const qint32 nWindowSize = 0x8000;  // Deflate back-references reach at most 32 KiB
+
+    if (!pStream->bAllocated || (nInputSize < 0) || (nOutputSize < 0)) {
+        return false;
+    }
+
+    // A reset drops the inflater's own window, the dictionary restores it without decoding anything
+    qint32 ret = X_inflateReset(&(pStream->strm));
+
+    if ((ret == Z_OK) && (!pStream->baWindow.isEmpty())) {
+        ret = X_inflateSetDictionary(&(pStream->strm), (const Bytef *)pStream->baWindow.constData(), pStream->baWindow.size());
+    }
+
+    if (ret != Z_OK) {
+        return false;
+    }
+
+    char cEmpty = 0;  // inflate() rejects a null next_out even when no output is expected
+
+    pStream->strm.next_in = (quint8 *)pInput;
+    pStream->strm.avail_in = (uInt)nInputSize;
+    pStream->strm.next_out = (quint8 *)(nOutputSize ? pOutput : &cEmpty);
+    pStream->strm.avail_out = (uInt)nOutputSize;
+
+    ret = X_inflate(&(pStream->strm), Z_FINISH);
+
+    if ((ret != Z_STREAM_END) || (pStream->strm.avail_in != 0) || (pStream->strm.avail_out != 0)) {
+        return false;
+    }
+
+    if (nOutputSize >= nWindowSize) {
+        pStream->baWindow = QByteArray(pOutput + nOutputSize - nWindowSize, nWindowSize);
+    } else {
+        pStream->baWindow.append(pOutput, nOutputSize);
+
+        if (pStream->baWindow.size() > nWindowSize) {
+            pStream->baWindow.remove(0, pStream->baWindow.size() - nWindowSize);
+        }
+    }
+
+    return true;
+}
+
+void XDeflateDecoder::freeWindowStream(WINDOW_STREAM *pStream)
+{
+    if (pStream->bAllocated) {
+        X_inflateEnd(&(pStream->strm));
+        pStream->bAllocated = false;
+    }
+
+    pStream->baWindow.clear();
+}
+
+bool XDeflateDecoder::initCABCursor(CAB_CURSOR *pCursor, QIODevice *pDeviceInput, qint64 nInputOffset, qint64 nInputLimit, qint32 nReservedSize,
+                                    qint64 nUncompressedSize)
+{
+    if (!pCursor) {
+        return false;
+    }
+
+    freeCABCursor(pCursor);
+
+    if (!pDeviceInput || (nInputOffset < 0) || (nInputLimit < 0) || (nReservedSize < 0) || (nUncompressedSize < 0)) {
+        return false;
+    }
+
+    if (!initWindowStream(&(pCursor->windowStream))) {
+        return false;
+    }
+
+    pCursor->pDeviceInput = pDeviceInput;
+    pCursor->nInputOffset = nInputOffset;
+    pCursor->nInputLimit = nInputLimit;
+    pCursor->nInputPos = 0;
+    pCursor->nReservedSize = nReservedSize;
+    pCursor->nUncompressedSize = nUncompressedSize;
+    pCursor->nCountOutput = 0;
+    pCursor->nFramePos = 0;
+    pCursor->baFrame.clear();
+    pCursor->bAllocated = true;
+
+    return true;
+}
+
+bool XDeflateDecoder::readCABCursor(CAB_CURSOR *pCursor, QIODevice *pDeviceOutput, qint64 nSize, XBinary::PDSTRUCT *pPdStruct)
+{
+    if (!pCursor || !pCursor->bAllocated || (nSize < 0) || (nSize > pCursor->nUncompressedSize - pCursor->nCountOutput)) {
+        return false;
+    }
+
+    const qint64 nCFDataHeaderSize = 8;  // checksum(4) + cbData(2) + cbUncomp(2)
+    const qint32 nMaxBlockSize = 0x8000;
+    bool bResult = true;
+
+    while ((nSize > 0) && bResult && XBinary::isPdStructNotCanceled(pPdStruct)) {
+        if (pCursor->nFramePos >= pCursor->baFrame.size()) {
+            // Every CFDATA payload is "CK" and one complete deflate stream over the shared window
+            bResult = false;
+            pCursor->nFramePos = 0;
+
+            qint64 nPayloadPos = pCursor->nInputPos + nCFDataHeaderSize + pCursor->nReservedSize;
+            char header[8];
+
+            if ((nPayloadPos > pCursor->nInputLimit) || !pCursor->pDeviceInput->seek(pCursor->nInputOffset + pCursor->nInputPos) ||
+                (pCursor->pDeviceInput->read(header, 8) != 8)) {
+                break;
+            }
+
+            quint16 nCbData = (quint8)header[4] | ((quint16)(quint8)header[5] << 8);
+            quint16 nCbUncomp = (quint8)header[6] | ((quint16)(quint8)header[7] << 8);
+
+            if ((nCbData < 2) || (nCbUncomp > nMaxBlockSize) || ((qint64)nCbData > pCursor->nInputLimit - nPayloadPos) ||
+                ((qint64)nCbUncomp > pCursor->nUncompressedSize - pCursor->nCountOutput) ||
+                !pCursor->pDeviceInput->seek(pCursor->nInputOffset + nPayloadPos)) {
+                break;
+            }
+
+            QByteArray baPayload = pCursor->pDeviceInput->read(nCbData);
+            pCursor->baFrame.resize(nCbUncomp);
+
+            if ((baPayload.size() != nCbData) || (baPayload.at(0) != 'C') || (baPayload.at(1) != 'K') ||
+                !inflateWindowStream(&(pCursor->windowStream), baPayload.constData() + 2, nCbData - 2, pCursor->baFrame.data(), nCbUncomp)) {
+                break;
+            }
+
+            pCursor->nInputPos = nPayloadPos + nCbData;
+            bResult = true;
+
+            continue;
+        }
+
+        qint64 nChunkSize = qMin(nSize, (qint64)(pCursor->baFrame.size() - pCursor->nFramePos));
+
+        if (pDeviceOutput) {
+            const char *pData = pCursor->baFrame.constData() + pCursor->nFramePos;
+            qint64 nWritten = 0;
+
+            while (nWritten < nChunkSize) {
+                qint64 nResult = pDeviceOutput->write(pData + nWritten, nChunkSize - nWritten);
+
+                if ((nResult <= 0) || (nResult > nChunkSize - nWritten)) {
+                    bResult = false;
+                    break;
+                }
+
+                nWritten += nResult;
+            }
+        }
+
+        pCursor->nFramePos += (qint32)nChunkSize;
+        pCursor->nCountOutput += nChunkSize;
+        nSize -= nChunkSize;
+    }
+
+    return bResult && (nSize == 0) && XBinary::isPdStructNotCanceled(pPdStruct);
+}
+
+void XDeflateDecoder::freeCABCursor(CAB_CURSOR *pCursor)
+{
+    if (pCursor) {
+        if (pCursor->bAllocated) {
+            freeWindowStream(&(pCursor->windowStream));
+        }
+
+        pCursor->pDeviceInput = nullptr;
+        pCursor->nInputOffset = 0;
+        pCursor->nInputLimit = 0;
+        pCursor->nInputPos = 0;
+        pCursor->nReservedSize = 0;
+        pCursor->nUncompressedSize = 0;
+        pCursor->nCountOutput = 0;
+        pCursor->nFramePos = 0;
+        pCursor->baFrame.clear();
+        pCursor->bAllocated = false;
+    }
+}
+
 bool XDeflateDecoder::decompress64(XBinary::DATAPROCESS_STATE *pDecompressState, XBinary::PDSTRUCT *pPdStruct)
 {
     Algo_utils::seekToStart(pDecompressState);
@@ -10559,12 +10937,12 @@ bool XDeflateDecoder::decompress_zlib(XBinary::DATAPROCESS_STATE *pDecompressSta
     return bResult;
 }
 
-bool XDeflateDecoder::compress(XBinary::DATAPROCESS_STATE *pCompressState, XBinary::PDSTRUCT *pPdStruct, int nCompressionLevel)
+bool XDeflateDecoder::compress(XBinary::DATAPROCESS_STATE *pCompressState, XBinary::PDSTRUCT *pPdStruct, int nCompressionLevel, bool bParallel)
 {
-    return Algo_utils::compressDeflate(pCompressState, pPdStruct, nCompressionLevel, -MAX_WBITS);
+    return Algo_utils::compressDeflate(pCompressState, pPdStruct, nCompressionLevel, -MAX_WBITS, bParallel);
 }
 
-bool XDeflateDecoder::compress_zlib(XBinary::DATAPROCESS_STATE *pCompressState, XBinary::PDSTRUCT *pPdStruct, int nCompressionLevel)
+bool XDeflateDecoder::compress_zlib(XBinary::DATAPROCESS_STATE *pCompressState, XBinary::PDSTRUCT *pPdStruct, int nCompressionLevel, bool bParallel)
 {
-    return Algo_utils::compressDeflate(pCompressState, pPdStruct, nCompressionLevel, MAX_WBITS);
+    return Algo_utils::compressDeflate(pCompressState, pPdStruct, nCompressionLevel, MAX_WBITS, bParallel);
 }
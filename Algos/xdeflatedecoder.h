@@ -27,12 +27,59 @@
 class XDeflateDecoder : public QObject {
     Q_OBJECT
 public:
+    // Resume point inside a raw deflate stream, taken at a block boundary
+    struct CHECKPOINT {
+        qint64 nInputOffset;   // First compressed byte not fully consumed, relative to the stream start
+        qint32 nBits;          // Bits of the byte before nInputOffset that still belong to the next block
+        qint64 nOutputOffset;  // Decompressed offset of the checkpoint
+        QByteArray baWindow;   // Up to 32 KiB of output preceding nOutputOffset
+    };
+
+    // Sequence of complete raw deflate streams sharing one history, as in CAB MSZIP where every
+    // CFDATA block restarts the bitstream but may reference the previous blocks' output
+    struct WINDOW_STREAM {
+        z_stream strm;
+        QByteArray baWindow;  // Last 32 KiB of output, primed as the dictionary of the next stream
+        bool bAllocated;
+    };
+
+    // Forward-only reader over the CFDATA blocks of one CAB MSZIP folder
+    struct CAB_CURSOR {
+        WINDOW_STREAM windowStream;
+        QIODevice *pDeviceInput;
+        qint64 nInputOffset;       // first CFDATA header of the folder
+        qint64 nInputLimit;        // size of the CFDATA stream
+        qint64 nInputPos;          // next CFDATA header, relative to nInputOffset
+        qint32 nReservedSize;      // per-block reserved area (CFHEADER cbCFData)
+        qint64 nUncompressedSize;  // complete folder size
+        qint64 nCountOutput;       // folder bytes already read
+        QByteArray baFrame;        // current decoded block
+        qint32 nFramePos;
+        bool bAllocated;
+    };
+
     explicit XDeflateDecoder(QObject *parent = nullptr);
     static bool decompress(XBinary::DATAPROCESS_STATE *pDecompressState, XBinary::PDSTRUCT *pPdStruct = nullptr);
+    // Decodes the nProcessedOffset/nProcessedLimit window of a raw deflate stream starting from the
+    // nearest checkpoint and appends a new checkpoint every nSpan decompressed bytes
+    static bool decompressCheckpoint(XBinary::DATAPROCESS_STATE *pDecompressState, QList<CHECKPOINT> *pListCheckpoints, qint64 nSpan,
+                                     XBinary::PDSTRUCT *pPdStruct = nullptr);
+    static bool initWindowStream(WINDOW_STREAM *pStream);
+    // Inflates one complete stream that has to decode to exactly nOutputSize bytes
+    static bool inflateWindowStream(WINDOW_STREAM *pStream, const char *pInput, qint32 nInputSize, char *pOutput, qint32 nOutputSize);
+    static void freeWindowStream(WINDOW_STREAM *pStream);
+    static bool initCABCursor(CAB_CURSOR *pCursor, QIODevice *pDeviceInput, qint64 nInputOffset, qint64 nInputLimit, qint32 nReservedSize,
+                              qint64 nUncompressedSize);
+    // pDeviceOutput == nullptr skips nSize bytes
+    static bool readCABCursor(CAB_CURSOR *pCursor, QIODevice *pDeviceOutput, qint64 nSize, XBinary::PDSTRUCT *pPdStruct = nullptr);
+    static void freeCABCursor(CAB_CURSOR *pCursor);
     static bool decompress64(XBinary::DATAPROCESS_STATE *pDecompressState, XBinary::PDSTRUCT *pPdStruct = nullptr);
     static bool decompress_zlib(XBinary::DATAPROCESS_STATE *pDecompressState, XBinary::PDSTRUCT *pPdStruct = nullptr);
-    static bool compress(XBinary::DATAPROCESS_STATE *pCompressState, XBinary::PDSTRUCT *pPdStruct = nullptr, int nCompressionLevel = Z_DEFAULT_COMPRESSION);
-    static bool compress_zlib(XBinary::DATAPROCESS_STATE *pCompressState, XBinary::PDSTRUCT *pPdStruct = nullptr, int nCompressionLevel = Z_DEFAULT_COMPRESSION);
+    // bParallel: see Algo_utils::compressDeflate
+    static bool compress(XBinary::DATAPROCESS_STATE *pCompressState, XBinary::PDSTRUCT *pPdStruct = nullptr, int nCompressionLevel = Z_DEFAULT_COMPRESSION,
+                         bool bParallel = false);
+    static bool compress_zlib(XBinary::DATAPROCESS_STATE *pCompressState, XBinary::PDSTRUCT *pPdStruct = nullptr, int nCompressionLevel = Z_DEFAULT_COMPRESSION,
+                              bool bParallel = false);
 
 signals:
 };
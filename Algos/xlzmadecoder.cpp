@@ -23,6 +23,10 @@
 #include "xbranchdecoder.h"
 #include "xalgo_local.h"
 #include <QBuffer>
+#include <QCryptographicHash>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
 
 #include <algorithm>
 
@@ -175,210 +179,888 @@ bool XLZMADecoder::decompressLZMA2(XBinary::DATAPROCESS_STATE *pDecompressState,
     return bResult;
 }
 
-bool XLZMADecoder::decompressXZ(XBinary::DATAPROCESS_STATE *pDecompressState, XBinary::PDSTRUCT *pPdStruct)
+namespace {
+
+const quint8 XZ_HEADER_MAGIC[6] = {0xFD, 0x37, 0x7A, 0x58, 0x5A, 0x00};
+const quint8 XZ_FOOTER_MAGIC[2] = {0x59, 0x5A};
+const qint64 XZ_PARALLEL_BLOCK_LIMIT = 0x4000000;  // Largest block (either side) decoded in memory by a worker
+
+quint32 xzCRC32(const char *pData, qint64 nSize, quint32 nInit = 0)
 {
-    if (!pDecompressState || !pDecompressState->pDeviceInput || !pDecompressState->pDeviceOutput) {
-        return false;
+    return XBinary::_getCRC32(pData, (qint32)nSize, ~nInit, XBinary::_getCRC32Table_EDB88320()) ^ 0xFFFFFFFF;
+}
+
+// XBinary has no CRC-64 helper: reflected ECMA-182, used by the XZ check type 0x04
+struct XZ_CRC64_TABLE {
+    quint64 nValues[256];
+
+    XZ_CRC64_TABLE()
+    {
+        for (quint32 i = 0; i < 256; i++) {
+            quint64 nValue = i;
+
+            for (qint32 j = 0; j < 8; j++) {
+                nValue = (nValue & 1) ? ((nValue >> 1) ^ 0xC96C5795D7870F42ULL) : (nValue >> 1);
+            }
+
+            nValues[i] = nValue;
+        }
     }
+};
 
-    QIODevice *pDevice = pDecompressState->pDeviceInput;
-    qint64 nOffset = pDecompressState->nInputOffset;
-    qint64 nTotalSize = pDecompressState->nInputLimit;
+quint64 xzCRC64(const char *pData, qint64 nSize, quint64 nInit = 0)
+{
+    static const XZ_CRC64_TABLE table;
+    quint64 nResult = ~nInit;
 
-    if (nTotalSize < 28) {  // stream header(12) + minimal block header(4) + stream footer(12)
-        return false;
+    for (qint64 i = 0; i < nSize; i++) {
+        nResult = table.nValues[(nResult ^ (quint8)pData[i]) & 0xFF] ^ (nResult >> 8);
     }
 
-    // --- 1. Validate XZ stream header (12 bytes) ---
-    pDevice->seek(nOffset);
-    QByteArray baStreamHeader = pDevice->read(12);
-    if (baStreamHeader.size() != 12) {
-        return false;
+    return ~nResult;
+}
+
+quint32 xzReadLE32(const char *pData)
+{
+    return (quint32)(quint8)pData[0] | ((quint32)(quint8)pData[1] << 8) | ((quint32)(quint8)pData[2] << 16) | ((quint32)(quint8)pData[3] << 24);
+}
+
+qint64 xzAlign4(qint64 nValue)
+{
+    return (nValue + 3) & ~((qint64)3);
+}
+
+qint32 xzCheckSize(quint8 nCheckType)
+{
+    if (nCheckType == 0) {
+        return 0;
+    }
+
+    return 4 << ((nCheckType - 1) / 3);
+}
+
+QByteArray xzReadBytes(QIODevice *pDevice, qint64 nOffset, qint64 nSize)
+{
+    QByteArray baResult;
+
+    if ((nOffset >= 0) && (nSize >= 0) && pDevice->seek(nOffset)) {
+        baResult = pDevice->read(nSize);
+    }
+
+    return baResult;
+}
+
+// Sink for one block: computes the block check over every decoded byte and
+// forwards only the window [nSkip, nSkip + nTake) to the target device.
+class XZBlockOutput : public QIODevice {
+public:
+    XZBlockOutput(QIODevice *pTarget, quint8 nCheckType, qint64 nSkip, qint64 nTake)
+        : m_pTarget(pTarget), m_nCheckType(nCheckType), m_nSkip(nSkip), m_nTake(nTake), m_nTotal(0), m_nForwarded(0), m_nCRC32(0), m_nCRC64(0),
+          m_sha256(QCryptographicHash::Sha256)
+    {
+    }
+
+    qint64 getTotal() const
+    {
+        return m_nTotal;
+    }
+
+    qint64 getForwarded() const
+    {
+        return m_nForwarded;
     }
-    static const quint8 XZ_MAGIC[6] = {0xFD, 0x37, 0x7A, 0x58, 0x5A, 0x00};
-    if (memcmp(baStreamHeader.constData(), XZ_MAGIC, 6) != 0) {
+
+    bool isCheckSupported() const
+    {
+        return (m_nCheckType == 0x00) || (m_nCheckType == 0x01) || (m_nCheckType == 0x04) || (m_nCheckType == 0x0A);
+    }
+
+    QByteArray getCheck()
+    {
+        QByteArray baResult;
+
+        if (m_nCheckType == 0x01) {
+            for (qint32 i = 0; i < 4; i++) {
+                baResult.append((char)((m_nCRC32 >> (8 * i)) & 0xFF));
+            }
+        } else if (m_nCheckType == 0x04) {
+            for (qint32 i = 0; i < 8; i++) {
+                baResult.append((char)((m_nCRC64 >> (8 * i)) & 0xFF));
+            }
+        } else if (m_nCheckType == 0x0A) {
+            baResult = m_sha256.result();
+        }
+
+        return baResult;
+    }
+
+    bool isSequential() const override
+    {
         return false;
     }
 
-    // --- 2. Parse block header (starts at offset 12) ---
-    qint64 nBlockHeaderOffset = nOffset + 12;
-    pDevice->seek(nBlockHeaderOffset);
+protected:
+    qint64 readData(char *pData, qint64 nMaxSize) override
+    {
+        Q_UNUSED(pData)
+        Q_UNUSED(nMaxSize)
+
+        return -1;
+    }
+
+    qint64 writeData(const char *pData, qint64 nSize) override
+    {
+        if (m_nCheckType == 0x01) {
+            m_nCRC32 = xzCRC32(pData, nSize, m_nCRC32);
+        } else if (m_nCheckType == 0x04) {
+            m_nCRC64 = xzCRC64(pData, nSize, m_nCRC64);
+        } else if (m_nCheckType == 0x0A) {
+            m_sha256.addData(QByteArray::fromRawData(pData, (int)nSize));
+        }
+
+        qint64 nStart = m_nTotal;
+        qint64 nEnd = m_nTotal + nSize;
+        qint64 nWindowStart = (std::max)(nStart, m_nSkip);
+        qint64 nWindowEnd = (m_nTake == -1) ? nEnd : (std::min)(nEnd, m_nSkip + m_nTake);
+
+        if (nWindowEnd > nWindowStart) {
+            qint64 nToWrite = nWindowEnd - nWindowStart;
+
+            if (m_pTarget->write(pData + (nWindowStart - nStart), nToWrite) != nToWrite) {
+                return -1;
+            }
+
+            m_nForwarded += nToWrite;
+        }
+
+        m_nTotal += nSize;
+
+        return nSize;
+    }
+
+private:
+    QIODevice *m_pTarget;
+    quint8 m_nCheckType;
+    qint64 m_nSkip;
+    qint64 m_nTake;
+    qint64 m_nTotal;
+    qint64 m_nForwarded;
+    quint32 m_nCRC32;
+    quint64 m_nCRC64;
+    QCryptographicHash m_sha256;
+};
+
+void xzApplyFilters(QByteArray &baData, const QList<QPair<quint64, QByteArray>> &listFilters)
+{
+    for (qint32 i = listFilters.count() - 1; i >= 0; i--) {
+        quint64 nFilterID = listFilters.at(i).first;
+        const QByteArray &baProps = listFilters.at(i).second;
+
+        if (nFilterID == 0x03) {  // Delta: 1-byte prop = distance - 1
+            qint32 nDistance = baProps.isEmpty() ? 1 : ((qint32)(quint8)baProps.at(0) + 1);
+            XBranchDecoder::applyDeltaDecode(baData, nDistance);
+        } else {
+            // Branch filters: optional 4-byte LE start offset property
+            quint32 nIp = 0;
+            if (baProps.size() >= 4) {
+                nIp = xzReadLE32(baProps.constData());
+            }
+
+            if (nFilterID == 0x04) {
+                Algo_utils::applyBCJX86Decode(baData, nIp);
+            } else if (nFilterID == 0x05) {
+                XBranchDecoder::applyBranchDecode(baData, XBranchDecoder::BTYPE_PPC, nIp);
+            } else if (nFilterID == 0x06) {
+                XBranchDecoder::applyBranchDecode(baData, XBranchDecoder::BTYPE_IA64, nIp);
+            } else if (nFilterID == 0x07) {
+                XBranchDecoder::applyBranchDecode(baData, XBranchDecoder::BTYPE_ARM, nIp);
+            } else if (nFilterID == 0x08) {
+                XBranchDecoder::applyBranchDecode(baData, XBranchDecoder::BTYPE_ARMT, nIp);
+            } else if (nFilterID == 0x09) {
+                XBranchDecoder::applyBranchDecode(baData, XBranchDecoder::BTYPE_SPARC, nIp);
+            } else if (nFilterID == 0x0A) {
+                XBranchDecoder::applyBranchDecode(baData, XBranchDecoder::BTYPE_ARM64, nIp);
+            }
+        }
+    }
+}
+
+struct XZ_BLOCK_RESULT {
+    qint64 nBlockSize;  // Header + padded data + check, -1 if the header and index both lack the compressed size
+    qint64 nUncompressedSize;
+    qint64 nForwarded;
+};
+
+// Decodes one block starting at nBlockOffset; nBlockLimit bounds the bytes the block may occupy.
+// nUnpaddedSize/nUncompressedSize come from the index (-1 if unknown) and are cross-checked.
+bool xzDecompressBlock(QIODevice *pDevice, qint64 nBlockOffset, qint64 nBlockLimit, quint8 nCheckType, qint64 nUnpaddedSize, qint64 nUncompressedSize,
+                       bool bVerifyCheck, QIODevice *pDeviceOutput, qint64 nSkip, qint64 nTake, XZ_BLOCK_RESULT *pResult, XBinary::PDSTRUCT *pPdStruct)
+{
+    *pResult = {};
+    pResult->nBlockSize = -1;
 
-    // header_size byte: actual block header size = (header_size + 1) * 4
-    char nHdrSizeBuf = 0;
-    if (pDevice->read(&nHdrSizeBuf, 1) != 1) {
+    // header_size byte: actual block header size = (header_size + 1) * 4; 0x00 is the index indicator
+    QByteArray baHeaderSize = xzReadBytes(pDevice, nBlockOffset, 1);
+    if ((baHeaderSize.size() != 1) || (baHeaderSize.at(0) == 0)) {
         return false;
     }
-    quint8 nHeaderSizeByte = (quint8)nHdrSizeBuf;
-    qint32 nActualHeaderSize = (nHeaderSizeByte + 1) * 4;
-    if (nActualHeaderSize < 4 || nActualHeaderSize > 1024) {
+
+    qint32 nHeaderSize = ((quint8)baHeaderSize.at(0) + 1) * 4;
+    if (nHeaderSize > nBlockLimit) {
         return false;
     }
 
-    pDevice->seek(nBlockHeaderOffset);
-    QByteArray baBH = pDevice->read(nActualHeaderSize);
-    if (baBH.size() != nActualHeaderSize) {
+    QByteArray baBH = xzReadBytes(pDevice, nBlockOffset, nHeaderSize);
+    if (baBH.size() != nHeaderSize) {
+        return false;
+    }
+
+    if (xzCRC32(baBH.constData(), nHeaderSize - 4) != xzReadLE32(baBH.constData() + nHeaderSize - 4)) {
         return false;
     }
 
     quint8 nBlockFlags = (quint8)baBH.at(1);
-    qint32 nNumFilters = (nBlockFlags & 0x03) + 1;
-    bool bHasCompressedSize = (nBlockFlags & 0x40) != 0;
-    bool bHasUncompressedSize = (nBlockFlags & 0x80) != 0;
+    if (nBlockFlags & 0x3C) {
+        return false;
+    }
 
+    qint32 nNumFilters = (nBlockFlags & 0x03) + 1;
     qint32 nBHPos = 2;
-    quint64 nCompressedSize64 = 0;
-    quint64 nUncompressedSize64 = 0;
-
-    if (bHasCompressedSize) {
-        if (!Algo_utils::xzReadVarInt(baBH, nBHPos, nCompressedSize64)) {
+    qint32 nBHLimit = nHeaderSize - 4;
+    QByteArray baBHFields = baBH.left(nBHLimit);
+    qint64 nDataSize = -1;
+    qint64 nHeaderUncompressedSize = -1;
+
+    if (nBlockFlags & 0x40) {
+        quint64 nValue = 0;
+        if (!Algo_utils::xzReadVarInt(baBHFields, nBHPos, nValue) || (nValue == 0)) {
             return false;
         }
+        nDataSize = (qint64)nValue;
     }
-    if (bHasUncompressedSize) {
-        if (!Algo_utils::xzReadVarInt(baBH, nBHPos, nUncompressedSize64)) {
+
+    if (nBlockFlags & 0x80) {
+        quint64 nValue = 0;
+        if (!Algo_utils::xzReadVarInt(baBHFields, nBHPos, nValue)) {
             return false;
         }
+        nHeaderUncompressedSize = (qint64)nValue;
     }
 
-    // Parse filter chain: find LZMA2 props byte and collect pre-filters (delta/branch)
+    // Parse filter chain: the last filter must be LZMA2, the others delta/branch filters
     QList<QPair<quint64, QByteArray>> listFilters;
+    bool bLZMA2 = false;
     quint8 nLZMA2PropsByte = 0;
 
-    for (qint32 nFilter = 0; nFilter < nNumFilters && nFilter < 4; nFilter++) {
+    for (qint32 nFilter = 0; nFilter < nNumFilters; nFilter++) {
         quint64 nFilterID = 0;
         quint64 nPropSize = 0;
-        if (!Algo_utils::xzReadVarInt(baBH, nBHPos, nFilterID)) {
+        if (!Algo_utils::xzReadVarInt(baBHFields, nBHPos, nFilterID) || !Algo_utils::xzReadVarInt(baBHFields, nBHPos, nPropSize)) {
             return false;
         }
-        if (!Algo_utils::xzReadVarInt(baBH, nBHPos, nPropSize)) {
+        if (nPropSize > (quint64)(nBHLimit - nBHPos)) {
             return false;
         }
-        if (nFilterID == 0x21) {  // LZMA2
-            if (nPropSize == 1 && nBHPos < baBH.size()) {
-                nLZMA2PropsByte = (quint8)baBH.at(nBHPos);
-            }
-        } else if ((nFilterID >= 0x03) && (nFilterID <= 0x0A)) {  // Delta / branch filters
-            listFilters.append(qMakePair(nFilterID, baBH.mid(nBHPos, (qint32)nPropSize)));
+
+        bool bLast = (nFilter == (nNumFilters - 1));
+
+        if ((nFilterID == 0x21) && bLast && (nPropSize == 1)) {  // LZMA2
+            nLZMA2PropsByte = (quint8)baBHFields.at(nBHPos);
+            bLZMA2 = true;
+        } else if ((nFilterID >= 0x03) && (nFilterID <= 0x0A) && !bLast) {  // Delta / branch filters
+            listFilters.append(qMakePair(nFilterID, baBHFields.mid(nBHPos, (qint32)nPropSize)));
+        } else {
+            return false;
         }
         nBHPos += (qint32)nPropSize;
     }
 
-    // --- 3. Locate compressed block data ---
-    qint64 nDataOffset = nBlockHeaderOffset + nActualHeaderSize;
-    qint64 nDataSize = 0;
-    if (bHasCompressedSize) {
-        nDataSize = (qint64)nCompressedSize64;
-    } else {
-        // Generous estimate; LZMA2 end-of-stream marker stops decompression naturally
-        nDataSize = nTotalSize - 12 - nActualHeaderSize - 12;
-        if (nDataSize <= 0) {
+    if (!bLZMA2) {
+        return false;
+    }
+
+    qint32 nCheckSize = xzCheckSize(nCheckType);
+
+    if (nUnpaddedSize != -1) {
+        qint64 nIndexDataSize = nUnpaddedSize - nHeaderSize - nCheckSize;
+        if ((nIndexDataSize <= 0) || ((nDataSize != -1) && (nDataSize != nIndexDataSize))) {
             return false;
         }
+        nDataSize = nIndexDataSize;
     }
 
-    pDevice->seek(nDataOffset);
-    QByteArray baCompressed = pDevice->read(nDataSize);
-    if (baCompressed.isEmpty()) {
+    if ((nUncompressedSize != -1) && (nHeaderUncompressedSize != -1) && (nUncompressedSize != nHeaderUncompressedSize)) {
         return false;
     }
 
-    QBuffer compressedBuffer(&baCompressed);
-    if (!compressedBuffer.open(QIODevice::ReadOnly)) {
+    if (nHeaderUncompressedSize != -1) {
+        nUncompressedSize = nHeaderUncompressedSize;
+    }
+
+    qint64 nDataOffset = nBlockOffset + nHeaderSize;
+    qint64 nDataLimit = nBlockLimit - nHeaderSize;
+
+    if (nDataSize != -1) {
+        if (nHeaderSize + xzAlign4(nDataSize) + nCheckSize > nBlockLimit) {
+            return false;
+        }
+        nDataLimit = nDataSize;
+    }
+
+    XZBlockOutput blockOutput(pDeviceOutput, nCheckType, nSkip, nTake);
+    if (!blockOutput.open(QIODevice::WriteOnly | QIODevice::Unbuffered)) {
         return false;
     }
 
     QByteArray baPropByte;
     baPropByte.append((char)nLZMA2PropsByte);
 
-    bool bDecompressResult = false;
+    XBinary::DATAPROCESS_STATE lzma2State = {};
+    lzma2State.pDeviceInput = pDevice;
+    lzma2State.nInputOffset = nDataOffset;
+    lzma2State.nInputLimit = nDataLimit;
+    lzma2State.nProcessedOffset = 0;
+    lzma2State.nProcessedLimit = -1;
+
+    bool bResult = false;
 
     if (!listFilters.isEmpty()) {
         // Decompress LZMA2 to intermediate buffer, then apply the pre-filters in reverse order
         QByteArray baIntermediate;
         QBuffer intermediateBuffer(&baIntermediate);
-        if (!intermediateBuffer.open(QIODevice::WriteOnly)) {
+        if (intermediateBuffer.open(QIODevice::WriteOnly)) {
+            lzma2State.pDeviceOutput = &intermediateBuffer;
+            bResult = XLZMADecoder::decompressLZMA2(&lzma2State, baPropByte, pPdStruct);
+            intermediateBuffer.close();
+        }
+
+        if (bResult) {
+            xzApplyFilters(baIntermediate, listFilters);
+            bResult = (blockOutput.write(baIntermediate) == baIntermediate.size());
+        }
+    } else {
+        lzma2State.pDeviceOutput = &blockOutput;
+        bResult = XLZMADecoder::decompressLZMA2(&lzma2State, baPropByte, pPdStruct);
+    }
+
+    blockOutput.close();
+
+    if (!bResult || !XBinary::isPdStructNotCanceled(pPdStruct)) {
+        return false;
+    }
+
+    if ((nUncompressedSize != -1) && (blockOutput.getTotal() != nUncompressedSize)) {
+        return false;
+    }
+
+    if (nDataSize == -1) {
+        // No size anywhere: the decoder stopped at the LZMA2 end marker, the block extent is unknown
+        if (lzma2State.nCountInput <= 0) {
             return false;
         }
+    } else {
+        if (nCheckSize > 0) {
+            QByteArray baCheck = xzReadBytes(pDevice, nDataOffset + xzAlign4(nDataSize), nCheckSize);
+            if (baCheck.size() != nCheckSize) {
+                return false;
+            }
 
-        XBinary::DATAPROCESS_STATE lzma2State = {};
-        lzma2State.pDeviceInput = &compressedBuffer;
-        lzma2State.pDeviceOutput = &intermediateBuffer;
-        lzma2State.nInputOffset = 0;
-        lzma2State.nInputLimit = baCompressed.size();
-        lzma2State.nProcessedOffset = 0;
-        lzma2State.nProcessedLimit = -1;
+            if (bVerifyCheck && blockOutput.isCheckSupported() && (baCheck != blockOutput.getCheck())) {
+                return false;
+            }
+        }
 
-        bDecompressResult = XLZMADecoder::decompressLZMA2(&lzma2State, baPropByte, pPdStruct);
-        intermediateBuffer.close();
+        pResult->nBlockSize = nHeaderSize + xzAlign4(nDataSize) + nCheckSize;
+    }
 
-        if (bDecompressResult) {
-            for (qint32 i = listFilters.count() - 1; i >= 0; i--) {
-                quint64 nFilterID = listFilters.at(i).first;
-                const QByteArray &baProps = listFilters.at(i).second;
+    pResult->nUncompressedSize = blockOutput.getTotal();
+    pResult->nForwarded = blockOutput.getForwarded();
 
-                if (nFilterID == 0x03) {  // Delta: 1-byte prop = distance - 1
-                    qint32 nDistance = baProps.isEmpty() ? 1 : ((qint32)(quint8)baProps.at(0) + 1);
-                    XBranchDecoder::applyDeltaDecode(baIntermediate, nDistance);
-                } else {
-                    // Branch filters: optional 4-byte LE start offset property
-                    quint32 nIp = 0;
-                    if (baProps.size() >= 4) {
-                        nIp = (quint32)(quint8)baProps.at(0) | ((quint32)(quint8)baProps.at(1) << 8) | ((quint32)(quint8)baProps.at(2) << 16) |
-                              ((quint32)(quint8)baProps.at(3) << 24);
-                    }
+    return true;
+}
+
+class XZBlockRunnable : public QRunnable {
+public:
+    XZBlockRunnable(const XLZMADecoder::XZ_BLOCK &block, bool bVerifyCheck, qint64 nSkip, qint64 nTake, XBinary::PDSTRUCT *pPdStruct)
+        : m_block(block), m_bVerifyCheck(bVerifyCheck), m_nSkip(nSkip), m_nTake(nTake), m_pPdStruct(pPdStruct), m_bSuccess(false)
+    {
+        setAutoDelete(false);
+    }
+
+    QByteArray *getInput()
+    {
+        return &m_baInput;
+    }
+
+    const QByteArray &getOutput() const
+    {
+        return m_baOutput;
+    }
+
+    bool isSuccess() const
+    {
+        return m_bSuccess;
+    }
+
+    void run() override
+    {
+        QBuffer bufferInput(&m_baInput);
+        QBuffer bufferOutput(&m_baOutput);
+
+        if (bufferInput.open(QIODevice::ReadOnly) && bufferOutput.open(QIODevice::WriteOnly)) {
+            XZ_BLOCK_RESULT result = {};
+            m_bSuccess = xzDecompressBlock(&bufferInput, 0, m_baInput.size(), m_block.nCheckType, m_block.nUnpaddedSize, m_block.nUncompressedSize, m_bVerifyCheck,
+                                           &bufferOutput, m_nSkip, m_nTake, &result, m_pPdStruct);
+        }
+    }
 
-                    if (nFilterID == 0x04) {
-                        Algo_utils::applyBCJX86Decode(baIntermediate, nIp);
-                    } else if (nFilterID == 0x05) {
-                        XBranchDecoder::applyBranchDecode(baIntermediate, XBranchDecoder::BTYPE_PPC, nIp);
-                    } else if (nFilterID == 0x06) {
-                        XBranchDecoder::applyBranchDecode(baIntermediate, XBranchDecoder::BTYPE_IA64, nIp);
-                    } else if (nFilterID == 0x07) {
-                        XBranchDecoder::applyBranchDecode(baIntermediate, XBranchDecoder::BTYPE_ARM, nIp);
-                    } else if (nFilterID == 0x08) {
-                        XBranchDecoder::applyBranchDecode(baIntermediate, XBranchDecoder::BTYPE_ARMT, nIp);
-                    } else if (nFilterID == 0x09) {
-                        XBranchDecoder::applyBranchDecode(baIntermediate, XBranchDecoder::BTYPE_SPARC, nIp);
-                    } else if (nFilterID == 0x0A) {
-                        XBranchDecoder::applyBranchDecode(baIntermediate, XBranchDecoder::BTYPE_ARM64, nIp);
+private:
+    XLZMADecoder::XZ_BLOCK m_block;
+    bool m_bVerifyCheck;
+    qint64 m_nSkip;
+    qint64 m_nTake;
+    XBinary::PDSTRUCT *m_pPdStruct;
+    QByteArray m_baInput;
+    QByteArray m_baOutput;
+    bool m_bSuccess;
+};
+
+}  // namespace
+
+bool XLZMADecoder::getXZBlocks(QIODevice *pDevice, qint64 nOffset, qint64 nSize, QList<XZ_BLOCK> *pListBlocks, XBinary::PDSTRUCT *pPdStruct)
+{
+    if (!pDevice || !pListBlocks || (nOffset < 0) || (nSize < 32)) {
+        return false;
+    }
+
+    QList<QList<XZ_BLOCK>> listStreams;  // Collected last stream first
+    qint64 nEnd = nOffset + nSize;
+
+    while ((nEnd > nOffset) && XBinary::isPdStructNotCanceled(pPdStruct)) {
+        // Stream padding: multiples of four zero bytes
+        while (nEnd - nOffset >= 4) {
+            QByteArray baPadding = xzReadBytes(pDevice, nEnd - 4, 4);
+            if ((baPadding.size() != 4) || (xzReadLE32(baPadding.constData()) != 0)) {
+                break;
+            }
+            nEnd -= 4;
+        }
+
+        if (nEnd - nOffset < 32) {
+            return false;
+        }
+
+        QByteArray baFooter = xzReadBytes(pDevice, nEnd - 12, 12);
+        if ((baFooter.size() != 12) || (memcmp(baFooter.constData() + 10, XZ_FOOTER_MAGIC, 2) != 0)) {
+            return false;
+        }
+        if (xzCRC32(baFooter.constData() + 4, 6) != xzReadLE32(baFooter.constData())) {
+            return false;
+        }
+
+        qint64 nIndexSize = ((qint64)xzReadLE32(baFooter.constData() + 4) + 1) * 4;
+        qint64 nIndexOffset = nEnd - 12 - nIndexSize;
+        if (nIndexOffset < nOffset + 12) {
+            return false;
+        }
+
+        QByteArray baIndex = xzReadBytes(pDevice, nIndexOffset, nIndexSize);
+        if ((baIndex.size() != nIndexSize) || (baIndex.at(0) != 0)) {
+            return false;
+        }
+        if (xzCRC32(baIndex.constData(), nIndexSize - 4) != xzReadLE32(baIndex.constData() + nIndexSize - 4)) {
+            return false;
+        }
+
+        QByteArray baIndexFields = baIndex.left(nIndexSize - 4);
+        qint32 nPos = 1;
+        quint64 nNumberOfRecords = 0;
+        if (!Algo_utils::xzReadVarInt(baIndexFields, nPos, nNumberOfRecords) || (nNumberOfRecords > (quint64)nIndexSize)) {
+            return false;
+        }
+
+        QList<XZ_BLOCK> listBlocks;
+        qint64 nBlocksSize = 0;
+
+        for (quint64 i = 0; i < nNumberOfRecords; i++) {
+            quint64 nUnpadded = 0;
+            quint64 nUncompressed = 0;
+            if (!Algo_utils::xzReadVarInt(baIndexFields, nPos, nUnpadded) || !Algo_utils::xzReadVarInt(baIndexFields, nPos, nUncompressed)) {
+                return false;
+            }
+            if ((nUnpadded < 5) || (nUnpadded > (quint64)nSize)) {
+                return false;
+            }
+
+            XZ_BLOCK block = {};
+            block.nUnpaddedSize = (qint64)nUnpadded;
+            block.nUncompressedSize = (qint64)nUncompressed;
+            block.nOffset = nBlocksSize;  // Relative for now
+            listBlocks.append(block);
+
+            nBlocksSize += xzAlign4((qint64)nUnpadded);
+        }
+
+        // Index padding must be zero up to the CRC32
+        for (; nPos < baIndexFields.size(); nPos++) {
+            if (baIndexFields.at(nPos) != 0) {
+                return false;
+            }
+        }
+        if (xzAlign4(nPos) != baIndexFields.size()) {
+            return false;
+        }
+
+        qint64 nStreamOffset = nIndexOffset - nBlocksSize - 12;
+        if (nStreamOffset < nOffset) {
+            return false;
+        }
+
+        QByteArray baHeader = xzReadBytes(pDevice, nStreamOffset, 12);
+        if ((baHeader.size() != 12) || (memcmp(baHeader.constData(), XZ_HEADER_MAGIC, 6) != 0)) {
+            return false;
+        }
+        if (xzCRC32(baHeader.constData() + 6, 2) != xzReadLE32(baHeader.constData() + 8)) {
+            return false;
+        }
+        if ((baHeader.at(6) != baFooter.at(8)) || (baHeader.at(7) != baFooter.at(9)) || ((quint8)baHeader.at(7) & 0xF0) || baHeader.at(6)) {
+            return false;
+        }
+
+        quint8 nCheckType = (quint8)baHeader.at(7) & 0x0F;
+
+        for (qint32 i = 0; i < listBlocks.count(); i++) {
+            listBlocks[i].nOffset += nStreamOffset + 12;
+            listBlocks[i].nCheckType = nCheckType;
+        }
+
+        listStreams.prepend(listBlocks);
+        nEnd = nStreamOffset;
+    }
+
+    if (!XBinary::isPdStructNotCanceled(pPdStruct)) {
+        return false;
+    }
+
+    pListBlocks->clear();
+    qint64 nUncompressedOffset = 0;
+
+    for (qint32 i = 0; i < listStreams.count(); i++) {
+        const QList<XZ_BLOCK> &listBlocks = listStreams.at(i);
+
+        for (qint32 j = 0; j < listBlocks.count(); j++) {
+            XZ_BLOCK block = listBlocks.at(j);
+            block.nUncompressedOffset = nUncompressedOffset;
+            nUncompressedOffset += block.nUncompressedSize;
+            pListBlocks->append(block);
+        }
+    }
+
+    return true;
+}
+
+bool XLZMADecoder::decompressXZ(XBinary::DATAPROCESS_STATE *pDecompressState, XBinary::PDSTRUCT *pPdStruct)
+{
+    if (!pDecompressState || !pDecompressState->pDeviceInput || !pDecompressState->pDeviceOutput) {
+        return false;
+    }
+
+    QIODevice *pDevice = pDecompressState->pDeviceInput;
+    qint64 nOffset = pDecompressState->nInputOffset;
+    qint64 nTotalSize = pDecompressState->nInputLimit;
+
+    if (nTotalSize == -1) {
+        nTotalSize = pDevice->size() - nOffset;
+    }
+
+    if (nTotalSize < 28) {  // stream header(12) + minimal block header(4) + stream footer(12)
+        return false;
+    }
+
+    // Validate the first XZ stream header (12 bytes)
+    QByteArray baStreamHeader = xzReadBytes(pDevice, nOffset, 12);
+    if ((baStreamHeader.size() != 12) || (memcmp(baStreamHeader.constData(), XZ_HEADER_MAGIC, 6) != 0)) {
+        return false;
+    }
+    if (xzCRC32(baStreamHeader.constData() + 6, 2) != xzReadLE32(baStreamHeader.constData() + 8)) {
+        return false;
+    }
+
+    quint8 nCheckType = (quint8)baStreamHeader.at(7) & 0x0F;
+    bool bVerifyCheck = XBinary::isUnpackCRCEnabled(pDecompressState->mapUnpackProperties, XBinary::CRC_TYPE_FFFFFFFF_EDB88320_FFFFFFFFF);
+
+    // Output window in uncompressed coordinates
+    qint64 nWriteFrom = (std::max)(pDecompressState->nProcessedOffset, (qint64)0);
+    qint64 nWriteEnd = (pDecompressState->nProcessedLimit == -1) ? -1 : (nWriteFrom + pDecompressState->nProcessedLimit);
+
+    pDecompressState->pDeviceOutput->seek(0);
+    pDecompressState->nCountInput = 0;
+    pDecompressState->nCountOutput = 0;
+
+    bool bResult = false;
+    QList<XZ_BLOCK> listBlocks;
+
+    if (getXZBlocks(pDevice, nOffset, nTotalSize, &listBlocks, pPdStruct)) {
+        // The index is valid: decode only the blocks overlapping the requested window
+        QList<XZ_BLOCK> listSelected;
+        bool bParallel = (QThread::idealThreadCount() > 1);
+
+        for (qint32 i = 0; i < listBlocks.count(); i++) {
+            const XZ_BLOCK &block = listBlocks.at(i);
+
+            if ((block.nUncompressedOffset + block.nUncompressedSize <= nWriteFrom) || (block.nUncompressedSize == 0)) {
+                continue;
+            }
+            if ((nWriteEnd != -1) && (block.nUncompressedOffset >= nWriteEnd)) {
+                break;
+            }
+
+            if ((block.nUnpaddedSize > XZ_PARALLEL_BLOCK_LIMIT) || (block.nUncompressedSize > XZ_PARALLEL_BLOCK_LIMIT)) {
+                bParallel = false;
+            }
+
+            listSelected.append(block);
+        }
+
+        if (listSelected.count() < 2) {
+            bParallel = false;
+        }
+
+        bResult = true;
+
+        if (bParallel) {
+            // Workers decode a batch of blocks from memory, the caller writes them out in order
+            qint32 nNumberOfThreads = QThread::idealThreadCount();
+            QThreadPool threadPool;
+            threadPool.setMaxThreadCount(nNumberOfThreads);
+
+            for (qint32 i = 0; (i < listSelected.count()) && bResult && XBinary::isPdStructNotCanceled(pPdStruct); i += nNumberOfThreads) {
+                qint32 nBatchCount = (std::min)(nNumberOfThreads, (qint32)(listSelected.count() - i));
+                QList<XZBlockRunnable *> listTasks;
+
+                for (qint32 j = 0; j < nBatchCount; j++) {
+                    const XZ_BLOCK &block = listSelected.at(i + j);
+                    qint64 nSkip = (std::max)(nWriteFrom - block.nUncompressedOffset, (qint64)0);
+                    qint64 nTake = (nWriteEnd == -1) ? -1 : ((std::min)(nWriteEnd - block.nUncompressedOffset, block.nUncompressedSize) - nSkip);
+
+                    XZBlockRunnable *pTask = new XZBlockRunnable(block, bVerifyCheck, nSkip, nTake, pPdStruct);
+                    *(pTask->getInput()) = xzReadBytes(pDevice, block.nOffset, xzAlign4(block.nUnpaddedSize));
+                    listTasks.append(pTask);
+                    threadPool.start(pTask);
+                }
+
+                threadPool.waitForDone();
+
+                for (qint32 j = 0; j < listTasks.count(); j++) {
+                    XZBlockRunnable *pTask = listTasks.at(j);
+
+                    if (bResult && pTask->isSuccess()) {
+                        const QByteArray &baOutput = pTask->getOutput();
+
+                        if (pDecompressState->pDeviceOutput->write(baOutput) == baOutput.size()) {
+                            pDecompressState->nCountOutput += baOutput.size();
+                        } else {
+                            pDecompressState->bWriteError = true;
+                            bResult = false;
+                        }
+                    } else {
+                        bResult = false;
                     }
+
+                    delete pTask;
                 }
             }
+        } else {
+            for (qint32 i = 0; (i < listSelected.count()) && bResult && XBinary::isPdStructNotCanceled(pPdStruct); i++) {
+                const XZ_BLOCK &block = listSelected.at(i);
+                qint64 nSkip = (std::max)(nWriteFrom - block.nUncompressedOffset, (qint64)0);
+                qint64 nTake = (nWriteEnd == -1) ? -1 : ((std::min)(nWriteEnd - block.nUncompressedOffset, block.nUncompressedSize) - nSkip);
+
+                XZ_BLOCK_RESULT result = {};
+                bResult = xzDecompressBlock(pDevice, block.nOffset, xzAlign4(block.nUnpaddedSize), block.nCheckType,
+                                            block.nUnpaddedSize, block.nUncompressedSize, bVerifyCheck, pDecompressState->pDeviceOutput, nSkip, nTake, &result, pPdStruct);
+                pDecompressState->nCountOutput += result.nForwarded;
+            }
+        }
+
+        if (bResult) {
+            pDecompressState->nCountInput = nTotalSize;
+        }
+    } else {
+        // No usable index (truncated or trailing data): walk the blocks of the first stream by their headers.
+        // Reaching the index indicator (or the end of the requested window) is the only clean exit.
+        qint64 nBlockOffset = nOffset + 12;
+        qint64 nUncompressedOffset = 0;
+
+        while (XBinary::isPdStructNotCanceled(pPdStruct)) {
+            if ((nWriteEnd != -1) && (nUncompressedOffset >= nWriteEnd)) {
+                bResult = true;
+                break;
+            }
+
+            QByteArray baIndicator = xzReadBytes(pDevice, nBlockOffset, 1);
+            if (baIndicator.size() != 1) {
+                break;  // Truncated before the index
+            }
 
-            qint64 nWriteFrom = pDecompressState->nProcessedOffset;
-            qint64 nWriteLimit = pDecompressState->nProcessedLimit;
-            if (nWriteLimit == -1) {
-                nWriteLimit = baIntermediate.size();
+            if (baIndicator.at(0) == 0) {
+                bResult = true;
+                break;  // Index reached
             }
-            qint64 nToWrite = (std::min)(nWriteLimit, (qint64)(baIntermediate.size() - nWriteFrom));
-            if (nToWrite > 0 && nWriteFrom >= 0) {
-                pDecompressState->pDeviceOutput->seek(0);
-                pDecompressState->pDeviceOutput->write(baIntermediate.constData() + nWriteFrom, nToWrite);
-                pDecompressState->nCountOutput = nToWrite;
+
+            qint64 nSkip = (std::max)(nWriteFrom - nUncompressedOffset, (qint64)0);
+            qint64 nTake = (nWriteEnd == -1) ? -1 : (std::max)(nWriteEnd - (std::max)(nWriteFrom, nUncompressedOffset), (qint64)0);
+
+            XZ_BLOCK_RESULT result = {};
+            if (!xzDecompressBlock(pDevice, nBlockOffset, nOffset + nTotalSize - nBlockOffset, nCheckType, -1, -1, bVerifyCheck, pDecompressState->pDeviceOutput, nSkip,
+                                   nTake, &result, pPdStruct)) {
+                break;
             }
+
+            pDecompressState->nCountOutput += result.nForwarded;
+            nUncompressedOffset += result.nUncompressedSize;
+
+            if (result.nBlockSize == -1) {
+                // Block extent unknown, cannot locate the next one; only fine if the window is complete
+                bResult = (nWriteEnd != -1) && (nUncompressedOffset >= nWriteEnd);
+                break;
+            }
+
+            nBlockOffset += result.nBlockSize;
+            pDecompressState->nCountInput = nBlockOffset - nOffset;
         }
-    } else {
-        // Pure LZMA2 — stream directly to output device
-        XBinary::DATAPROCESS_STATE lzma2State = {};
-        lzma2State.pDeviceInput = &compressedBuffer;
-        lzma2State.pDeviceOutput = pDecompressState->pDeviceOutput;
-        lzma2State.nInputOffset = 0;
-        lzma2State.nInputLimit = baCompressed.size();
-        lzma2State.nProcessedOffset = pDecompressState->nProcessedOffset;
-        lzma2State.nProcessedLimit = pDecompressState->nProcessedLimit;
+    }
+
+    return bResult && XBinary::isPdStructNotCanceled(pPdStruct);
+}
+
+bool XLZMADecoder::initCursor(STREAM_CURSOR *pCursor, XBinary::HANDLE_METHOD method, const QByteArray &baProperty, QIODevice *pDeviceInput, qint64 nInputOffset,
+                              qint64 nInputLimit, XBinary::PDSTRUCT *pPdStruct)
+{
+    if (!pCursor || !pDeviceInput || (nInputOffset < 0) || (nInputLimit < 0)) {
+        return false;
+    }
+
+    freeCursor(pCursor);
 
-        bDecompressResult = XLZMADecoder::decompressLZMA2(&lzma2State, baPropByte, pPdStruct);
+    SRes ret = SZ_ERROR_UNSUPPORTED;
 
-        if (bDecompressResult) {
-            pDecompressState->nCountInput = lzma2State.nCountInput;
-            pDecompressState->nCountOutput = lzma2State.nCountOutput;
+    if ((method == XBinary::HANDLE_METHOD_LZMA) && (baProperty.size() > 0) && (baProperty.size() < 30)) {
+        X_LzmaDec_Construct(&pCursor->lzmaState);
+        ret = X_LzmaDec_Allocate(&pCursor->lzmaState, (const Byte *)baProperty.constData(), baProperty.size(), Algo_utils::lzmaAlloc());
+
+        if (ret == SZ_OK) {
+            X_LzmaDec_Init(&pCursor->lzmaState);
         }
+    } else if ((method == XBinary::HANDLE_METHOD_LZMA2) && (baProperty.size() == 1)) {
+        X_Lzma2Dec_Construct(&pCursor->lzma2State);
+        ret = X_Lzma2Dec_Allocate(&pCursor->lzma2State, (Byte)baProperty.at(0), Algo_utils::lzmaAlloc());
+
+        if (ret == SZ_OK) {
+            X_Lzma2Dec_Init(&pCursor->lzma2State);
+        }
+    }
+
+    if (ret != SZ_OK) {
+        return false;
     }
 
-    compressedBuffer.close();
+    qint32 nBufferSize = XBinary::getBufferSize(pPdStruct);
+
+    pCursor->method = method;
+    pCursor->bAllocated = true;
+    pCursor->pDeviceInput = pDeviceInput;
+    pCursor->nInputOffset = nInputOffset;
+    pCursor->nInputLimit = nInputLimit;
+    pCursor->nCountInput = 0;
+    pCursor->nCountOutput = 0;
+    pCursor->baInput.resize(nBufferSize);
+    pCursor->baOutput.resize(nBufferSize);
+    pCursor->nInputBufferPos = 0;
+    pCursor->nInputBufferSize = 0;
+
+    return true;
+}
+
+bool XLZMADecoder::readCursor(STREAM_CURSOR *pCursor, QIODevice *pDeviceOutput, qint64 nSize, XBinary::PDSTRUCT *pPdStruct)
+{
+    // With pDeviceOutput == nullptr the decoded bytes are discarded (skip).
+    if (!pCursor || !pCursor->bAllocated || (nSize < 0)) {
+        return false;
+    }
+
+    qint64 nRemaining = nSize;
+
+    while ((nRemaining > 0) && XBinary::isPdStructNotCanceled(pPdStruct)) {
+        if (pCursor->nInputBufferPos >= pCursor->nInputBufferSize) {
+            // The input device is shared with other readers, so always seek.
+            qint32 nToRead = (qint32)(std::min)(pCursor->nInputLimit - pCursor->nCountInput, (qint64)pCursor->baInput.size());
+
+            pCursor->nInputBufferPos = 0;
+            pCursor->nInputBufferSize = 0;
+
+            if (nToRead > 0) {
+                if (!pCursor->pDeviceInput->seek(pCursor->nInputOffset + pCursor->nCountInput)) {
+                    return false;
+                }
+
+                qint64 nRead = pCursor->pDeviceInput->read(pCursor->baInput.data(), nToRead);
+
+                if (nRead <= 0) {
+                    return false;
+                }
+
+                pCursor->nInputBufferSize = (qint32)nRead;
+                pCursor->nCountInput += nRead;
+            }
+        }
+
+        SizeT nInProcessed = pCursor->nInputBufferSize - pCursor->nInputBufferPos;
+        SizeT nOutProcessed = (SizeT)(std::min)(nRemaining, (qint64)pCursor->baOutput.size());
+        ELzmaStatus status = LZMA_STATUS_NOT_SPECIFIED;
+        const Byte *pIn = (const Byte *)pCursor->baInput.constData() + pCursor->nInputBufferPos;
+        Byte *pOut = (Byte *)pCursor->baOutput.data();
+        SRes ret = SZ_OK;
 
-    return bDecompressResult;
+        if (pCursor->method == XBinary::HANDLE_METHOD_LZMA2) {
+            ret = X_Lzma2Dec_DecodeToBuf(&pCursor->lzma2State, pOut, &nOutProcessed, pIn, &nInProcessed, LZMA_FINISH_ANY, &status);
+        } else {
+            ret = X_LzmaDec_DecodeToBuf(&pCursor->lzmaState, pOut, &nOutProcessed, pIn, &nInProcessed, LZMA_FINISH_ANY, &status);
+        }
+
+        if (ret != SZ_OK) {
+            return false;
+        }
+
+        pCursor->nInputBufferPos += (qint32)nInProcessed;
+
+        if (nOutProcessed > 0) {
+            if (pDeviceOutput && (pDeviceOutput->write((const char *)pOut, (qint64)nOutProcessed) != (qint64)nOutProcessed)) {
+                return false;
+            }
+
+            nRemaining -= nOutProcessed;
+            pCursor->nCountOutput += nOutProcessed;
+        } else if (nInProcessed == 0) {
+            // No progress: truncated input or an end marker before the requested size.
+            return false;
+        }
+    }
+
+    return (nRemaining == 0);
+}
+
+void XLZMADecoder::freeCursor(STREAM_CURSOR *pCursor)
+{
+    if (pCursor && pCursor->bAllocated) {
+        if (pCursor->method == XBinary::HANDLE_METHOD_LZMA2) {
+            X_Lzma2Dec_Free(&pCursor->lzma2State, Algo_utils::lzmaAlloc());
+        } else {
+            X_LzmaDec_Free(&pCursor->lzmaState, Algo_utils::lzmaAlloc());
+        }
+
+        pCursor->bAllocated = false;
+    }
 }
 
 /* ===== Begin embedded xlzma_local.c ===== */
@@ -28,12 +28,44 @@ class XLZMADecoder : public QObject {
     Q_OBJECT
 
 public:
+    // Resumable LZMA/LZMA2 decoder for forward-only reads of a solid block.
+    // Memory is the dictionary plus two I/O buffers, independent of block size.
+    struct STREAM_CURSOR {
+        XBinary::HANDLE_METHOD method;
+        CLzmaDec lzmaState;
+        CLzma2Dec lzma2State;
+        bool bAllocated;
+        QIODevice *pDeviceInput;
+        qint64 nInputOffset;
+        qint64 nInputLimit;
+        qint64 nCountInput;
+        qint64 nCountOutput;
+        QByteArray baInput;
+        QByteArray baOutput;
+        qint32 nInputBufferPos;
+        qint32 nInputBufferSize;
+    };
+
+    // One block of an .xz file as described by the stream indexes
+    struct XZ_BLOCK {
+        qint64 nOffset;  // Block header offset in the device
+        qint64 nUnpaddedSize;
+        qint64 nUncompressedOffset;
+        qint64 nUncompressedSize;
+        quint8 nCheckType;
+    };
+
     explicit XLZMADecoder(QObject *parent = nullptr);
     static bool decompress(XBinary::DATAPROCESS_STATE *pDecompressState, XBinary::PDSTRUCT *pPdStruct = nullptr);
     static bool decompress(XBinary::DATAPROCESS_STATE *pDecompressState, const QByteArray &baProperty, XBinary::PDSTRUCT *pPdStruct = nullptr);
     static bool decompressLZMA2(XBinary::DATAPROCESS_STATE *pDecompressState, XBinary::PDSTRUCT *pPdStruct = nullptr);
     static bool decompressLZMA2(XBinary::DATAPROCESS_STATE *pDecompressState, const QByteArray &baProperty, XBinary::PDSTRUCT *pPdStruct = nullptr);
     static bool decompressXZ(XBinary::DATAPROCESS_STATE *pDecompressState, XBinary::PDSTRUCT *pPdStruct = nullptr);
+    static bool getXZBlocks(QIODevice *pDevice, qint64 nOffset, qint64 nSize, QList<XZ_BLOCK> *pListBlocks, XBinary::PDSTRUCT *pPdStruct = nullptr);
+    static bool initCursor(STREAM_CURSOR *pCursor, XBinary::HANDLE_METHOD method, const QByteArray &baProperty, QIODevice *pDeviceInput, qint64 nInputOffset,
+                           qint64 nInputLimit, XBinary::PDSTRUCT *pPdStruct = nullptr);
+    static bool readCursor(STREAM_CURSOR *pCursor, QIODevice *pDeviceOutput, qint64 nSize, XBinary::PDSTRUCT *pPdStruct = nullptr);
+    static void freeCursor(STREAM_CURSOR *pCursor);
 };
 
 #endif  // XLZMADECODER_H
@@ -0,0 +1,830 @@
+/* Copyright (c) 2026 hors<horsicq@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "xlzmsdecoder.h"
+
+#include <algorithm>
+
+namespace {
+
+const qint32 LZMS_NUM_LZ_REPS = 3;
+const qint32 LZMS_NUM_DELTA_REPS = 3;
+
+const quint32 LZMS_NUM_MAIN_PROBS = 16;
+const quint32 LZMS_NUM_MATCH_PROBS = 32;
+const quint32 LZMS_NUM_LZ_PROBS = 64;
+const quint32 LZMS_NUM_LZ_REP_PROBS = 64;
+const quint32 LZMS_NUM_DELTA_PROBS = 64;
+const quint32 LZMS_NUM_DELTA_REP_PROBS = 64;
+
+const quint32 LZMS_PROBABILITY_BITS = 6;
+const quint32 LZMS_PROBABILITY_DENOMINATOR = 1 << LZMS_PROBABILITY_BITS;
+const quint32 LZMS_INITIAL_PROBABILITY = 48;
+const quint64 LZMS_INITIAL_RECENT_BITS = 0x0000000055555555ULL;
+
+const qint32 LZMS_NUM_LITERAL_SYMS = 256;
+const qint32 LZMS_NUM_LENGTH_SYMS = 54;
+const qint32 LZMS_NUM_DELTA_POWER_SYMS = 8;
+const qint32 LZMS_MAX_NUM_OFFSET_SYMS = 799;
+const qint32 LZMS_MAX_NUM_SYMS = LZMS_MAX_NUM_OFFSET_SYMS;
+const qint32 LZMS_MAX_CODEWORD_LEN = 15;
+
+const qint32 LZMS_LITERAL_CODE_REBUILD_FREQ = 1024;
+const qint32 LZMS_LZ_OFFSET_CODE_REBUILD_FREQ = 1024;
+const qint32 LZMS_LENGTH_CODE_REBUILD_FREQ = 512;
+const qint32 LZMS_DELTA_OFFSET_CODE_REBUILD_FREQ = 1024;
+const qint32 LZMS_DELTA_POWER_CODE_REBUILD_FREQ = 512;
+
+const qint32 LZMS_X86_ID_WINDOW_SIZE = 65535;
+const qint32 LZMS_X86_MAX_TRANSLATION_OFFSET = 1023;
+
+const qint32 LZMS_TABLE_BITS = 10;
+const qint32 LZMS_NUM_SYMBOL_BITS = 10;
+const quint32 LZMS_SYMBOL_MASK = (1u << LZMS_NUM_SYMBOL_BITS) - 1;
+
+// ---- Slot tables ----
+//
+// Consecutive slot bases differ by increasing powers of two; the run lengths
+// below give how many slots use each power (1, 2, 4, ...). The last slot is
+// closed by a fixed upper bound.
+
+const quint8 LZMS_OFFSET_SLOT_DELTA_RUN_LENS[] = {9, 0, 9, 7, 10, 15, 15, 20, 20, 30, 33, 40, 42, 45, 60, 73, 80, 85, 95, 105, 6};
+const quint8 LZMS_LENGTH_SLOT_DELTA_RUN_LENS[] = {27, 4, 6, 4, 5, 2, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 1};
+
+struct LZMS_SLOTS {
+    quint32 nOffsetBase[LZMS_MAX_NUM_OFFSET_SYMS + 1];
+    quint8 nOffsetExtraBits[LZMS_MAX_NUM_OFFSET_SYMS];
+    quint32 nLengthBase[LZMS_NUM_LENGTH_SYMS + 1];
+    quint8 nLengthExtraBits[LZMS_NUM_LENGTH_SYMS];
+};
+
+void lzms_decodeSlotBases(quint32 *pBases, quint8 *pExtraBits, const quint8 *pRunLens, qint32 nNumRunLens, quint32 nFinal)
+{
+    quint32 nOrder = 0;
+    quint32 nDelta = 1;
+    quint32 nBase = 0;
+    qint32 nSlot = 0;
+
+    for (qint32 i = 0; i < nNumRunLens; i++) {
+        for (qint32 j = 0; j < pRunLens[i]; j++) {
+            nBase += nDelta;
+
+            if (nSlot > 0) {
+                pExtraBits[nSlot - 1] = (quint8)nOrder;
+            }
+
+            pBases[nSlot++] = nBase;
+        }
+
+        nOrder++;
+        nDelta <<= 1;
+    }
+
+    pBases[nSlot] = nFinal;
+
+    quint32 nLastDelta = nFinal - pBases[nSlot - 1];
+    quint8 nLastBits = 0;
+
+    while (nLastDelta >>= 1) {
+        nLastBits++;
+    }
+
+    pExtraBits[nSlot - 1] = nLastBits;
+}
+
+LZMS_SLOTS lzms_makeSlots()
+{
+    LZMS_SLOTS slots = {};
+
+    lzms_decodeSlotBases(slots.nOffsetBase, slots.nOffsetExtraBits, LZMS_OFFSET_SLOT_DELTA_RUN_LENS, sizeof(LZMS_OFFSET_SLOT_DELTA_RUN_LENS), 0x7FFFFFFF);
+    lzms_decodeSlotBases(slots.nLengthBase, slots.nLengthExtraBits, LZMS_LENGTH_SLOT_DELTA_RUN_LENS, sizeof(LZMS_LENGTH_SLOT_DELTA_RUN_LENS), 0x400108AB);
+
+    return slots;
+}
+
+const LZMS_SLOTS *lzms_getSlots()
+{
+    static const LZMS_SLOTS g_slots = lzms_makeSlots();  // Thread-safe initialization
+
+    return &g_slots;
+}
+
+qint32 lzms_getNumOffsetSlots(const LZMS_SLOTS *pSlots, qint32 nUncompressedSize)
+{
+    if (nUncompressedSize < 2) {
+        return 0;
+    }
+
+    quint32 nOffset = (quint32)nUncompressedSize - 1;
+
+    // Slot s holds offsets [base[s], base[s + 1])
+    const quint32 *pUpper = std::upper_bound(pSlots->nOffsetBase, pSlots->nOffsetBase + LZMS_MAX_NUM_OFFSET_SYMS, nOffset);
+
+    return (qint32)(pUpper - pSlots->nOffsetBase);
+}
+
+// ---- Range decoder (forward 16-bit LE units) ----
+
+struct LZMS_PROB {
+    quint32 nZeroBits;     // Number of 0 bits among the last 64 decisions
+    quint64 nRecentBits;
+};
+
+struct LZMS_RANGE {
+    quint32 nRange;
+    quint32 nCode;
+    const quint8 *pNext;
+    const quint8 *pEnd;
+};
+
+void lzms_initProbs(LZMS_PROB *pProbs, qint32 nCount)
+{
+    for (qint32 i = 0; i < nCount; i++) {
+        pProbs[i].nZeroBits = LZMS_INITIAL_PROBABILITY;
+        pProbs[i].nRecentBits = LZMS_INITIAL_RECENT_BITS;
+    }
+}
+
+qint32 lzms_decodeBit(LZMS_RANGE *pRange, quint32 *pnState, quint32 nNumStates, LZMS_PROB *pProbs)
+{
+    LZMS_PROB *pProb = &pProbs[*pnState];
+
+    *pnState = ((*pnState) << 1) & (nNumStates - 1);
+
+    // 0% and 100% are not allowed
+    quint32 nProb = pProb->nZeroBits;
+
+    if (nProb == 0) {
+        nProb = 1;
+    } else if (nProb == LZMS_PROBABILITY_DENOMINATOR) {
+        nProb = LZMS_PROBABILITY_DENOMINATOR - 1;
+    }
+
+    if (!(pRange->nRange & 0xFFFF0000)) {
+        pRange->nRange <<= 16;
+        pRange->nCode <<= 16;
+
+        if (pRange->pNext != pRange->pEnd) {
+            pRange->nCode |= (quint32)pRange->pNext[0] | ((quint32)pRange->pNext[1] << 8);
+            pRange->pNext += 2;
+        }
+    }
+
+    quint32 nBound = (pRange->nRange >> LZMS_PROBABILITY_BITS) * nProb;
+    qint32 nBit = 0;
+
+    if (pRange->nCode < nBound) {
+        pRange->nRange = nBound;
+    } else {
+        pRange->nRange -= nBound;
+        pRange->nCode -= nBound;
+        nBit = 1;
+        *pnState |= 1;
+    }
+
+    pProb->nZeroBits += (qint32)(pProb->nRecentBits >> (LZMS_PROBABILITY_DENOMINATOR - 1)) - nBit;
+    pProb->nRecentBits = (pProb->nRecentBits << 1) | (quint64)nBit;
+
+    return nBit;
+}
+
+// ---- Huffman bitstream (backward 16-bit LE units, MSB first) ----
+
+struct LZMS_BITS {
+    const quint8 *pBegin;
+    const quint8 *pNext;
+    quint64 nBitBuf;
+    qint32 nBitsLeft;
+};
+
+void lzms_ensureBits(LZMS_BITS *pBits, qint32 nBits)
+{
+    while (pBits->nBitsLeft < nBits) {
+        quint64 nWord = 0;
+
+        if ((pBits->pNext - pBits->pBegin) >= 2) {
+            pBits->pNext -= 2;
+            nWord = (quint64)pBits->pNext[0] | ((quint64)pBits->pNext[1] << 8);
+        }
+
+        pBits->nBitBuf |= nWord << (48 - pBits->nBitsLeft);
+        pBits->nBitsLeft += 16;
+    }
+}
+
+quint32 lzms_peekBits(const LZMS_BITS *pBits, qint32 nBits)
+{
+    return (quint32)(pBits->nBitBuf >> (64 - nBits));
+}
+
+void lzms_removeBits(LZMS_BITS *pBits, qint32 nBits)
+{
+    pBits->nBitBuf <<= nBits;
+    pBits->nBitsLeft -= nBits;
+}
+
+quint32 lzms_readBits(LZMS_BITS *pBits, qint32 nBits)
+{
+    if (nBits == 0) {
+        return 0;
+    }
+
+    lzms_ensureBits(pBits, nBits);
+    quint32 nResult = lzms_peekBits(pBits, nBits);
+    lzms_removeBits(pBits, nBits);
+
+    return nResult;
+}
+
+// ---- Adaptive Huffman codes ----
+//
+// Every code starts with all frequencies at 1 and is rebuilt from the running
+// frequencies after a fixed number of symbols, after which the frequencies are
+// halved. Code lengths must match the encoder exactly, so the tree is built
+// the same way as the reference implementation: symbols sorted by
+// (frequency, symbol), leaves preferred over internal nodes on ties, and the
+// lengths limited to 15 bits by moving overlong nodes up.
+
+struct LZMS_HUFF {
+    qint32 nNumSyms;
+    qint32 nRebuildFreq;
+    qint32 nSymsUntilRebuild;
+    quint32 nFreqs[LZMS_MAX_NUM_SYMS];
+    quint16 nCount[LZMS_MAX_CODEWORD_LEN + 1];
+    quint16 nSymbol[LZMS_MAX_NUM_SYMS];
+    quint16 nTable[1 << LZMS_TABLE_BITS];  // (symbol << 4) | length, 0 = longer than LZMS_TABLE_BITS
+};
+
+void lzms_makeLengths(qint32 nNumSyms, const quint32 *pFreqs, quint8 *pLens)
+{
+    quint32 A[LZMS_MAX_NUM_SYMS];
+
+    for (qint32 i = 0; i < nNumSyms; i++) {
+        A[i] = (pFreqs[i] << LZMS_NUM_SYMBOL_BITS) | (quint32)i;
+    }
+
+    std::sort(A, A + nNumSyms);
+
+    // Build the tree in place: non-leaves overwrite the front of the array
+    qint32 i = 0;  // Next lowest-frequency leaf
+    qint32 b = 0;  // Next lowest-frequency non-leaf
+    qint32 e = 0;  // Next non-leaf to be created
+
+    do {
+        qint32 m = 0;
+        qint32 n = 0;
+
+        if ((i != nNumSyms) && ((b == e) || ((A[i] >> LZMS_NUM_SYMBOL_BITS) <= (A[b] >> LZMS_NUM_SYMBOL_BITS)))) {
+            m = i++;
+        } else {
+            m = b++;
+        }
+
+        if ((i != nNumSyms) && ((b == e) || ((A[i] >> LZMS_NUM_SYMBOL_BITS) <= (A[b] >> LZMS_NUM_SYMBOL_BITS)))) {
+            n = i++;
+        } else {
+            n = b++;
+        }
+
+        quint32 nFreqShifted = (A[m] & ~LZMS_SYMBOL_MASK) + (A[n] & ~LZMS_SYMBOL_MASK);
+
+        A[m] = (A[m] & LZMS_SYMBOL_MASK) | ((quint32)e << LZMS_NUM_SYMBOL_BITS);
+        A[n] = (A[n] & LZMS_SYMBOL_MASK) | ((quint32)e << LZMS_NUM_SYMBOL_BITS);
+        A[e] = (A[e] & LZMS_SYMBOL_MASK) | nFreqShifted;
+        e++;
+    } while ((nNumSyms - e) > 1);
+
+    // Depths of the non-leaves (parents come after their children), turned into length counts
+    quint32 nLenCounts[LZMS_MAX_CODEWORD_LEN + 2] = {};
+    nLenCounts[1] = 2;
+
+    qint32 nRoot = nNumSyms - 2;
+    A[nRoot] &= LZMS_SYMBOL_MASK;
+
+    for (qint32 nNode = nRoot - 1; nNode >= 0; nNode--) {
+        quint32 nParent = A[nNode] >> LZMS_NUM_SYMBOL_BITS;
+        quint32 nDepth = (A[nParent] >> LZMS_NUM_SYMBOL_BITS) + 1;
+        quint32 nLen = nDepth;
+
+        A[nNode] = (A[nNode] & LZMS_SYMBOL_MASK) | (nDepth << LZMS_NUM_SYMBOL_BITS);
+
+        if (nLen >= (quint32)LZMS_MAX_CODEWORD_LEN) {
+            nLen = LZMS_MAX_CODEWORD_LEN;
+
+            do {
+                nLen--;
+            } while (nLenCounts[nLen] == 0);
+        }
+
+        nLenCounts[nLen]--;
+        nLenCounts[nLen + 1] += 2;
+    }
+
+    // Longest lengths go to the lowest (frequency, symbol) entries
+    qint32 nIndex = 0;
+
+    for (qint32 nLen = LZMS_MAX_CODEWORD_LEN; nLen >= 1; nLen--) {
+        for (quint32 k = 0; k < nLenCounts[nLen]; k++) {
+            pLens[A[nIndex++] & LZMS_SYMBOL_MASK] = (quint8)nLen;
+        }
+    }
+}
+
+void lzms_rebuildHuff(LZMS_HUFF *pHuff)
+{
+    quint8 lens[LZMS_MAX_NUM_SYMS];
+    qint32 nNumSyms = pHuff->nNumSyms;
+
+    if (nNumSyms >= 2) {
+        lzms_makeLengths(nNumSyms, pHuff->nFreqs, lens);
+    } else {
+        lens[0] = 1;
+    }
+
+    for (qint32 i = 0; i <= LZMS_MAX_CODEWORD_LEN; i++) {
+        pHuff->nCount[i] = 0;
+    }
+
+    for (qint32 i = 0; i < nNumSyms; i++) {
+        pHuff->nCount[lens[i]]++;
+    }
+
+    qint32 nOffsets[LZMS_MAX_CODEWORD_LEN + 2];
+    nOffsets[1] = 0;
+
+    for (qint32 nLen = 1; nLen <= LZMS_MAX_CODEWORD_LEN; nLen++) {
+        nOffsets[nLen + 1] = nOffsets[nLen] + pHuff->nCount[nLen];
+    }
+
+    for (qint32 i = 0; i < nNumSyms; i++) {
+        pHuff->nSymbol[nOffsets[lens[i]]++] = (quint16)i;
+    }
+
+    // Direct lookup for codes up to LZMS_TABLE_BITS; canonical codes are assigned in (length, symbol) order
+    std::fill(pHuff->nTable, pHuff->nTable + (1 << LZMS_TABLE_BITS), (quint16)0);
+
+    quint32 nCode = 0;
+    qint32 nIndex = 0;
+
+    for (qint32 nLen = 1; nLen <= LZMS_TABLE_BITS; nLen++) {
+        for (qint32 k = 0; k < pHuff->nCount[nLen]; k++) {
+            quint16 nEntry = (quint16)((pHuff->nSymbol[nIndex++] << 4) | nLen);
+            quint32 nStart = nCode << (LZMS_TABLE_BITS - nLen);
+            quint32 nEnd = (nCode + 1) << (LZMS_TABLE_BITS - nLen);
+
+            std::fill(pHuff->nTable + nStart, pHuff->nTable + nEnd, nEntry);
+            nCode++;
+        }
+
+        nCode <<= 1;
+    }
+
+    if (nNumSyms == 1) {
+        // Degenerate one-symbol code: both 1-bit codes decode to symbol 0
+        std::fill(pHuff->nTable, pHuff->nTable + (1 << LZMS_TABLE_BITS), (quint16)((0 << 4) | 1));
+    }
+
+    for (qint32 i = 0; i < nNumSyms; i++) {
+        pHuff->nFreqs[i] = (pHuff->nFreqs[i] >> 1) + 1;
+    }
+
+    pHuff->nSymsUntilRebuild = pHuff->nRebuildFreq;
+}
+
+void lzms_initHuff(LZMS_HUFF *pHuff, qint32 nNumSyms, qint32 nRebuildFreq)
+{
+    pHuff->nNumSyms = nNumSyms;
+    pHuff->nRebuildFreq = nRebuildFreq;
+
+    for (qint32 i = 0; i < nNumSyms; i++) {
+        pHuff->nFreqs[i] = 1;
+    }
+
+    lzms_rebuildHuff(pHuff);
+}
+
+qint32 lzms_decodeSym(LZMS_BITS *pBits, LZMS_HUFF *pHuff)
+{
+    lzms_ensureBits(pBits, LZMS_MAX_CODEWORD_LEN);
+
+    qint32 nSym = -1;
+    quint16 nEntry = pHuff->nTable[lzms_peekBits(pBits, LZMS_TABLE_BITS)];
+
+    if (nEntry) {
+        nSym = nEntry >> 4;
+        lzms_removeBits(pBits, nEntry & 0x0F);
+    } else {
+        quint32 nPeek = lzms_peekBits(pBits, LZMS_MAX_CODEWORD_LEN);
+        qint32 nCode = 0;
+        qint32 nFirst = 0;
+        qint32 nIndex = 0;
+
+        for (qint32 nLen = 1; nLen <= LZMS_MAX_CODEWORD_LEN; nLen++) {
+            nCode |= (qint32)((nPeek >> (LZMS_MAX_CODEWORD_LEN - nLen)) & 1);
+            qint32 nCount = pHuff->nCount[nLen];
+
+            if (nCode - nFirst < nCount) {
+                nSym = pHuff->nSymbol[nIndex + (nCode - nFirst)];
+                lzms_removeBits(pBits, nLen);
+                break;
+            }
+
+            nIndex += nCount;
+            nFirst += nCount;
+            nFirst <<= 1;
+            nCode <<= 1;
+        }
+
+        if (nSym < 0) {
+            return -1;
+        }
+    }
+
+    pHuff->nFreqs[nSym]++;
+
+    if (--pHuff->nSymsUntilRebuild == 0) {
+        lzms_rebuildHuff(pHuff);
+    }
+
+    return nSym;
+}
+
+// ---- x86 filter ----
+//
+// Relative operands of likely x86 instructions were turned into absolute ones
+// by the encoder; an instruction counts as likely when the same (low 16 bits
+// of the) target was referenced within the last 64K bytes.
+
+qint32 lzms_x86OpcodeSize(const quint8 *p, qint32 *pnMaxTransOffset)
+{
+    *pnMaxTransOffset = LZMS_X86_MAX_TRANSLATION_OFFSET;
+
+    switch (p[0]) {
+        case 0x48:
+            if (p[1] == 0x8B) {
+                if ((p[2] == 0x05) || (p[2] == 0x0D)) {
+                    return 3;  // Load relative (x86_64)
+                }
+            } else if (p[1] == 0x8D) {
+                if ((p[2] & 0x07) == 0x05) {
+                    return 3;  // Load effective address relative (x86_64)
+                }
+            }
+            break;
+        case 0x4C:
+            if ((p[1] == 0x8D) && ((p[2] & 0x07) == 0x05)) {
+                return 3;  // Load effective address relative (x86_64)
+            }
+            break;
+        case 0xE8:
+            *pnMaxTransOffset = LZMS_X86_MAX_TRANSLATION_OFFSET / 2;  // Call relative
+            return 1;
+        case 0xE9:
+            *pnMaxTransOffset = 0;  // Jump relative: skipped, never translated
+            return 5;
+        case 0xF0:
+            if ((p[1] == 0x83) && (p[2] == 0x05)) {
+                return 3;  // Lock add relative
+            }
+            break;
+        case 0xFF:
+            if (p[1] == 0x15) {
+                return 2;  // Call indirect relative
+            }
+            break;
+    }
+
+    *pnMaxTransOffset = 0;
+
+    return 1;
+}
+
+void lzms_x86Undo(quint8 *pData, qint32 nSize, qint32 *pLastTargetUsages)
+{
+    qint32 nClosestTargetUsage = -LZMS_X86_MAX_TRANSLATION_OFFSET - 1;
+
+    for (qint32 i = 0; i < 65536; i++) {
+        pLastTargetUsages[i] = -LZMS_X86_ID_WINDOW_SIZE - 1;
+    }
+
+    for (qint32 i = 0; i < nSize - 16;) {
+        qint32 nMaxTransOffset = 0;
+        qint32 nOpSize = lzms_x86OpcodeSize(pData + i, &nMaxTransOffset);
+
+        if (!nMaxTransOffset) {
+            i += nOpSize;
+            continue;
+        }
+
+        quint8 *pOperand = pData + i + nOpSize;
+
+        if (i - nClosestTargetUsage <= nMaxTransOffset) {
+            quint32 nValue = (quint32)pOperand[0] | ((quint32)pOperand[1] << 8) | ((quint32)pOperand[2] << 16) | ((quint32)pOperand[3] << 24);
+            nValue -= (quint32)i;
+
+            pOperand[0] = (quint8)nValue;
+            pOperand[1] = (quint8)(nValue >> 8);
+            pOperand[2] = (quint8)(nValue >> 16);
+            pOperand[3] = (quint8)(nValue >> 24);
+        }
+
+        quint16 nPos = (quint16)(i + ((quint32)pOperand[0] | ((quint32)pOperand[1] << 8)));
+
+        i += nOpSize + 3;
+
+        if (i - pLastTargetUsages[nPos] <= LZMS_X86_ID_WINDOW_SIZE) {
+            nClosestTargetUsage = i;
+        }
+
+        pLastTargetUsages[nPos] = i;
+
+        i++;
+    }
+}
+
+// ---- Decoder ----
+
+struct LZMS_DECODER {
+    LZMS_PROB mainProbs[LZMS_NUM_MAIN_PROBS];
+    LZMS_PROB matchProbs[LZMS_NUM_MATCH_PROBS];
+    LZMS_PROB lzProbs[LZMS_NUM_LZ_PROBS];
+    LZMS_PROB lzRepProbs[LZMS_NUM_LZ_REPS - 1][LZMS_NUM_LZ_REP_PROBS];
+    LZMS_PROB deltaProbs[LZMS_NUM_DELTA_PROBS];
+    LZMS_PROB deltaRepProbs[LZMS_NUM_DELTA_REPS - 1][LZMS_NUM_DELTA_REP_PROBS];
+
+    LZMS_HUFF literalCode;
+    LZMS_HUFF lzOffsetCode;
+    LZMS_HUFF lengthCode;
+    LZMS_HUFF deltaOffsetCode;
+    LZMS_HUFF deltaPowerCode;
+
+    qint32 nLastTargetUsages[65536];
+};
+
+bool lzms_decode(LZMS_DECODER *pDecoder, const LZMS_SLOTS *pSlots, const quint8 *pIn, qint32 nInSize, quint8 *pOut, qint32 nOutSize)
+{
+    // The range decoder needs 4 bytes up front and both streams use 16-bit units
+    if ((nInSize < 4) || (nInSize & 1)) {
+        return false;
+    }
+
+    LZMS_RANGE range = {};
+    range.nRange = 0xFFFFFFFF;
+    range.nCode = ((quint32)pIn[0] << 16) | ((quint32)pIn[1] << 24) | (quint32)pIn[2] | ((quint32)pIn[3] << 8);
+    range.pNext = pIn + 4;
+    range.pEnd = pIn + nInSize;
+
+    LZMS_BITS bits = {};
+    bits.pBegin = pIn;
+    bits.pNext = pIn + nInSize;
+
+    lzms_initProbs(pDecoder->mainProbs, LZMS_NUM_MAIN_PROBS);
+    lzms_initProbs(pDecoder->matchProbs, LZMS_NUM_MATCH_PROBS);
+    lzms_initProbs(pDecoder->lzProbs, LZMS_NUM_LZ_PROBS);
+    lzms_initProbs(pDecoder->deltaProbs, LZMS_NUM_DELTA_PROBS);
+
+    for (qint32 i = 0; i < LZMS_NUM_LZ_REPS - 1; i++) {
+        lzms_initProbs(pDecoder->lzRepProbs[i], LZMS_NUM_LZ_REP_PROBS);
+    }
+
+    for (qint32 i = 0; i < LZMS_NUM_DELTA_REPS - 1; i++) {
+        lzms_initProbs(pDecoder->deltaRepProbs[i], LZMS_NUM_DELTA_REP_PROBS);
+    }
+
+    qint32 nNumOffsetSlots = lzms_getNumOffsetSlots(pSlots, nOutSize);
+
+    lzms_initHuff(&pDecoder->literalCode, LZMS_NUM_LITERAL_SYMS, LZMS_LITERAL_CODE_REBUILD_FREQ);
+    lzms_initHuff(&pDecoder->lzOffsetCode, (std::max)(nNumOffsetSlots, 1), LZMS_LZ_OFFSET_CODE_REBUILD_FREQ);
+    lzms_initHuff(&pDecoder->lengthCode, LZMS_NUM_LENGTH_SYMS, LZMS_LENGTH_CODE_REBUILD_FREQ);
+    lzms_initHuff(&pDecoder->deltaOffsetCode, (std::max)(nNumOffsetSlots, 1), LZMS_DELTA_OFFSET_CODE_REBUILD_FREQ);
+    lzms_initHuff(&pDecoder->deltaPowerCode, LZMS_NUM_DELTA_POWER_SYMS, LZMS_DELTA_POWER_CODE_REBUILD_FREQ);
+
+    quint32 nMainState = 0;
+    quint32 nMatchState = 0;
+    quint32 nLzState = 0;
+    quint32 nLzRepStates[LZMS_NUM_LZ_REPS - 1] = {};
+    quint32 nDeltaState = 0;
+    quint32 nDeltaRepStates[LZMS_NUM_DELTA_REPS - 1] = {};
+
+    // The offset of a match enters the recent queue only once the next item has been decoded
+    quint32 nRecentLzOffsets[LZMS_NUM_LZ_REPS + 1];
+    quint64 nRecentDeltaPairs[LZMS_NUM_DELTA_REPS + 1];
+
+    for (qint32 i = 0; i < LZMS_NUM_LZ_REPS + 1; i++) {
+        nRecentLzOffsets[i] = (quint32)(i + 1);
+    }
+
+    for (qint32 i = 0; i < LZMS_NUM_DELTA_REPS + 1; i++) {
+        nRecentDeltaPairs[i] = (quint64)(i + 1);
+    }
+
+    quint32 nPendingLzOffset = 0;
+    quint64 nPendingDeltaPair = 0;
+    qint32 nLzPendingPos = -1;
+    qint32 nDeltaPendingPos = -1;
+
+    qint32 nPos = 0;
+
+    while (nPos < nOutSize) {
+        if (!lzms_decodeBit(&range, &nMainState, LZMS_NUM_MAIN_PROBS, pDecoder->mainProbs)) {
+            // Literal
+            qint32 nSym = lzms_decodeSym(&bits, &pDecoder->literalCode);
+
+            if (nSym < 0) {
+                return false;
+            }
+
+            pOut[nPos++] = (quint8)nSym;
+        } else if (!lzms_decodeBit(&range, &nMatchState, LZMS_NUM_MATCH_PROBS, pDecoder->matchProbs)) {
+            // LZ match
+            if ((nPendingLzOffset != 0) && (nPos != nLzPendingPos)) {
+                nRecentLzOffsets[3] = nRecentLzOffsets[2];
+                nRecentLzOffsets[2] = nRecentLzOffsets[1];
+                nRecentLzOffsets[1] = nRecentLzOffsets[0];
+                nRecentLzOffsets[0] = nPendingLzOffset;
+                nPendingLzOffset = 0;
+            }
+
+            quint32 nOffset = 0;
+
+            if (!lzms_decodeBit(&range, &nLzState, LZMS_NUM_LZ_PROBS, pDecoder->lzProbs)) {
+                qint32 nSlot = lzms_decodeSym(&bits, &pDecoder->lzOffsetCode);
+
+                if (nSlot < 0) {
+                    return false;
+                }
+
+                nOffset = pSlots->nOffsetBase[nSlot] + lzms_readBits(&bits, pSlots->nOffsetExtraBits[nSlot]);
+            } else if (!lzms_decodeBit(&range, &nLzRepStates[0], LZMS_NUM_LZ_REP_PROBS, pDecoder->lzRepProbs[0])) {
+                nOffset = nRecentLzOffsets[0];
+                nRecentLzOffsets[0] = nRecentLzOffsets[1];
+                nRecentLzOffsets[1] = nRecentLzOffsets[2];
+                nRecentLzOffsets[2] = nRecentLzOffsets[3];
+            } else if (!lzms_decodeBit(&range, &nLzRepStates[1], LZMS_NUM_LZ_REP_PROBS, pDecoder->lzRepProbs[1])) {
+                nOffset = nRecentLzOffsets[1];
+                nRecentLzOffsets[1] = nRecentLzOffsets[2];
+                nRecentLzOffsets[2] = nRecentLzOffsets[3];
+            } else {
+                nOffset = nRecentLzOffsets[2];
+                nRecentLzOffsets[2] = nRecentLzOffsets[3];
+            }
+
+            if (nPendingLzOffset != 0) {
+                nRecentLzOffsets[3] = nRecentLzOffsets[2];
+                nRecentLzOffsets[2] = nRecentLzOffsets[1];
+                nRecentLzOffsets[1] = nRecentLzOffsets[0];
+                nRecentLzOffsets[0] = nPendingLzOffset;
+            }
+
+            nPendingLzOffset = nOffset;
+
+            qint32 nLengthSlot = lzms_decodeSym(&bits, &pDecoder->lengthCode);
+
+            if (nLengthSlot < 0) {
+                return false;
+            }
+
+            quint32 nLength = pSlots->nLengthBase[nLengthSlot] + lzms_readBits(&bits, pSlots->nLengthExtraBits[nLengthSlot]);
+
+            if ((nLength > (quint32)(nOutSize - nPos)) || (nOffset > (quint32)nPos)) {
+                return false;
+            }
+
+            const quint8 *pSrc = pOut + nPos - nOffset;
+            quint8 *pDst = pOut + nPos;
+
+            for (quint32 i = 0; i < nLength; i++) {
+                pDst[i] = pSrc[i];
+            }
+
+            nPos += (qint32)nLength;
+            nLzPendingPos = nPos;
+        } else {
+            // Delta match
+            if ((nPendingDeltaPair != 0) && (nPos != nDeltaPendingPos)) {
+                nRecentDeltaPairs[3] = nRecentDeltaPairs[2];
+                nRecentDeltaPairs[2] = nRecentDeltaPairs[1];
+                nRecentDeltaPairs[1] = nRecentDeltaPairs[0];
+                nRecentDeltaPairs[0] = nPendingDeltaPair;
+                nPendingDeltaPair = 0;
+            }
+
+            quint32 nPower = 0;
+            quint32 nRawOffset = 0;
+
+            if (!lzms_decodeBit(&range, &nDeltaState, LZMS_NUM_DELTA_PROBS, pDecoder->deltaProbs)) {
+                qint32 nPowerSym = lzms_decodeSym(&bits, &pDecoder->deltaPowerCode);
+                qint32 nSlot = lzms_decodeSym(&bits, &pDecoder->deltaOffsetCode);
+
+                if ((nPowerSym < 0) || (nSlot < 0)) {
+                    return false;
+                }
+
+                nPower = (quint32)nPowerSym;
+                nRawOffset = pSlots->nOffsetBase[nSlot] + lzms_readBits(&bits, pSlots->nOffsetExtraBits[nSlot]);
+            } else {
+                quint64 nPair = 0;
+
+                if (!lzms_decodeBit(&range, &nDeltaRepStates[0], LZMS_NUM_DELTA_REP_PROBS, pDecoder->deltaRepProbs[0])) {
+                    nPair = nRecentDeltaPairs[0];
+                    nRecentDeltaPairs[0] = nRecentDeltaPairs[1];
+                    nRecentDeltaPairs[1] = nRecentDeltaPairs[2];
+                    nRecentDeltaPairs[2] = nRecentDeltaPairs[3];
+                } else if (!lzms_decodeBit(&range, &nDeltaRepStates[1], LZMS_NUM_DELTA_REP_PROBS, pDecoder->deltaRepProbs[1])) {
+                    nPair = nRecentDeltaPairs[1];
+                    nRecentDeltaPairs[1] = nRecentDeltaPairs[2];
+                    nRecentDeltaPairs[2] = nRecentDeltaPairs[3];
+                } else {
+                    nPair = nRecentDeltaPairs[2];
+                    nRecentDeltaPairs[2] = nRecentDeltaPairs[3];
+                }
+
+                nPower = (quint32)(nPair >> 32);
+                nRawOffset = (quint32)nPair;
+            }
+
+            if (nPendingDeltaPair != 0) {
+                nRecentDeltaPairs[3] = nRecentDeltaPairs[2];
+                nRecentDeltaPairs[2] = nRecentDeltaPairs[1];
+                nRecentDeltaPairs[1] = nRecentDeltaPairs[0];
+                nRecentDeltaPairs[0] = nPendingDeltaPair;
+            }
+
+            nPendingDeltaPair = (quint64)nRawOffset | ((quint64)nPower << 32);
+
+            qint32 nLengthSlot = lzms_decodeSym(&bits, &pDecoder->lengthCode);
+
+            if ((nLengthSlot < 0) || (nPower >= 32)) {
+                return false;
+            }
+
+            quint32 nLength = pSlots->nLengthBase[nLengthSlot] + lzms_readBits(&bits, pSlots->nLengthExtraBits[nLengthSlot]);
+
+            quint32 nOffset1 = (quint32)1 << nPower;
+            quint32 nOffset2 = nRawOffset << nPower;
+            quint32 nOffset = nOffset1 + nOffset2;
+
+            if (((nOffset2 >> nPower) != nRawOffset) || (nOffset < nOffset2)) {
+                return false;  // Overflow
+            }
+
+            if ((nLength > (quint32)(nOutSize - nPos)) || (nOffset > (quint32)nPos)) {
+                return false;
+            }
+
+            quint8 *pDst = pOut + nPos;
+
+            for (quint32 i = 0; i < nLength; i++) {
+                pDst[i] = (quint8)(pDst[(qint64)i - nOffset1] + pDst[(qint64)i - nOffset2] - pDst[(qint64)i - nOffset]);
+            }
+
+            nPos += (qint32)nLength;
+            nDeltaPendingPos = nPos;
+        }
+    }
+
+    lzms_x86Undo(pOut, nOutSize, pDecoder->nLastTargetUsages);
+
+    return true;
+}
+
+}  // namespace
+
+bool XLZMSDecoder::decompressChunk(const QByteArray &baCompressed, QByteArray *pbaUncompressed, qint32 nUncompressedSize)
+{
+    if (!pbaUncompressed || (nUncompressedSize <= 0)) {
+        return false;
+    }
+
+    pbaUncompressed->resize(nUncompressedSize);
+
+    LZMS_DECODER *pDecoder = new LZMS_DECODER;
+
+    bool bResult = lzms_decode(pDecoder, lzms_getSlots(), reinterpret_cast<const quint8 *>(baCompressed.constData()), baCompressed.size(),
+                               reinterpret_cast<quint8 *>(pbaUncompressed->data()), nUncompressedSize);
+
+    delete pDecoder;
+
+    if (!bResult) {
+        pbaUncompressed->clear();
+    }
+
+    return bResult;
+}
@@ -0,0 +1,37 @@
+/* Copyright (c) 2026 hors<horsicq@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef XLZMSDECODER_H
+#define XLZMSDECODER_H
+
+#include "xbinary.h"
+
+// Microsoft LZMS decompressor (WIM version 3584 / ESD solid resources).
+// LZ77 + delta matches with adaptive range-coded decisions and adaptive
+// Huffman codes for literals, offsets and lengths; x86 relative-address
+// post-filter. The range-coded stream is read forwards and the Huffman
+// bitstream backwards from the same buffer. Chunks are independent, so the
+// caller can decode them in parallel.
+class XLZMSDecoder {
+public:
+    static bool decompressChunk(const QByteArray &baCompressed, QByteArray *pbaUncompressed, qint32 nUncompressedSize);
+};
+
+#endif  // XLZMSDECODER_H
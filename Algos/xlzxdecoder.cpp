@@ -44,7 +44,9 @@ struct LZX_HUFF {
     bool bEmpty;
 };
 
-struct LZX_STATE {
+}  // namespace
+
+struct XLZXDecoder::LZX_STATE {
     const quint8 *pIn;
     qint64 nInSize;
     qint64 nInPos;      // bytes consumed into the bit buffer
@@ -53,6 +55,14 @@ struct LZX_STATE {
     qint64 nOverrun;    // 16-bit words injected past end of input
     bool bError;
 
+    // CAB folder source: CFDATA payloads are appended to baInput on demand
+    QIODevice *pDeviceInput;
+    qint64 nInputOffset;
+    qint64 nInputLimit;
+    qint64 nInputPos;   // next CFDATA header, relative to nInputOffset
+    qint32 nReservedSize;
+    QByteArray baInput;
+
     // Sliding window
     QByteArray baWindow;
     quint32 nWindowSize;
@@ -72,8 +82,25 @@ struct LZX_STATE {
     quint32 positionBase[51];
     quint8 extraBits[51];
     qint32 nPositionSlots;
+
+    // Decoding position, kept so the stream can be resumed frame by frame
+    bool bWIMVariant;
+    bool bHeaderRead;
+    qint32 nIntelFileSize;
+    qint64 nUncompressedSize;
+    qint64 nOutCount;
+    qint64 nNextFrame;
+    qint64 nFrameOffset;  // output offset of the next frame handed out
+    qint64 nBlockRemaining;
+    qint32 nBlockType;
+    bool bOddBlock;
+    QByteArray baPending;  // decoded bytes not yet handed out as a frame
 };
 
+namespace {
+
+typedef XLZXDecoder::LZX_STATE LZX_STATE;
+
 void lzx_initBitReader(LZX_STATE *pState, const quint8 *pIn, qint64 nInSize)
 {
     pState->pIn = pIn;
@@ -85,11 +112,78 @@ void lzx_initBitReader(LZX_STATE *pState, const quint8 *pIn, qint64 nInSize)
     pState->bError = false;
 }
 
+// Appends the next CFDATA payload of the folder to the input. Consumed bytes are
+// dropped first, except the last few that an uncompressed block header may rewind into.
+bool lzx_refill(LZX_STATE *pState)
+{
+    const qint64 nHeaderSize = 8;  // checksum(4) + cbData(2) + cbUncomp(2)
+
+    if (!pState->pDeviceInput || (pState->nInputPos >= pState->nInputLimit)) {
+        return false;
+    }
+
+    if ((nHeaderSize + pState->nReservedSize > pState->nInputLimit - pState->nInputPos) ||
+        !pState->pDeviceInput->seek(pState->nInputOffset + pState->nInputPos)) {
+        pState->bError = true;
+        return false;
+    }
+
+    char header[8];
+    if (pState->pDeviceInput->read(header, nHeaderSize) != nHeaderSize) {
+        pState->bError = true;
+        return false;
+    }
+
+    quint16 nCbData = (quint8)header[4] | ((quint16)(quint8)header[5] << 8);
+    quint16 nCbUncomp = (quint8)header[6] | ((quint16)(quint8)header[7] << 8);
+    qint64 nPayloadPos = pState->nInputPos + nHeaderSize + pState->nReservedSize;
+
+    if ((nCbData == 0) || (nCbUncomp > LZX_FRAME_SIZE) || ((qint64)nCbData > pState->nInputLimit - nPayloadPos) ||
+        !pState->pDeviceInput->seek(pState->nInputOffset + nPayloadPos)) {
+        pState->bError = true;
+        return false;
+    }
+
+    QByteArray baPayload = pState->pDeviceInput->read(nCbData);
+
+    if (baPayload.size() != nCbData) {
+        pState->bError = true;
+        return false;
+    }
+
+    qint64 nDiscard = qMin(pState->nInPos, (qint64)pState->baInput.size()) - 16;
+
+    if (nDiscard > 0) {
+        pState->baInput.remove(0, (qint32)nDiscard);
+        pState->nInPos -= nDiscard;
+    }
+
+    pState->baInput.append(baPayload);
+    pState->pIn = reinterpret_cast<const quint8 *>(pState->baInput.constData());
+    pState->nInSize = pState->baInput.size();
+    pState->nInputPos = nPayloadPos + nCbData;
+
+    return true;
+}
+
+// Makes nBytes raw input bytes available at nInPos
+bool lzx_fillRaw(LZX_STATE *pState, qint64 nBytes)
+{
+    while ((pState->nInPos + nBytes > pState->nInSize) && lzx_refill(pState)) {
+    }
+
+    return (pState->nInPos + nBytes <= pState->nInSize);
+}
+
 void lzx_ensureBits(LZX_STATE *pState, qint32 nBits)
 {
     while (pState->nBitCount < nBits) {
         quint32 nWord = 0;
 
+        if (pState->nInPos + 1 >= pState->nInSize) {
+            lzx_fillRaw(pState, 2);
+        }
+
         if (pState->nInPos + 1 < pState->nInSize) {
             nWord = (quint32)pState->pIn[pState->nInPos] | ((quint32)pState->pIn[pState->nInPos + 1] << 8);
         } else if (pState->nInPos < pState->nInSize) {
@@ -314,12 +408,8 @@ void lzx_undoE8(QByteArray &baData, qint64 nFrameOffset, qint64 nFrameSize, qint
     }
 }
 
-bool lzx_decompressStream(LZX_STATE *pState, QByteArray *pbaOut, qint64 nUncompressedSize, qint32 nWindowBits, bool bWIMVariant, XBinary::PDSTRUCT *pPdStruct)
+void lzx_initStream(LZX_STATE *pState, qint32 nWindowBits, qint64 nUncompressedSize, bool bWIMVariant)
 {
-    if (!XBinary::isPdStructNotCanceled(pPdStruct)) {
-        return false;
-    }
-
     pState->nWindowSize = (quint32)1 << nWindowBits;
     pState->baWindow.resize((int)pState->nWindowSize);
     pState->baWindow.fill(0);
@@ -331,33 +421,44 @@ bool lzx_decompressStream(LZX_STATE *pState, QByteArray *pbaOut, qint64 nUncompr
     memset(pState->mainLens, 0, sizeof(pState->mainLens));
     memset(pState->lengthLens, 0, sizeof(pState->lengthLens));
 
-    pbaOut->clear();
-    pbaOut->reserve((int)nUncompressedSize);
-
-    qint32 nIntelFileSize = 0;
+    pState->bWIMVariant = bWIMVariant;
+    pState->bHeaderRead = false;
+    pState->nIntelFileSize = 0;
+    pState->nUncompressedSize = nUncompressedSize;
+    pState->nOutCount = 0;
+    pState->nNextFrame = LZX_FRAME_SIZE;
+    pState->nFrameOffset = 0;
+    pState->nBlockRemaining = 0;
+    pState->nBlockType = 0;
+    pState->bOddBlock = false;
+    pState->baPending.clear();
+}
 
-    if (!bWIMVariant) {
-        // CAB stream header: 1-bit Intel E8 flag, then optional 32-bit translation size
-        if (lzx_readBits(pState, 1)) {
-            quint32 nHigh = lzx_readBits(pState, 16);
-            quint32 nLow = lzx_readBits(pState, 16);
-            nIntelFileSize = (qint32)((nHigh << 16) | nLow);
+// Decodes until nTarget bytes of the stream have been produced. A match may run past
+// nTarget; the extra bytes stay in pbaOut for the following frame.
+bool lzx_decodeUntil(LZX_STATE *pState, QByteArray *pbaOut, qint64 nTarget, XBinary::PDSTRUCT *pPdStruct)
+{
+    if (!pState->bHeaderRead) {
+        if (!pState->bWIMVariant) {
+            // CAB stream header: 1-bit Intel E8 flag, then optional 32-bit translation size
+            if (lzx_readBits(pState, 1)) {
+                quint32 nHigh = lzx_readBits(pState, 16);
+                quint32 nLow = lzx_readBits(pState, 16);
+                pState->nIntelFileSize = (qint32)((nHigh << 16) | nLow);
+            }
         }
-    }
 
-    qint64 nOutCount = 0;
-    qint64 nNextFrame = LZX_FRAME_SIZE;
-    qint64 nBlockRemaining = 0;
-    qint32 nBlockType = 0;
+        pState->bHeaderRead = true;
+    }
 
-    while ((nOutCount < nUncompressedSize) && !pState->bError && XBinary::isPdStructNotCanceled(pPdStruct)) {
-        if (nBlockRemaining == 0) {
+    while ((pState->nOutCount < nTarget) && !pState->bError && XBinary::isPdStructNotCanceled(pPdStruct)) {
+        if (pState->nBlockRemaining == 0) {
             // Block header
-            nBlockType = (qint32)lzx_readBits(pState, 3);
+            pState->nBlockType = (qint32)lzx_readBits(pState, 3);
 
             qint64 nBlockSize = 0;
 
-            if (bWIMVariant) {
+            if (pState->bWIMVariant) {
                 if (lzx_readBits(pState, 1)) {
                     nBlockSize = LZX_FRAME_SIZE;
                 } else {
@@ -367,13 +468,14 @@ bool lzx_decompressStream(LZX_STATE *pState, QByteArray *pbaOut, qint64 nUncompr
                 nBlockSize = lzx_readBits(pState, 24);
             }
 
-            if ((nBlockSize <= 0) || (nBlockSize > nUncompressedSize - nOutCount)) {
+            if ((nBlockSize <= 0) || (nBlockSize > pState->nUncompressedSize - pState->nOutCount)) {
                 return false;
             }
 
-            nBlockRemaining = nBlockSize;
+            pState->nBlockRemaining = nBlockSize;
+            pState->bOddBlock = (nBlockSize & 1);
 
-            if (nBlockType == LZX_BLOCK_ALIGNED) {
+            if (pState->nBlockType == LZX_BLOCK_ALIGNED) {
                 quint8 alignedLens[LZX_ALIGNED_SYMBOLS];
                 for (qint32 i = 0; i < LZX_ALIGNED_SYMBOLS; i++) {
                     alignedLens[i] = (quint8)lzx_readBits(pState, 3);
@@ -383,7 +485,7 @@ bool lzx_decompressStream(LZX_STATE *pState, QByteArray *pbaOut, qint64 nUncompr
                 }
             }
 
-            if ((nBlockType == LZX_BLOCK_VERBATIM) || (nBlockType == LZX_BLOCK_ALIGNED)) {
+            if ((pState->nBlockType == LZX_BLOCK_VERBATIM) || (pState->nBlockType == LZX_BLOCK_ALIGNED)) {
                 if (!lzx_readLengths(pState, pState->mainLens, 0, 256)) {
                     return false;
                 }
@@ -399,57 +501,62 @@ bool lzx_decompressStream(LZX_STATE *pState, QByteArray *pbaOut, qint64 nUncompr
                 if (!lzx_buildHuff(&pState->lengthTree, pState->lengthLens, LZX_LENGTH_SYMBOLS)) {
                     return false;
                 }
-            } else if (nBlockType == LZX_BLOCK_UNCOMPRESSED) {
-                // Align to a 16-bit boundary (1-16 pad bits), then 12 bytes of R0/R1/R2
+            } else if (pState->nBlockType == LZX_BLOCK_UNCOMPRESSED) {
+                // Align to a 16-bit boundary (1-16 pad bits), then 12 bytes of R0/R1/R2.
+                // The block body is read as raw bytes, so the bit buffer is emptied.
                 lzx_align16(pState, true);
 
-                qint64 nRawPos = lzx_rawPosition(pState);
+                pState->nInPos = lzx_rawPosition(pState);
                 pState->nBitBuf = 0;
                 pState->nBitCount = 0;
 
-                if (nRawPos + 12 > pState->nInSize) {
+                if (!lzx_fillRaw(pState, 12)) {
                     return false;
                 }
 
-                const quint8 *p = pState->pIn + nRawPos;
+                const quint8 *p = pState->pIn + pState->nInPos;
                 pState->R0 = (quint32)p[0] | ((quint32)p[1] << 8) | ((quint32)p[2] << 16) | ((quint32)p[3] << 24);
                 pState->R1 = (quint32)p[4] | ((quint32)p[5] << 8) | ((quint32)p[6] << 16) | ((quint32)p[7] << 24);
                 pState->R2 = (quint32)p[8] | ((quint32)p[9] << 8) | ((quint32)p[10] << 16) | ((quint32)p[11] << 24);
-                nRawPos += 12;
+                pState->nInPos += 12;
 
                 if ((pState->R0 == 0) || (pState->R1 == 0) || (pState->R2 == 0)) {
                     return false;
                 }
+            } else {
+                return false;
+            }
+        }
 
-                // Copy raw bytes
-                if (nRawPos + nBlockRemaining > pState->nInSize) {
+        if (pState->nBlockType == LZX_BLOCK_UNCOMPRESSED) {
+            // Copy raw bytes, no further than the requested frame
+            qint64 nCopy = qMin(pState->nBlockRemaining, nTarget - pState->nOutCount);
+
+            for (qint64 i = 0; i < nCopy; i++) {
+                if (!lzx_fillRaw(pState, 1)) {
                     return false;
                 }
 
-                for (qint64 i = 0; i < nBlockRemaining; i++) {
-                    if (((i & 0x3FFF) == 0) && !XBinary::isPdStructNotCanceled(pPdStruct)) return false;
-                    lzx_outputByte(pState, pbaOut, pState->pIn[nRawPos + i]);
-                }
+                lzx_outputByte(pState, pbaOut, pState->pIn[pState->nInPos]);
+                pState->nInPos++;
+            }
 
-                nOutCount += nBlockRemaining;
-                nRawPos += nBlockRemaining;
+            pState->nOutCount += nCopy;
+            pState->nBlockRemaining -= nCopy;
 
-                if (nBlockRemaining & 1) {
-                    if (nRawPos >= pState->nInSize) return false;
-                    nRawPos++;  // pad byte
+            if ((pState->nBlockRemaining == 0) && pState->bOddBlock) {
+                if (!lzx_fillRaw(pState, 1)) {
+                    return false;
                 }
 
-                nBlockRemaining = 0;
-                pState->nInPos = nRawPos;
-
-                while (nOutCount >= nNextFrame) {
-                    nNextFrame += LZX_FRAME_SIZE;
-                }
+                pState->nInPos++;  // pad byte
+            }
 
-                continue;
-            } else {
-                return false;
+            while (pState->nOutCount >= pState->nNextFrame) {
+                pState->nNextFrame += LZX_FRAME_SIZE;
             }
+
+            continue;
         }
 
         // Decode one symbol from a verbatim/aligned block
@@ -460,10 +567,10 @@ bool lzx_decompressStream(LZX_STATE *pState, QByteArray *pbaOut, qint64 nUncompr
         }
 
         if (nMainSym < 256) {
-            if ((nBlockRemaining <= 0) || (nOutCount >= nUncompressedSize)) return false;
+            if ((pState->nBlockRemaining <= 0) || (pState->nOutCount >= pState->nUncompressedSize)) return false;
             lzx_outputByte(pState, pbaOut, (quint8)nMainSym);
-            nOutCount++;
-            nBlockRemaining--;
+            pState->nOutCount++;
+            pState->nBlockRemaining--;
         } else {
             nMainSym -= 256;
             qint32 nLenHeader = nMainSym & 7;
@@ -498,7 +605,7 @@ bool lzx_decompressStream(LZX_STATE *pState, QByteArray *pbaOut, qint64 nUncompr
                 qint32 nExtra = pState->extraBits[nPosSlot];
                 quint32 nVerbatim = 0;
 
-                if ((nBlockType == LZX_BLOCK_ALIGNED) && (nExtra >= 3)) {
+                if ((pState->nBlockType == LZX_BLOCK_ALIGNED) && (nExtra >= 3)) {
                     nVerbatim = lzx_readBits(pState, nExtra - 3);
                     qint32 nAlignedSym = lzx_decodeHuff(pState, &pState->alignedTree);
                     if (pState->bError || (nAlignedSym < 0)) {
@@ -517,8 +624,8 @@ bool lzx_decompressStream(LZX_STATE *pState, QByteArray *pbaOut, qint64 nUncompr
                 pState->R0 = nMatchOffset;
             }
 
-            if ((nMatchOffset == 0) || (nMatchOffset > pState->nWindowSize) || ((qint64)nMatchLen > nBlockRemaining) ||
-                ((qint64)nMatchLen > nUncompressedSize - nOutCount)) {
+            if ((nMatchOffset == 0) || (nMatchOffset > pState->nWindowSize) || ((qint64)nMatchLen > pState->nBlockRemaining) ||
+                ((qint64)nMatchLen > pState->nUncompressedSize - pState->nOutCount)) {
                 return false;
             }
 
@@ -529,45 +636,82 @@ bool lzx_decompressStream(LZX_STATE *pState, QByteArray *pbaOut, qint64 nUncompr
                 nSrc = (nSrc + 1) & (pState->nWindowSize - 1);
             }
 
-            nOutCount += nMatchLen;
-            nBlockRemaining -= nMatchLen;
+            pState->nOutCount += nMatchLen;
+            pState->nBlockRemaining -= nMatchLen;
         }
 
-        if (nBlockRemaining < 0) {
+        if (pState->nBlockRemaining < 0) {
             return false;
         }
 
         // Bitstream realigns to 16 bits at every 32KB output frame boundary (CAB)
-        while (nOutCount >= nNextFrame) {
-            if (!bWIMVariant) {
+        while (pState->nOutCount >= pState->nNextFrame) {
+            if (!pState->bWIMVariant) {
                 lzx_align16(pState, false);
             }
-            nNextFrame += LZX_FRAME_SIZE;
+            pState->nNextFrame += LZX_FRAME_SIZE;
         }
     }
 
-    if (pState->bError || pState->nOverrun || (nOutCount != nUncompressedSize) || (nBlockRemaining != 0) ||
-        (pbaOut->size() != nUncompressedSize) || !XBinary::isPdStructNotCanceled(pPdStruct)) {
+    return !pState->bError && (pState->nOutCount >= nTarget) && XBinary::isPdStructNotCanceled(pPdStruct);
+}
+
+// Hands out the next 32KB output frame (the last one may be shorter) with the E8 translation undone
+bool lzx_nextFrame(LZX_STATE *pState, QByteArray *pbaFrame, XBinary::PDSTRUCT *pPdStruct)
+{
+    qint64 nFrameOffset = pState->nFrameOffset;
+    qint64 nFrameSize = qMin((qint64)LZX_FRAME_SIZE, pState->nUncompressedSize - nFrameOffset);
+
+    if (nFrameSize <= 0) {
+        return false;
+    }
+
+    if ((pState->nOutCount < nFrameOffset + nFrameSize) && !lzx_decodeUntil(pState, &pState->baPending, nFrameOffset + nFrameSize, pPdStruct)) {
+        return false;
+    }
+
+    *pbaFrame = pState->baPending.left((qint32)nFrameSize);
+    pState->baPending.remove(0, (qint32)nFrameSize);
+    pState->nFrameOffset += nFrameSize;
+
+    if (pState->bWIMVariant) {
+        lzx_undoE8(*pbaFrame, 0, nFrameSize, 0, LZX_WIM_MAGIC_FILESIZE);
+    } else if (pState->nIntelFileSize != 0) {
+        lzx_undoE8(*pbaFrame, nFrameOffset, nFrameSize, 0, pState->nIntelFileSize);
+    }
+
+    return true;
+}
+
+// The whole stream was consumed exactly, without running past the input
+bool lzx_isComplete(LZX_STATE *pState)
+{
+    return !pState->bError && !pState->nOverrun && (pState->nOutCount == pState->nUncompressedSize) && (pState->nBlockRemaining == 0) &&
+           (pState->nFrameOffset == pState->nUncompressedSize) && pState->baPending.isEmpty();
+}
+
+bool lzx_decompressStream(LZX_STATE *pState, QByteArray *pbaOut, qint64 nUncompressedSize, qint32 nWindowBits, bool bWIMVariant, XBinary::PDSTRUCT *pPdStruct)
+{
+    if (!XBinary::isPdStructNotCanceled(pPdStruct)) {
         return false;
     }
 
-    // Intel E8 post-processing
-    if (bWIMVariant) {
-        if (!XBinary::isPdStructNotCanceled(pPdStruct)) {
+    lzx_initStream(pState, nWindowBits, nUncompressedSize, bWIMVariant);
+
+    pbaOut->clear();
+    pbaOut->reserve((int)nUncompressedSize);
+
+    QByteArray baFrame;
+
+    while (pState->nFrameOffset < nUncompressedSize) {
+        if (!lzx_nextFrame(pState, &baFrame, pPdStruct)) {
             return false;
         }
-        lzx_undoE8(*pbaOut, 0, nUncompressedSize, 0, LZX_WIM_MAGIC_FILESIZE);
-    } else if (nIntelFileSize != 0) {
-        for (qint64 nFrame = 0; nFrame < nUncompressedSize; nFrame += LZX_FRAME_SIZE) {
-            if (!XBinary::isPdStructNotCanceled(pPdStruct)) {
-                return false;
-            }
-            qint64 nFrameSize = qMin((qint64)LZX_FRAME_SIZE, nUncompressedSize - nFrame);
-            lzx_undoE8(*pbaOut, nFrame, nFrameSize, nFrame, nIntelFileSize);
-        }
+
+        pbaOut->append(baFrame);
     }
 
-    return XBinary::isPdStructNotCanceled(pPdStruct);
+    return lzx_isComplete(pState) && (pbaOut->size() == nUncompressedSize) && XBinary::isPdStructNotCanceled(pPdStruct);
 }
 
 }  // namespace
@@ -586,6 +730,108 @@ bool XLZXDecoder::decompressCABFolder(const QByteArray &baCompressed, QByteArray
     return lzx_decompressStream(&state, pbaUncompressed, nUncompressedSize, nWindowBits, false, pPdStruct);
 }
 
+bool XLZXDecoder::initCABCursor(CAB_CURSOR *pCursor, QIODevice *pDeviceInput, qint64 nInputOffset, qint64 nInputLimit, qint32 nReservedSize,
+                                qint64 nUncompressedSize, qint32 nWindowBits)
+{
+    if (!pCursor) {
+        return false;
+    }
+
+    freeCABCursor(pCursor);
+
+    if (!pDeviceInput || (nInputOffset < 0) || (nInputLimit < 0) || (nReservedSize < 0) || (nUncompressedSize < 0) || (nWindowBits < 15) ||
+        (nWindowBits > 21)) {
+        return false;
+    }
+
+    LZX_STATE *pState = new LZX_STATE();
+    lzx_initBitReader(pState, nullptr, 0);
+    lzx_initStream(pState, nWindowBits, nUncompressedSize, false);
+
+    pState->pDeviceInput = pDeviceInput;
+    pState->nInputOffset = nInputOffset;
+    pState->nInputLimit = nInputLimit;
+    pState->nInputPos = 0;
+    pState->nReservedSize = nReservedSize;
+
+    pCursor->pState = pState;
+    pCursor->pDeviceInput = pDeviceInput;
+    pCursor->nInputOffset = nInputOffset;
+    pCursor->nUncompressedSize = nUncompressedSize;
+    pCursor->nCountOutput = 0;
+    pCursor->nFramePos = 0;
+    pCursor->baFrame.clear();
+    pCursor->bAllocated = true;
+
+    return true;
+}
+
+bool XLZXDecoder::readCABCursor(CAB_CURSOR *pCursor, QIODevice *pDeviceOutput, qint64 nSize, XBinary::PDSTRUCT *pPdStruct)
+{
+    if (!pCursor || !pCursor->bAllocated || (nSize < 0) || (nSize > pCursor->nUncompressedSize - pCursor->nCountOutput)) {
+        return false;
+    }
+
+    LZX_STATE *pState = pCursor->pState;
+    bool bResult = true;
+
+    while ((nSize > 0) && bResult && XBinary::isPdStructNotCanceled(pPdStruct)) {
+        if (pCursor->nFramePos >= pCursor->baFrame.size()) {
+            bResult = lzx_nextFrame(pState, &pCursor->baFrame, pPdStruct);
+            pCursor->nFramePos = 0;
+
+            // The last frame must end the bitstream exactly
+            if (bResult && (pState->nFrameOffset == pState->nUncompressedSize)) {
+                bResult = lzx_isComplete(pState);
+            }
+
+            if (!bResult) {
+                break;
+            }
+        }
+
+        qint64 nChunkSize = qMin(nSize, (qint64)(pCursor->baFrame.size() - pCursor->nFramePos));
+
+        if (pDeviceOutput) {
+            const char *pData = pCursor->baFrame.constData() + pCursor->nFramePos;
+            qint64 nWritten = 0;
+
+            while (nWritten < nChunkSize) {
+                qint64 nResult = pDeviceOutput->write(pData + nWritten, nChunkSize - nWritten);
+
+                if ((nResult <= 0) || (nResult > nChunkSize - nWritten)) {
+                    bResult = false;
+                    break;
+                }
+
+                nWritten += nResult;
+            }
+        }
+
+        pCursor->nFramePos += (qint32)nChunkSize;
+        pCursor->nCountOutput += nChunkSize;
+        nSize -= nChunkSize;
+    }
+
+    return bResult && (nSize == 0) && XBinary::isPdStructNotCanceled(pPdStruct);
+}
+
+void XLZXDecoder::freeCABCursor(CAB_CURSOR *pCursor)
+{
+    if (pCursor) {
+        delete pCursor->pState;
+
+        pCursor->pState = nullptr;
+        pCursor->pDeviceInput = nullptr;
+        pCursor->nInputOffset = 0;
+        pCursor->nUncompressedSize = 0;
+        pCursor->nCountOutput = 0;
+        pCursor->nFramePos = 0;
+        pCursor->baFrame.clear();
+        pCursor->bAllocated = false;
+    }
+}
+
 bool XLZXDecoder::decompressWIMChunk(const QByteArray &baCompressed, QByteArray *pbaUncompressed, qint32 nUncompressedSize)
 {
     if (!pbaUncompressed || baCompressed.isEmpty() || (nUncompressedSize <= 0) || (nUncompressedSize > 32768)) {
@@ -31,10 +31,33 @@
 //    Intel E8 post-processing always applied with fixed file size 12000000.
 class XLZXDecoder {
 public:
+    struct LZX_STATE;
+
+    // Resumable CAB folder decoder for forward-only reads. CFDATA blocks are pulled
+    // from the device as the bitstream needs them and output is produced one 32KB
+    // frame at a time, so memory is the window plus one frame, independent of folder size.
+    struct CAB_CURSOR {
+        LZX_STATE *pState;
+        QIODevice *pDeviceInput;
+        qint64 nInputOffset;       // first CFDATA header of the folder
+        qint64 nUncompressedSize;  // complete folder size
+        qint64 nCountOutput;       // folder bytes already read
+        QByteArray baFrame;        // current decoded frame
+        qint32 nFramePos;
+        bool bAllocated;
+    };
+
     // baCompressed: concatenated compressed folder stream (CFDATA payloads joined)
     static bool decompressCABFolder(const QByteArray &baCompressed, QByteArray *pbaUncompressed, qint64 nUncompressedSize, qint32 nWindowBits,
                                     XBinary::PDSTRUCT *pPdStruct = nullptr);
 
+    // nInputLimit: size of the CFDATA stream; nReservedSize: per-block reserved area (CFHEADER cbCFData)
+    static bool initCABCursor(CAB_CURSOR *pCursor, QIODevice *pDeviceInput, qint64 nInputOffset, qint64 nInputLimit, qint32 nReservedSize,
+                              qint64 nUncompressedSize, qint32 nWindowBits);
+    // pDeviceOutput == nullptr skips nSize bytes
+    static bool readCABCursor(CAB_CURSOR *pCursor, QIODevice *pDeviceOutput, qint64 nSize, XBinary::PDSTRUCT *pPdStruct = nullptr);
+    static void freeCABCursor(CAB_CURSOR *pCursor);
+
     // One independent WIM chunk (chunk uncompressed size <= 32768)
     static bool decompressWIMChunk(const QByteArray &baCompressed, QByteArray *pbaUncompressed, qint32 nUncompressedSize);
 };
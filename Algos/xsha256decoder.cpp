@@ -19,9 +19,79 @@
  * SOFTWARE.
  */
 #include "xsha256decoder.h"
+#include "algo_utils.h"
 
 #include <string.h>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#define XSHA256_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define XSHA256_TARGET_SHANI
+#else
+#define XSHA256_TARGET_SHANI __attribute__((target("sha,sse4.1")))
+#endif
+#endif
+
+// SHA-256 constants (K array)
+static const quint32 s_sha256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be,
+    0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa,
+    0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85,
+    0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f,
+    0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+//------------------------------------------------------------------------------
+// SHA-NI backend (x86-64, selected at runtime)
+//------------------------------------------------------------------------------
+
+#ifdef XSHA256_X86
+static XSHA256_TARGET_SHANI void sha256_transformSHANI(quint32 state[8], const quint8 *pData, qint32 nNumBlocks)
+{
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    // The SHA instructions keep the state as ABEF/CDGH
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&state[0])), 0xB1);     // CDAB
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&state[4])), 0x1B);  // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);                                                          // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);                                                               // CDGH
+
+    for (qint32 nBlock = 0; nBlock < nNumBlocks; nBlock++) {
+        const quint8 *pBlock = pData + nBlock * 64;
+        __m128i abefSave = state0;
+        __m128i cdghSave = state1;
+        __m128i msg[4];
+
+        for (qint32 i = 0; i < 4; i++) {
+            msg[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pBlock + i * 16)), mask);
+        }
+
+        // 16 groups of 4 rounds; after group g its schedule slot is refilled with the words of group g + 4
+        for (qint32 g = 0; g < 16; g++) {
+            __m128i wk = _mm_add_epi32(msg[g & 3], _mm_loadu_si128(reinterpret_cast<const __m128i *>(&s_sha256_K[g * 4])));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, wk);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(wk, 0x0E));
+
+            if (g < 12) {
+                __m128i w = _mm_sha256msg1_epu32(msg[g & 3], msg[(g + 1) & 3]);
+                w = _mm_add_epi32(w, _mm_alignr_epi8(msg[(g + 3) & 3], msg[(g + 2) & 3], 4));
+                msg[g & 3] = _mm_sha256msg2_epu32(w, msg[(g + 3) & 3]);
+            }
+        }
+
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);     // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);  // DCHG
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&state[0]), _mm_blend_epi16(tmp, state1, 0xF0));  // DCBA
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&state[4]), _mm_alignr_epi8(state1, tmp, 8));     // HGFE
+}
+#endif
+
 XSha256Decoder::XSha256Decoder(QObject *parent) : QObject(parent)
 {
 }
@@ -59,14 +129,6 @@ void XSha256Decoder::setBe32(quint8 *p, quint32 v)
 
 void XSha256Decoder::transform(quint32 state[8], const quint8 data[64])
 {
-    // SHA-256 constants (K array)
-    static const quint32 K[64] = {0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be,
-                                  0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa,
-                                  0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85,
-                                  0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
-                                  0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f,
-                                  0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
-
     quint32 W[64];
     quint32 a, b, c, d, e, f, g, h;
     quint32 T1, T2;
@@ -100,7 +162,7 @@ void XSha256Decoder::transform(quint32 state[8], const quint8 data[64])
         quint32 ch = (e & f) ^ ((~e) & g);
         quint32 maj = (a & b) ^ (a & c) ^ (b & c);
 
-        T1 = h + S1 + ch + K[i] + W[i];
+        T1 = h + S1 + ch + s_sha256_K[i] + W[i];
         T2 = S0 + maj;
 
         h = g;
@@ -124,6 +186,20 @@ void XSha256Decoder::transform(quint32 state[8], const quint8 data[64])
     state[7] += h;
 }
 
+void XSha256Decoder::transformBlocks(quint32 state[8], const quint8 *pData, qint32 nNumBlocks)
+{
+#ifdef XSHA256_X86
+    if (Algo_utils::isCPUFeatureSupported(Algo_utils::CPU_FEATURE_SSSE3 | Algo_utils::CPU_FEATURE_SSE41 | Algo_utils::CPU_FEATURE_SHA)) {
+        sha256_transformSHANI(state, pData, nNumBlocks);
+        return;
+    }
+#endif
+
+    for (qint32 i = 0; i < nNumBlocks; i++) {
+        transform(state, pData + i * 64);
+    }
+}
+
 void XSha256Decoder::update(Context *pContext, const quint8 *pData, qint32 nSize)
 {
     if (nSize == 0) {
@@ -144,14 +220,12 @@ void XSha256Decoder::update(Context *pContext, const quint8 *pData, qint32 nSize
         nSize -= nNum;
         memcpy(pContext->buffer + nPos, pData, nNum);
         pData += nNum;
-        transform(pContext->state, pContext->buffer);
+        transformBlocks(pContext->state, pContext->buffer, 1);
     }
 
     qint32 nNumBlocks = nSize >> 6;
-    for (qint32 i = 0; i < nNumBlocks; i++) {
-        transform(pContext->state, pData);
-        pData += 64;
-    }
+    transformBlocks(pContext->state, pData, nNumBlocks);
+    pData += nNumBlocks * 64;
 
     nSize &= 63;
     if (nSize != 0) {
@@ -168,7 +242,7 @@ void XSha256Decoder::final(Context *pContext, quint8 *pDigest)
         while (nPos != 64) {
             pContext->buffer[nPos++] = 0;
         }
-        transform(pContext->state, pContext->buffer);
+        transformBlocks(pContext->state, pContext->buffer, 1);
         nPos = 0;
     }
 
@@ -178,7 +252,7 @@ void XSha256Decoder::final(Context *pContext, quint8 *pDigest)
     setBe32(pContext->buffer + 56, (quint32)(nNumBits >> 32));
     setBe32(pContext->buffer + 60, (quint32)(nNumBits));
 
-    transform(pContext->state, pContext->buffer);
+    transformBlocks(pContext->state, pContext->buffer, 1);
 
     for (qint32 i = 0; i < 8; i++) {
         setBe32(pDigest + i * 4, pContext->state[i]);
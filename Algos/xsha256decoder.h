@@ -41,6 +41,7 @@ public:
 
 private:
     static void transform(quint32 state[8], const quint8 data[64]);
+    static void transformBlocks(quint32 state[8], const quint8 *pData, qint32 nNumBlocks);
     static quint32 rotr(quint32 x, quint32 n);
     static quint32 getBe32(const quint8 *p);
     static void setBe32(quint8 *p, quint32 v);
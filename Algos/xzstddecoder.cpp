@@ -21,23 +21,471 @@
 #include "xzstddecoder.h"
 #include "algo_utils.h"
 
+#include <QBuffer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+
+namespace {
+
+const quint32 ZSTD_FRAME_MAGIC = 0xFD2FB528;
+const quint32 ZSTD_SKIPPABLE_MAGIC = 0x184D2A50;  // Low nibble is free
+const quint32 ZSTD_SEEKABLE_SKIPPABLE_MAGIC = 0x184D2A5E;
+const quint32 ZSTD_SEEKABLE_MAGIC = 0x8F92EAB1;
+const qint64 ZSTD_PARALLEL_FRAME_LIMIT = 0x4000000;  // Largest frame (either side) decoded in memory by a worker
+
+quint32 zstdReadLE32(const char *pData)
+{
+    return (quint32)(quint8)pData[0] | ((quint32)(quint8)pData[1] << 8) | ((quint32)(quint8)pData[2] << 16) | ((quint32)(quint8)pData[3] << 24);
+}
+
+quint64 zstdReadLE(const char *pData, qint32 nSize)
+{
+    quint64 nResult = 0;
+
+    for (qint32 i = nSize - 1; i >= 0; i--) {
+        nResult = (nResult << 8) | (quint8)pData[i];
+    }
+
+    return nResult;
+}
+
+QByteArray zstdReadBytes(QIODevice *pDevice, qint64 nOffset, qint64 nSize)
+{
+    QByteArray baResult;
+
+    if ((nOffset >= 0) && (nSize >= 0) && pDevice->seek(nOffset)) {
+        baResult = pDevice->read(nSize);
+    }
+
+    return baResult;
+}
+
+// DStreams are reset with ZSTD_initDStream and reused across calls and threads
+class XZstdDStreamPool {
+public:
+    ~XZstdDStreamPool()
+    {
+        for (qint32 i = 0; i < m_listStreams.count(); i++) {
+            ZSTD_freeDStream(m_listStreams.at(i));
+        }
+    }
+
+    ZSTD_DStream *acquire()
+    {
+        ZSTD_DStream *pResult = nullptr;
+
+        {
+            QMutexLocker locker(&m_mutex);
+
+            if (!m_listStreams.isEmpty()) {
+                pResult = m_listStreams.takeLast();
+            }
+        }
+
+        if (!pResult) {
+            pResult = ZSTD_createDStream();
+        }
+
+        if (pResult && ZSTD_isError(ZSTD_initDStream(pResult))) {
+            ZSTD_freeDStream(pResult);
+            pResult = nullptr;
+        }
+
+        return pResult;
+    }
+
+    void release(ZSTD_DStream *pDStream)
+    {
+        if (pDStream) {
+            QMutexLocker locker(&m_mutex);
+
+            if (m_listStreams.count() < (std::max)(QThread::idealThreadCount(), 1) * 2) {
+                m_listStreams.append(pDStream);
+                pDStream = nullptr;
+            }
+        }
+
+        if (pDStream) {
+            ZSTD_freeDStream(pDStream);
+        }
+    }
+
+private:
+    QMutex m_mutex;
+    QList<ZSTD_DStream *> m_listStreams;
+};
+
+XZstdDStreamPool *zstdDStreamPool()
+{
+    static XZstdDStreamPool pool;
+    return &pool;
+}
+
+// Decodes the frame at [nOffset, nOffset + nSize) and writes the window [nSkip, nSkip + nTake) of its output
+bool zstdDecodeFrame(QIODevice *pDevice, qint64 nOffset, qint64 nSize, QIODevice *pDeviceOutput, qint64 nSkip, qint64 nTake, qint64 *pnDecoded,
+                     qint64 *pnWritten, XBinary::PDSTRUCT *pPdStruct)
+{
+    *pnDecoded = 0;
+    *pnWritten = 0;
+
+    ZSTD_DStream *pDStream = zstdDStreamPool()->acquire();
+
+    if (!pDStream) {
+        return false;
+    }
+
+    qint32 _nBufferSize = XBinary::getBufferSize(pPdStruct);
+    QByteArray baOutput;
+    baOutput.resize(_nBufferSize);
+
+    bool bFinished = false;
+    bool bError = false;
+    qint64 nRead = 0;
+
+    while (!bFinished && !bError && (nRead < nSize) && XBinary::isPdStructNotCanceled(pPdStruct)) {
+        QByteArray baInput = zstdReadBytes(pDevice, nOffset + nRead, (std::min)((qint64)_nBufferSize, nSize - nRead));
+
+        if (baInput.isEmpty()) {
+            break;
+        }
+
+        nRead += baInput.size();
+
+        ZSTD_inBuffer input = {baInput.constData(), (size_t)baInput.size(), 0};
+
+        while (!bFinished && !bError && (input.pos < input.size)) {
+            ZSTD_outBuffer output = {baOutput.data(), (size_t)baOutput.size(), 0};
+
+            size_t nRet = ZSTD_decompressStream(pDStream, &output, &input);
+
+            if (ZSTD_isError(nRet)) {
+                bError = true;
+                break;
+            }
+
+            qint64 nStart = *pnDecoded;
+            qint64 nEnd = nStart + (qint64)output.pos;
+            qint64 nWindowStart = (std::max)(nStart, nSkip);
+            qint64 nWindowEnd = (nTake == -1) ? nEnd : (std::min)(nEnd, nSkip + nTake);
+
+            if (nWindowEnd > nWindowStart) {
+                qint64 nToWrite = nWindowEnd - nWindowStart;
+
+                if (pDeviceOutput->write(baOutput.constData() + (nWindowStart - nStart), nToWrite) != nToWrite) {
+                    bError = true;
+                    break;
+                }
+
+                *pnWritten += nToWrite;
+            }
+
+            *pnDecoded = nEnd;
+
+            if (nRet == 0) {
+                bFinished = true;
+            }
+        }
+    }
+
+    zstdDStreamPool()->release(pDStream);
+
+    return bFinished && !bError && XBinary::isPdStructNotCanceled(pPdStruct);
+}
+
+// Frames listed by the seekable-format seek table at the end of [nOffset, nOffset + nSize)
+bool zstdGetSeekTableFrames(QIODevice *pDevice, qint64 nOffset, qint64 nSize, QList<XZstdDecoder::ZSTD_FRAME> *pListFrames)
+{
+    if (nSize < 17) {
+        return false;
+    }
+
+    QByteArray baFooter = zstdReadBytes(pDevice, nOffset + nSize - 9, 9);
+
+    if ((baFooter.size() != 9) || (zstdReadLE32(baFooter.constData() + 5) != ZSTD_SEEKABLE_MAGIC)) {
+        return false;
+    }
+
+    quint32 nNumberOfFrames = zstdReadLE32(baFooter.constData());
+    quint8 nDescriptor = (quint8)baFooter.at(4);
+
+    if (nDescriptor & 0x7C) {  // Reserved bits
+        return false;
+    }
+
+    qint64 nEntrySize = (nDescriptor & 0x80) ? 12 : 8;
+    qint64 nTableSize = 8 + nEntrySize * nNumberOfFrames + 9;
+
+    if (nTableSize > nSize) {
+        return false;
+    }
+
+    qint64 nTableOffset = nOffset + nSize - nTableSize;
+    QByteArray baTable = zstdReadBytes(pDevice, nTableOffset, nTableSize);
+
+    if ((baTable.size() != nTableSize) || (zstdReadLE32(baTable.constData()) != ZSTD_SEEKABLE_SKIPPABLE_MAGIC) ||
+        ((qint64)zstdReadLE32(baTable.constData() + 4) != nTableSize - 8)) {
+        return false;
+    }
+
+    QList<XZstdDecoder::ZSTD_FRAME> listFrames;
+    qint64 nFrameOffset = nOffset;
+    qint64 nDecompressedOffset = 0;
+
+    for (quint32 i = 0; i < nNumberOfFrames; i++) {
+        const char *pEntry = baTable.constData() + 8 + i * nEntrySize;
+
+        XZstdDecoder::ZSTD_FRAME frame = {};
+        frame.nOffset = nFrameOffset;
+        frame.nCompressedSize = zstdReadLE32(pEntry);
+        frame.nDecompressedOffset = nDecompressedOffset;
+        frame.nDecompressedSize = zstdReadLE32(pEntry + 4);
+
+        if (frame.nCompressedSize == 0) {
+            return false;
+        }
+
+        listFrames.append(frame);
+
+        nFrameOffset += frame.nCompressedSize;
+        nDecompressedOffset += frame.nDecompressedSize;
+    }
+
+    if (nFrameOffset != nTableOffset) {
+        return false;
+    }
+
+    *pListFrames = listFrames;
+
+    return true;
+}
+
+// Size of the frame at nOffset from its header and block headers; *pnContentSize is -1 if not stored
+qint64 zstdGetFrameSize(QIODevice *pDevice, qint64 nOffset, qint64 nLimit, qint64 *pnContentSize)
+{
+    *pnContentSize = -1;
+
+    QByteArray baHeader = zstdReadBytes(pDevice, nOffset, 18);  // Magic + largest frame header
+
+    if (baHeader.size() < 6) {
+        return -1;
+    }
+
+    quint8 nDescriptor = (quint8)baHeader.at(4);
+
+    if (nDescriptor & 0x08) {  // Reserved bit
+        return -1;
+    }
+
+    bool bSingleSegment = (nDescriptor & 0x20) != 0;
+    qint32 nFCSFlag = nDescriptor >> 6;
+    qint32 nDictIDSize = (nDescriptor & 0x03) ? (1 << ((nDescriptor & 0x03) - 1)) : 0;
+    qint32 nFCSSize = (nFCSFlag == 0) ? (bSingleSegment ? 1 : 0) : (1 << nFCSFlag);
+    qint32 nHeaderSize = 5 + (bSingleSegment ? 0 : 1) + nDictIDSize + nFCSSize;
+
+    if (baHeader.size() < nHeaderSize) {
+        return -1;
+    }
+
+    if (nFCSSize) {
+        quint64 nFCS = zstdReadLE(baHeader.constData() + nHeaderSize - nFCSSize, nFCSSize);
+
+        if (nFCSSize == 2) {
+            nFCS += 256;
+        }
+
+        *pnContentSize = (qint64)nFCS;
+    }
+
+    qint64 nPos = nHeaderSize;
+    bool bLast = false;
+
+    while (!bLast) {
+        QByteArray baBlockHeader = zstdReadBytes(pDevice, nOffset + nPos, 3);
+
+        if (baBlockHeader.size() != 3) {
+            return -1;
+        }
+
+        quint32 nBlockHeader = (quint32)zstdReadLE(baBlockHeader.constData(), 3);
+        quint32 nBlockType = (nBlockHeader >> 1) & 0x03;
+        qint64 nBlockSize = nBlockHeader >> 3;
+
+        bLast = (nBlockHeader & 1) != 0;
+
+        if (nBlockType == 3) {
+            return -1;
+        } else if (nBlockType == 1) {  // RLE: a single byte
+            nBlockSize = 1;
+        }
+
+        nPos += 3 + nBlockSize;
+
+        if (nPos > nLimit) {
+            return -1;
+        }
+    }
+
+    if (nDescriptor & 0x04) {  // Content checksum
+        nPos += 4;
+    }
+
+    if (nPos > nLimit) {
+        return -1;
+    }
+
+    return nPos;
+}
+
+class ZstdFrameRunnable : public QRunnable {
+public:
+    ZstdFrameRunnable(qint64 nSkip, qint64 nTake, XBinary::PDSTRUCT *pPdStruct) : m_nSkip(nSkip), m_nTake(nTake), m_pPdStruct(pPdStruct), m_bSuccess(false)
+    {
+        setAutoDelete(false);
+    }
+
+    QByteArray *getInput()
+    {
+        return &m_baInput;
+    }
+
+    const QByteArray &getOutput() const
+    {
+        return m_baOutput;
+    }
+
+    bool isSuccess() const
+    {
+        return m_bSuccess;
+    }
+
+    void run() override
+    {
+        QBuffer bufferInput(&m_baInput);
+        QBuffer bufferOutput(&m_baOutput);
+
+        if (bufferInput.open(QIODevice::ReadOnly) && bufferOutput.open(QIODevice::WriteOnly)) {
+            qint64 nDecoded = 0;
+            qint64 nWritten = 0;
+            m_bSuccess = zstdDecodeFrame(&bufferInput, 0, m_baInput.size(), &bufferOutput, m_nSkip, m_nTake, &nDecoded, &nWritten, m_pPdStruct);
+        }
+    }
+
+private:
+    qint64 m_nSkip;
+    qint64 m_nTake;
+    XBinary::PDSTRUCT *m_pPdStruct;
+    QByteArray m_baInput;
+    QByteArray m_baOutput;
+    bool m_bSuccess;
+};
+
+}  // namespace
+
 XZstdDecoder::XZstdDecoder(QObject *parent) : QObject(parent)
 {
 }
 
+bool XZstdDecoder::getFrames(QIODevice *pDevice, qint64 nOffset, qint64 nSize, QList<ZSTD_FRAME> *pListFrames, qint64 *pnFramesSize, XBinary::PDSTRUCT *pPdStruct)
+{
+    if (!pDevice || !pListFrames || (nOffset < 0) || (nSize < 0)) {
+        return false;
+    }
+
+    pListFrames->clear();
+
+    if (zstdGetSeekTableFrames(pDevice, nOffset, nSize, pListFrames)) {
+        if (pnFramesSize) {
+            *pnFramesSize = nSize;
+        }
+
+        return true;
+    }
+
+    // No seek table: walk the frame headers, skippable frames are passed over
+    qint64 nPos = 0;
+    qint64 nDecompressedOffset = 0;
+
+    while ((nPos + 8 <= nSize) && XBinary::isPdStructNotCanceled(pPdStruct)) {
+        QByteArray baMagic = zstdReadBytes(pDevice, nOffset + nPos, 8);
+
+        if (baMagic.size() != 8) {
+            break;
+        }
+
+        quint32 nMagic = zstdReadLE32(baMagic.constData());
+
+        if ((nMagic & 0xFFFFFFF0) == ZSTD_SKIPPABLE_MAGIC) {
+            qint64 nFrameSize = 8 + (qint64)zstdReadLE32(baMagic.constData() + 4);
+
+            if (nPos + nFrameSize > nSize) {
+                return false;
+            }
+
+            nPos += nFrameSize;
+        } else if (nMagic == ZSTD_FRAME_MAGIC) {
+            ZSTD_FRAME frame = {};
+            frame.nOffset = nOffset + nPos;
+            frame.nCompressedSize = zstdGetFrameSize(pDevice, frame.nOffset, nSize - nPos, &frame.nDecompressedSize);
+            frame.nDecompressedOffset = nDecompressedOffset;
+
+            if (frame.nCompressedSize == -1) {
+                return false;
+            }
+
+            if ((nDecompressedOffset != -1) && (frame.nDecompressedSize != -1)) {
+                nDecompressedOffset += frame.nDecompressedSize;
+            } else {
+                nDecompressedOffset = -1;
+            }
+
+            pListFrames->append(frame);
+            nPos += frame.nCompressedSize;
+        } else {
+            break;  // Trailing data
+        }
+    }
+
+    if (pnFramesSize) {
+        *pnFramesSize = nPos;
+    }
+
+    return !pListFrames->isEmpty() && XBinary::isPdStructNotCanceled(pPdStruct);
+}
+
 bool XZstdDecoder::decompress(XBinary::DATAPROCESS_STATE *pDecompressState, XBinary::PDSTRUCT *pPdStruct)
 {
     bool bResult = false;
 
     if (pDecompressState && pDecompressState->pDeviceInput && pDecompressState->pDeviceOutput) {
+        Algo_utils::seekToStart(pDecompressState);
+
+        qint64 nInputSize = pDecompressState->nInputLimit;
+
+        if ((nInputSize == -1) && !pDecompressState->pDeviceInput->isSequential()) {
+            nInputSize = pDecompressState->pDeviceInput->size() - pDecompressState->nInputOffset;
+        }
+
+        QList<ZSTD_FRAME> listFrames;
+        qint64 nFramesSize = 0;
+
+        if ((nInputSize > 0) && getFrames(pDecompressState->pDeviceInput, pDecompressState->nInputOffset, nInputSize, &listFrames, &nFramesSize, pPdStruct)) {
+            return _decompressFrames(pDecompressState, listFrames, nFramesSize, pPdStruct);
+        }
+
         qint32 _nBufferSize = XBinary::getBufferSize(pPdStruct);
 
-        char *bufferIn = new char[_nBufferSize];
+        Algo_utils::MAPPED_INPUT mappedInput = {};
+        char *bufferIn = Algo_utils::mapInput(pDecompressState, &mappedInput) ? nullptr : new char[_nBufferSize];
         char *bufferOut = new char[_nBufferSize];
 
         Algo_utils::seekToStart(pDecompressState);
 
-        ZSTD_DStream *pDStream = ZSTD_createDStream();
+        ZSTD_DStream *pDStream = zstdDStreamPool()->acquire();
 
         if (pDStream) {
             size_t nInitResult = ZSTD_initDStream(pDStream);
@@ -54,10 +502,11 @@ bool XZstdDecoder::decompress(XBinary::DATAPROCESS_STATE *pDecompressState, XBin
                         qint32 nBufferSize = Algo_utils::getReadChunkSize(pDecompressState, _nBufferSize);
 
                         if (nBufferSize > 0) {
-                            qint32 nRead = XBinary::_readDevice(bufferIn, nBufferSize, pDecompressState);
+                            qint32 nRead = 0;
+                            const char *pInput = Algo_utils::readSpan(pDecompressState, &mappedInput, bufferIn, nBufferSize, &nRead);
 
                             if (nRead > 0) {
-                                input.src = bufferIn;
+                                input.src = pInput;
                                 input.size = nRead;
                                 input.pos = 0;
                             } else {
@@ -103,12 +552,129 @@ bool XZstdDecoder::decompress(XBinary::DATAPROCESS_STATE *pDecompressState, XBin
                 }
             }
 
-            ZSTD_freeDStream(pDStream);
+            zstdDStreamPool()->release(pDStream);
         }
 
+        Algo_utils::unmapInput(&mappedInput);
         delete[] bufferIn;
         delete[] bufferOut;
     }
 
     return bResult;
 }
+
+bool XZstdDecoder::_decompressFrames(XBinary::DATAPROCESS_STATE *pDecompressState, const QList<ZSTD_FRAME> &listFrames, qint64 nFramesSize,
+                                     XBinary::PDSTRUCT *pPdStruct)
+{
+    QIODevice *pDevice = pDecompressState->pDeviceInput;
+    QIODevice *pDeviceOutput = pDecompressState->pDeviceOutput;
+
+    // Output window in decompressed coordinates
+    qint64 nWriteFrom = (std::max)(pDecompressState->nProcessedOffset, (qint64)0);
+    qint64 nWriteEnd = (pDecompressState->nProcessedLimit == -1) ? -1 : (nWriteFrom + pDecompressState->nProcessedLimit);
+
+    pDecompressState->nCountInput = 0;
+    pDecompressState->nCountOutput = 0;
+
+    qint32 nNumberOfFrames = listFrames.count();
+    qint32 nNumberOfThreads = QThread::idealThreadCount();
+    bool bParallel = (nNumberOfThreads > 1) && (nNumberOfFrames > 1);
+
+    for (qint32 i = 0; (i < nNumberOfFrames) && bParallel; i++) {
+        const ZSTD_FRAME &frame = listFrames.at(i);
+
+        if ((frame.nDecompressedSize == -1) || (frame.nDecompressedSize > ZSTD_PARALLEL_FRAME_LIMIT) || (frame.nCompressedSize > ZSTD_PARALLEL_FRAME_LIMIT)) {
+            bParallel = false;
+        }
+    }
+
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount((std::max)(nNumberOfThreads, 1));
+
+    qint32 nBatchSize = bParallel ? nNumberOfThreads : 1;
+    qint64 nPos = 0;  // Decompressed offset of frame i
+    bool bResult = true;
+
+    for (qint32 i = 0; (i < nNumberOfFrames) && bResult && XBinary::isPdStructNotCanceled(pPdStruct);) {
+        if ((nWriteEnd != -1) && (nPos >= nWriteEnd)) {
+            break;
+        }
+
+        const ZSTD_FRAME &frame = listFrames.at(i);
+
+        // Random access: frames with a known size ahead of the window are not decoded
+        if ((frame.nDecompressedSize != -1) && (nPos + frame.nDecompressedSize <= nWriteFrom)) {
+            nPos += frame.nDecompressedSize;
+            i++;
+            continue;
+        }
+
+        if (nBatchSize > 1) {
+            QList<ZstdFrameRunnable *> listTasks;
+            qint64 nFramePos = nPos;
+
+            for (qint32 j = i; (j < nNumberOfFrames) && (listTasks.count() < nBatchSize); j++) {
+                const ZSTD_FRAME &frameTask = listFrames.at(j);
+
+                if ((nWriteEnd != -1) && (nFramePos >= nWriteEnd)) {
+                    break;
+                }
+
+                qint64 nSkip = (std::max)(nWriteFrom - nFramePos, (qint64)0);
+                qint64 nTake = (nWriteEnd == -1) ? -1 : ((std::min)(nWriteEnd - nFramePos, frameTask.nDecompressedSize) - nSkip);
+
+                ZstdFrameRunnable *pTask = new ZstdFrameRunnable(nSkip, nTake, pPdStruct);
+                *(pTask->getInput()) = zstdReadBytes(pDevice, frameTask.nOffset, frameTask.nCompressedSize);
+                listTasks.append(pTask);
+                threadPool.start(pTask);
+
+                nFramePos += frameTask.nDecompressedSize;
+            }
+
+            threadPool.waitForDone();
+
+            for (qint32 j = 0; j < listTasks.count(); j++) {
+                ZstdFrameRunnable *pTask = listTasks.at(j);
+
+                if (bResult && pTask->isSuccess()) {
+                    const QByteArray &baOutput = pTask->getOutput();
+
+                    if (pDeviceOutput->write(baOutput) == baOutput.size()) {
+                        pDecompressState->nCountOutput += baOutput.size();
+                    } else {
+                        pDecompressState->bWriteError = true;
+                        bResult = false;
+                    }
+                } else {
+                    bResult = false;
+                }
+
+                delete pTask;
+            }
+
+            i += listTasks.count();
+            nPos = nFramePos;
+        } else {
+            qint64 nSkip = (std::max)(nWriteFrom - nPos, (qint64)0);
+            qint64 nTake = (nWriteEnd == -1) ? -1 : (std::max)(nWriteEnd - (std::max)(nWriteFrom, nPos), (qint64)0);
+            qint64 nDecoded = 0;
+            qint64 nWritten = 0;
+
+            bResult = zstdDecodeFrame(pDevice, frame.nOffset, frame.nCompressedSize, pDeviceOutput, nSkip, nTake, &nDecoded, &nWritten, pPdStruct);
+
+            if ((frame.nDecompressedSize != -1) && (nDecoded != frame.nDecompressedSize)) {
+                bResult = false;
+            }
+
+            pDecompressState->nCountOutput += nWritten;
+            nPos += nDecoded;
+            i++;
+        }
+    }
+
+    if (bResult) {
+        pDecompressState->nCountInput = nFramesSize;
+    }
+
+    return bResult && XBinary::isPdStructNotCanceled(pPdStruct);
+}
@@ -50,9 +50,23 @@ class XZstdDecoder : public QObject {
     Q_OBJECT
 
 public:
+    // One zstd frame; sizes come from the seek table or the frame header, -1 if unknown
+    struct ZSTD_FRAME {
+        qint64 nOffset;
+        qint64 nCompressedSize;
+        qint64 nDecompressedOffset;
+        qint64 nDecompressedSize;
+    };
+
     explicit XZstdDecoder(QObject *parent = nullptr);
 
     static bool decompress(XBinary::DATAPROCESS_STATE *pDecompressState, XBinary::PDSTRUCT *pPdStruct = nullptr);
+    static bool getFrames(QIODevice *pDevice, qint64 nOffset, qint64 nSize, QList<ZSTD_FRAME> *pListFrames, qint64 *pnFramesSize = nullptr,
+                          XBinary::PDSTRUCT *pPdStruct = nullptr);
+
+private:
+    static bool _decompressFrames(XBinary::DATAPROCESS_STATE *pDecompressState, const QList<ZSTD_FRAME> &listFrames, qint64 nFramesSize,
+                                  XBinary::PDSTRUCT *pPdStruct);
 };
 
 #endif  // XZSTDDECODER_H
@@ -0,0 +1,283 @@
+/* Copyright (c) 2025-2026 hors<horsicq@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Solid 7z extraction benchmark: builds archives with a growing number of records in one LZMA2 folder and
+// times a streaming walk over all of them. With the folder decoded once, the time per record stays flat;
+// a walk that re-decodes the folder from its start for every record grows linearly with the record count.
+// Usage: bench_7z_solid [largest record count (4096)] [record size (4096)]
+
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+
+#include <cstdio>
+
+#include "xsevenzip.h"
+
+namespace {
+
+const qint32 N_LZMA2_CHUNK_SIZE = 0x10000;
+
+// 7z NUMBER: the count of leading one bits in the first byte gives the number of little-endian bytes that follow
+void appendNumber(QByteArray *pbaData, quint64 nValue)
+{
+    qint32 nExtraBytes = 0;
+
+    while ((nExtraBytes < 8) && (nValue >= ((quint64)1 << (7 * (nExtraBytes + 1))))) {
+        nExtraBytes++;
+    }
+
+    quint8 nFirstByte = (quint8)(0xFF00 >> nExtraBytes);
+
+    if (nExtraBytes < 8) {
+        nFirstByte |= (quint8)((nExtraBytes < 7) ? (nValue >> (8 * nExtraBytes)) : 0);
+    }
+
+    pbaData->append((char)nFirstByte);
+
+    for (qint32 i = 0; i < nExtraBytes; i++) {
+        pbaData->append((char)(nValue >> (8 * i)));
+    }
+}
+
+void appendUInt32(QByteArray *pbaData, quint32 nValue)
+{
+    for (qint32 i = 0; i < 4; i++) {
+        pbaData->append((char)(nValue >> (8 * i)));
+    }
+}
+
+void appendUInt64(QByteArray *pbaData, quint64 nValue)
+{
+    for (qint32 i = 0; i < 8; i++) {
+        pbaData->append((char)(nValue >> (8 * i)));
+    }
+}
+
+quint32 getCRC32(const QByteArray &baData)
+{
+    return XBinary::_getCRC32(baData, 0xFFFFFFFF, XBinary::_getCRC32Table_EDB88320()) ^ 0xFFFFFFFF;
+}
+
+QByteArray getRecordData(qint32 nIndex, qint32 nRecordSize)
+{
+    QByteArray baResult(nRecordSize, '\0');
+
+    for (qint32 j = 0; j < nRecordSize; j++) {
+        baResult[j] = (char)(((nIndex * 131) + (j * 7)) ^ (j >> 8));
+    }
+
+    return baResult;
+}
+
+// The repo has no LZMA encoder, so the folder is an LZMA2 stream of uncompressed chunks: the records still
+// go through the LZMA2 decoder and the solid folder path, only the match decoding is skipped
+QByteArray createSolid7z(qint32 nNumberOfRecords, qint32 nRecordSize, QList<quint32> *pListCRC)
+{
+    QByteArray baUnpacked;
+
+    for (qint32 i = 0; i < nNumberOfRecords; i++) {
+        QByteArray baRecord = getRecordData(i, nRecordSize);
+        pListCRC->append(getCRC32(baRecord));
+        baUnpacked.append(baRecord);
+    }
+
+    QByteArray baPacked;
+
+    for (qint32 nOffset = 0; nOffset < baUnpacked.size(); nOffset += N_LZMA2_CHUNK_SIZE) {
+        qint32 nChunkSize = qMin(N_LZMA2_CHUNK_SIZE, (qint32)baUnpacked.size() - nOffset);
+
+        baPacked.append((char)((nOffset == 0) ? 0x01 : 0x02));  // Uncompressed chunk, the first one resets the dictionary
+        baPacked.append((char)((nChunkSize - 1) >> 8));
+        baPacked.append((char)((nChunkSize - 1) & 0xFF));
+        baPacked.append(baUnpacked.constData() + nOffset, nChunkSize);
+    }
+
+    baPacked.append('\0');
+
+    QByteArray baHeader;
+    baHeader.append((char)XSevenZip::k7zIdHeader);
+    baHeader.append((char)XSevenZip::k7zIdMainStreamsInfo);
+
+    baHeader.append((char)XSevenZip::k7zIdPackInfo);
+    appendNumber(&baHeader, 0);  // Pack position
+    appendNumber(&baHeader, 1);
+    baHeader.append((char)XSevenZip::k7zIdSize);
+    appendNumber(&baHeader, baPacked.size());
+    baHeader.append((char)XSevenZip::k7zIdEnd);
+
+    // One folder with a single LZMA2 coder (id 0x21, one property byte: 1 MiB dictionary)
+    baHeader.append((char)XSevenZip::k7zIdUnpackInfo);
+    baHeader.append((char)XSevenZip::k7zIdFolder);
+    appendNumber(&baHeader, 1);
+    baHeader.append('\0');  // Not external
+    appendNumber(&baHeader, 1);
+    baHeader.append(QByteArray::fromHex("21210110"));
+    baHeader.append((char)XSevenZip::k7zIdCodersUnpackSize);
+    appendNumber(&baHeader, baUnpacked.size());
+    baHeader.append((char)XSevenZip::k7zIdEnd);
+
+    baHeader.append((char)XSevenZip::k7zIdSubStreamsInfo);
+    baHeader.append((char)XSevenZip::k7zIdNumUnpackStream);
+    appendNumber(&baHeader, nNumberOfRecords);
+    baHeader.append((char)XSevenZip::k7zIdSize);
+
+    for (qint32 i = 0; i < nNumberOfRecords - 1; i++) {
+        appendNumber(&baHeader, nRecordSize);
+    }
+
+    baHeader.append((char)XSevenZip::k7zIdCRC);
+    baHeader.append('\x01');  // All defined
+
+    for (qint32 i = 0; i < nNumberOfRecords; i++) {
+        appendUInt32(&baHeader, pListCRC->at(i));
+    }
+
+    baHeader.append((char)XSevenZip::k7zIdEnd);
+    baHeader.append((char)XSevenZip::k7zIdEnd);
+
+    QByteArray baNames;
+
+    for (qint32 i = 0; i < nNumberOfRecords; i++) {
+        QString sName = QString("file%1.bin").arg(i, 6, 10, QChar('0'));
+
+        for (qint32 j = 0; j < sName.size(); j++) {
+            ushort nChar = sName.at(j).unicode();
+            baNames.append((char)(nChar & 0xFF));
+            baNames.append((char)(nChar >> 8));
+        }
+
+        baNames.append(2, '\0');
+    }
+
+    baHeader.append((char)XSevenZip::k7zIdFilesInfo);
+    appendNumber(&baHeader, nNumberOfRecords);
+    baHeader.append((char)XSevenZip::k7zIdName);
+    appendNumber(&baHeader, baNames.size() + 1);
+    baHeader.append('\0');  // Not external
+    baHeader.append(baNames);
+    baHeader.append((char)XSevenZip::k7zIdEnd);
+    baHeader.append((char)XSevenZip::k7zIdEnd);
+
+    QByteArray baStartHeader;
+    appendUInt64(&baStartHeader, baPacked.size());
+    appendUInt64(&baStartHeader, baHeader.size());
+    appendUInt32(&baStartHeader, getCRC32(baHeader));
+
+    QByteArray baResult = QByteArray::fromHex("377ABCAF271C0004");
+    appendUInt32(&baResult, getCRC32(baStartHeader));
+    baResult.append(baStartHeader);
+    baResult.append(baPacked);
+    baResult.append(baHeader);
+
+    return baResult;
+}
+
+// Walks every record the way XArchives::decompressToFolder does, into memory; returns the number of records that match
+qint32 extractAll(QIODevice *pDevice, qint32 nRecordSize, const QList<quint32> &listCRC, XBinary::PDSTRUCT *pPdStruct)
+{
+    XSevenZip sevenZip(pDevice);
+
+    XBinary::UNPACK_STATE state = {};
+
+    if (!sevenZip.initUnpack(&state, sevenZip.getDefaultUnpackProperties(), pPdStruct)) {
+        return 0;
+    }
+
+    qint32 nResult = 0;
+
+    while ((state.nCurrentIndex < state.nNumberOfRecords) && XBinary::isPdStructNotCanceled(pPdStruct)) {
+        qint32 nIndex = state.nCurrentIndex;
+
+        QBuffer buffer;
+        buffer.open(QIODevice::ReadWrite);
+
+        if (sevenZip.unpackCurrent(&state, &buffer, pPdStruct)) {
+            const QByteArray &baRecord = buffer.data();
+
+            if ((baRecord.size() == nRecordSize) && (nIndex < listCRC.count()) && (getCRC32(baRecord) == listCRC.at(nIndex))) {
+                nResult++;
+            }
+        }
+
+        if (!sevenZip.moveToNext(&state, pPdStruct)) {
+            break;
+        }
+    }
+
+    sevenZip.finishUnpack(&state, pPdStruct);
+
+    return nResult;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    qint32 nMaxRecords = (argc > 1) ? QString(argv[1]).toInt() : 4096;
+    qint32 nRecordSize = (argc > 2) ? QString(argv[2]).toInt() : 4096;
+
+    if ((nMaxRecords < 1) || (nRecordSize < 1)) {
+        printf("Usage: bench_7z_solid [largest record count] [record size]\n");
+        return 1;
+    }
+
+    XBinary::PDSTRUCT pdStruct = XBinary::createPdStruct();
+
+    printf("%10s %14s %14s %14s\n", "records", "archive KiB", "total ms", "us/record");
+
+    double dFirstPerRecord = 0;
+    double dLastPerRecord = 0;
+
+    for (qint32 nNumberOfRecords = qMin(256, nMaxRecords); nNumberOfRecords <= nMaxRecords; nNumberOfRecords *= 2) {
+        QList<quint32> listCRC;
+        QByteArray baArchive = createSolid7z(nNumberOfRecords, nRecordSize, &listCRC);
+
+        QBuffer buffer(&baArchive);
+        buffer.open(QIODevice::ReadOnly);
+
+        QElapsedTimer timer;
+        timer.start();
+        qint32 nExtracted = extractAll(&buffer, nRecordSize, listCRC, &pdStruct);
+        qint64 nTime = timer.nsecsElapsed();
+
+        if (nExtracted != nNumberOfRecords) {
+            printf("%d records: %d extracted correctly\n", nNumberOfRecords, nExtracted);
+            return 1;
+        }
+
+        double dPerRecord = (nTime / 1000.0) / nNumberOfRecords;
+
+        if (dFirstPerRecord == 0) {
+            dFirstPerRecord = dPerRecord;
+        }
+
+        dLastPerRecord = dPerRecord;
+
+        printf("%10d %14lld %14.1f %14.2f\n", nNumberOfRecords, (qint64)(baArchive.size() / 1024), nTime / 1000000.0, dPerRecord);
+    }
+
+    printf("per-record time, largest / smallest count: %.2f\n", dLastPerRecord / qMax(dFirstPerRecord, 0.001));
+
+    return 0;
+}
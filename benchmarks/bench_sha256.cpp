@@ -0,0 +1,146 @@
+/* Copyright (c) 2025-2026 hors<horsicq@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// SHA-256 backend microbenchmark: the 7z and RAR5 key derivations and plain hashing, timed with the
+// SHA-NI backend and again with the CPU features masked off so the scalar transform runs.
+// Usage: bench_sha256 [7z cycles power (19)] [RAR5 KDF count (15)]
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QList>
+
+#include <cstdio>
+
+#include "algo_utils.h"
+#include "xaesdecoder.h"
+#include "xsha256decoder.h"
+
+namespace {
+
+struct BACKEND {
+    const char *pszName;
+    quint32 nFeatureMask;
+};
+
+// Key = SHA256 over 2^nNumCyclesPower copies of (UTF-16LE password + 64-bit counter): 7zAes.cpp with the empty salt 7-Zip writes
+void run7zKDF(const QByteArray &baPassword, quint8 nNumCyclesPower, quint8 *pKey)
+{
+    QByteArray baBuffer = baPassword + QByteArray(8, '\0');
+    const qint32 nCounterOffset = baBuffer.size() - 8;
+    const quint32 nNumRounds = static_cast<quint32>(1) << nNumCyclesPower;
+
+    XSha256Decoder::Context sha;
+    XSha256Decoder::init(&sha);
+
+    for (quint32 nRound = 0; nRound < nNumRounds; nRound++) {
+        baBuffer[nCounterOffset + 0] = (char)(nRound >> 0);
+        baBuffer[nCounterOffset + 1] = (char)(nRound >> 8);
+        baBuffer[nCounterOffset + 2] = (char)(nRound >> 16);
+        baBuffer[nCounterOffset + 3] = (char)(nRound >> 24);
+
+        XSha256Decoder::update(&sha, reinterpret_cast<const quint8 *>(baBuffer.constData()), baBuffer.size());
+    }
+
+    XSha256Decoder::final(&sha, pKey);
+}
+
+void runBulk(const QByteArray &baData, quint8 *pDigest)
+{
+    XSha256Decoder::Context sha;
+    XSha256Decoder::init(&sha);
+    XSha256Decoder::update(&sha, reinterpret_cast<const quint8 *>(baData.constData()), baData.size());
+    XSha256Decoder::final(&sha, pDigest);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    quint8 nNumCyclesPower = (argc > 1) ? (quint8)QString(argv[1]).toUInt() : 19;
+    quint8 nKdfCount = (argc > 2) ? (quint8)QString(argv[2]).toUInt() : 15;
+
+    const QString sPassword = QStringLiteral("benchmark password");
+    QByteArray baPassword;
+
+    for (qint32 i = 0; i < sPassword.size(); i++) {
+        ushort nChar = sPassword.at(i).unicode();
+        baPassword.append((char)(nChar & 0xFF));
+        baPassword.append((char)(nChar >> 8));
+    }
+
+    QByteArray baSalt(16, '\x5A');
+    QByteArray baBulk(64 * 1024 * 1024, '\xA5');
+
+    QList<BACKEND> listBackends;
+
+    if (Algo_utils::isCPUFeatureSupported(Algo_utils::CPU_FEATURE_SSSE3 | Algo_utils::CPU_FEATURE_SSE41 | Algo_utils::CPU_FEATURE_SHA)) {
+        listBackends.append({"sha-ni", 0xFFFFFFFF});
+    } else {
+        printf("sha-ni: not supported by this CPU\n");
+    }
+
+    listBackends.append({"scalar", 0});
+
+    printf("%-8s %14s %14s %14s\n", "backend", "7z KDF ms", "RAR5 KDF ms", "bulk MiB/s");
+
+    QByteArray baReference;
+
+    for (qint32 i = 0; i < listBackends.count(); i++) {
+        Algo_utils::setCPUFeatureMask(listBackends.at(i).nFeatureMask);
+
+        QElapsedTimer timer;
+        quint8 aKey[32] = {};
+        quint8 aDigest[32] = {};
+
+        timer.start();
+        run7zKDF(baPassword, nNumCyclesPower, aKey);
+        qint64 n7zTime = timer.elapsed();
+
+        // The derived-key cache would turn a repeated derivation into a lookup
+        XAESDecoder::clearKeyCache();
+        timer.restart();
+        QByteArray baRar5Key = XAESDecoder::deriveRar5HeaderKey(sPassword, baSalt, nKdfCount);
+        qint64 nRar5Time = timer.elapsed();
+
+        timer.restart();
+        runBulk(baBulk, aDigest);
+        qint64 nBulkTime = qMax((qint64)1, timer.elapsed());
+
+        printf("%-8s %14lld %14lld %14.1f\n", listBackends.at(i).pszName, n7zTime, nRar5Time, (baBulk.size() / 1048576.0) * 1000.0 / nBulkTime);
+
+        // Every backend has to produce the same keys and digest
+        QByteArray baResult = QByteArray((const char *)aKey, sizeof(aKey)) + baRar5Key + QByteArray((const char *)aDigest, sizeof(aDigest));
+
+        if (baReference.isEmpty()) {
+            baReference = baResult;
+        } else if (baResult != baReference) {
+            printf("%s: result differs from %s\n", listBackends.at(i).pszName, listBackends.at(0).pszName);
+            return 1;
+        }
+    }
+
+    Algo_utils::setCPUFeatureMask(0xFFFFFFFF);
+    XAESDecoder::clearKeyCache();
+
+    return 0;
+}
@@ -389,9 +389,10 @@ bool XACE::moveToNext(UNPACK_STATE *pState, PDSTRUCT *pPdStruct)
 
 bool XACE::finishUnpack(UNPACK_STATE *pState, PDSTRUCT *pPdStruct)
 {
-    Q_UNUSED(pState)
     Q_UNUSED(pPdStruct)
 
+    _freeDecompressSession(pState);
+
     return true;
 }
 
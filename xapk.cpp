@@ -28,11 +28,10 @@ bool XAPK::isValid(PDSTRUCT *pPdStruct)
 {
     bool bResult = false;
 
-    XZip xzip(getDevice());
-
-    if (xzip.isValid()) {
-        qint64 nECDOffset = xzip.findECDOffset(pPdStruct);
-        bResult = xzip.isAPK(nECDOffset, pPdStruct);
+    // Reuse this instance so the central directory is parsed only once
+    if (XZip::isValid(pPdStruct)) {
+        qint64 nECDOffset = findECDOffset(pPdStruct);
+        bResult = isAPK(nECDOffset, pPdStruct);
     }
 
     return bResult;
@@ -185,8 +184,7 @@ XBinary::OFFSETSIZE XAPK::getSignOffsetSize()
     if ((nBlockSize1) && (nBlockSize1 == nBlockSize2)) {
         nOffset = nOffset - nBlockSize1 + 16;
 
-        qint64 nCentralDirectoryOffset = findECDOffset(nullptr);
-        nCentralDirectoryOffset = read_uint32(nCentralDirectoryOffset + offsetof(ENDOFCENTRALDIRECTORYRECORD, nOffsetToCentralDirectory));
+        qint64 nCentralDirectoryOffset = getCentralDirectoryTable(nullptr)->nCentralDirectoryOffset;
 
         osResult.nOffset = nOffset;
         osResult.nSize = qMax((qint64)0, nCentralDirectoryOffset - nOffset);
@@ -268,8 +266,7 @@ qint64 XAPK::findAPKSignBlockOffset(PDSTRUCT *pPdStruct)
 {
     qint64 nResult = -1;
 
-    qint64 nOffset = findECDOffset(pPdStruct);
-    nOffset = read_uint32(nOffset + offsetof(ENDOFCENTRALDIRECTORYRECORD, nOffsetToCentralDirectory));
+    qint64 nOffset = getCentralDirectoryTable(pPdStruct)->nCentralDirectoryOffset;
 
     nOffset = qMax((qint64)0, nOffset - 0x100);  // TODO const
 
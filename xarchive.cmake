@@ -1,10 +1,14 @@
 include_directories(${CMAKE_CURRENT_LIST_DIR})
 include_directories(${CMAKE_CURRENT_LIST_DIR}/Algos/)
 include_directories(${CMAKE_CURRENT_LIST_DIR}/3rdparty/bzip2/src/)
+include_directories(${CMAKE_CURRENT_LIST_DIR}/3rdparty/lzfse/src/)
 include_directories(${CMAKE_CURRENT_LIST_DIR}/3rdparty/lzma/src/)
 include_directories(${CMAKE_CURRENT_LIST_DIR}/3rdparty/zlib/src/)
 include_directories(${CMAKE_CURRENT_LIST_DIR}/3rdparty/ppmd/src/)
 
+# The 3rdparty libraries are added by CMakeLists.txt; targets built from these sources link them:
+# target_link_libraries(<target> bzip2 lzfse lzma ppmd zlib)
+
 if (NOT DEFINED XBINARY_SOURCES)
     include(${CMAKE_CURRENT_LIST_DIR}/../Formats/xbinary.cmake)
     set(XARCHIVE_SOURCES ${XARCHIVE_SOURCES} ${XBINARY_SOURCES})
@@ -35,6 +39,8 @@ set(XARCHIVE_SOURCES
     ${CMAKE_CURRENT_LIST_DIR}/xace.h
     ${CMAKE_CURRENT_LIST_DIR}/xarchive.cpp
     ${CMAKE_CURRENT_LIST_DIR}/xarchive.h
+    ${CMAKE_CURRENT_LIST_DIR}/xarchiveindex.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/xarchiveindex.h
     ${CMAKE_CURRENT_LIST_DIR}/xcab.cpp
     ${CMAKE_CURRENT_LIST_DIR}/xcab.h
     ${CMAKE_CURRENT_LIST_DIR}/xcfbf.cpp
@@ -193,6 +199,8 @@ set(XARCHIVE_SOURCES
     ${CMAKE_CURRENT_LIST_DIR}/Algos/xbranchdecoder.h
     ${CMAKE_CURRENT_LIST_DIR}/Algos/xlzxdecoder.cpp
     ${CMAKE_CURRENT_LIST_DIR}/Algos/xlzxdecoder.h
+    ${CMAKE_CURRENT_LIST_DIR}/Algos/xlzmsdecoder.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/Algos/xlzmsdecoder.h
     ${CMAKE_CURRENT_LIST_DIR}/Algos/xxpressdecoder.cpp
     ${CMAKE_CURRENT_LIST_DIR}/Algos/xxpressdecoder.h
     ${CMAKE_CURRENT_LIST_DIR}/Algos/xsha256decoder.cpp
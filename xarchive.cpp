@@ -19,7 +19,9 @@
  * SOFTWARE.
  */
 #include "xarchive.h"
+#include "xarchiveindex.h"
 #include "xdecompress.h"
+#include "Algos/algo_utils.h"
 #include "Algos/xppmddecoder.h"
 
 #if defined(_MSC_VER)
@@ -49,6 +51,20 @@ static ISzAlloc g_Alloc = {SzAlloc, SzFree};
 
 XArchive::XArchive(QIODevice *pDevice) : XBinary(pDevice)
 {
+    m_pArchiveIndex = nullptr;
+    m_pArchiveIndexDevice = nullptr;
+    m_nArchiveIndexSize = 0;
+}
+
+XArchive::~XArchive()
+{
+    QList<UNPACK_STATE *> listStates = m_mapDecompressSessions.keys();
+
+    for (qint32 i = 0; i < listStates.count(); i++) {
+        _freeDecompressSession(listStates.at(i));
+    }
+
+    delete m_pArchiveIndex;
 }
 
 quint64 XArchive::getNumberOfRecords(PDSTRUCT *pPdStruct)
@@ -516,6 +532,31 @@ XArchive::COMPRESS_RESULT XArchive::_compress_deflate(QIODevice *pSourceDevice,
 
     COMPRESS_RESULT result = COMPRESS_RESULT_UNKNOWN;
 
+    // Large random-access inputs are deflated block-parallel into the same single stream
+    if ((nMethod == Z_DEFLATED) && (!pSourceDevice->isSequential())) {
+        qint64 nInputSize = pSourceDevice->size() - pSourceDevice->pos();
+
+        if (Algo_utils::isDeflateParallel(nInputSize, nWindowsBits)) {
+            XBinary::DATAPROCESS_STATE compressState = {};
+            compressState.pDeviceInput = pSourceDevice;
+            compressState.pDeviceOutput = pDestDevice;
+            compressState.nInputOffset = pSourceDevice->pos();
+            compressState.nInputLimit = nInputSize;
+
+            if (Algo_utils::compressDeflateParallel(&compressState, pPdStruct, nLevel, nWindowsBits, nMemLevel, nStrategy)) {
+                result = COMPRESS_RESULT_OK;
+            } else if (compressState.bReadError) {
+                result = COMPRESS_RESULT_READERROR;
+            } else if (compressState.bWriteError) {
+                result = COMPRESS_RESULT_WRITEERROR;
+            } else if (XBinary::isPdStructNotCanceled(pPdStruct)) {
+                result = COMPRESS_RESULT_DATAERROR;  // deflate() failed on a block
+            }
+
+            return result;
+        }
+    }
+
     const qint32 CHUNK = COMPRESS_BUFFERSIZE;
 
     unsigned char in[CHUNK];
@@ -622,9 +663,19 @@ QByteArray XArchive::decompress(QList<XArchive::RECORD> *pListArchive, const QSt
 
 QByteArray XArchive::decompress(const QString &sRecordFileName, PDSTRUCT *pPdStruct)
 {
-    QList<XArchive::RECORD> listArchive = getRecords(-1, pPdStruct);
+    QByteArray baResult;
+
+    const XArchiveIndex *pArchiveIndex = getArchiveIndex(pPdStruct);
+
+    if (pArchiveIndex) {
+        XArchive::RECORD record = pArchiveIndex->getRecord(sRecordFileName);
+
+        if ((!record.spInfo.sRecordName.isEmpty()) && record.spInfo.nUncompressedSize) {
+            baResult = decompress(&record, pPdStruct);
+        }
+    }
 
-    return decompress(&listArchive, sRecordFileName, pPdStruct);
+    return baResult;
 }
 
 bool XArchive::decompressToFile(const XArchive::RECORD *pRecord, const QString &sResultFileName, PDSTRUCT *pPdStruct)
@@ -743,6 +794,10 @@ bool XArchive::decompressToFile(const QString &sArchiveFileName, const QString &
         }
 
         file.close();
+
+        // The QFile is local, so the cached index must not outlive it
+        delete m_pArchiveIndex;
+        m_pArchiveIndex = nullptr;
     }
 
     return bResult;
@@ -765,6 +820,10 @@ bool XArchive::decompressToPath(const QString &sArchiveFileName, const QString &
         }
 
         file.close();
+
+        // The QFile is local, so the cached index must not outlive it
+        delete m_pArchiveIndex;
+        m_pArchiveIndex = nullptr;
     }
 
     return bResult;
@@ -816,9 +875,15 @@ XArchive::RECORD XArchive::getArchiveRecordByUUID(const QString &sUUID, QList<RE
 
 bool XArchive::isArchiveRecordPresent(const QString &sRecordFileName, PDSTRUCT *pPdStruct)
 {
-    QList<XArchive::RECORD> listRecords = getRecords(-1, pPdStruct);
+    bool bResult = false;
+
+    const XArchiveIndex *pArchiveIndex = getArchiveIndex(pPdStruct);
+
+    if (pArchiveIndex) {
+        bResult = pArchiveIndex->isRecordPresent(sRecordFileName);
+    }
 
-    return isArchiveRecordPresent(sRecordFileName, &listRecords, pPdStruct);
+    return bResult;
 }
 
 bool XArchive::isArchiveRecordPresent(const QString &sRecordFileName, QList<XArchive::RECORD> *pListRecords, PDSTRUCT *pPdStruct)
@@ -842,6 +907,30 @@ bool XArchive::isArchiveRecordPresentExp(const QString &sRecordFileName, QList<R
     return bResult;
 }
 
+const XArchiveIndex *XArchive::getArchiveIndex(PDSTRUCT *pPdStruct)
+{
+    QIODevice *pDevice = getDevice();
+    qint64 nSize = getSize();
+
+    if (m_pArchiveIndex && ((m_pArchiveIndexDevice != pDevice) || (m_nArchiveIndexSize != nSize))) {
+        delete m_pArchiveIndex;
+        m_pArchiveIndex = nullptr;
+    }
+
+    if (!m_pArchiveIndex) {
+        m_pArchiveIndex = new XArchiveIndex(getRecords(-1, pPdStruct), pPdStruct);
+        m_pArchiveIndexDevice = pDevice;
+        m_nArchiveIndexSize = nSize;
+
+        // A cancelled build is handed out once and rebuilt on the next call
+        if ((!m_pArchiveIndex->isComplete()) || (!isPdStructNotCanceled(pPdStruct))) {
+            m_pArchiveIndexDevice = nullptr;
+        }
+    }
+
+    return m_pArchiveIndex;
+}
+
 quint32 XArchive::getCompressBufferSize()
 {
     return COMPRESS_BUFFERSIZE;
@@ -1067,11 +1156,10 @@ bool XArchive::unpackCurrent(UNPACK_STATE *pState, QIODevice *pDevice, PDSTRUCT
         // A zero output size is not proof that the compressed stream is valid.
         // Run it through the normal pipeline so decoders can consume stream
         // terminators and encryption layers can authenticate empty payloads.
-        XDecompress xDecompress;
-        connect(&xDecompress, &XDecompress::errorMessage, this, &XBinary::errorMessage);
-        connect(&xDecompress, &XDecompress::infoMessage, this, &XBinary::infoMessage);
+        // The session keeps solid-block caches between records of this walk.
+        XDecompress *pDecompress = _getDecompressSession(pState);
 
-        bResult = xDecompress.decompressArchiveRecord(archiveRecord, getDevice(), pWorkDevice, pState->mapUnpackProperties, pPdStruct);
+        bResult = pDecompress->decompressArchiveRecord(archiveRecord, getDevice(), pWorkDevice, pState->mapUnpackProperties, pPdStruct);
 
         if (bResult && pCRCBuffer) {
             bResult = pCRCBuffer->seek(0);
@@ -1136,6 +1224,44 @@ bool XArchive::unpackCurrent(UNPACK_STATE *pState, QIODevice *pDevice, PDSTRUCT
     return bResult;
 }
 
+bool XArchive::finishUnpack(UNPACK_STATE *pState, PDSTRUCT *pPdStruct)
+{
+    _freeDecompressSession(pState);
+
+    return XBinary::finishUnpack(pState, pPdStruct);
+}
+
+XDecompress *XArchive::_getDecompressSession(UNPACK_STATE *pState)
+{
+    DECOMPRESS_SESSION session = m_mapDecompressSessions.value(pState);
+
+    // A walk only moves forward. A lower index means the same UNPACK_STATE was
+    // reused for a new walk without finishUnpack, so drop the stale decoder state.
+    if (session.pDecompress && (pState->nCurrentIndex < session.nLastIndex)) {
+        _freeDecompressSession(pState);
+        session = {};
+    }
+
+    if (!session.pDecompress) {
+        session.pDecompress = new XDecompress;
+        connect(session.pDecompress, &XDecompress::errorMessage, this, &XBinary::errorMessage);
+        connect(session.pDecompress, &XDecompress::infoMessage, this, &XBinary::infoMessage);
+    }
+
+    session.nLastIndex = pState->nCurrentIndex;
+    m_mapDecompressSessions.insert(pState, session);
+
+    return session.pDecompress;
+}
+
+void XArchive::_freeDecompressSession(UNPACK_STATE *pState)
+{
+    if (m_mapDecompressSessions.contains(pState)) {
+        delete m_mapDecompressSessions.value(pState).pDecompress;
+        m_mapDecompressSessions.remove(pState);
+    }
+}
+
 bool XArchive::handleInternalInfo(PDSTRUCT *pPdStruct)
 {
     bool bResult = true;
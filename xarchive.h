@@ -32,6 +32,8 @@
 #include "Algos/xlzmadecoder.h"
 #include "Algos/xlzssdecoder.h"
 
+class XArchiveIndex;
+
 class XArchive : public XBinary {
     Q_OBJECT
 
@@ -97,6 +99,7 @@ public:
     static const qint32 DECOMPRESS_BUFFERSIZE = 0x4000;  // TODO Check mb set/get ???
 
     explicit XArchive(QIODevice *pDevice = nullptr);
+    virtual ~XArchive();
 
     virtual quint64 getNumberOfRecords(PDSTRUCT *pPdStruct);               // Depricated
     virtual QList<RECORD> getRecords(qint32 nLimit, PDSTRUCT *pPdStruct);  // Depricated
@@ -134,23 +137,42 @@ public:
     bool isArchiveRecordPresent(const QString &sRecordFileName, PDSTRUCT *pPdStruct = nullptr);
     static bool isArchiveRecordPresent(const QString &sRecordFileName, QList<RECORD> *pListRecords, PDSTRUCT *pPdStruct = nullptr);
     static bool isArchiveRecordPresentExp(const QString &sRecordFileName, QList<RECORD> *pListRecords, PDSTRUCT *pPdStruct = nullptr);
+    // Built from getRecords(-1) on first use and kept until the device changes
+    const XArchiveIndex *getArchiveIndex(PDSTRUCT *pPdStruct = nullptr);
     static quint32 getCompressBufferSize();
     static quint32 getDecompressBufferSize();
     static void showRecords(QList<RECORD> *pListArchive);
+    static QString _normalizeOutputPath(const QString &sPath);
+    static bool _isSafeChildPath(const QString &sPath, const QString &sCanonicalRoot);
     virtual QList<FPART_PROP> getAvailableFPARTProperties() override;
     virtual MODE getMode();
     virtual QMap<UNPACK_PROP, QVariant> getDefaultUnpackProperties() override;
     virtual bool unpackCurrent(UNPACK_STATE *pState, QIODevice *pDevice, PDSTRUCT *pPdStruct = nullptr) override;
+    virtual bool finishUnpack(UNPACK_STATE *pState, PDSTRUCT *pPdStruct = nullptr) override;
     //    virtual _MEMORY_MAP getMemoryMap(); // TODO
     virtual qint32 getType();
     virtual QString typeIdToString(qint32 nType);
     virtual bool isArchive();
 
+protected:
+    // One XDecompress per unpack walk, so solid caches and persistent decoders
+    // survive between unpackCurrent calls. Formats that override finishUnpack
+    // must call _freeDecompressSession.
+    XDecompress *_getDecompressSession(UNPACK_STATE *pState);
+    void _freeDecompressSession(UNPACK_STATE *pState);
+
 private:
+    struct DECOMPRESS_SESSION {
+        XDecompress *pDecompress;
+        qint64 nLastIndex;
+    };
+
     static bool _writeToDevice(char *pBuffer, qint32 nBufferSize, DECOMPRESSSTRUCT *pDecompressStruct);
-    static QString _normalizeOutputPath(const QString &sPath);
-    static bool _isSafeChildPath(const QString &sPath, const QString &sCanonicalRoot);
     INTERNAL_INFO m_internalInfo;
+    QMap<UNPACK_STATE *, DECOMPRESS_SESSION> m_mapDecompressSessions;
+    XArchiveIndex *m_pArchiveIndex;
+    QIODevice *m_pArchiveIndexDevice;
+    qint64 m_nArchiveIndexSize;
 };
 
 #endif  // XARCHIVE_H
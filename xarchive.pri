@@ -35,6 +35,7 @@ HEADERS += \
     $$PWD/Algos/xbcj2decoder.h \
     $$PWD/Algos/xbranchdecoder.h \
     $$PWD/Algos/xlzxdecoder.h \
+    $$PWD/Algos/xlzmsdecoder.h \
     $$PWD/Algos/xxpressdecoder.h \
     $$PWD/Algos/xsha256decoder.h \
     $$PWD/Algos/xblake2sp.h \
@@ -51,6 +52,7 @@ HEADERS += \
     $$PWD/xarj.h \
     $$PWD/xace.h \
     $$PWD/xarchive.h \
+    $$PWD/xarchiveindex.h \
     $$PWD/xcab.h \
     $$PWD/xcfbf.h \
     $$PWD/xcpio.h \
@@ -130,6 +132,7 @@ SOURCES += \
     $$PWD/Algos/xbcj2decoder.cpp \
     $$PWD/Algos/xbranchdecoder.cpp \
     $$PWD/Algos/xlzxdecoder.cpp \
+    $$PWD/Algos/xlzmsdecoder.cpp \
     $$PWD/Algos/xxpressdecoder.cpp \
     $$PWD/Algos/xsha256decoder.cpp \
     $$PWD/Algos/xblake2sp.cpp \
@@ -145,6 +148,7 @@ SOURCES += \
     $$PWD/xarj.cpp \
     $$PWD/xace.cpp \
     $$PWD/xarchive.cpp \
+    $$PWD/xarchiveindex.cpp \
     $$PWD/xcab.cpp \
     $$PWD/xcfbf.cpp \
     $$PWD/xcpio.cpp \
@@ -226,6 +230,11 @@ SOURCES += \
     include($$PWD/3rdparty/bzip2/bzip2.pri)
 }
 
+!contains(XCONFIG, lzfse) {
+    XCONFIG += lzfse
+    include($$PWD/3rdparty/lzfse/lzfse.pri)
+}
+
 !contains(XCONFIG, lzma) {
     XCONFIG += lzma
     include($$PWD/3rdparty/lzma/lzma.pri)
@@ -0,0 +1,382 @@
+/* Copyright (c) 2026 hors<horsicq@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "xarchiveindex.h"
+
+#include <algorithm>
+
+static bool _compareSortedName(const QPair<QString, qint32> &item, const QString &sName)
+{
+    return item.first < sName;
+}
+
+XArchiveIndex::XArchiveIndex()
+{
+    m_bIsNamesNormalized = true;
+    m_bIsComplete = true;
+}
+
+XArchiveIndex::XArchiveIndex(const QList<XArchive::RECORD> &listRecords, XBinary::PDSTRUCT *pPdStruct)
+{
+    setRecords(listRecords, pPdStruct);
+}
+
+void XArchiveIndex::setRecords(const QList<XArchive::RECORD> &listRecords, XBinary::PDSTRUCT *pPdStruct)
+{
+    XBinary::PDSTRUCT pdStructEmpty = {};
+
+    if (!pPdStruct) {
+        pdStructEmpty = XBinary::createPdStruct();
+        pPdStruct = &pdStructEmpty;
+    }
+
+    m_listRecords = listRecords;
+    m_hashNames.clear();
+    m_hashNormalizedNames.clear();
+    m_hashUUIDs.clear();
+    m_listSortedNames.clear();
+    m_bIsNamesNormalized = true;
+    m_bIsComplete = true;
+
+    qint32 nNumberOfRecords = m_listRecords.count();
+
+    m_hashNames.reserve(nNumberOfRecords);
+    m_hashNormalizedNames.reserve(nNumberOfRecords);
+    m_listSortedNames.reserve(nNumberOfRecords);
+
+    for (qint32 i = 0; i < nNumberOfRecords; i++) {
+        if (!XBinary::isPdStructNotCanceled(pPdStruct)) {
+            m_bIsComplete = false;
+            break;
+        }
+
+        const XArchive::RECORD &record = m_listRecords.at(i);
+        const QString &sName = record.spInfo.sRecordName;
+        QString sNormalizedName = normalizeName(sName);
+
+        // The first record wins on duplicates, as with the linear scans
+        if (!m_hashNames.contains(sName)) {
+            m_hashNames.insert(sName, i);
+        }
+
+        if (!m_hashNormalizedNames.contains(sNormalizedName)) {
+            m_hashNormalizedNames.insert(sNormalizedName, i);
+        }
+
+        if ((!record.sUUID.isEmpty()) && (!m_hashUUIDs.contains(record.sUUID))) {
+            m_hashUUIDs.insert(record.sUUID, i);
+        }
+
+        if (sNormalizedName != sName) {
+            m_bIsNamesNormalized = false;
+        }
+
+        m_listSortedNames.append(qMakePair(sNormalizedName, i));
+    }
+
+    std::stable_sort(m_listSortedNames.begin(), m_listSortedNames.end(),
+                     [](const QPair<QString, qint32> &a, const QPair<QString, qint32> &b) { return a.first < b.first; });
+}
+
+bool XArchiveIndex::isComplete() const
+{
+    return m_bIsComplete;
+}
+
+qint32 XArchiveIndex::getNumberOfRecords() const
+{
+    return m_listRecords.count();
+}
+
+const QList<XArchive::RECORD> *XArchiveIndex::getRecords() const
+{
+    return &m_listRecords;
+}
+
+qint32 XArchiveIndex::indexOf(const QString &sRecordName) const
+{
+    return m_hashNames.value(sRecordName, -1);
+}
+
+qint32 XArchiveIndex::indexOfNormalized(const QString &sRecordName) const
+{
+    return m_hashNormalizedNames.value(normalizeName(sRecordName), -1);
+}
+
+qint32 XArchiveIndex::indexOfUUID(const QString &sUUID) const
+{
+    return m_hashUUIDs.value(sUUID, -1);
+}
+
+XArchive::RECORD XArchiveIndex::getRecord(const QString &sRecordName) const
+{
+    XArchive::RECORD result = {};
+
+    qint32 nIndex = indexOf(sRecordName);
+
+    if (nIndex != -1) {
+        result = m_listRecords.at(nIndex);
+    }
+
+    return result;
+}
+
+XArchive::RECORD XArchiveIndex::getRecordNormalized(const QString &sRecordName) const
+{
+    XArchive::RECORD result = {};
+
+    qint32 nIndex = indexOfNormalized(sRecordName);
+
+    if (nIndex != -1) {
+        result = m_listRecords.at(nIndex);
+    }
+
+    return result;
+}
+
+XArchive::RECORD XArchiveIndex::getRecordByUUID(const QString &sUUID) const
+{
+    XArchive::RECORD result = {};
+
+    qint32 nIndex = indexOfUUID(sUUID);
+
+    if (nIndex != -1) {
+        result = m_listRecords.at(nIndex);
+    }
+
+    return result;
+}
+
+bool XArchiveIndex::isRecordPresent(const QString &sRecordName) const
+{
+    return (indexOf(sRecordName) != -1);
+}
+
+bool XArchiveIndex::isRecordPresentNormalized(const QString &sRecordName) const
+{
+    return (indexOfNormalized(sRecordName) != -1);
+}
+
+bool XArchiveIndex::isRecordPresentExp(const QString &sRegExp, XBinary::PDSTRUCT *pPdStruct) const
+{
+    bool bResult = false;
+
+    qint32 nStart = 0;
+    qint32 nEnd = m_listSortedNames.count();
+
+    // An anchored literal head narrows the candidates to one sorted range. The
+    // sorted keys are normalized, so this only holds if no name was rewritten.
+    if (m_bIsNamesNormalized) {
+        QString sPrefix = _getRegExpLiteralPrefix(sRegExp);
+
+        if (!sPrefix.isEmpty()) {
+            QPair<qint32, qint32> range = _getPrefixRange(sPrefix);
+            nStart = range.first;
+            nEnd = range.second;
+        }
+    }
+
+    for (qint32 i = nStart; (i < nEnd) && XBinary::isPdStructNotCanceled(pPdStruct); i++) {
+        if (XBinary::isRegExpPresent(sRegExp, m_listRecords.at(m_listSortedNames.at(i).second).spInfo.sRecordName)) {
+            bResult = true;
+            break;
+        }
+    }
+
+    return bResult;
+}
+
+QList<qint32> XArchiveIndex::getIndexesByPrefix(const QString &sPrefix) const
+{
+    QList<qint32> listResult;
+
+    QPair<qint32, qint32> range = _getPrefixRange(normalizeName(sPrefix));
+
+    for (qint32 i = range.first; i < range.second; i++) {
+        listResult.append(m_listSortedNames.at(i).second);
+    }
+
+    std::sort(listResult.begin(), listResult.end());
+
+    return listResult;
+}
+
+QList<XArchive::RECORD> XArchiveIndex::getRecordsByPrefix(const QString &sPrefix) const
+{
+    return _getRecords(getIndexesByPrefix(sPrefix));
+}
+
+QList<qint32> XArchiveIndex::getIndexesByWildcard(const QString &sPattern) const
+{
+    QList<qint32> listResult;
+
+    QString sNormalizedPattern = normalizeName(sPattern);
+
+    qint32 nLiteralSize = 0;
+
+    while ((nLiteralSize < sNormalizedPattern.size()) && (sNormalizedPattern.at(nLiteralSize) != QChar('*')) &&
+           (sNormalizedPattern.at(nLiteralSize) != QChar('?'))) {
+        nLiteralSize++;
+    }
+
+    QPair<qint32, qint32> range = _getPrefixRange(sNormalizedPattern.left(nLiteralSize));
+
+    for (qint32 i = range.first; i < range.second; i++) {
+        if (isWildcardMatch(sNormalizedPattern, m_listSortedNames.at(i).first)) {
+            listResult.append(m_listSortedNames.at(i).second);
+        }
+    }
+
+    std::sort(listResult.begin(), listResult.end());
+
+    return listResult;
+}
+
+QList<XArchive::RECORD> XArchiveIndex::getRecordsByWildcard(const QString &sPattern) const
+{
+    return _getRecords(getIndexesByWildcard(sPattern));
+}
+
+QString XArchiveIndex::normalizeName(const QString &sRecordName)
+{
+    QString sResult = sRecordName;
+
+    sResult.replace(QChar('\\'), QChar('/'));
+
+    while (true) {
+        if (sResult.startsWith(QChar('/'))) {
+            sResult.remove(0, 1);
+        } else if (sResult.startsWith(QLatin1String("./"))) {
+            sResult.remove(0, 2);
+        } else {
+            break;
+        }
+    }
+
+    return sResult;
+}
+
+bool XArchiveIndex::isWildcardMatch(const QString &sPattern, const QString &sName)
+{
+    // '*' matches any run (including '/'), '?' matches one character
+    qint32 nPatternSize = sPattern.size();
+    qint32 nNameSize = sName.size();
+    qint32 nPattern = 0;
+    qint32 nName = 0;
+    qint32 nStarPattern = -1;
+    qint32 nStarName = 0;
+
+    while (nName < nNameSize) {
+        if ((nPattern < nPatternSize) && ((sPattern.at(nPattern) == QChar('?')) || (sPattern.at(nPattern) == sName.at(nName)))) {
+            nPattern++;
+            nName++;
+        } else if ((nPattern < nPatternSize) && (sPattern.at(nPattern) == QChar('*'))) {
+            nStarPattern = nPattern;
+            nStarName = nName;
+            nPattern++;
+        } else if (nStarPattern != -1) {
+            nPattern = nStarPattern + 1;
+            nStarName++;
+            nName = nStarName;
+        } else {
+            return false;
+        }
+    }
+
+    while ((nPattern < nPatternSize) && (sPattern.at(nPattern) == QChar('*'))) {
+        nPattern++;
+    }
+
+    return (nPattern == nPatternSize);
+}
+
+QPair<qint32, qint32> XArchiveIndex::_getPrefixRange(const QString &sNormalizedPrefix) const
+{
+    qint32 nNumberOfNames = m_listSortedNames.count();
+
+    if (sNormalizedPrefix.isEmpty()) {
+        return qMakePair(0, nNumberOfNames);
+    }
+
+    qint32 nStart = (qint32)(std::lower_bound(m_listSortedNames.begin(), m_listSortedNames.end(), sNormalizedPrefix, _compareSortedName) - m_listSortedNames.begin());
+    qint32 nEnd = nStart;
+
+    while ((nEnd < nNumberOfNames) && m_listSortedNames.at(nEnd).first.startsWith(sNormalizedPrefix)) {
+        nEnd++;
+    }
+
+    return qMakePair(nStart, nEnd);
+}
+
+QList<XArchive::RECORD> XArchiveIndex::_getRecords(const QList<qint32> &listIndexes) const
+{
+    QList<XArchive::RECORD> listResult;
+
+    qint32 nNumberOfIndexes = listIndexes.count();
+
+    for (qint32 i = 0; i < nNumberOfIndexes; i++) {
+        listResult.append(m_listRecords.at(listIndexes.at(i)));
+    }
+
+    return listResult;
+}
+
+QString XArchiveIndex::_getRegExpLiteralPrefix(const QString &sRegExp)
+{
+    QString sResult;
+
+    // Only a plain "^literal" head is usable; top-level alternation could match elsewhere
+    if ((!sRegExp.startsWith(QChar('^'))) || sRegExp.contains(QChar('|'))) {
+        return sResult;
+    }
+
+    const QString sMeta = QStringLiteral(".^$|?*+()[]{}");
+
+    qint32 nSize = sRegExp.size();
+    qint32 i = 1;
+
+    while (i < nSize) {
+        QChar c = sRegExp.at(i);
+
+        if (c == QChar('\\')) {
+            if ((i + 1 < nSize) && (!sRegExp.at(i + 1).isLetterOrNumber())) {
+                sResult.append(sRegExp.at(i + 1));
+                i += 2;
+                continue;
+            }
+
+            break;
+        }
+
+        if (sMeta.contains(c)) {
+            // A quantifier applies to the previous character, which then is not fixed
+            if (((c == QChar('?')) || (c == QChar('*')) || (c == QChar('{'))) && (!sResult.isEmpty())) {
+                sResult.chop(1);
+            }
+
+            break;
+        }
+
+        sResult.append(c);
+        i++;
+    }
+
+    return sResult;
+}
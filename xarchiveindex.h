@@ -0,0 +1,77 @@
+/* Copyright (c) 2026 hors<horsicq@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef XARCHIVEINDEX_H
+#define XARCHIVEINDEX_H
+
+#include <QHash>
+#include <QPair>
+#include <QVector>
+
+#include "xarchive.h"
+
+// Name/UUID lookup over a record list, built once per archive. Names are
+// hashed as-is and normalized ('\' -> '/', no leading "/" or "./"); the
+// normalized names are also kept sorted for directory and wildcard queries.
+// indexOf/getRecord/isRecordPresent match the stored name exactly, the
+// *Normalized variants compare normalized names.
+class XArchiveIndex {
+public:
+    XArchiveIndex();
+    explicit XArchiveIndex(const QList<XArchive::RECORD> &listRecords, XBinary::PDSTRUCT *pPdStruct = nullptr);
+
+    void setRecords(const QList<XArchive::RECORD> &listRecords, XBinary::PDSTRUCT *pPdStruct = nullptr);
+    bool isComplete() const;
+    qint32 getNumberOfRecords() const;
+    const QList<XArchive::RECORD> *getRecords() const;
+
+    qint32 indexOf(const QString &sRecordName) const;
+    qint32 indexOfNormalized(const QString &sRecordName) const;
+    qint32 indexOfUUID(const QString &sUUID) const;
+    XArchive::RECORD getRecord(const QString &sRecordName) const;
+    XArchive::RECORD getRecordNormalized(const QString &sRecordName) const;
+    XArchive::RECORD getRecordByUUID(const QString &sUUID) const;
+    bool isRecordPresent(const QString &sRecordName) const;
+    bool isRecordPresentNormalized(const QString &sRecordName) const;
+    bool isRecordPresentExp(const QString &sRegExp, XBinary::PDSTRUCT *pPdStruct = nullptr) const;
+
+    QList<qint32> getIndexesByPrefix(const QString &sPrefix) const;
+    QList<XArchive::RECORD> getRecordsByPrefix(const QString &sPrefix) const;
+    QList<qint32> getIndexesByWildcard(const QString &sPattern) const;
+    QList<XArchive::RECORD> getRecordsByWildcard(const QString &sPattern) const;
+
+    static QString normalizeName(const QString &sRecordName);
+    static bool isWildcardMatch(const QString &sPattern, const QString &sName);
+
+private:
+    QPair<qint32, qint32> _getPrefixRange(const QString &sNormalizedPrefix) const;
+    QList<XArchive::RECORD> _getRecords(const QList<qint32> &listIndexes) const;
+    static QString _getRegExpLiteralPrefix(const QString &sRegExp);
+
+    QList<XArchive::RECORD> m_listRecords;
+    QHash<QString, qint32> m_hashNames;
+    QHash<QString, qint32> m_hashNormalizedNames;
+    QHash<QString, qint32> m_hashUUIDs;
+    QVector<QPair<QString, qint32>> m_listSortedNames;  // normalized name, record index
+    bool m_bIsNamesNormalized;
+    bool m_bIsComplete;
+};
+
+#endif  // XARCHIVEINDEX_H
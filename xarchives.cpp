@@ -19,6 +19,175 @@
  * SOFTWARE.
  */
 #include "xarchives.h"
+#include "xtarcompressed.h"
+#include "xwim.h"
+
+#include <QAtomicInt>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+
+namespace {
+
+struct EXTRACT_ITEM {
+    XArchive::RECORD record;
+    QString sResultFileName;
+    qint32 nIndex;  // Position in the unpack walk
+};
+
+// Records that have to be decoded in order by one worker: a solid folder, a RAR solid chain or a single record
+struct EXTRACT_GROUP {
+    QList<EXTRACT_ITEM> listItems;
+    qint64 nTotalSize;
+    bool bIsSolid;
+};
+
+bool isRarMethod(XBinary::HANDLE_METHOD method)
+{
+    return (method == XBinary::HANDLE_METHOD_RAR_15) || (method == XBinary::HANDLE_METHOD_RAR_20) || (method == XBinary::HANDLE_METHOD_RAR_29) ||
+           (method == XBinary::HANDLE_METHOD_RAR_50) || (method == XBinary::HANDLE_METHOD_RAR_70);
+}
+
+bool isCabMethod(XBinary::HANDLE_METHOD method)
+{
+    return (method == XBinary::HANDLE_METHOD_STORE_CAB) || (method == XBinary::HANDLE_METHOD_MSZIP_CAB) || (method == XBinary::HANDLE_METHOD_LZX_CAB);
+}
+
+// Pulls groups from the shared list until none are left. Each worker reads through its own
+// handle: either the caller's device (single worker) or a fresh QFile on the archive.
+// Solid groups are decoded through one unpack walk, so the walk's decompressor keeps the
+// folder or chain state from one record to the next instead of restarting it per record.
+class XExtractWorker : public QRunnable {
+public:
+    XExtractWorker(QIODevice *pDevice, const QString &sFileName, XBinary::FT fileType, const QList<EXTRACT_GROUP> *pListGroups, QAtomicInt *pnNextGroup,
+                   QAtomicInt *pnProcessed, QAtomicInt *pnFailed, XBinary::PDSTRUCT *pPdStruct)
+        : m_pDevice(pDevice),
+          m_sFileName(sFileName),
+          m_fileType(fileType),
+          m_pListGroups(pListGroups),
+          m_pnNextGroup(pnNextGroup),
+          m_pnProcessed(pnProcessed),
+          m_pnFailed(pnFailed),
+          m_pPdStruct(pPdStruct)
+    {
+        setAutoDelete(false);
+    }
+
+    void run() override
+    {
+        QFile file;
+        QIODevice *pDevice = m_pDevice;
+
+        if (!pDevice) {
+            file.setFileName(m_sFileName);
+
+            if (!file.open(QIODevice::ReadOnly)) {
+                return;  // The remaining workers take over the groups
+            }
+
+            pDevice = &file;
+        }
+
+        XArchive *pArchive = static_cast<XArchive *>(XFormats::createClass(m_fileType, pDevice));
+
+        if (pArchive) {
+            XBinary::UNPACK_STATE state = {};
+            bool bWalk = false;
+
+            while (XBinary::isPdStructNotCanceled(m_pPdStruct)) {
+                qint32 nIndex = m_pnNextGroup->fetchAndAddOrdered(1);
+
+                if (nIndex >= m_pListGroups->count()) {
+                    break;
+                }
+
+                const EXTRACT_GROUP &group = m_pListGroups->at(nIndex);
+                qint32 nNumberOfItems = group.listItems.count();
+
+                if (group.bIsSolid) {
+                    // A walk only moves forward: restart it when this group lies behind it
+                    if (bWalk && (state.nCurrentIndex > group.listItems.first().nIndex)) {
+                        pArchive->finishUnpack(&state, m_pPdStruct);
+                        bWalk = false;
+                    }
+
+                    if (!bWalk) {
+                        state = {};
+                        bWalk = pArchive->initUnpack(&state, pArchive->getDefaultUnpackProperties(), m_pPdStruct);
+                    }
+                }
+
+                for (qint32 i = 0; (i < nNumberOfItems) && XBinary::isPdStructNotCanceled(m_pPdStruct); i++) {
+                    const EXTRACT_ITEM &item = group.listItems.at(i);
+                    bool bResult = false;
+
+                    if (group.bIsSolid) {
+                        bResult = bWalk && _unpackItem(pArchive, &state, item);
+                    } else {
+                        bResult = pArchive->decompressToFile(&item.record, item.sResultFileName, m_pPdStruct);
+                    }
+
+                    if (!bResult) {
+                        m_pnFailed->fetchAndAddOrdered(1);
+                    }
+
+                    m_pnProcessed->fetchAndAddOrdered(1);
+                }
+            }
+
+            if (bWalk) {
+                pArchive->finishUnpack(&state, m_pPdStruct);
+            }
+
+            delete pArchive;
+        }
+
+        if (file.isOpen()) {
+            file.close();
+        }
+    }
+
+private:
+    bool _unpackItem(XArchive *pArchive, XBinary::UNPACK_STATE *pState, const EXTRACT_ITEM &item)
+    {
+        while ((pState->nCurrentIndex < item.nIndex) && XBinary::isPdStructNotCanceled(m_pPdStruct)) {
+            if (!pArchive->moveToNext(pState, m_pPdStruct)) {
+                return false;
+            }
+        }
+
+        if (pState->nCurrentIndex != item.nIndex) {
+            return false;
+        }
+
+        QFile file;
+        file.setFileName(item.sResultFileName);
+
+        if (!file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+            return false;
+        }
+
+        // Empty members are unpacked as well, chained decoders count every record
+        bool bResult = pArchive->unpackCurrent(pState, &file, m_pPdStruct);
+
+        file.close();
+
+        return (bResult && (file.error() == QFile::NoError));
+    }
+
+    QIODevice *m_pDevice;
+    QString m_sFileName;
+    XBinary::FT m_fileType;
+    const QList<EXTRACT_GROUP> *m_pListGroups;
+    QAtomicInt *m_pnNextGroup;
+    QAtomicInt *m_pnProcessed;
+    QAtomicInt *m_pnFailed;
+    XBinary::PDSTRUCT *m_pPdStruct;
+};
+
+}  // namespace
+
 
 XArchives::XArchives(QObject *pParent) : QObject(pParent)
 {
@@ -79,6 +248,16 @@ QList<XArchive::RECORD> XArchives::getRecordsFromDirectory(const QString &sDirec
     return listResult;
 }
 
+XArchiveIndex XArchives::getArchiveIndex(QIODevice *pDevice, XBinary::FT fileType, XBinary::PDSTRUCT *pPdStruct)
+{
+    return XArchiveIndex(getRecords(pDevice, fileType, -1, pPdStruct), pPdStruct);
+}
+
+XArchiveIndex XArchives::getArchiveIndex(const QString &sFileName, XBinary::FT fileType, XBinary::PDSTRUCT *pPdStruct)
+{
+    return XArchiveIndex(getRecords(sFileName, fileType, -1, pPdStruct), pPdStruct);
+}
+
 QByteArray XArchives::decompress(QIODevice *pDevice, const XArchive::RECORD *pRecord, XBinary::PDSTRUCT *pPdStruct, qint64 nDecompressedOffset, qint64 nDecompressedSize)
 {
     QByteArray baResult;
@@ -136,6 +315,19 @@ QByteArray XArchives::decompress(const QString &sFileName, const QString &sRecor
     return baResult;
 }
 
+QByteArray XArchives::decompress(QIODevice *pDevice, const XArchiveIndex *pArchiveIndex, const QString &sRecordFileName, XBinary::PDSTRUCT *pPdStruct)
+{
+    QByteArray baResult;
+
+    qint32 nIndex = pArchiveIndex->indexOf(sRecordFileName);
+
+    if (nIndex != -1) {
+        baResult = decompress(pDevice, &(pArchiveIndex->getRecords()->at(nIndex)), pPdStruct);
+    }
+
+    return baResult;
+}
+
 bool XArchives::decompressToFile(QIODevice *pDevice, XArchive::RECORD *pRecord, const QString &sResultFileName, XBinary::PDSTRUCT *pPdStruct)
 {
     bool bResult = false;
@@ -210,8 +402,6 @@ bool XArchives::decompressToFile(const QString &sFileName, const QString &sRecor
 
 bool XArchives::decompressToFolder(QIODevice *pDevice, const QString &sResultFileFolder, XBinary::PDSTRUCT *pPdStruct)
 {
-    bool bResult = false;
-
     XBinary::PDSTRUCT pdStructEmpty = {};
 
     if (!pPdStruct) {
@@ -219,26 +409,159 @@ bool XArchives::decompressToFolder(QIODevice *pDevice, const QString &sResultFil
         pPdStruct = &pdStructEmpty;
     }
 
+    XBinary::FT fileType = XFormats::getPrefFileType(pDevice, true);
+
+    {
+        // Formats with their own folder extractor:
+        // - compressed tarballs are one solid stream, walked once in a single pass instead of
+        //   listing the records first and decoding the stream again for every entry;
+        // - WIM images decode every unique stream once and link the duplicates.
+        XBinary *pBinary = XFormats::createClass(fileType, pDevice);
+        XTARCOMPRESSED *pTarCompressed = dynamic_cast<XTARCOMPRESSED *>(pBinary);
+        XWIM *pWIM = dynamic_cast<XWIM *>(pBinary);
+
+        if (pTarCompressed || pWIM) {
+            bool bResult = false;
+
+            if (pTarCompressed) {
+                pTarCompressed->setStreamingUnpack(true);
+                bResult = _decompressToFolderStreaming(pTarCompressed, sResultFileFolder, pPdStruct);
+            } else {
+                bResult = pWIM->extractToFolder(sResultFileFolder, pPdStruct);
+            }
+
+            delete pBinary;
+
+            return bResult;
+        }
+
+        delete pBinary;
+    }
+
     QList<XArchive::RECORD> listRecords = getRecords(pDevice, XBinary::FT_UNKNOWN, -1, pPdStruct);
 
     qint32 nNumberOfRecords = listRecords.count();
 
-    QString sCanonicalRoot = QDir::cleanPath(QDir(sResultFileFolder).absolutePath());
+    if (nNumberOfRecords == 0) {
+        return false;
+    }
+
+    const QString sCanonicalRoot = XArchive::_normalizeOutputPath(QDir(sResultFileFolder).absolutePath());
+    QString sCanonicalRootForCheck = QFileInfo(sCanonicalRoot).canonicalFilePath();
+
+    if (sCanonicalRootForCheck.isEmpty()) {
+        sCanonicalRootForCheck = sCanonicalRoot;
+    }
+
+    // 1. Group the records. Records of one solid folder (7z, CAB) share their data offset;
+    //    a solid RAR archive is a single chain.
+    bool bRarSolid = false;
+
+    for (qint32 i = 0; i < nNumberOfRecords; i++) {
+        if (listRecords.at(i).spInfo.bIsSolid && isRarMethod(listRecords.at(i).spInfo.compressMethod)) {
+            bRarSolid = true;
+            break;
+        }
+    }
+
+    QList<EXTRACT_GROUP> listGroups;
+    QMap<QString, qint32> mapGroupIndexes;
+    QSet<QString> stDirectories;
+    qint32 nNumberOfItems = 0;
+    bool bResult = true;
 
     for (qint32 i = 0; (i < nNumberOfRecords) && XBinary::isPdStructNotCanceled(pPdStruct); i++) {
-        XArchive::RECORD record = listRecords.at(i);
-        QString sResultFileName = QDir::cleanPath(sResultFileFolder + QDir::separator() + record.spInfo.sRecordName);
+        EXTRACT_ITEM item = {};
+        item.record = listRecords.at(i);
+        item.nIndex = i;
+        item.sResultFileName = XArchive::_normalizeOutputPath(QDir(sCanonicalRoot).absoluteFilePath(item.record.spInfo.sRecordName));
 
-        if (!sResultFileName.startsWith(sCanonicalRoot + "/")) {
+        if (!XArchive::_isSafeChildPath(item.sResultFileName, sCanonicalRootForCheck)) {
             bResult = false;
             continue;
         }
 
-        bResult = decompressToFile(pDevice, &record, sResultFileName, pPdStruct);
+        stDirectories.insert(QFileInfo(item.sResultFileName).absolutePath());
 
-        if (!bResult) {
-            //            break;
+        XBinary::HANDLE_METHOD method = item.record.spInfo.compressMethod;
+        QString sKey;
+
+        if (bRarSolid && isRarMethod(method)) {
+            sKey = QString("rar");
+        } else if (item.record.spInfo.bIsSolid || isCabMethod(method)) {
+            sKey = QString("f%1").arg(item.record.nDataOffset);
         }
+
+        qint32 nGroupIndex = sKey.isEmpty() ? -1 : mapGroupIndexes.value(sKey, -1);
+
+        if (nGroupIndex == -1) {
+            EXTRACT_GROUP group = {};
+            listGroups.append(group);
+            nGroupIndex = listGroups.count() - 1;
+
+            if (!sKey.isEmpty()) {
+                mapGroupIndexes.insert(sKey, nGroupIndex);
+            }
+
+            listGroups[nGroupIndex].bIsSolid = !sKey.isEmpty();
+        }
+
+        listGroups[nGroupIndex].listItems.append(item);
+        listGroups[nGroupIndex].nTotalSize += item.record.spInfo.nUncompressedSize;
+        nNumberOfItems++;
+    }
+
+    // Largest groups first, so a big solid folder does not start last and leave the other threads idle
+    std::stable_sort(listGroups.begin(), listGroups.end(), [](const EXTRACT_GROUP &group1, const EXTRACT_GROUP &group2) { return group1.nTotalSize > group2.nTotalSize; });
+
+    // Directories are created up front so the workers never race on the same path
+    QList<QString> listDirectories = stDirectories.values();
+
+    for (qint32 i = 0; i < listDirectories.count(); i++) {
+        XBinary::createDirectory(listDirectories.at(i));
+    }
+
+    // 2. Fan the groups out. Parallel workers need their own handle, which requires a file name.
+    QFile *pFile = qobject_cast<QFile *>(pDevice);
+    QString sFileName = pFile ? pFile->fileName() : QString();
+
+    qint32 nNumberOfThreads = 1;
+
+    if ((!sFileName.isEmpty()) && (listGroups.count() > 1)) {
+        nNumberOfThreads = (std::min)((qint32)listGroups.count(), (std::max)(QThread::idealThreadCount(), 1));
+    }
+
+    QAtomicInt nNextGroup(0);
+    QAtomicInt nProcessed(0);
+    QAtomicInt nFailed(0);
+
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(nNumberOfThreads);
+
+    QList<XExtractWorker *> listWorkers;
+
+    for (qint32 i = 0; i < nNumberOfThreads; i++) {
+        XExtractWorker *pWorker =
+            new XExtractWorker((nNumberOfThreads == 1) ? pDevice : nullptr, sFileName, fileType, &listGroups, &nNextGroup, &nProcessed, &nFailed, pPdStruct);
+        listWorkers.append(pWorker);
+        threadPool.start(pWorker);
+    }
+
+    qint32 _nFreeIndex = XBinary::getFreeIndex(pPdStruct);
+    XBinary::setPdStructInit(pPdStruct, _nFreeIndex, nNumberOfItems);
+
+    while (!threadPool.waitForDone(100)) {
+        XBinary::setPdStructCurrent(pPdStruct, _nFreeIndex, nProcessed.loadAcquire());
+    }
+
+    XBinary::setPdStructCurrent(pPdStruct, _nFreeIndex, nProcessed.loadAcquire());
+    XBinary::setPdStructFinished(pPdStruct, _nFreeIndex);
+
+    qDeleteAll(listWorkers);
+
+    // Every safe record has to be extracted, including the ones left behind by workers that could not open the file
+    if ((nFailed.loadAcquire() != 0) || (nProcessed.loadAcquire() != nNumberOfItems)) {
+        bResult = false;
     }
 
     return bResult;
@@ -259,6 +582,73 @@ bool XArchives::decompressToFolder(const QString &sFileName, const QString &sRes
     return bResult;
 }
 
+bool XArchives::_decompressToFolderStreaming(XTARCOMPRESSED *pArchive, const QString &sResultFileFolder, XBinary::PDSTRUCT *pPdStruct)
+{
+    const QString sCanonicalRoot = XArchive::_normalizeOutputPath(QDir(sResultFileFolder).absolutePath());
+    QString sCanonicalRootForCheck = QFileInfo(sCanonicalRoot).canonicalFilePath();
+
+    if (sCanonicalRootForCheck.isEmpty()) {
+        sCanonicalRootForCheck = sCanonicalRoot;
+    }
+
+    XBinary::UNPACK_STATE state = {};
+
+    if (!pArchive->initUnpack(&state, pArchive->getDefaultUnpackProperties(), pPdStruct)) {
+        return false;
+    }
+
+    qint32 _nFreeIndex = XBinary::getFreeIndex(pPdStruct);
+    XBinary::setPdStructInit(pPdStruct, _nFreeIndex, 0);
+
+    bool bResult = true;
+    qint32 nProcessed = 0;
+
+    while ((state.nCurrentIndex < state.nNumberOfRecords) && XBinary::isPdStructNotCanceled(pPdStruct)) {
+        XBinary::ARCHIVERECORD archiveRecord = pArchive->infoCurrent(&state, pPdStruct);
+        QString sRecordName = archiveRecord.mapProperties.value(XBinary::FPART_PROP_ORIGINALNAME).toString();
+        QString sResultFileName = XArchive::_normalizeOutputPath(QDir(sCanonicalRoot).absoluteFilePath(sRecordName));
+
+        if (sRecordName.isEmpty() || !XArchive::_isSafeChildPath(sResultFileName, sCanonicalRootForCheck)) {
+            bResult = false;
+        } else if (sRecordName.endsWith("/") || archiveRecord.mapProperties.value(XBinary::FPART_PROP_ISFOLDER).toBool()) {
+            XBinary::createDirectory(sResultFileName);
+        } else {
+            XBinary::createDirectory(QFileInfo(sResultFileName).absolutePath());
+
+            QFile file;
+            file.setFileName(sResultFileName);
+
+            if (file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+                if (!pArchive->unpackCurrent(&state, &file, pPdStruct)) {
+                    bResult = false;
+                }
+
+                file.close();
+            } else {
+                bResult = false;
+            }
+        }
+
+        nProcessed++;
+        XBinary::setPdStructCurrent(pPdStruct, _nFreeIndex, nProcessed);
+
+        if (!pArchive->moveToNext(&state, pPdStruct)) {
+            break;
+        }
+    }
+
+    // The walk only ends cleanly on the end-of-archive header; anything else is a truncated or corrupt stream
+    if (!pArchive->isStreamEnd(&state)) {
+        bResult = false;
+    }
+
+    XBinary::setPdStructFinished(pPdStruct, _nFreeIndex);
+
+    pArchive->finishUnpack(&state, pPdStruct);
+
+    return bResult && XBinary::isPdStructNotCanceled(pPdStruct);
+}
+
 bool XArchives::isArchiveRecordPresent(QIODevice *pDevice, const QString &sRecordFileName, XBinary::PDSTRUCT *pPdStruct)
 {
     bool bResult = false;
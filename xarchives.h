@@ -27,6 +27,9 @@
 
 #include "xformats.h"
 #include "xarchive.h"
+#include "xarchiveindex.h"
+
+class XTARCOMPRESSED;
 
 class XArchives : public QObject {
     Q_OBJECT
@@ -38,12 +41,15 @@ public:
     static QList<XArchive::RECORD> getRecords(const QString &sFileName, XBinary::FT fileType = XBinary::FT_UNKNOWN, qint32 nLimit = -1,
                                               XBinary::PDSTRUCT *pPdStruct = nullptr);
     static QList<XArchive::RECORD> getRecordsFromDirectory(const QString &sDirectoryName, qint32 nLimit = -1, XBinary::PDSTRUCT *pPdStruct = nullptr);
+    static XArchiveIndex getArchiveIndex(QIODevice *pDevice, XBinary::FT fileType = XBinary::FT_UNKNOWN, XBinary::PDSTRUCT *pPdStruct = nullptr);
+    static XArchiveIndex getArchiveIndex(const QString &sFileName, XBinary::FT fileType = XBinary::FT_UNKNOWN, XBinary::PDSTRUCT *pPdStruct = nullptr);
     static QByteArray decompress(QIODevice *pDevice, const XArchive::RECORD *pRecord, XBinary::PDSTRUCT *pPdStruct = nullptr, qint64 nDecompressedOffset = 0,
                                  qint64 nDecompressedSize = -1);
     static QByteArray decompress(const QString &sFileName, const XArchive::RECORD *pRecord, XBinary::PDSTRUCT *pPdStruct = nullptr, qint64 nDecompressedOffset = 0,
                                  qint64 nDecompressedSize = -1);
     static QByteArray decompress(QIODevice *pDevice, const QString &sRecordFileName, XBinary::PDSTRUCT *pPdStruct = nullptr);
     static QByteArray decompress(const QString &sFileName, const QString &sRecordFileName, XBinary::PDSTRUCT *pPdStruct = nullptr);
+    static QByteArray decompress(QIODevice *pDevice, const XArchiveIndex *pArchiveIndex, const QString &sRecordFileName, XBinary::PDSTRUCT *pPdStruct = nullptr);
     static bool decompressToFile(QIODevice *pDevice, XArchive::RECORD *pRecord, const QString &sResultFileName, XBinary::PDSTRUCT *pPdStruct = nullptr);
     static bool decompressToDevice(QIODevice *pDevice, XArchive::RECORD *pRecord, QIODevice *pDestDevice, XBinary::PDSTRUCT *pPdStruct = nullptr);
     static bool decompressToFile(const QString &sFileName, XArchive::RECORD *pRecord, const QString &sResultFileName, XBinary::PDSTRUCT *pPdStruct = nullptr);
@@ -57,6 +63,8 @@ public:
     static QSet<XBinary::FT> getArchiveOpenValidFileTypes();
 
 private:
+    // Single pass over a compressed tar: records are written as they are reached
+    static bool _decompressToFolderStreaming(XTARCOMPRESSED *pArchive, const QString &sResultFileFolder, XBinary::PDSTRUCT *pPdStruct);
     static void _findFiles(const QString &sDirectoryName, QList<XArchive::RECORD> *pListRecords, qint32 nLimit,
                            XBinary::PDSTRUCT *pPdStruct);  // TODO mb nLimit pointer to qint32
 };
@@ -454,6 +454,8 @@ bool XASAR::finishUnpack(UNPACK_STATE *pState, PDSTRUCT *pPdStruct)
 {
     Q_UNUSED(pPdStruct)
 
+    _freeDecompressSession(pState);
+
     if (!pState) {
         return false;
     }
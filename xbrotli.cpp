@@ -431,6 +431,8 @@ bool XBrotli::finishUnpack(UNPACK_STATE *pState, PDSTRUCT *pPdStruct)
 {
     Q_UNUSED(pPdStruct)
 
+    _freeDecompressSession(pState);
+
     if (!pState) {
         return false;
     }
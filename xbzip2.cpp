@@ -436,6 +436,8 @@ bool XBZIP2::finishUnpack(UNPACK_STATE *pState, PDSTRUCT *pPdStruct)
 {
     Q_UNUSED(pPdStruct)
 
+    _freeDecompressSession(pState);
+
     if (!pState) {
         return false;
     }
@@ -805,6 +805,10 @@ bool XCab::initUnpack(UNPACK_STATE *pState, const QMap<UNPACK_PROP, QVariant> &m
     pContext->nCbCFHeader = 0;
     pContext->nCbCFFolder = 0;
     pContext->nCbCFData = 0;
+    pContext->lzxCursor = {};
+    pContext->nLZXCursorFolder = -1;
+    pContext->mszipCursor = {};
+    pContext->nMSZIPCursorFolder = -1;
 
     auto fail = [&]() -> bool {
         delete pContext;
@@ -1079,6 +1083,85 @@ XBinary::ARCHIVERECORD XCab::infoCurrent(UNPACK_STATE *pState, PDSTRUCT *pPdStru
     return result;
 }
 
+bool XCab::unpackCurrent(UNPACK_STATE *pState, QIODevice *pDevice, PDSTRUCT *pPdStruct)
+{
+    if (!pState || !pState->pContext || !pDevice || (pState->nCurrentIndex >= pState->nNumberOfRecords)) {
+        return false;
+    }
+
+    CAB_UNPACK_CONTEXT *pContext = (CAB_UNPACK_CONTEXT *)pState->pContext;
+    CFFILE cfFile = readCFFILE(pContext->listFileOffsets.at(pState->nCurrentIndex));
+
+    if (cfFile.iFolder >= (quint16)pContext->listFolders.size()) {
+        return XArchive::unpackCurrent(pState, pDevice, pPdStruct);
+    }
+
+    // LZX and MSZIP folders are one continuous stream. The folder decoder stays suspended in the
+    // context between records, so walking the files of a folder decodes it only once.
+    CFFOLDER cfFolder = pContext->listFolders.at(cfFile.iFolder);
+    quint16 nCompressType = cfFolder.typeCompress & 0x000F;
+    qint64 nFileStart = (qint64)cfFile.uoffFolderStart;
+
+    if ((nCompressType != 0x0001) && (nCompressType != 0x0003)) {
+        return XArchive::unpackCurrent(pState, pDevice, pPdStruct);
+    }
+
+    if (!pDevice->isSequential()) {
+        if (!pDevice->seek(0) || ((pDevice->size() != 0) && !XBinary::resize(pDevice, 0))) {
+            return false;
+        }
+    }
+
+    if (nCompressType == 0x0001) {
+        // The cursor only moves forward; restart it for another folder or a file behind it
+        if (!pContext->mszipCursor.bAllocated || (pContext->nMSZIPCursorFolder != cfFile.iFolder) ||
+            (pContext->mszipCursor.nCountOutput > nFileStart)) {
+            pContext->nMSZIPCursorFolder = -1;
+
+            if (!XDeflateDecoder::initCABCursor(&pContext->mszipCursor, getDevice(), cfFolder.coffCabStart, pContext->mapFolderStreamSizes.value(cfFile.iFolder, -1),
+                                                pContext->nCbCFData, pContext->mapFolderDataSizes.value(cfFile.iFolder, 0))) {
+                return false;
+            }
+
+            pContext->nMSZIPCursorFolder = cfFile.iFolder;
+        }
+
+        bool bResult = XDeflateDecoder::readCABCursor(&pContext->mszipCursor, nullptr, nFileStart - pContext->mszipCursor.nCountOutput, pPdStruct) &&
+                       XDeflateDecoder::readCABCursor(&pContext->mszipCursor, pDevice, (qint64)cfFile.cbFile, pPdStruct);
+
+        if (!bResult) {
+            // The window is undefined after a failure; the next record restarts the folder
+            XDeflateDecoder::freeCABCursor(&pContext->mszipCursor);
+            pContext->nMSZIPCursorFolder = -1;
+        }
+
+        return bResult;
+    }
+
+    // The cursor only moves forward; restart it for another folder or a file behind it
+    if (!pContext->lzxCursor.bAllocated || (pContext->nLZXCursorFolder != cfFile.iFolder) || (pContext->lzxCursor.nCountOutput > nFileStart)) {
+        pContext->nLZXCursorFolder = -1;
+
+        if (!XLZXDecoder::initCABCursor(&pContext->lzxCursor, getDevice(), cfFolder.coffCabStart, pContext->mapFolderStreamSizes.value(cfFile.iFolder, -1),
+                                        pContext->nCbCFData, pContext->mapFolderDataSizes.value(cfFile.iFolder, 0), (cfFolder.typeCompress >> 8) & 0x1F)) {
+            return false;
+        }
+
+        pContext->nLZXCursorFolder = cfFile.iFolder;
+    }
+
+    bool bResult = XLZXDecoder::readCABCursor(&pContext->lzxCursor, nullptr, nFileStart - pContext->lzxCursor.nCountOutput, pPdStruct) &&
+                   XLZXDecoder::readCABCursor(&pContext->lzxCursor, pDevice, (qint64)cfFile.cbFile, pPdStruct);
+
+    if (!bResult) {
+        // The decoder position is undefined after a failure; the next record restarts the folder
+        XLZXDecoder::freeCABCursor(&pContext->lzxCursor);
+        pContext->nLZXCursorFolder = -1;
+    }
+
+    return bResult;
+}
+
 // bool XCab::unpackCurrent(UNPACK_STATE *pState, QIODevice *pDevice, PDSTRUCT *pPdStruct)
 // {
 //     if (!pState || !pState->pContext || !pDevice) {
@@ -1289,12 +1372,16 @@ bool XCab::finishUnpack(UNPACK_STATE *pState, PDSTRUCT *pPdStruct)
 {
     Q_UNUSED(pPdStruct)
 
+    _freeDecompressSession(pState);
+
     if (!pState) {
         return false;
     }
 
     if (pState->pContext) {
         CAB_UNPACK_CONTEXT *pContext = (CAB_UNPACK_CONTEXT *)pState->pContext;
+        XLZXDecoder::freeCABCursor(&pContext->lzxCursor);
+        XDeflateDecoder::freeCABCursor(&pContext->mszipCursor);
         pContext->mapFolderCache.clear();
         pContext->mapFolderUncompressedSizes.clear();
         pContext->mapFolderStreamSizes.clear();
@@ -108,6 +108,10 @@ public:
         quint16 nCbCFHeader;                       // Size of per-cabinet reserved area (if flags & 0x0004)
         quint8 nCbCFFolder;                        // Size of per-folder reserved area
         quint8 nCbCFData;                          // Size of per-datablock reserved area
+        XLZXDecoder::CAB_CURSOR lzxCursor;         // Suspended LZX decoder of the current folder
+        qint32 nLZXCursorFolder;                   // Folder index of lzxCursor, -1 if none
+        XDeflateDecoder::CAB_CURSOR mszipCursor;   // Suspended MSZIP decoder of the current folder
+        qint32 nMSZIPCursorFolder;                 // Folder index of mszipCursor, -1 if none
     };
 
     struct CAB_PACK_CONTEXT {
@@ -160,6 +164,7 @@ public:
     virtual QMap<UNPACK_PROP, QVariant> getDefaultUnpackProperties() override;
     virtual bool initUnpack(UNPACK_STATE *pState, const QMap<UNPACK_PROP, QVariant> &mapProperties, PDSTRUCT *pPdStruct = nullptr) override;
     virtual ARCHIVERECORD infoCurrent(UNPACK_STATE *pState, PDSTRUCT *pPdStruct = nullptr) override;
+    virtual bool unpackCurrent(UNPACK_STATE *pState, QIODevice *pDevice, PDSTRUCT *pPdStruct = nullptr) override;
     virtual bool moveToNext(UNPACK_STATE *pState, PDSTRUCT *pPdStruct = nullptr) override;
     virtual bool finishUnpack(UNPACK_STATE *pState, PDSTRUCT *pPdStruct = nullptr) override;
 
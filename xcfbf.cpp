@@ -1169,6 +1169,8 @@ bool XCFBF::finishUnpack(UNPACK_STATE *pState, PDSTRUCT *pPdStruct)
 {
     Q_UNUSED(pPdStruct)
 
+    _freeDecompressSession(pState);
+
     bool bResult = false;
 
     if (pState) {
@@ -19,6 +19,18 @@
  * SOFTWARE.
  */
 #include "xcompresseddevice.h"
+#include "Algos/algo_utils.h"
+
+#include <algorithm>
+
+namespace {
+
+const qint64 COMPRESSEDDEVICE_CHUNK_SIZE = 0x100000;       // Decoded bytes per cached chunk
+const qint32 COMPRESSEDDEVICE_MAX_CHUNKS = 16;             // Cached chunks kept in memory
+const qint64 COMPRESSEDDEVICE_CHECKPOINT_SPAN = 0x100000;  // Decoded bytes between deflate checkpoints
+const qint64 COMPRESSEDDEVICE_WASTE_FACTOR = 2;            // Decode everything once restarts cost this many times the size
+
+}  // namespace
 
 XCompressedDevice::XCompressedDevice(QObject *pParent) : XIODevice(pParent)
 {
@@ -27,6 +39,14 @@ XCompressedDevice::XCompressedDevice(QObject *pParent) : XIODevice(pParent)
     m_bIsValid = false;
     m_pCurrentDevice = nullptr;
     m_pBufferDevice = nullptr;
+    m_fPart = {};
+    m_bIsLazy = false;
+    m_bIsDeflate = false;
+    m_nSize = 0;
+    m_nWastedSize = 0;
+    m_bCheckCRC = false;
+    m_bCRCFailed = false;
+    m_nExpectedCRC = 0;
 }
 
 XCompressedDevice::~XCompressedDevice()
@@ -45,13 +65,54 @@ bool XCompressedDevice::setData(QIODevice *pDevice, const XBinary::FPART &fPart,
 
     m_pOrigDevice = pDevice;
 
-    if (fPart.mapProperties.value(XBinary::FPART_PROP_HANDLEMETHOD, XBinary::HANDLE_METHOD_STORE) != XBinary::HANDLE_METHOD_STORE) {
+    XBinary::HANDLE_METHOD method = (XBinary::HANDLE_METHOD)fPart.mapProperties.value(XBinary::FPART_PROP_HANDLEMETHOD, XBinary::HANDLE_METHOD_STORE).toUInt();
+
+    if (method != XBinary::HANDLE_METHOD_STORE) {
         qint64 nUncompressedSize = fPart.mapProperties.value(XBinary::FPART_PROP_UNCOMPRESSEDSIZE, 0).toLongLong();
 
-        m_pBufferDevice = XBinary::createFileBuffer(nUncompressedSize, pPdStruct);
+        XBinary::CRC_TYPE crcType = (XBinary::CRC_TYPE)fPart.mapProperties.value(XBinary::FPART_PROP_CRC_TYPE, XBinary::CRC_TYPE_UNKNOWN).toUInt();
+
+        // Windows can be decoded independently only for a single non-solid coder of known size.
+        // The member CRC is then folded from the per-chunk CRCs, which only works for CRC-32.
+        bool bLazy = (nUncompressedSize > 0) && (!fPart.mapProperties.value(XBinary::FPART_PROP_ISSOLID, false).toBool()) &&
+                     (!fPart.mapProperties.contains(XBinary::FPART_PROP_HANDLEMETHOD2)) && (!fPart.mapProperties.contains(XBinary::FPART_PROP_HANDLEMETHOD3)) &&
+                     ((crcType == XBinary::CRC_TYPE_UNKNOWN) || (crcType == XBinary::CRC_TYPE_FFFFFFFF_EDB88320_FFFFFFFFF));
 
-        bResult = XDecompress().decompressFPART(fPart, pDevice, m_pBufferDevice, pPdStruct);
-        m_pCurrentDevice = m_pBufferDevice;
+        if (bLazy) {
+            m_fPart = fPart;
+            m_bIsLazy = true;
+            m_bCheckCRC = (crcType == XBinary::CRC_TYPE_FFFFFFFF_EDB88320_FFFFFFFFF);
+            m_nExpectedCRC = fPart.mapProperties.value(XBinary::FPART_PROP_RESULTCRC, 0).toUInt();
+            m_bIsDeflate = (method == XBinary::HANDLE_METHOD_DEFLATE);
+            m_nSize = nUncompressedSize;
+            m_listBoundaries.append(0);
+
+            if (method == XBinary::HANDLE_METHOD_XZ) {
+                QList<XLZMADecoder::XZ_BLOCK> listBlocks;
+
+                if (XLZMADecoder::getXZBlocks(pDevice, fPart.nFileOffset, fPart.nFileSize, &listBlocks, pPdStruct)) {
+                    for (qint32 i = 1; i < listBlocks.count(); i++) {
+                        m_listBoundaries.append(listBlocks.at(i).nUncompressedOffset);
+                    }
+                }
+            } else if (method == XBinary::HANDLE_METHOD_ZSTD) {
+                QList<XZstdDecoder::ZSTD_FRAME> listFrames;
+
+                if (XZstdDecoder::getFrames(pDevice, fPart.nFileOffset, fPart.nFileSize, &listFrames, nullptr, pPdStruct)) {
+                    for (qint32 i = 1; i < listFrames.count(); i++) {
+                        m_listBoundaries.append(listFrames.at(i).nDecompressedOffset);
+                    }
+                }
+            }
+
+            // The first chunk validates the stream and serves the usual header probe
+            bResult = _loadChunk(0, pPdStruct);
+        } else {
+            m_pBufferDevice = XBinary::createFileBuffer(nUncompressedSize, pPdStruct);
+
+            bResult = XDecompress().decompressFPART(fPart, pDevice, m_pBufferDevice, pPdStruct);
+            m_pCurrentDevice = m_pBufferDevice;
+        }
     } else {
         if ((fPart.nFileOffset == 0) && (pDevice->size() == fPart.nFileSize)) {
             m_pCurrentDevice = m_pOrigDevice;
@@ -90,7 +151,9 @@ qint64 XCompressedDevice::size() const
 {
     qint64 nResult = 0;
 
-    if (m_pCurrentDevice) {
+    if (m_bIsLazy) {
+        nResult = m_nSize;
+    } else if (m_pCurrentDevice) {
         nResult = m_pCurrentDevice->size();
     }
 
@@ -101,7 +164,9 @@ bool XCompressedDevice::seek(qint64 nPos)
 {
     bool bResult = false;
 
-    if (m_pCurrentDevice) {
+    if (m_bIsLazy) {
+        bResult = (nPos >= 0) && (nPos <= m_nSize) && XIODevice::seek(nPos);
+    } else if (m_pCurrentDevice) {
         bResult = m_pCurrentDevice->seek(nPos) && XIODevice::seek(nPos);
     }
 
@@ -112,7 +177,9 @@ qint64 XCompressedDevice::pos() const
 {
     qint64 nResult = 0;
 
-    if (m_pCurrentDevice) {
+    if (m_bIsLazy) {
+        nResult = XIODevice::pos();
+    } else if (m_pCurrentDevice) {
         nResult = m_pCurrentDevice->pos();
     }
 
@@ -122,9 +189,39 @@ qint64 XCompressedDevice::pos() const
 qint64 XCompressedDevice::readData(char *pData, qint64 nMaxSize)
 {
     qint64 nResult = 0;
+    qint64 nPos = pos();
+
+    while (m_bIsLazy && (nResult < nMaxSize) && (nPos < m_nSize)) {
+        qint64 nChunkIndex = nPos / COMPRESSEDDEVICE_CHUNK_SIZE;
+
+        if (!_loadChunk(nChunkIndex, nullptr)) {
+            break;
+        }
+
+        if (!m_bIsLazy) {
+            break;  // Switched to the fully decoded buffer
+        }
+
+        QByteArray baChunk = m_mapChunks.value(nChunkIndex);
+        qint64 nOffsetInChunk = nPos - nChunkIndex * COMPRESSEDDEVICE_CHUNK_SIZE;
+        qint64 nToCopy = (std::min)(nMaxSize - nResult, (qint64)baChunk.size() - nOffsetInChunk);
+
+        if (nToCopy <= 0) {
+            break;
+        }
+
+        memcpy(pData + nResult, baChunk.constData() + nOffsetInChunk, nToCopy);
 
-    if (m_pCurrentDevice->seek(pos())) {
-        nResult = m_pCurrentDevice->read(pData, nMaxSize);
+        nResult += nToCopy;
+        nPos += nToCopy;
+    }
+
+    if ((!m_bIsLazy) && (nResult < nMaxSize) && m_pCurrentDevice && m_pCurrentDevice->seek(nPos)) {
+        qint64 nRead = m_pCurrentDevice->read(pData + nResult, nMaxSize - nResult);
+
+        if (nRead > 0) {
+            nResult += nRead;
+        }
     }
 
     return nResult;
@@ -139,3 +236,160 @@ qint64 XCompressedDevice::writeData(const char *pData, qint64 nMaxSize)
 #endif
     return 0;
 }
+
+qint64 XCompressedDevice::_getRestartOffset(qint64 nOffset)
+{
+    qint64 nResult = 0;
+
+    if (m_bIsDeflate) {
+        for (qint32 i = 0; i < m_listCheckpoints.count(); i++) {
+            if (m_listCheckpoints.at(i).nOutputOffset > nOffset) {
+                break;
+            }
+
+            nResult = m_listCheckpoints.at(i).nOutputOffset;
+        }
+    } else {
+        for (qint32 i = 0; i < m_listBoundaries.count(); i++) {
+            if (m_listBoundaries.at(i) > nOffset) {
+                break;
+            }
+
+            nResult = m_listBoundaries.at(i);
+        }
+    }
+
+    return nResult;
+}
+
+bool XCompressedDevice::_loadChunk(qint64 nChunkIndex, XBinary::PDSTRUCT *pPdStruct)
+{
+    if (m_mapChunks.contains(nChunkIndex)) {
+        return true;
+    }
+
+    if (m_bCRCFailed) {
+        return false;
+    }
+
+    XBinary::PDSTRUCT pdStructEmpty = XBinary::createPdStruct();
+
+    if (!pPdStruct) {
+        pPdStruct = &pdStructEmpty;
+    }
+
+    qint64 nChunkOffset = nChunkIndex * COMPRESSEDDEVICE_CHUNK_SIZE;
+    qint64 nChunkSize = (std::min)(COMPRESSEDDEVICE_CHUNK_SIZE, m_nSize - nChunkOffset);
+
+    if (nChunkSize <= 0) {
+        return false;
+    }
+
+    // Without a nearby restart point every chunk repeats the decode from the start;
+    // past the budget a single full decode is cheaper
+    m_nWastedSize += nChunkOffset - _getRestartOffset(nChunkOffset);
+
+    if (m_nWastedSize > COMPRESSEDDEVICE_WASTE_FACTOR * m_nSize) {
+        return _materialize(pPdStruct);
+    }
+
+    QByteArray baChunk;
+    QBuffer buffer(&baChunk);
+
+    if (!buffer.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    XBinary::DATAPROCESS_STATE state = {};
+    state.mapProperties = m_fPart.mapProperties;
+    // The member CRC covers the whole stream, not a window of it
+    state.mapProperties.remove(XBinary::FPART_PROP_CRC_TYPE);
+    state.mapProperties.remove(XBinary::FPART_PROP_RESULTCRC);
+    state.pDeviceInput = m_pOrigDevice;
+    state.pDeviceOutput = &buffer;
+    state.nInputOffset = m_fPart.nFileOffset;
+    state.nInputLimit = m_fPart.nFileSize;
+    state.nProcessedOffset = nChunkOffset;
+    state.nProcessedLimit = nChunkSize;
+
+    bool bDecoded = false;
+
+    if (m_bIsDeflate) {
+        bDecoded = XDeflateDecoder::decompressCheckpoint(&state, &m_listCheckpoints, COMPRESSEDDEVICE_CHECKPOINT_SPAN, pPdStruct);
+    } else {
+        bDecoded = XDecompress().multiDecompress(&state, pPdStruct);
+    }
+
+    buffer.close();
+
+    // Decoders stopped by the window limit may report failure once the window is full, while an
+    // error inside the window leaves it short. The last window ends with the stream and has to
+    // decode cleanly.
+    bool bIsLast = ((nChunkOffset + nChunkSize) == m_nSize);
+
+    if ((baChunk.size() != nChunkSize) || state.bReadError || (bIsLast && !bDecoded) || !XBinary::isPdStructNotCanceled(pPdStruct)) {
+        return false;
+    }
+
+    if (m_bCheckCRC && !m_mapChunkCRCs.contains(nChunkIndex)) {
+        m_mapChunkCRCs.insert(nChunkIndex, XBinary::_getCRC32(baChunk.constData(), baChunk.size(), 0xFFFFFFFF, XBinary::_getCRC32Table_EDB88320()) ^ 0xFFFFFFFF);
+
+        if (!_checkCRC()) {
+            m_mapChunks.clear();
+            m_listChunkOrder.clear();
+            m_bCRCFailed = true;
+
+            return false;
+        }
+    }
+
+    m_mapChunks.insert(nChunkIndex, baChunk);
+    m_listChunkOrder.append(nChunkIndex);
+
+    if (m_listChunkOrder.count() > COMPRESSEDDEVICE_MAX_CHUNKS) {
+        m_mapChunks.remove(m_listChunkOrder.takeFirst());
+    }
+
+    return true;
+}
+
+bool XCompressedDevice::_checkCRC()
+{
+    qint64 nNumberOfChunks = (m_nSize + COMPRESSEDDEVICE_CHUNK_SIZE - 1) / COMPRESSEDDEVICE_CHUNK_SIZE;
+
+    if (m_mapChunkCRCs.count() < nNumberOfChunks) {
+        return true;  // Not fully read yet
+    }
+
+    quint32 nCRC = m_mapChunkCRCs.value(0);
+
+    for (qint64 i = 1; i < nNumberOfChunks; i++) {
+        qint64 nChunkSize = (std::min)(COMPRESSEDDEVICE_CHUNK_SIZE, m_nSize - i * COMPRESSEDDEVICE_CHUNK_SIZE);
+        nCRC = Algo_utils::combineCRC32(nCRC, m_mapChunkCRCs.value(i), nChunkSize);
+    }
+
+    return (nCRC == m_nExpectedCRC);
+}
+
+bool XCompressedDevice::_materialize(XBinary::PDSTRUCT *pPdStruct)
+{
+    bool bResult = false;
+
+    m_pBufferDevice = XBinary::createFileBuffer(m_nSize, pPdStruct);
+
+    if (m_pBufferDevice) {
+        bResult = XDecompress().decompressFPART(m_fPart, m_pOrigDevice, m_pBufferDevice, pPdStruct);
+
+        if (bResult) {
+            m_pCurrentDevice = m_pBufferDevice;
+            m_bIsLazy = false;
+            m_mapChunks.clear();
+            m_listChunkOrder.clear();
+            m_listCheckpoints.clear();
+        } else {
+            XBinary::freeFileBuffer(&m_pBufferDevice);
+        }
+    }
+
+    return bResult;
+}
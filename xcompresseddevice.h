@@ -46,12 +46,33 @@ protected:
     virtual qint64 readData(char *pData, qint64 nMaxSize);
     virtual qint64 writeData(const char *pData, qint64 nMaxSize);
 
+private:
+    qint64 _getRestartOffset(qint64 nOffset);
+    bool _loadChunk(qint64 nChunkIndex, XBinary::PDSTRUCT *pPdStruct);
+    bool _checkCRC();
+    bool _materialize(XBinary::PDSTRUCT *pPdStruct);
+
 private:
     QIODevice *m_pOrigDevice;
     SubDevice *m_pSubDevice;
     bool m_bIsValid;
     QIODevice *m_pCurrentDevice;
     QIODevice *m_pBufferDevice;
+    // Lazy mode: decoded chunks are produced on demand from the nearest restart point
+    XBinary::FPART m_fPart;
+    bool m_bIsLazy;
+    bool m_bIsDeflate;
+    qint64 m_nSize;
+    qint64 m_nWastedSize;  // Bytes decoded only to reach a chunk
+    QList<qint64> m_listBoundaries;  // Decompressed offsets of XZ blocks / zstd frames
+    QList<XDeflateDecoder::CHECKPOINT> m_listCheckpoints;
+    QMap<qint64, QByteArray> m_mapChunks;
+    QList<qint64> m_listChunkOrder;
+    // Lazy mode CRC: the member CRC-32 is checked once every chunk has been decoded
+    bool m_bCheckCRC;
+    bool m_bCRCFailed;
+    quint32 m_nExpectedCRC;
+    QMap<qint64, quint32> m_mapChunkCRCs;
 };
 
 #endif  // XCOMPRESSEDDEVICE_H
@@ -22,12 +22,16 @@
 #include "subdevice.h"
 #include "xpng.h"
 #include "Algos/algo_utils.h"
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
 #include <limits>
 
 XDecompress::XDecompress(QObject *parent) : QObject(parent)
 {
     m_pRarUnpacker = nullptr;
     m_nRarSolidIndex = 0;
+    m_solidCursor = {};
 }
 
 // A decompressed size is usable as a QByteArray length only if it is non-negative
@@ -76,63 +80,65 @@ static bool decWriteAll(QIODevice *pDevice, const char *pData, qint64 nSize, XBi
     return (nWritten == nSize) && XBinary::isPdStructNotCanceled(pPdStruct);
 }
 
-// Each MSZIP CFDATA block is a fresh raw-DEFLATE stream, but blocks after the
-// first inherit the previous 32 KiB as their dictionary.  The bundled inflater
-// has no inflateSetDictionary entry point, so feed that history through a
-// non-final stored block and strip it from the decoded result.
-static bool decInflateMSZIPBlock(const QByteArray &baPayload, const QByteArray &baHistory, qint32 nExpectedSize, QByteArray *pbaResult,
-                                 XBinary::PDSTRUCT *pPdStruct)
-{
-    if (!pbaResult || (baPayload.size() < 2) || (baPayload.at(0) != 'C') || (baPayload.at(1) != 'K') || (nExpectedSize < 0) ||
-        (nExpectedSize > 32768)) {
-        return false;
+// Decodes one BCJ2 side stream (call or jump) on a pool thread. The packed
+// bytes are copied into memory beforehand because the archive QIODevice is
+// not safe to share between threads. Each task owns its decoder and its
+// PDSTRUCT; only cancellation is forwarded from the caller through stop().
+class DecBCJ2Runnable : public QRunnable {
+public:
+    DecBCJ2Runnable(QByteArray *pbaPacked, XBinary::HANDLE_METHOD compressMethod, const QByteArray &baProperty, qint64 nOutputSize, QByteArray *pbaOutput)
+        : m_pbaPacked(pbaPacked),
+          m_compressMethod(compressMethod),
+          m_baProperty(baProperty),
+          m_nOutputSize(nOutputSize),
+          m_pbaOutput(pbaOutput),
+          m_pdStruct(XBinary::createPdStruct()),
+          m_bResult(false)
+    {
+        setAutoDelete(false);
     }
 
-    qint32 nDictionarySize = qMin(32768, baHistory.size());
-    QByteArray baInput;
-
-    if (nDictionarySize > 0) {
-        baInput.resize(5 + nDictionarySize);
-        quint16 nLength = (quint16)nDictionarySize;
-        quint16 nInverseLength = (quint16)~nLength;
-        baInput[0] = 0;  // BFINAL=0, BTYPE=stored, then byte alignment.
-        baInput[1] = (char)(nLength & 0xFF);
-        baInput[2] = (char)((nLength >> 8) & 0xFF);
-        baInput[3] = (char)(nInverseLength & 0xFF);
-        baInput[4] = (char)((nInverseLength >> 8) & 0xFF);
-        memcpy(baInput.data() + 5, baHistory.constData() + baHistory.size() - nDictionarySize, nDictionarySize);
-    }
+    void run() override
+    {
+        QBuffer inputBuffer(m_pbaPacked);
+        QBuffer outputBuffer(m_pbaOutput);
 
-    baInput.append(baPayload.constData() + 2, baPayload.size() - 2);
+        if (inputBuffer.open(QIODevice::ReadOnly) && outputBuffer.open(QIODevice::WriteOnly)) {
+            XBinary::DATAPROCESS_STATE state = {};
+            state.pDeviceInput = &inputBuffer;
+            state.pDeviceOutput = &outputBuffer;
+            state.nInputOffset = 0;
+            state.nInputLimit = m_pbaPacked->size();
+            state.nProcessedOffset = 0;
+            state.nProcessedLimit = m_nOutputSize;
+            state.mapProperties.insert(XBinary::FPART_PROP_HANDLEMETHOD, (quint32)m_compressMethod);
+            state.mapProperties.insert(XBinary::FPART_PROP_COMPRESSPROPERTIES, m_baProperty);
+            state.mapProperties.insert(XBinary::FPART_PROP_UNCOMPRESSEDSIZE, m_nOutputSize);
 
-    QBuffer inputBuffer(&baInput);
-    QByteArray baDecoded;
-    QBuffer outputBuffer(&baDecoded);
-    if (!inputBuffer.open(QIODevice::ReadOnly) || !outputBuffer.open(QIODevice::WriteOnly)) {
-        return false;
+            XDecompress decompressor;
+            m_bResult = decompressor.decompress(&state, &m_pdStruct);
+        }
     }
 
-    XBinary::DATAPROCESS_STATE state = {};
-    state.pDeviceInput = &inputBuffer;
-    state.pDeviceOutput = &outputBuffer;
-    state.nInputOffset = 0;
-    state.nInputLimit = baInput.size();
-    state.nProcessedOffset = 0;
-    state.nProcessedLimit = (qint64)nDictionarySize + nExpectedSize;
-
-    bool bResult = XDeflateDecoder::decompress(&state, pPdStruct);
-    inputBuffer.close();
-    outputBuffer.close();
+    void stop()
+    {
+        m_pdStruct.bIsStop = true;
+    }
 
-    qint64 nExpectedDecodedSize = (qint64)nDictionarySize + nExpectedSize;
-    if (!bResult || state.bReadError || state.bWriteError || (state.nCountInput != baInput.size()) || (state.nCountOutput != nExpectedDecodedSize) ||
-        (baDecoded.size() != nExpectedDecodedSize) || !XBinary::isPdStructNotCanceled(pPdStruct)) {
-        return false;
+    bool isSuccess() const
+    {
+        return m_bResult;
     }
 
-    *pbaResult = baDecoded.mid(nDictionarySize);
-    return pbaResult->size() == nExpectedSize;
-}
+private:
+    QByteArray *m_pbaPacked;
+    XBinary::HANDLE_METHOD m_compressMethod;
+    QByteArray m_baProperty;
+    qint64 m_nOutputSize;
+    QByteArray *m_pbaOutput;
+    XBinary::PDSTRUCT m_pdStruct;
+    bool m_bResult;
+};
 
 XDecompress::~XDecompress()
 {
@@ -181,6 +187,94 @@ void XDecompress::clearSolidCache()
     delete m_pRarUnpacker;
     m_pRarUnpacker = nullptr;
     m_nRarSolidIndex = 0;
+
+    XLZMADecoder::freeCursor(&m_solidCursor);
+    m_sSolidCursorKey.clear();
+}
+
+bool XDecompress::isSolidStreamable(XBinary::DATAPROCESS_STATE *pState)
+{
+    // Only a single LZMA/LZMA2 coder can be resumed in place. Filter chains,
+    // encryption and BCJ2 still decode the whole folder into the cache.
+    XBinary::HANDLE_METHOD method = (XBinary::HANDLE_METHOD)pState->mapProperties.value(XBinary::FPART_PROP_HANDLEMETHOD, XBinary::HANDLE_METHOD_STORE).toUInt();
+
+    if ((method != XBinary::HANDLE_METHOD_LZMA) && (method != XBinary::HANDLE_METHOD_LZMA2)) {
+        return false;
+    }
+
+    if (pState->mapProperties.contains(XBinary::FPART_PROP_HANDLEMETHOD2) || !pState->mapProperties.contains(XBinary::FPART_PROP_SUBSTREAMOFFSET) ||
+        pState->mapProperties.value(XBinary::FPART_PROP_COMPRESSPROPERTIES).toByteArray().isEmpty()) {
+        return false;
+    }
+
+    if ((pState->nProcessedOffset != 0) || (pState->nProcessedLimit != -1)) {
+        return false;
+    }
+
+    // The folder CRC needs the complete block. Stream only when the record has
+    // its own CRC to verify, or when the folder carries no CRC at all.
+    if (pState->mapProperties.contains(XBinary::FPART_PROP_UNCOMPRESSEDCRC) && !pState->mapProperties.contains(XBinary::FPART_PROP_RESULTCRC)) {
+        return false;
+    }
+
+    return true;
+}
+
+bool XDecompress::decompressSolidStream(XBinary::DATAPROCESS_STATE *pState, const QString &sCacheKey, XBinary::PDSTRUCT *pPdStruct)
+{
+    qint64 nSubstreamOffset = pState->mapProperties.value(XBinary::FPART_PROP_SUBSTREAMOFFSET, (qint64)0).toLongLong();
+    qint64 nDecompressedSize = pState->mapProperties.value(XBinary::FPART_PROP_UNCOMPRESSEDSIZE, (qint64)0).toLongLong();
+
+    if (!pState->pDeviceInput || !pState->pDeviceOutput || (nSubstreamOffset < 0) || (nDecompressedSize < 0)) {
+        return false;
+    }
+
+    // The cursor only moves forward; restart it for another folder or a rewind.
+    if (!m_solidCursor.bAllocated || (m_sSolidCursorKey != sCacheKey) || (m_solidCursor.pDeviceInput != pState->pDeviceInput) ||
+        (m_solidCursor.nCountOutput > nSubstreamOffset)) {
+        XBinary::HANDLE_METHOD method =
+            (XBinary::HANDLE_METHOD)pState->mapProperties.value(XBinary::FPART_PROP_HANDLEMETHOD, XBinary::HANDLE_METHOD_STORE).toUInt();
+        QByteArray baProperty = pState->mapProperties.value(XBinary::FPART_PROP_COMPRESSPROPERTIES).toByteArray();
+
+        m_sSolidCursorKey.clear();
+
+        if (!XLZMADecoder::initCursor(&m_solidCursor, method, baProperty, pState->pDeviceInput, pState->nInputOffset, pState->nInputLimit, pPdStruct)) {
+            return false;
+        }
+
+        m_sSolidCursorKey = sCacheKey;
+    }
+
+    bool bResult = XLZMADecoder::readCursor(&m_solidCursor, nullptr, nSubstreamOffset - m_solidCursor.nCountOutput, pPdStruct);
+
+    if (bResult) {
+        bResult = decClearOutputDevice(pState->pDeviceOutput);
+
+        if (!bResult) {
+            pState->bWriteError = true;
+        }
+    }
+
+    if (bResult) {
+        bResult = XLZMADecoder::readCursor(&m_solidCursor, pState->pDeviceOutput, nDecompressedSize, pPdStruct);
+    }
+
+    if (bResult) {
+        pState->nCountOutput = nDecompressedSize;
+
+        XBinary::CRC_TYPE crcType = (XBinary::CRC_TYPE)pState->mapProperties.value(XBinary::FPART_PROP_CRC_TYPE, XBinary::CRC_TYPE_UNKNOWN).toUInt();
+
+        if (XBinary::isUnpackCRCEnabled(pState->mapUnpackProperties, crcType)) {
+            QVariant varCRC = pState->mapProperties.value(XBinary::FPART_PROP_RESULTCRC, 0);
+            bResult = checkCRC(crcType, varCRC, pState->pDeviceOutput, pPdStruct);
+        }
+    } else {
+        // The decoder position is undefined after a failure; the next request restarts.
+        XLZMADecoder::freeCursor(&m_solidCursor);
+        m_sSolidCursorKey.clear();
+    }
+
+    return bResult;
 }
 
 bool XDecompress::decompressRarSolid(XBinary::DATAPROCESS_STATE *pState, XBinary::PDSTRUCT *pPdStruct)
@@ -441,7 +535,24 @@ bool XDecompress::multiDecompress(XBinary::DATAPROCESS_STATE *pState, XBinary::P
                 sCacheKey = QString("%1_%2").arg(pState->nInputOffset).arg(pState->nInputLimit);
             }
 
+            if (isSolidStreamable(pState)) {
+                // Stream this record's window straight from the suspended folder
+                // decoder instead of materializing the whole folder.
+                return decompressSolidStream(pState, sCacheKey, pPdStruct);
+            }
+
             if (!m_mapSolidCache.contains(sCacheKey)) {
+                // Records are walked folder by folder, so once a new folder is
+                // requested the previous folder blocks are not needed again.
+                // Release them to keep a long-lived session bounded.
+                QList<QString> listKeys = m_mapSolidCache.keys();
+                for (qint32 i = 0; i < listKeys.count(); i++) {
+                    if (!listKeys.at(i).startsWith("rar_")) {
+                        QIODevice *pOldDevice = m_mapSolidCache.take(listKeys.at(i));
+                        XBinary::freeFileBuffer(&pOldDevice);
+                    }
+                }
+
                 qint64 nStreamUnpackedSize = pState->mapProperties.value(XBinary::FPART_PROP_STREAMUNPACKEDSIZE, (qint64)0).toLongLong();
 
                 // Build a block-level state: same source, ISSOLID=false, full block uncompressed size.
@@ -905,53 +1016,90 @@ bool XDecompress::decompress(XBinary::DATAPROCESS_STATE *pState, XBinary::PDSTRU
                 baCall.resize((qint32)nCallUnpack);
                 baJmp.resize((qint32)nJmpUnpack);
 
-                struct _BCJ2Task {
-                    qint64 nOffset;
-                    qint64 nSize;
-                    qint64 nOutputSize;
-                    XBinary::HANDLE_METHOD cm;
-                    QByteArray *pOutput;
-                    const QByteArray *pProperty;
-                };
-
-                _BCJ2Task tasks[3];
-                tasks[0] = {pState->nInputOffset, pState->nInputLimit, nMainUnpack, cmMain, &baMain, &baPropMain};
-                tasks[1] = {nCallOffset, nCallSize, nCallUnpack, cmCall, &baCall, &baPropCall};
-                tasks[2] = {nJmpOffset, nJmpSize, nJmpUnpack, cmJmp, &baJmp, &baPropJmp};
-
-                bool bLZMAOk = true;
-                for (qint32 nTask = 0; nTask < 3 && bLZMAOk && XBinary::isPdStructNotCanceled(pPdStruct); nTask++) {
-                    QBuffer outBuf(tasks[nTask].pOutput);
-                    if (!outBuf.open(QIODevice::WriteOnly)) {
-                        bLZMAOk = false;
-                        break;
+                // The main, call and jump streams are independent. Call and
+                // jump are decoded on a bounded pool from in-memory packed
+                // copies while main is decoded here straight from the archive
+                // device, which stays owned by this thread. The workers have
+                // their own decoders and PDSTRUCTs; a cancel of the caller's
+                // PDSTRUCT is forwarded to them while waiting.
+                bool bLZMAOk = XBinary::isPdStructNotCanceled(pPdStruct);
+                QByteArray baCallPacked = aBCJ2Decrypted[1];
+                QByteArray baJmpPacked = aBCJ2Decrypted[2];
+
+                if (bLZMAOk && baCallPacked.isEmpty()) {
+                    bLZMAOk = decIsValidBufferSize(nCallSize) && pState->pDeviceInput->seek(nCallOffset);
+                    if (bLZMAOk) {
+                        baCallPacked = pState->pDeviceInput->read(nCallSize);
+                        bLZMAOk = (baCallPacked.size() == nCallSize);
                     }
-                    XBinary::DATAPROCESS_STATE dpState = {};
-                    dpState.pDeviceOutput = &outBuf;
-                    dpState.nProcessedOffset = 0;
-                    dpState.nProcessedLimit = tasks[nTask].nOutputSize;
-                    dpState.mapProperties.insert(XBinary::FPART_PROP_HANDLEMETHOD, (quint32)tasks[nTask].cm);
-                    dpState.mapProperties.insert(XBinary::FPART_PROP_COMPRESSPROPERTIES, *tasks[nTask].pProperty);
-                    dpState.mapProperties.insert(XBinary::FPART_PROP_UNCOMPRESSEDSIZE, tasks[nTask].nOutputSize);
-                    if (bBCJ2HasAES && !aBCJ2Decrypted[nTask].isEmpty()) {
-                        // Use AES-decrypted buffer as LZMA input
-                        QBuffer lzmaBuf(&aBCJ2Decrypted[nTask]);
-                        if (lzmaBuf.open(QIODevice::ReadOnly)) {
-                            dpState.pDeviceInput = &lzmaBuf;
-                            dpState.nInputOffset = 0;
-                            dpState.nInputLimit = aBCJ2Decrypted[nTask].size();
-                            bLZMAOk = decompress(&dpState, pPdStruct);
-                            lzmaBuf.close();
+                }
+
+                if (bLZMAOk && baJmpPacked.isEmpty()) {
+                    bLZMAOk = decIsValidBufferSize(nJmpSize) && pState->pDeviceInput->seek(nJmpOffset);
+                    if (bLZMAOk) {
+                        baJmpPacked = pState->pDeviceInput->read(nJmpSize);
+                        bLZMAOk = (baJmpPacked.size() == nJmpSize);
+                    }
+                }
+
+                if (bLZMAOk) {
+                    DecBCJ2Runnable taskCall(&baCallPacked, cmCall, baPropCall, nCallUnpack, &baCall);
+                    DecBCJ2Runnable taskJmp(&baJmpPacked, cmJmp, baPropJmp, nJmpUnpack, &baJmp);
+
+                    QThreadPool threadPool;
+                    bool bParallel = (QThread::idealThreadCount() > 1);
+
+                    if (bParallel) {
+                        threadPool.setMaxThreadCount(2);
+                        threadPool.start(&taskCall);
+                        threadPool.start(&taskJmp);
+                    }
+
+                    QBuffer outBuf(&baMain);
+                    bLZMAOk = outBuf.open(QIODevice::WriteOnly);
+
+                    if (bLZMAOk) {
+                        XBinary::DATAPROCESS_STATE dpState = {};
+                        dpState.pDeviceOutput = &outBuf;
+                        dpState.nProcessedOffset = 0;
+                        dpState.nProcessedLimit = nMainUnpack;
+                        dpState.mapProperties.insert(XBinary::FPART_PROP_HANDLEMETHOD, (quint32)cmMain);
+                        dpState.mapProperties.insert(XBinary::FPART_PROP_COMPRESSPROPERTIES, baPropMain);
+                        dpState.mapProperties.insert(XBinary::FPART_PROP_UNCOMPRESSEDSIZE, nMainUnpack);
+                        if (bBCJ2HasAES && !aBCJ2Decrypted[0].isEmpty()) {
+                            // Use AES-decrypted buffer as LZMA input
+                            QBuffer lzmaBuf(&aBCJ2Decrypted[0]);
+                            if (lzmaBuf.open(QIODevice::ReadOnly)) {
+                                dpState.pDeviceInput = &lzmaBuf;
+                                dpState.nInputOffset = 0;
+                                dpState.nInputLimit = aBCJ2Decrypted[0].size();
+                                bLZMAOk = decompress(&dpState, pPdStruct);
+                                lzmaBuf.close();
+                            } else {
+                                bLZMAOk = false;
+                            }
                         } else {
-                            bLZMAOk = false;
+                            dpState.pDeviceInput = pState->pDeviceInput;
+                            dpState.nInputOffset = pState->nInputOffset;
+                            dpState.nInputLimit = pState->nInputLimit;
+                            bLZMAOk = decompress(&dpState, pPdStruct);
                         }
-                    } else {
-                        dpState.pDeviceInput = pState->pDeviceInput;
-                        dpState.nInputOffset = tasks[nTask].nOffset;
-                        dpState.nInputLimit = tasks[nTask].nSize;
-                        bLZMAOk = decompress(&dpState, pPdStruct);
+                        outBuf.close();
+                    }
+
+                    if (bParallel) {
+                        while (!threadPool.waitForDone(50)) {
+                            if (!bLZMAOk || XBinary::isPdStructStopped(pPdStruct)) {
+                                taskCall.stop();
+                                taskJmp.stop();
+                            }
+                        }
+                    } else if (bLZMAOk && XBinary::isPdStructNotCanceled(pPdStruct)) {
+                        taskCall.run();
+                        taskJmp.run();
                     }
-                    outBuf.close();
+
+                    bLZMAOk = bLZMAOk && taskCall.isSuccess() && taskJmp.isSuccess();
                 }
 
                 if (bLZMAOk && XBinary::isPdStructNotCanceled(pPdStruct)) {
@@ -1301,25 +1449,32 @@ bool XDecompress::decompress(XBinary::DATAPROCESS_STATE *pState, XBinary::PDSTRU
     } else if ((compressMethod == XBinary::HANDLE_METHOD_STORE_CAB) || (compressMethod == XBinary::HANDLE_METHOD_MSZIP_CAB)) {
         // CAB archive: data is stored in CFDATA blocks with 8-byte headers
         // CFDATA: checksum(4) + cbData(2) + cbUncomp(2) + [reserved] + payload(cbData)
+        // Blocks are decoded one at a time up to the end of this record and only their overlap with
+        // the record is written. Each MSZIP block is "CK" plus a complete raw deflate stream that
+        // may reference the previous 32 KiB of folder output, so the inflater carries that window.
         qint64 nSubstreamOffset = pState->mapProperties.value(XBinary::FPART_PROP_SUBSTREAMOFFSET, 0).toLongLong();
         qint64 nDataReservedSize = pState->mapProperties.value(XBinary::FPART_PROP_OPTHEADER_SIZE, 0).toLongLong();
         qint64 nStreamSize = pState->nInputLimit;
         const qint64 nCFDataHeaderSize = 8;  // sizeof(CFDATA): checksum(4) + cbData(2) + cbUncomp(2)
+        const qint32 nMaxBlockSize = 32768;
         bool bTargetRangeValid = (nSubstreamOffset >= 0) && (nUncompressedSize >= 0) &&
                                  (nUncompressedSize <= (std::numeric_limits<qint64>::max)() - nSubstreamOffset);
         qint64 nMinimumFolderSize = bTargetRangeValid ? nSubstreamOffset + nUncompressedSize : -1;
         qint64 nDeclaredFolderSize = pState->mapProperties.value(XBinary::FPART_PROP_STREAMUNPACKEDSIZE, nMinimumFolderSize).toLongLong();
+        bool bMSZIP = (compressMethod == XBinary::HANDLE_METHOD_MSZIP_CAB);
 
-        QByteArray baFolderData;
+        XDeflateDecoder::WINDOW_STREAM windowStream = {};
+        QByteArray baBlock;
         qint64 nOffset = 0;
         qint64 nDecodedFolderSize = 0;
-        bResult = bTargetRangeValid && (nDataReservedSize >= 0) && (nStreamSize >= 0) && decIsValidBufferSize(nDeclaredFolderSize) &&
-                  (nDeclaredFolderSize >= nMinimumFolderSize);
-        if (bResult) {
-            baFolderData.reserve((qint32)nDeclaredFolderSize);
+        bResult = bTargetRangeValid && (nDataReservedSize >= 0) && (nStreamSize >= 0) && (nDeclaredFolderSize >= nMinimumFolderSize);
+
+        if (bResult && bMSZIP) {
+            baBlock.resize(nMaxBlockSize);
+            bResult = XDeflateDecoder::initWindowStream(&windowStream);
         }
 
-        while (bResult && (nOffset < nStreamSize) && XBinary::isPdStructNotCanceled(pPdStruct)) {
+        while (bResult && (nDecodedFolderSize < nMinimumFolderSize) && XBinary::isPdStructNotCanceled(pPdStruct)) {
             if ((nCFDataHeaderSize + nDataReservedSize > nStreamSize - nOffset) ||
                 !pState->pDeviceInput->seek(pState->nInputOffset + nOffset)) {
                 bResult = false;
@@ -1338,132 +1493,90 @@ bool XDecompress::decompress(XBinary::DATAPROCESS_STATE *pState, XBinary::PDSTRU
 
             qint64 nPayloadOffset = nOffset + nCFDataHeaderSize + nDataReservedSize;
 
-            if ((nCbData == 0) || (nCbUncomp > 32768) || ((qint64)nCbData > nStreamSize - nPayloadOffset) ||
-                ((qint64)nCbUncomp > nDeclaredFolderSize - nDecodedFolderSize)) {
+            if ((nCbData == 0) || (nCbUncomp > nMaxBlockSize) || ((qint64)nCbData > nStreamSize - nPayloadOffset) ||
+                ((qint64)nCbUncomp > nDeclaredFolderSize - nDecodedFolderSize) || (!bMSZIP && (nCbData != nCbUncomp))) {
                 bResult = false;
                 break;
             }
 
-            if (!pState->pDeviceInput->seek(pState->nInputOffset + nPayloadOffset)) {
-                bResult = false;
-                break;
-            }
-            QByteArray baPayload = pState->pDeviceInput->read(nCbData);
-
-            if (baPayload.size() != nCbData) {
-                bResult = false;
-                break;
-            }
+            qint64 nChunkFrom = (std::max)(nDecodedFolderSize, nSubstreamOffset);
+            qint64 nChunkEnd = (std::min)(nDecodedFolderSize + nCbUncomp, nMinimumFolderSize);
 
-            if (compressMethod == XBinary::HANDLE_METHOD_STORE_CAB) {
-                if (nCbData != nCbUncomp) {
+            // Stored blocks in front of the record are only skipped, MSZIP ones still feed the window
+            if (bMSZIP || (nChunkEnd > nChunkFrom)) {
+                if (!pState->pDeviceInput->seek(pState->nInputOffset + nPayloadOffset)) {
                     bResult = false;
                     break;
                 }
-                baFolderData.append(baPayload);
-            } else {
-                QByteArray baUncompressedBlock;
-                if (!decInflateMSZIPBlock(baPayload, baFolderData, nCbUncomp, &baUncompressedBlock, pPdStruct)) {
+                QByteArray baPayload = pState->pDeviceInput->read(nCbData);
+
+                if (baPayload.size() != nCbData) {
                     bResult = false;
                     break;
                 }
 
-                baFolderData.append(baUncompressedBlock);
+                const char *pBlock = baPayload.constData();
+
+                if (bMSZIP) {
+                    if ((nCbData < 2) || (baPayload.at(0) != 'C') || (baPayload.at(1) != 'K') ||
+                        !XDeflateDecoder::inflateWindowStream(&windowStream, baPayload.constData() + 2, nCbData - 2, baBlock.data(), nCbUncomp)) {
+                        bResult = false;
+                        break;
+                    }
+
+                    pBlock = baBlock.constData();
+                }
+
+                if ((nChunkEnd > nChunkFrom) &&
+                    !decWriteAll(pState->pDeviceOutput, pBlock + (nChunkFrom - nDecodedFolderSize), nChunkEnd - nChunkFrom, pPdStruct)) {
+                    bResult = false;
+                    break;
+                }
             }
 
             nDecodedFolderSize += nCbUncomp;
             nOffset = nPayloadOffset + nCbData;
         }
 
-        bResult = bResult && XBinary::isPdStructNotCanceled(pPdStruct) && (nOffset == nStreamSize) &&
-                  (nDecodedFolderSize == nDeclaredFolderSize) && (baFolderData.size() == nDeclaredFolderSize);
+        XDeflateDecoder::freeWindowStream(&windowStream);
 
-        if (bResult) {
-            const char *pOutput = (nUncompressedSize > 0) ? (baFolderData.constData() + nSubstreamOffset) : nullptr;
-            bResult = decWriteAll(pState->pDeviceOutput, pOutput, nUncompressedSize, pPdStruct);
-            pState->nCountOutput = bResult ? nUncompressedSize : 0;
-        }
+        bResult = bResult && XBinary::isPdStructNotCanceled(pPdStruct) && (nDecodedFolderSize >= nMinimumFolderSize);
+        pState->nCountOutput = bResult ? nUncompressedSize : 0;
     } else if (compressMethod == XBinary::HANDLE_METHOD_LZX_CAB) {
-        // CAB LZX: gather every CFDATA payload into one folder stream, then LZX-decode the whole folder.
+        // CAB LZX: the cursor pulls CFDATA payloads from the folder stream as the bitstream needs them
+        // and decodes 32KB frames, skipping up to this record's window and writing only the record itself.
         // The window bits are carried in FPART_PROP_WINDOWSIZE (extracted from CFFOLDER.typeCompress).
         qint64 nSubstreamOffset = pState->mapProperties.value(XBinary::FPART_PROP_SUBSTREAMOFFSET, 0).toLongLong();
         qint64 nDataReservedSize = pState->mapProperties.value(XBinary::FPART_PROP_OPTHEADER_SIZE, 0).toLongLong();
         qint32 nWindowBits = (qint32)pState->mapProperties.value(XBinary::FPART_PROP_WINDOWSIZE, 0).toInt();
         qint64 nStreamSize = pState->nInputLimit;
-        const qint64 nCFDataHeaderSize = 8;
 
         if ((nWindowBits < 15) || (nWindowBits > 21)) {
             nWindowBits = 21;  // Reasonable default; most CAB LZX folders use the largest window
         }
 
-        QByteArray baCompressedFolder;
         bool bFolderSizeValid = (nSubstreamOffset >= 0) && (nUncompressedSize >= 0) &&
                                 (nUncompressedSize <= (std::numeric_limits<qint64>::max)() - nSubstreamOffset);
         qint64 nMinimumFolderSize = bFolderSizeValid ? (nSubstreamOffset + nUncompressedSize) : -1;
         qint64 nFolderUncompressed = pState->mapProperties.value(XBinary::FPART_PROP_STREAMUNPACKEDSIZE, nMinimumFolderSize).toLongLong();
-        qint64 nOffset = 0;
-        qint64 nDeclaredBlockOutput = 0;
-        bResult = bFolderSizeValid && (nDataReservedSize >= 0) && (nStreamSize >= 0) && decIsValidBufferSize(nFolderUncompressed) &&
+        bResult = bFolderSizeValid && (nDataReservedSize >= 0) && (nDataReservedSize <= 255) && (nStreamSize >= 0) &&
                   (nFolderUncompressed >= nMinimumFolderSize);
 
-        while (bResult && (nOffset < nStreamSize) && XBinary::isPdStructNotCanceled(pPdStruct)) {
-            if ((nCFDataHeaderSize + nDataReservedSize > nStreamSize - nOffset) ||
-                !pState->pDeviceInput->seek(pState->nInputOffset + nOffset)) {
-                bResult = false;
-                break;
-            }
-
-            char header[8];
-            if (pState->pDeviceInput->read(header, 8) != 8) {
-                bResult = false;
-                break;
-            }
-
-            quint16 nCbData = (quint8)header[4] | ((quint16)(quint8)header[5] << 8);
-            quint16 nCbUncomp = (quint8)header[6] | ((quint16)(quint8)header[7] << 8);
-
-            qint64 nPayloadOffset = nOffset + nCFDataHeaderSize + nDataReservedSize;
-
-            if ((nCbData == 0) || (nCbUncomp > 32768) || ((qint64)nCbData > nStreamSize - nPayloadOffset) ||
-                ((qint64)nCbUncomp > nFolderUncompressed - nDeclaredBlockOutput)) {
-                bResult = false;
-                break;
-            }
-
-            if (!pState->pDeviceInput->seek(pState->nInputOffset + nPayloadOffset)) {
-                bResult = false;
-                break;
-            }
-            QByteArray baPayload = pState->pDeviceInput->read(nCbData);
-
-            if (baPayload.size() != nCbData) {
-                bResult = false;
-                break;
-            }
-
-            baCompressedFolder.append(baPayload);
-            nDeclaredBlockOutput += nCbUncomp;
-            nOffset = nPayloadOffset + nCbData;
-        }
-
-        bResult = bResult && XBinary::isPdStructNotCanceled(pPdStruct) && (nOffset == nStreamSize) &&
-                  (nDeclaredBlockOutput == nFolderUncompressed);
-
         if (bResult && (nFolderUncompressed == 0)) {
-            bResult = (nUncompressedSize == 0) && (nSubstreamOffset == 0) &&
-                      decWriteAll(pState->pDeviceOutput, nullptr, 0, pPdStruct);
+            bResult = (nUncompressedSize == 0) && (nSubstreamOffset == 0) && decWriteAll(pState->pDeviceOutput, nullptr, 0, pPdStruct);
             pState->nCountOutput = 0;
         } else if (bResult) {
-            QByteArray baFolderData;
-            bResult = XLZXDecoder::decompressCABFolder(baCompressedFolder, &baFolderData, nFolderUncompressed, nWindowBits, pPdStruct);
+            XLZXDecoder::CAB_CURSOR cursor = {};
+            bResult = XLZXDecoder::initCABCursor(&cursor, pState->pDeviceInput, pState->nInputOffset, nStreamSize, (qint32)nDataReservedSize,
+                                                 nFolderUncompressed, nWindowBits);
 
-            if (bResult && (baFolderData.size() == nFolderUncompressed)) {
-                const char *pOutput = (nUncompressedSize > 0) ? (baFolderData.constData() + nSubstreamOffset) : nullptr;
-                bResult = decWriteAll(pState->pDeviceOutput, pOutput, nUncompressedSize, pPdStruct);
-                pState->nCountOutput = bResult ? nUncompressedSize : 0;
-            } else {
-                bResult = false;
+            if (bResult) {
+                bResult = XLZXDecoder::readCABCursor(&cursor, nullptr, nSubstreamOffset, pPdStruct) &&
+                          XLZXDecoder::readCABCursor(&cursor, pState->pDeviceOutput, nUncompressedSize, pPdStruct);
             }
+
+            XLZXDecoder::freeCABCursor(&cursor);
+            pState->nCountOutput = bResult ? nUncompressedSize : 0;
         }
     } else if (compressMethod == XBinary::HANDLE_METHOD_ZSTD) {
         bResult = XZstdDecoder::decompress(pState, pPdStruct);
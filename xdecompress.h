@@ -67,7 +67,11 @@ public:
 private:
     void clearSolidCache();
     bool decompressRarSolid(XBinary::DATAPROCESS_STATE *pState, XBinary::PDSTRUCT *pPdStruct);
+    bool isSolidStreamable(XBinary::DATAPROCESS_STATE *pState);
+    bool decompressSolidStream(XBinary::DATAPROCESS_STATE *pState, const QString &sCacheKey, XBinary::PDSTRUCT *pPdStruct);
     QMap<QString, QIODevice *> m_mapSolidCache;
+    XLZMADecoder::STREAM_CURSOR m_solidCursor;
+    QString m_sSolidCursorKey;
     QString m_sCurrentArchiveMD5;
     rar_Unpack *m_pRarUnpacker;
     qint32 m_nRarSolidIndex;
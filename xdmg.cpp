@@ -22,7 +22,12 @@
 #include "xdmg.h"
 #include <QBuffer>
 #include <QRegularExpression>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
 #include <zlib.h>
+#include "lzfse.h"
 
 XBinary::XCONVERT _TABLE_XDMG_STRUCTID[] = {
     {XDMG::STRUCTID_UNKNOWN, "Unknown", QObject::tr("Unknown")},
@@ -31,6 +36,224 @@ XBinary::XCONVERT _TABLE_XDMG_STRUCTID[] = {
     {XDMG::STRUCTID_STRIPE, "STRIPE", QString("Stripe")},
 };
 
+namespace {
+
+const qint64 DMG_SECTOR_SIZE = 512;
+const qint64 DMG_MAX_STRIPE_SIZE = 0x10000000;  // Sanity limit for a single decoded stripe
+const qint64 DMG_BATCH_SIZE = 0x4000000;        // Decoded bytes held in memory per parallel batch
+
+bool dmgIsCompressedStripe(quint32 nType)
+{
+    return (nType == XDMG::DMG_STRIPE_ADC) || (nType == XDMG::DMG_STRIPE_DEFLATE) || (nType == XDMG::DMG_STRIPE_BZ) || (nType == XDMG::DMG_STRIPE_LZFSE) ||
+           (nType == XDMG::DMG_STRIPE_LZMA);
+}
+
+// Apple Data Compression: literal runs plus 2- and 3-byte back-references
+bool dmgDecodeADC(const QByteArray &baInput, QByteArray *pbaOutput)
+{
+    const quint8 *pIn = (const quint8 *)baInput.constData();
+    quint8 *pOut = (quint8 *)pbaOutput->data();
+    qint32 nInSize = baInput.size();
+    qint32 nOutSize = pbaOutput->size();
+    qint32 nInPos = 0;
+    qint32 nOutPos = 0;
+
+    while ((nInPos < nInSize) && (nOutPos < nOutSize)) {
+        quint8 nCode = pIn[nInPos++];
+
+        if (nCode & 0x80) {
+            qint32 nLength = (nCode & 0x7F) + 1;
+
+            if ((nInPos + nLength > nInSize) || (nOutPos + nLength > nOutSize)) {
+                return false;
+            }
+
+            memcpy(pOut + nOutPos, pIn + nInPos, nLength);
+            nInPos += nLength;
+            nOutPos += nLength;
+        } else {
+            qint32 nLength = 0;
+            qint32 nDistance = 0;
+
+            if (nCode & 0x40) {
+                if (nInPos + 2 > nInSize) {
+                    return false;
+                }
+
+                nLength = (nCode & 0x3F) + 4;
+                nDistance = ((qint32)pIn[nInPos] << 8) | pIn[nInPos + 1];
+                nInPos += 2;
+            } else {
+                if (nInPos + 1 > nInSize) {
+                    return false;
+                }
+
+                nLength = ((nCode >> 2) & 0x0F) + 3;
+                nDistance = ((qint32)(nCode & 0x03) << 8) | pIn[nInPos];
+                nInPos += 1;
+            }
+
+            qint32 nSource = nOutPos - nDistance - 1;
+
+            if ((nSource < 0) || (nOutPos + nLength > nOutSize)) {
+                return false;
+            }
+
+            // Byte by byte: the source may overlap the bytes being written
+            for (qint32 i = 0; i < nLength; i++) {
+                pOut[nOutPos + i] = pOut[nSource + i];
+            }
+
+            nOutPos += nLength;
+        }
+    }
+
+    return (nOutPos == nOutSize);
+}
+
+bool dmgDecodeZlib(const QByteArray &baInput, QByteArray *pbaOutput)
+{
+    bool bResult = false;
+
+    z_stream strm = {};
+    strm.next_in = (Bytef *)baInput.constData();
+    strm.avail_in = baInput.size();
+    strm.next_out = (Bytef *)pbaOutput->data();
+    strm.avail_out = pbaOutput->size();
+
+    if (inflateInit(&strm) == Z_OK) {
+        qint32 nRet = inflate(&strm, Z_FINISH);
+        bResult = (nRet == Z_STREAM_END) && (strm.avail_out == 0);
+
+        inflateEnd(&strm);
+    }
+
+    return bResult;
+}
+
+bool dmgDecodeLZFSE(const QByteArray &baInput, QByteArray *pbaOutput)
+{
+    size_t nSize = lzfse_decode_buffer((uint8_t *)pbaOutput->data(), pbaOutput->size(), (const uint8_t *)baInput.constData(), baInput.size(), nullptr);
+
+    return (nSize == (size_t)pbaOutput->size());
+}
+
+// BZ stripes are bzip2 streams, LZMA stripes are the xz container written by libcompression
+bool dmgDecodeWithState(quint32 nType, const QByteArray &baInput, QByteArray *pbaOutput)
+{
+    bool bResult = false;
+
+    qint32 nExpectedSize = pbaOutput->size();
+
+    QBuffer bufferInput;
+    bufferInput.setData(baInput);
+
+    QByteArray baDecoded;
+    QBuffer bufferOutput(&baDecoded);
+
+    if (bufferInput.open(QIODevice::ReadOnly) && bufferOutput.open(QIODevice::WriteOnly)) {
+        XBinary::HANDLE_METHOD method = (nType == XDMG::DMG_STRIPE_BZ) ? XBinary::HANDLE_METHOD_BZIP2 : XBinary::HANDLE_METHOD_XZ;
+
+        XBinary::DATAPROCESS_STATE state = {};
+        state.mapProperties.insert(XBinary::FPART_PROP_HANDLEMETHOD, method);
+        state.mapProperties.insert(XBinary::FPART_PROP_UNCOMPRESSEDSIZE, nExpectedSize);
+        state.pDeviceInput = &bufferInput;
+        state.pDeviceOutput = &bufferOutput;
+        state.nInputOffset = 0;
+        state.nInputLimit = baInput.size();
+        state.nProcessedOffset = 0;
+        state.nProcessedLimit = nExpectedSize;
+
+        if (method == XBinary::HANDLE_METHOD_BZIP2) {
+            bResult = XBZip2Decoder::decompress(&state);
+        } else {
+            bResult = XLZMADecoder::decompressXZ(&state);
+        }
+
+        bufferOutput.close();
+        bufferInput.close();
+    }
+
+    if (bResult && (baDecoded.size() == nExpectedSize)) {
+        *pbaOutput = baDecoded;
+    } else {
+        bResult = false;
+    }
+
+    return bResult;
+}
+
+// Decodes one compressed stripe into a buffer already sized to its sector count
+bool dmgDecodeStripe(quint32 nType, const QByteArray &baInput, QByteArray *pbaOutput)
+{
+    bool bResult = false;
+
+    switch (nType) {
+        case XDMG::DMG_STRIPE_ADC:
+            bResult = dmgDecodeADC(baInput, pbaOutput);
+            break;
+
+        case XDMG::DMG_STRIPE_DEFLATE:
+            bResult = dmgDecodeZlib(baInput, pbaOutput);
+            break;
+
+        case XDMG::DMG_STRIPE_LZFSE:
+            bResult = dmgDecodeLZFSE(baInput, pbaOutput);
+            break;
+
+        case XDMG::DMG_STRIPE_BZ:
+        case XDMG::DMG_STRIPE_LZMA:
+            bResult = dmgDecodeWithState(nType, baInput, pbaOutput);
+            break;
+
+        default:
+            break;
+    }
+
+    return bResult;
+}
+
+class DMGStripeRunnable : public QRunnable {
+public:
+    DMGStripeRunnable(quint32 nType, qint64 nExpectedSize) : m_nType(nType), m_bSuccess(false)
+    {
+        setAutoDelete(false);
+
+        if ((nExpectedSize > 0) && (nExpectedSize <= DMG_MAX_STRIPE_SIZE)) {
+            m_baOutput.resize((qint32)nExpectedSize);
+        }
+    }
+
+    QByteArray *getInput()
+    {
+        return &m_baInput;
+    }
+
+    const QByteArray &getOutput() const
+    {
+        return m_baOutput;
+    }
+
+    bool isSuccess() const
+    {
+        return m_bSuccess;
+    }
+
+    void run() override
+    {
+        m_bSuccess = !m_baInput.isEmpty() && !m_baOutput.isEmpty() && dmgDecodeStripe(m_nType, m_baInput, &m_baOutput);
+        m_baInput.clear();
+    }
+
+private:
+    quint32 m_nType;
+    QByteArray m_baInput;
+    QByteArray m_baOutput;
+    bool m_bSuccess;
+};
+
+}  // namespace
+
 XDMG::XDMG(QIODevice *pDevice) : XArchive(pDevice)
 {
 }
@@ -456,16 +679,119 @@ bool XDMG::unpackCurrent(UNPACK_STATE *pState, QIODevice *pDevice, PDSTRUCT *pPd
 
         if ((pState->nCurrentIndex >= 0) && (pState->nCurrentIndex < pContext->listStripes.size())) {
             QList<BLOCK_DATA> listCurrentStripes = pContext->listStripes.at(pState->nCurrentIndex);
+            qint32 nNumberOfStripes = listCurrentStripes.size();
+            qint32 nNumberOfThreads = QThread::idealThreadCount();
+
+            qint64 nTotalSize = 0;
+
+            if (pState->nCurrentIndex < pContext->listMishBlocks.size()) {
+                nTotalSize = pContext->listMishBlocks.at(pState->nCurrentIndex).nSectorCount * DMG_SECTOR_SIZE;
+            }
+
+            // Stripes carry their own sector offsets: random-access outputs are written positioned,
+            // sequential outputs are zero-filled up to the start of each stripe
+            bool bSequential = pDevice->isSequential();
+            qint64 nBasePos = bSequential ? 0 : pDevice->pos();
+            qint64 nOutputPos = 0;
+            qint64 nOutputEnd = 0;
+
+            QThreadPool threadPool;
+            threadPool.setMaxThreadCount(nNumberOfThreads);
+
             bResult = true;
 
-            for (qint32 i = 0; (i < listCurrentStripes.size()) && bResult && isPdStructNotCanceled(pPdStruct); i++) {
-                const BLOCK_DATA stripe = listCurrentStripes.at(i);
+            qint32 i = 0;
 
-                if ((stripe.nType == DMG_STRIPE_END) || (stripe.nType == DMG_STRIPE_SKIP)) {
-                    continue;
+            while ((i < nNumberOfStripes) && bResult && isPdStructNotCanceled(pPdStruct)) {
+                // 1. Read a batch of stripes and decode the compressed ones in parallel
+                QList<BLOCK_DATA> listBatch;
+                QList<DMGStripeRunnable *> listTasks;
+                qint32 nNumberOfTasks = 0;
+                qint64 nBatchSize = 0;
+
+                while ((i < nNumberOfStripes) && (nNumberOfTasks < nNumberOfThreads) && (nBatchSize < DMG_BATCH_SIZE)) {
+                    const BLOCK_DATA &stripe = listCurrentStripes.at(i);
+                    DMGStripeRunnable *pTask = nullptr;
+
+                    if (dmgIsCompressedStripe(stripe.nType)) {
+                        qint64 nExpectedSize = stripe.nSectorCount * DMG_SECTOR_SIZE;
+
+                        pTask = new DMGStripeRunnable(stripe.nType, nExpectedSize);
+
+                        if ((stripe.nDataLength > 0) && (stripe.nDataLength <= DMG_MAX_STRIPE_SIZE)) {
+                            *(pTask->getInput()) = read_array(pContext->nDataForkOffset + stripe.nDataOffset, stripe.nDataLength);
+                        }
+
+                        nNumberOfTasks++;
+                        nBatchSize += nExpectedSize;
+                    }
+
+                    listBatch.append(stripe);
+                    listTasks.append(pTask);
+                    i++;
                 }
 
-                bResult = _decompressStripe(stripe, pContext->nDataForkOffset, pDevice, pPdStruct);
+                if (nNumberOfTasks == 1) {
+                    for (qint32 j = 0; j < listTasks.count(); j++) {
+                        if (listTasks.at(j)) {
+                            listTasks.at(j)->run();
+                        }
+                    }
+                } else if (nNumberOfTasks > 1) {
+                    for (qint32 j = 0; j < listTasks.count(); j++) {
+                        if (listTasks.at(j)) {
+                            threadPool.start(listTasks.at(j));
+                        }
+                    }
+
+                    threadPool.waitForDone();
+                }
+
+                // 2. Write the batch at the stripe offsets
+                for (qint32 j = 0; j < listBatch.count(); j++) {
+                    const BLOCK_DATA &stripe = listBatch.at(j);
+                    DMGStripeRunnable *pTask = listTasks.at(j);
+
+                    if (bResult && (stripe.nType != DMG_STRIPE_END) && (stripe.nType != DMG_STRIPE_SKIP) && (stripe.nType != DMG_STRIPE_EMPTY)) {
+                        qint64 nTargetPos = (qint64)stripe.nStartSector * DMG_SECTOR_SIZE;
+
+                        if (nTargetPos != nOutputPos) {
+                            if (!bSequential) {
+                                bResult = pDevice->seek(nBasePos + nTargetPos);
+                            } else if (nTargetPos > nOutputPos) {
+                                bResult = _writeZeroes(pDevice, nTargetPos - nOutputPos);
+                            } else {
+                                bResult = false;  // Sequential output cannot go back
+                            }
+
+                            nOutputPos = nTargetPos;
+                        }
+
+                        if (bResult) {
+                            if (pTask) {
+                                bResult = pTask->isSuccess() && (pDevice->write(pTask->getOutput()) == pTask->getOutput().size());
+                            } else {
+                                bResult = _decompressStripe(stripe, pContext->nDataForkOffset, pDevice, pPdStruct);
+                            }
+
+                            nOutputPos += stripe.nSectorCount * DMG_SECTOR_SIZE;
+                            nOutputEnd = (std::max)(nOutputEnd, nOutputPos);
+                        }
+                    }
+
+                    delete pTask;
+                }
+            }
+
+            // Trailing empty stripes still belong to the partition image
+            if (bResult && (nOutputEnd < nTotalSize) && isPdStructNotCanceled(pPdStruct)) {
+                if (!bSequential) {
+                    bResult = pDevice->seek(nBasePos + nOutputEnd);
+                }
+
+                if (bResult) {
+                    bResult = _writeZeroes(pDevice, nTotalSize - nOutputEnd);
+                }
             }
         }
     }
@@ -497,6 +823,8 @@ bool XDMG::finishUnpack(UNPACK_STATE *pState, PDSTRUCT *pPdStruct)
 {
     Q_UNUSED(pPdStruct)
 
+    _freeDecompressSession(pState);
+
     bool bResult = false;
 
     if (pState && pState->pContext) {
@@ -656,8 +984,7 @@ bool XDMG::_decompressStripe(const BLOCK_DATA &stripe, qint64 nDataForkOffset, Q
     Q_UNUSED(pPdStruct)
 
     bool bResult = true;
-    qint64 nSectorSize = 512;  // DMG sector size
-    qint64 nExpectedSize = stripe.nSectorCount * nSectorSize;
+    qint64 nExpectedSize = stripe.nSectorCount * DMG_SECTOR_SIZE;
 
     switch (stripe.nType) {
         case DMG_STRIPE_EMPTY:
@@ -684,64 +1011,21 @@ bool XDMG::_decompressStripe(const BLOCK_DATA &stripe, qint64 nDataForkOffset, Q
             }
             break;
 
+        case DMG_STRIPE_ADC:
         case DMG_STRIPE_DEFLATE:
-            // ZLIB compressed data
-            if (stripe.nDataLength > 0) {
-                QByteArray baCompressed = read_array(nDataForkOffset + stripe.nDataOffset, stripe.nDataLength);
-                if (!baCompressed.isEmpty()) {
-                    z_stream strm = {};
-                    strm.next_in = (Bytef *)baCompressed.data();
-                    strm.avail_in = baCompressed.size();
-
-                    if (inflateInit(&strm) == Z_OK) {
-                        QByteArray baBuffer(16384, 0);  // 16KB buffer
-                        qint64 nTotalWritten = 0;
-
-                        while (strm.avail_in > 0 && nTotalWritten < nExpectedSize) {
-                            strm.next_out = (Bytef *)baBuffer.data();
-                            strm.avail_out = baBuffer.size();
-
-                            qint32 nRet = inflate(&strm, Z_NO_FLUSH);
-                            if (nRet != Z_OK && nRet != Z_STREAM_END) {
-                                bResult = false;
-                                break;
-                            }
-
-                            qint64 nHave = baBuffer.size() - strm.avail_out;
-                            if (nHave > 0) {
-                                qint64 nWritten = pDevice->write(baBuffer.constData(), nHave);
-                                if (nWritten != nHave) {
-                                    bResult = false;
-                                    break;
-                                }
-                                nTotalWritten += nWritten;
-                            }
-
-                            if (nRet == Z_STREAM_END) {
-                                break;
-                            }
-                        }
-
-                        inflateEnd(&strm);
-                    } else {
-                        bResult = false;
-                    }
-                } else {
-                    bResult = false;
-                }
-            }
-            break;
-
         case DMG_STRIPE_BZ:
-            // BZ2 compressed - not implemented yet
-            // For now, write zeroes as placeholder
-            bResult = _writeZeroes(pDevice, nExpectedSize);
-            break;
-
-        case DMG_STRIPE_ADC:
-            // ADC compressed - not implemented yet
-            // For now, write zeroes as placeholder
-            bResult = _writeZeroes(pDevice, nExpectedSize);
+        case DMG_STRIPE_LZFSE:
+        case DMG_STRIPE_LZMA:
+            // Compressed data, decoded in one piece (unpackCurrent runs these on a thread pool)
+            if ((stripe.nDataLength > 0) && (stripe.nDataLength <= DMG_MAX_STRIPE_SIZE)) {
+                DMGStripeRunnable task(stripe.nType, nExpectedSize);
+                *(task.getInput()) = read_array(nDataForkOffset + stripe.nDataOffset, stripe.nDataLength);
+                task.run();
+
+                bResult = task.isSuccess() && (pDevice->write(task.getOutput()) == task.getOutput().size());
+            } else {
+                bResult = false;
+            }
             break;
 
         case DMG_STRIPE_SKIP:
@@ -42,6 +42,8 @@ public:
         DMG_STRIPE_ADC = 0x80000004,
         DMG_STRIPE_DEFLATE = 0x80000005,
         DMG_STRIPE_BZ = 0x80000006,
+        DMG_STRIPE_LZFSE = 0x80000007,
+        DMG_STRIPE_LZMA = 0x80000008,
         DMG_STRIPE_SKIP = 0x7FFFFFFE,
         DMG_STRIPE_END = 0xFFFFFFFF
     };
@@ -30,11 +30,10 @@ XJAR::XJAR(QIODevice *pDevice) : XZip(pDevice)
 
 bool XJAR::isValid(PDSTRUCT *pPdStruct)
 {
-    XZip xzip(getDevice());
-
-    if (xzip.isValid()) {
-        qint64 nECDOffset = xzip.findECDOffset(pPdStruct);
-        return xzip.isJAR(nECDOffset, pPdStruct);
+    // Reuse this instance so the central directory is parsed only once
+    if (XZip::isValid(pPdStruct)) {
+        qint64 nECDOffset = findECDOffset(pPdStruct);
+        return isJAR(nECDOffset, pPdStruct);
     }
 
     return false;
@@ -667,6 +667,8 @@ bool XLzip::finishUnpack(UNPACK_STATE *pState, PDSTRUCT *pPdStruct)
 {
     Q_UNUSED(pPdStruct)
 
+    _freeDecompressSession(pState);
+
     bool bResult = false;
 
     if (pState && pState->pContext) {
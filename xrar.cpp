@@ -2191,6 +2191,8 @@ bool XRar::finishUnpack(XBinary::UNPACK_STATE *pUnpackState, PDSTRUCT *pPdStruct
 {
     Q_UNUSED(pPdStruct)
 
+    _freeDecompressSession(pUnpackState);
+
     if (!pUnpackState) {
         return false;
     }
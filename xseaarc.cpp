@@ -339,9 +339,10 @@ bool XSEAARC::moveToNext(UNPACK_STATE *pState, PDSTRUCT *pPdStruct)
 
 bool XSEAARC::finishUnpack(UNPACK_STATE *pState, PDSTRUCT *pPdStruct)
 {
-    Q_UNUSED(pState)
     Q_UNUSED(pPdStruct)
 
+    _freeDecompressSession(pState);
+
     return true;
 }
 
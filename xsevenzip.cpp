@@ -2905,6 +2905,8 @@ bool XSevenZip::finishUnpack(UNPACK_STATE *pState, PDSTRUCT *pPdStruct)
 {
     Q_UNUSED(pPdStruct)
 
+    _freeDecompressSession(pState);
+
     bool bResult = true;
 
     if (pState && pState->pContext) {
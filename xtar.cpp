@@ -501,120 +501,129 @@ XBinary::ARCHIVERECORD XTAR::infoCurrent(UNPACK_STATE *pState, PDSTRUCT *pPdStru
 
     if (pState && (pState->nCurrentIndex < pState->nNumberOfRecords)) {
         posix_header header = read_posix_header(pState->nCurrentOffset);
-        qint64 nFileSize = _getSize(header);
-
-        result.nStreamOffset = pState->nCurrentOffset + 512;
-        result.nStreamSize = nFileSize;
-        // result.nDecompressedOffset = 0;
-        // result.nDecompressedSize = nFileSize;
-
-        // Extract file name
-        QString sFileName = QString::fromUtf8(header.name, qMin((qint32)sizeof(header.name), (qint32)100));
-        qint32 nNullPos = sFileName.indexOf(QChar('\0'));
-        if (nNullPos != -1) {
-            sFileName = sFileName.left(nNullPos);
-        }
+        result = _getArchiveRecord(header, pState->nCurrentOffset);
+    }
 
-        result.mapProperties.insert(XBinary::FPART_PROP_ORIGINALNAME, sFileName);
-        result.mapProperties.insert(XBinary::FPART_PROP_HANDLEMETHOD, XBinary::HANDLE_METHOD_STORE);
+    return result;
+}
 
-        // Parse mode (octal)
-        QString sMode = QString(QByteArray(header.mode, 8)).trimmed();
-        quint32 nMode = sMode.toUInt(nullptr, 8);
-        result.mapProperties.insert(XBinary::FPART_PROP_FILEMODE, nMode);
+XBinary::ARCHIVERECORD XTAR::_getArchiveRecord(const posix_header &header, qint64 nHeaderOffset)
+{
+    XBinary::ARCHIVERECORD result = {};
 
-        // Parse uid/gid (octal)
-        QString sUid = QString(QByteArray(header.uid, 8)).trimmed();
-        quint32 nUid = sUid.toUInt(nullptr, 8);
-        result.mapProperties.insert(XBinary::FPART_PROP_UID, nUid);
+    qint64 nFileSize = _getSize(header);
 
-        QString sGid = QString(QByteArray(header.gid, 8)).trimmed();
-        quint32 nGid = sGid.toUInt(nullptr, 8);
-        result.mapProperties.insert(XBinary::FPART_PROP_GID, nGid);
+    result.nStreamOffset = nHeaderOffset + 512;
+    result.nStreamSize = nFileSize;
+    // result.nDecompressedOffset = 0;
+    // result.nDecompressedSize = nFileSize;
 
-        // Size already handled
-        result.mapProperties.insert(XBinary::FPART_PROP_UNCOMPRESSEDSIZE, nFileSize);
+    // Extract file name
+    QString sFileName = QString::fromUtf8(header.name, qMin((qint32)sizeof(header.name), (qint32)100));
+    qint32 nNullPos = sFileName.indexOf(QChar('\0'));
+    if (nNullPos != -1) {
+        sFileName = sFileName.left(nNullPos);
+    }
 
-        // Parse mtime (octal)
-        QString sMTime = QString(QByteArray(header.mtime, 12)).trimmed();
-        qint64 nMTime = sMTime.toLongLong(nullptr, 8);
-#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
-        QDateTime dateTime = QDateTime::fromSecsSinceEpoch(nMTime);
-#else
-        QDateTime dateTime = QDateTime::fromMSecsSinceEpoch(nMTime * 1000);
-#endif
-        result.mapProperties.insert(XBinary::FPART_PROP_DATETIME, dateTime);
-
-        // Parse checksum (octal)
-        QString sChecksum = QString(QByteArray(header.chksum, 8)).trimmed();
-        quint32 nChecksum = sChecksum.toUInt(nullptr, 8);
-        result.mapProperties.insert(XBinary::FPART_PROP_RESULTCRC, nChecksum);
-        result.mapProperties.insert(XBinary::FPART_PROP_CRC_TYPE, XBinary::CRC_TYPE_UNKNOWN);
-
-        // Type flag
-        char cTypeFlag = header.typeflag[0];
-        QString sTypeFlag;
-        switch (cTypeFlag) {
-            case '0': sTypeFlag = "Regular file"; break;
-            case '1': sTypeFlag = "Hard link"; break;
-            case '2': sTypeFlag = "Symbolic link"; break;
-            case '3': sTypeFlag = "Character device"; break;
-            case '4': sTypeFlag = "Block device"; break;
-            case '5': sTypeFlag = "Directory"; break;
-            case '6': sTypeFlag = "FIFO"; break;
-            case '7': sTypeFlag = "Contiguous file"; break;
-            default: sTypeFlag = QString("Unknown (%1)").arg(cTypeFlag); break;
-        }
-        result.mapProperties.insert(XBinary::FPART_PROP_TYPE, sTypeFlag);
+    result.mapProperties.insert(XBinary::FPART_PROP_ORIGINALNAME, sFileName);
+    result.mapProperties.insert(XBinary::FPART_PROP_HANDLEMETHOD, XBinary::HANDLE_METHOD_STORE);
 
-        // Link name
-        QString sLinkName = QString::fromUtf8(header.linkname, qMin((qint32)sizeof(header.linkname), (qint32)100));
-        nNullPos = sLinkName.indexOf(QChar('\0'));
-        if (nNullPos != -1) {
-            sLinkName = sLinkName.left(nNullPos);
-        }
-        if (!sLinkName.isEmpty()) {
-            result.mapProperties.insert(XBinary::FPART_PROP_LINKNAME, sLinkName);
-        }
+    // Parse mode (octal)
+    QString sMode = QString(QByteArray(header.mode, 8)).trimmed();
+    quint32 nMode = sMode.toUInt(nullptr, 8);
+    result.mapProperties.insert(XBinary::FPART_PROP_FILEMODE, nMode);
 
-        // Uname/Gname
-        QString sUname = QString::fromUtf8(header.uname, qMin((qint32)sizeof(header.uname), (qint32)32));
-        nNullPos = sUname.indexOf(QChar('\0'));
-        if (nNullPos != -1) {
-            sUname = sUname.left(nNullPos);
-        }
-        if (!sUname.isEmpty()) {
-            result.mapProperties.insert(XBinary::FPART_PROP_USERNAME, sUname);
-        }
+    // Parse uid/gid (octal)
+    QString sUid = QString(QByteArray(header.uid, 8)).trimmed();
+    quint32 nUid = sUid.toUInt(nullptr, 8);
+    result.mapProperties.insert(XBinary::FPART_PROP_UID, nUid);
 
-        QString sGname = QString::fromUtf8(header.gname, qMin((qint32)sizeof(header.gname), (qint32)32));
-        nNullPos = sGname.indexOf(QChar('\0'));
-        if (nNullPos != -1) {
-            sGname = sGname.left(nNullPos);
-        }
-        if (!sGname.isEmpty()) {
-            result.mapProperties.insert(XBinary::FPART_PROP_GROUPNAME, sGname);
-        }
+    QString sGid = QString(QByteArray(header.gid, 8)).trimmed();
+    quint32 nGid = sGid.toUInt(nullptr, 8);
+    result.mapProperties.insert(XBinary::FPART_PROP_GID, nGid);
 
-        // Dev major/minor (for devices)
-        if (cTypeFlag == '3' || cTypeFlag == '4') {
-            QString sDevMajor = QString(QByteArray(header.devmajor, 8)).trimmed();
-            quint32 nDevMajor = sDevMajor.toUInt(nullptr, 8);
-            QString sDevMinor = QString(QByteArray(header.devminor, 8)).trimmed();
-            quint32 nDevMinor = sDevMinor.toUInt(nullptr, 8);
-            QString sDevVersion = QString("%1,%2").arg(nDevMajor).arg(nDevMinor);
-            result.mapProperties.insert(XBinary::FPART_PROP_DEVVERSION, sDevVersion);
-        }
+    // Size already handled
+    result.mapProperties.insert(XBinary::FPART_PROP_UNCOMPRESSEDSIZE, nFileSize);
 
-        // Prefix (for long names)
-        QString sPrefix = QString::fromUtf8(header.prefix, qMin((qint32)sizeof(header.prefix), (qint32)155));
-        nNullPos = sPrefix.indexOf(QChar('\0'));
-        if (nNullPos != -1) {
-            sPrefix = sPrefix.left(nNullPos);
-        }
-        if (!sPrefix.isEmpty()) {
-            result.mapProperties.insert(XBinary::FPART_PROP_PREFIX, sPrefix);
-        }
+    // Parse mtime (octal)
+    QString sMTime = QString(QByteArray(header.mtime, 12)).trimmed();
+    qint64 nMTime = sMTime.toLongLong(nullptr, 8);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+    QDateTime dateTime = QDateTime::fromSecsSinceEpoch(nMTime);
+#else
+    QDateTime dateTime = QDateTime::fromMSecsSinceEpoch(nMTime * 1000);
+#endif
+    result.mapProperties.insert(XBinary::FPART_PROP_DATETIME, dateTime);
+
+    // Parse checksum (octal)
+    QString sChecksum = QString(QByteArray(header.chksum, 8)).trimmed();
+    quint32 nChecksum = sChecksum.toUInt(nullptr, 8);
+    result.mapProperties.insert(XBinary::FPART_PROP_RESULTCRC, nChecksum);
+    result.mapProperties.insert(XBinary::FPART_PROP_CRC_TYPE, XBinary::CRC_TYPE_UNKNOWN);
+
+    // Type flag
+    char cTypeFlag = header.typeflag[0];
+    QString sTypeFlag;
+    switch (cTypeFlag) {
+        case '0': sTypeFlag = "Regular file"; break;
+        case '1': sTypeFlag = "Hard link"; break;
+        case '2': sTypeFlag = "Symbolic link"; break;
+        case '3': sTypeFlag = "Character device"; break;
+        case '4': sTypeFlag = "Block device"; break;
+        case '5': sTypeFlag = "Directory"; break;
+        case '6': sTypeFlag = "FIFO"; break;
+        case '7': sTypeFlag = "Contiguous file"; break;
+        default: sTypeFlag = QString("Unknown (%1)").arg(cTypeFlag); break;
+    }
+    result.mapProperties.insert(XBinary::FPART_PROP_TYPE, sTypeFlag);
+
+    // Link name
+    QString sLinkName = QString::fromUtf8(header.linkname, qMin((qint32)sizeof(header.linkname), (qint32)100));
+    nNullPos = sLinkName.indexOf(QChar('\0'));
+    if (nNullPos != -1) {
+        sLinkName = sLinkName.left(nNullPos);
+    }
+    if (!sLinkName.isEmpty()) {
+        result.mapProperties.insert(XBinary::FPART_PROP_LINKNAME, sLinkName);
+    }
+
+    // Uname/Gname
+    QString sUname = QString::fromUtf8(header.uname, qMin((qint32)sizeof(header.uname), (qint32)32));
+    nNullPos = sUname.indexOf(QChar('\0'));
+    if (nNullPos != -1) {
+        sUname = sUname.left(nNullPos);
+    }
+    if (!sUname.isEmpty()) {
+        result.mapProperties.insert(XBinary::FPART_PROP_USERNAME, sUname);
+    }
+
+    QString sGname = QString::fromUtf8(header.gname, qMin((qint32)sizeof(header.gname), (qint32)32));
+    nNullPos = sGname.indexOf(QChar('\0'));
+    if (nNullPos != -1) {
+        sGname = sGname.left(nNullPos);
+    }
+    if (!sGname.isEmpty()) {
+        result.mapProperties.insert(XBinary::FPART_PROP_GROUPNAME, sGname);
+    }
+
+    // Dev major/minor (for devices)
+    if (cTypeFlag == '3' || cTypeFlag == '4') {
+        QString sDevMajor = QString(QByteArray(header.devmajor, 8)).trimmed();
+        quint32 nDevMajor = sDevMajor.toUInt(nullptr, 8);
+        QString sDevMinor = QString(QByteArray(header.devminor, 8)).trimmed();
+        quint32 nDevMinor = sDevMinor.toUInt(nullptr, 8);
+        QString sDevVersion = QString("%1,%2").arg(nDevMajor).arg(nDevMinor);
+        result.mapProperties.insert(XBinary::FPART_PROP_DEVVERSION, sDevVersion);
+    }
+
+    // Prefix (for long names)
+    QString sPrefix = QString::fromUtf8(header.prefix, qMin((qint32)sizeof(header.prefix), (qint32)155));
+    nNullPos = sPrefix.indexOf(QChar('\0'));
+    if (nNullPos != -1) {
+        sPrefix = sPrefix.left(nNullPos);
+    }
+    if (!sPrefix.isEmpty()) {
+        result.mapProperties.insert(XBinary::FPART_PROP_PREFIX, sPrefix);
     }
 
     return result;
@@ -27,6 +27,7 @@
 class XTAR : public XArchive {
     Q_OBJECT
 
+public:
 #pragma pack(push)
 #pragma pack(1)
     struct posix_header {   /* byte offset */
@@ -104,10 +105,13 @@ public:
     virtual bool addFolder(PACK_STATE *pState, const QString &sDirectoryPath, PDSTRUCT *pPdStruct = nullptr) override;
     virtual bool finishPack(PACK_STATE *pState, PDSTRUCT *pPdStruct = nullptr) override;
 
+protected:
+    qint64 _getSize(const posix_header &header);
+    ARCHIVERECORD _getArchiveRecord(const posix_header &header, qint64 nHeaderOffset);
+
 private:
     posix_header read_posix_header(qint64 nOffset);
     qint32 _getNumberOf_posix_headers(qint64 nOffset, PDSTRUCT *pPdStruct);
-    qint64 _getSize(const posix_header &header);
     static posix_header createHeader(const QString &sFileName, const QString &sBasePath, qint64 nFileSize, quint32 nMode, qint64 nMTime);
     static quint32 calculateChecksum(const posix_header &header);
     static void writeOctal(char *pDest, qint32 nSize, qint64 nValue);
@@ -31,6 +31,225 @@
 #include "xtar_zstd.h"
 
 #include <QBuffer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <algorithm>
+
+namespace {
+
+const qint64 XTAR_STREAM_RING_SIZE = 0x400000;
+
+class XTarStreamDevice;
+
+// Producer side of the ring: the decoder writes here on the worker thread
+class XTarStreamWriter : public QIODevice {
+public:
+    explicit XTarStreamWriter(XTarStreamDevice *pStream) : m_pStream(pStream)
+    {
+    }
+
+    bool isSequential() const override
+    {
+        return false;  // Decoders seek the output to 0 before writing
+    }
+
+protected:
+    qint64 readData(char *pData, qint64 nMaxSize) override
+    {
+        Q_UNUSED(pData)
+        Q_UNUSED(nMaxSize)
+
+        return -1;
+    }
+
+    qint64 writeData(const char *pData, qint64 nSize) override;
+
+private:
+    XTarStreamDevice *m_pStream;
+};
+
+class XTarStreamThread : public QThread {
+public:
+    XTarStreamThread(XTarStreamDevice *pStream, QIODevice *pDevice, qint64 nOffset, qint64 nSize, XBinary::HANDLE_METHOD handleMethod,
+                     XBinary::PDSTRUCT *pPdStruct)
+        : m_pStream(pStream), m_pDevice(pDevice), m_nOffset(nOffset), m_nSize(nSize), m_handleMethod(handleMethod), m_pPdStruct(pPdStruct)
+    {
+    }
+
+protected:
+    void run() override;
+
+private:
+    XTarStreamDevice *m_pStream;
+    QIODevice *m_pDevice;
+    qint64 m_nOffset;
+    qint64 m_nSize;
+    XBinary::HANDLE_METHOD m_handleMethod;
+    XBinary::PDSTRUCT *m_pPdStruct;
+};
+
+// Consumer side: a sequential device over the decoded outer stream, backed by a bounded ring
+class XTarStreamDevice : public QIODevice {
+public:
+    XTarStreamDevice(QIODevice *pDevice, qint64 nOffset, qint64 nSize, XBinary::HANDLE_METHOD handleMethod, XBinary::PDSTRUCT *pPdStruct)
+        : m_thread(this, pDevice, nOffset, nSize, handleMethod, pPdStruct), m_nHead(0), m_nCount(0), m_bFinished(false), m_bSuccess(false), m_bAborted(false)
+    {
+        m_baRing.resize(XTAR_STREAM_RING_SIZE);
+    }
+
+    ~XTarStreamDevice()
+    {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_bAborted = true;
+            m_condNotFull.wakeAll();
+            m_condNotEmpty.wakeAll();
+        }
+
+        m_thread.wait();
+    }
+
+    bool start()
+    {
+        if (!open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+            return false;
+        }
+
+        m_thread.start();
+
+        return true;
+    }
+
+    bool isSequential() const override
+    {
+        return true;
+    }
+
+    qint64 push(const char *pData, qint64 nSize)
+    {
+        qint64 nWritten = 0;
+        qint64 nRingSize = m_baRing.size();
+
+        QMutexLocker locker(&m_mutex);
+
+        while (nWritten < nSize) {
+            while ((m_nCount == nRingSize) && !m_bAborted) {
+                m_condNotFull.wait(&m_mutex);
+            }
+
+            if (m_bAborted) {
+                return -1;
+            }
+
+            qint64 nTail = (m_nHead + m_nCount) % nRingSize;
+            qint64 nChunk = (std::min)(nSize - nWritten, (std::min)(nRingSize - m_nCount, nRingSize - nTail));
+
+            memcpy(m_baRing.data() + nTail, pData + nWritten, nChunk);
+            m_nCount += nChunk;
+            nWritten += nChunk;
+
+            m_condNotEmpty.wakeAll();
+        }
+
+        return nWritten;
+    }
+
+    void finish(bool bSuccess)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_bFinished = true;
+        m_bSuccess = bSuccess;
+        m_condNotEmpty.wakeAll();
+    }
+
+protected:
+    qint64 readData(char *pData, qint64 nMaxSize) override
+    {
+        qint64 nRingSize = m_baRing.size();
+
+        QMutexLocker locker(&m_mutex);
+
+        while ((m_nCount == 0) && !m_bFinished && !m_bAborted) {
+            m_condNotEmpty.wait(&m_mutex);
+        }
+
+        if (m_nCount == 0) {
+            return (m_bFinished && m_bSuccess) ? 0 : -1;
+        }
+
+        qint64 nChunk = (std::min)(nMaxSize, (std::min)(m_nCount, nRingSize - m_nHead));
+
+        memcpy(pData, m_baRing.constData() + m_nHead, nChunk);
+        m_nHead = (m_nHead + nChunk) % nRingSize;
+        m_nCount -= nChunk;
+
+        m_condNotFull.wakeAll();
+
+        return nChunk;
+    }
+
+    qint64 writeData(const char *pData, qint64 nSize) override
+    {
+        Q_UNUSED(pData)
+        Q_UNUSED(nSize)
+
+        return -1;
+    }
+
+private:
+    XTarStreamThread m_thread;
+    QMutex m_mutex;
+    QWaitCondition m_condNotEmpty;
+    QWaitCondition m_condNotFull;
+    QByteArray m_baRing;
+    qint64 m_nHead;
+    qint64 m_nCount;
+    bool m_bFinished;
+    bool m_bSuccess;
+    bool m_bAborted;
+};
+
+qint64 XTarStreamWriter::writeData(const char *pData, qint64 nSize)
+{
+    return m_pStream->push(pData, nSize);
+}
+
+void XTarStreamThread::run()
+{
+    XBinary::PDSTRUCT pdStructEmpty = {};
+    XBinary::PDSTRUCT *pPdStruct = m_pPdStruct;
+
+    if (!pPdStruct) {
+        pdStructEmpty = XBinary::createPdStruct();
+        pPdStruct = &pdStructEmpty;
+    }
+
+    XTarStreamWriter writer(m_pStream);
+    bool bResult = false;
+
+    if (writer.open(QIODevice::WriteOnly | QIODevice::Unbuffered)) {
+        XBinary::DATAPROCESS_STATE state = {};
+        state.pDeviceInput = m_pDevice;
+        state.pDeviceOutput = &writer;
+        state.nInputOffset = m_nOffset;
+        state.nInputLimit = m_nSize;
+        state.nProcessedOffset = 0;
+        state.nProcessedLimit = -1;
+        state.mapProperties.insert(XBinary::FPART_PROP_HANDLEMETHOD, m_handleMethod);
+
+        XDecompress decompress;
+        bResult = decompress.multiDecompress(&state, pPdStruct);
+
+        writer.close();
+    }
+
+    m_pStream->finish(bResult);
+}
+
+}  // namespace
 
 XTARCOMPRESSED::XTARCOMPRESSED(QIODevice *pDevice) : XTAR(pDevice)
 {
@@ -40,6 +259,7 @@ XTARCOMPRESSED::XTARCOMPRESSED(QIODevice *pDevice) : XTAR(pDevice)
     m_nOuterStreamOffset = 0;
     m_nOuterStreamSize = 0;
     m_outerHandleMethod = HANDLE_METHOD_UNKNOWN;
+    m_bStreamingUnpack = false;
 }
 
 XTARCOMPRESSED::~XTARCOMPRESSED()
@@ -171,6 +391,33 @@ bool XTARCOMPRESSED::initUnpack(UNPACK_STATE *pState, const QMap<UNPACK_PROP, QV
 
     pState->pContext = nullptr;
 
+    if (m_bStreamingUnpack) {
+        // Records are discovered one header at a time, nNumberOfRecords runs one ahead of the walk
+        STREAM_CONTEXT *pContext = new STREAM_CONTEXT;
+        *pContext = {};
+
+        pState->pContext = pContext;
+        pState->nCurrentOffset = 0;
+        pState->nTotalSize = getSize();
+        pState->nCurrentIndex = 0;
+        pState->nNumberOfRecords = _streamReadHeader(pContext, 0) ? 1 : 0;
+
+        m_pOriginalDevice = getDevice();
+
+        // An archive that ends right away is empty, not broken
+        bool bResult = (pState->nNumberOfRecords > 0) || pContext->bEnd;
+
+        if (!bResult) {
+            delete pContext;
+            pState->pContext = nullptr;
+
+            delete m_pDecompressedData;
+            m_pDecompressedData = nullptr;
+        }
+
+        return bResult;
+    }
+
     // Temporarily point device at the decompressed TAR so XTAR::initUnpack can
     // scan and count records, then immediately restore the original device.
     // Subsequent per-entry calls (infoCurrent/moveToNext/unpackCurrent) each
@@ -196,6 +443,14 @@ XBinary::ARCHIVERECORD XTARCOMPRESSED::infoCurrent(UNPACK_STATE *pState, PDSTRUC
     if (!m_pDecompressedData) {
         return XBinary::ARCHIVERECORD{};
     }
+    if (m_bStreamingUnpack) {
+        if (!pState || !pState->pContext || (pState->nCurrentIndex >= pState->nNumberOfRecords)) {
+            return XBinary::ARCHIVERECORD{};
+        }
+        // Offsets refer to the decoded stream, which cannot be revisited
+        STREAM_CONTEXT *pContext = static_cast<STREAM_CONTEXT *>(pState->pContext);
+        return _getArchiveRecord(pContext->header, pContext->nHeaderOffset);
+    }
     setDevice(m_pDecompressedData);
     XBinary::ARCHIVERECORD result = XTAR::infoCurrent(pState, pPdStruct);
     setDevice(m_pOriginalDevice);
@@ -230,6 +485,23 @@ bool XTARCOMPRESSED::moveToNext(UNPACK_STATE *pState, PDSTRUCT *pPdStruct)
     if (!m_pDecompressedData) {
         return false;
     }
+    if (m_bStreamingUnpack) {
+        if (!pState || !pState->pContext || (pState->nCurrentIndex >= pState->nNumberOfRecords)) {
+            return false;
+        }
+        STREAM_CONTEXT *pContext = static_cast<STREAM_CONTEXT *>(pState->pContext);
+        qint64 nNextOffset = pContext->nHeaderOffset + 512 + ((_getSize(pContext->header) + 511) / 512) * 512;
+        bool bResult = _streamSkip(pContext->nPayloadLeft + pContext->nPaddingLeft, pPdStruct);
+        pState->nCurrentIndex++;
+        pState->nCurrentOffset = nNextOffset;
+        if (bResult) {
+            bResult = _streamReadHeader(pContext, nNextOffset);
+        }
+        if (bResult) {
+            pState->nNumberOfRecords = pState->nCurrentIndex + 1;
+        }
+        return bResult;
+    }
     setDevice(m_pDecompressedData);
     bool bResult = XTAR::moveToNext(pState, pPdStruct);
     setDevice(m_pOriginalDevice);
@@ -241,6 +513,32 @@ bool XTARCOMPRESSED::unpackCurrent(UNPACK_STATE *pState, QIODevice *pDevice, PDS
     if (!m_pDecompressedData) {
         return false;
     }
+    if (m_bStreamingUnpack) {
+        if (!pState || !pState->pContext || !pDevice || (pState->nCurrentIndex >= pState->nNumberOfRecords)) {
+            return false;
+        }
+        STREAM_CONTEXT *pContext = static_cast<STREAM_CONTEXT *>(pState->pContext);
+        if (pContext->bUnpacked) {
+            return false;  // The payload has already been consumed
+        }
+        pContext->bUnpacked = true;
+        if (!pDevice->isSequential()) {
+            if (!pDevice->seek(0) || ((pDevice->size() != 0) && !XBinary::resize(pDevice, 0))) {
+                XBinary::setPdStructErrorString(pPdStruct, tr("Cannot clear unpacked output"));
+                return false;
+            }
+        }
+        qint32 nBufferSize = XBinary::getBufferSize(pPdStruct);
+        QByteArray baBuffer;
+        baBuffer.resize(nBufferSize);
+        bool bResult = true;
+        while (bResult && (pContext->nPayloadLeft > 0) && XBinary::isPdStructNotCanceled(pPdStruct)) {
+            qint64 nChunk = (std::min)((qint64)nBufferSize, pContext->nPayloadLeft);
+            bResult = _streamRead(baBuffer.data(), nChunk) && (pDevice->write(baBuffer.constData(), nChunk) == nChunk);
+            pContext->nPayloadLeft -= nChunk;
+        }
+        return bResult && XBinary::isPdStructNotCanceled(pPdStruct);
+    }
     setDevice(m_pDecompressedData);
     bool bResult = XTAR::unpackCurrent(pState, pDevice, pPdStruct);
     setDevice(m_pOriginalDevice);
@@ -251,10 +549,16 @@ bool XTARCOMPRESSED::finishUnpack(UNPACK_STATE *pState, PDSTRUCT *pPdStruct)
 {
     Q_UNUSED(pPdStruct)
 
+    _freeDecompressSession(pState);
+
     // The original device is always kept current between per-entry calls;
     // just clear the decompressed buffer and unpack state.
     m_pOriginalDevice = nullptr;
 
+    if (m_bStreamingUnpack && pState && pState->pContext) {
+        delete static_cast<STREAM_CONTEXT *>(pState->pContext);
+    }
+
     if (m_pDecompressedData) {
         delete m_pDecompressedData;
         m_pDecompressedData = nullptr;
@@ -285,6 +589,18 @@ QIODevice *XTARCOMPRESSED::decompressByMethod(HANDLE_METHOD handleMethod, qint64
         return nullptr;
     }
 
+    if (m_bStreamingUnpack) {
+        // The caller's PDSTRUCT has to outlive the walk, it is polled by the decoder until finishUnpack
+        XTarStreamDevice *pStream = new XTarStreamDevice(pDevice, nOffset, nInputSize, handleMethod, pPdStruct);
+
+        if (!pStream->start()) {
+            delete pStream;
+            return nullptr;
+        }
+
+        return pStream;
+    }
+
     XDecompress decompress;
     QByteArray baData = decompress.decomressToByteArray(pDevice, nOffset, nInputSize, handleMethod, pPdStruct);
 
@@ -312,6 +628,85 @@ QIODevice *XTARCOMPRESSED::createMemoryBuffer(const QByteArray &baData)
     return pBuffer;
 }
 
+void XTARCOMPRESSED::setStreamingUnpack(bool bState)
+{
+    m_bStreamingUnpack = bState;
+}
+
+bool XTARCOMPRESSED::isStreamingUnpack()
+{
+    return m_bStreamingUnpack;
+}
+
+bool XTARCOMPRESSED::isStreamEnd(UNPACK_STATE *pState)
+{
+    if (!m_bStreamingUnpack || !pState || !pState->pContext) {
+        return false;
+    }
+
+    return static_cast<STREAM_CONTEXT *>(pState->pContext)->bEnd;
+}
+
+bool XTARCOMPRESSED::_streamRead(char *pBuffer, qint64 nSize)
+{
+    qint64 nTotal = 0;
+
+    while (nTotal < nSize) {
+        qint64 nRead = m_pDecompressedData->read(pBuffer + nTotal, nSize - nTotal);
+
+        if (nRead <= 0) {
+            return false;
+        }
+
+        nTotal += nRead;
+    }
+
+    return true;
+}
+
+bool XTARCOMPRESSED::_streamSkip(qint64 nSize, PDSTRUCT *pPdStruct)
+{
+    char buffer[0x4000];
+
+    while ((nSize > 0) && XBinary::isPdStructNotCanceled(pPdStruct)) {
+        qint64 nChunk = (std::min)((qint64)sizeof(buffer), nSize);
+
+        if (!_streamRead(buffer, nChunk)) {
+            return false;
+        }
+
+        nSize -= nChunk;
+    }
+
+    return (nSize == 0);
+}
+
+bool XTARCOMPRESSED::_streamReadHeader(STREAM_CONTEXT *pContext, qint64 nHeaderOffset)
+{
+    char buffer[512];
+
+    if (!_streamRead(buffer, sizeof(buffer))) {
+        return false;
+    }
+
+    memcpy(&(pContext->header), buffer, sizeof(posix_header));
+
+    // Check for end of archive (empty header)
+    if (pContext->header.name[0] == 0) {
+        pContext->bEnd = true;
+        return false;
+    }
+
+    qint64 nFileSize = _getSize(pContext->header);
+
+    pContext->nHeaderOffset = nHeaderOffset;
+    pContext->nPayloadLeft = nFileSize;
+    pContext->nPaddingLeft = ((nFileSize + 511) / 512) * 512 - nFileSize;
+    pContext->bUnpacked = false;
+
+    return true;
+}
+
 bool XTARCOMPRESSED::handleInternalInfo(PDSTRUCT *pPdStruct)
 {
     bool bResult = true;
@@ -61,6 +61,15 @@ public:
     virtual bool unpackCurrent(UNPACK_STATE *pState, QIODevice *pDevice, PDSTRUCT *pPdStruct = nullptr) override;
     virtual bool finishUnpack(UNPACK_STATE *pState, PDSTRUCT *pPdStruct = nullptr) override;
 
+    // Single-pass unpacking: the outer stream is decoded on a worker thread into a
+    // bounded ring buffer and entries are consumed in order as they arrive, so memory
+    // stays constant. Records can only be unpacked during the walk, the original
+    // device must not be used elsewhere until finishUnpack.
+    void setStreamingUnpack(bool bState);
+    bool isStreamingUnpack();
+    // True once a streaming walk has read the end-of-archive header
+    bool isStreamEnd(UNPACK_STATE *pState);
+
 protected:
     QIODevice *m_pDecompressedData;
     QIODevice *m_pOriginalDevice;
@@ -84,7 +93,23 @@ protected:
 
     // Utility methods
     static QIODevice *createMemoryBuffer(const QByteArray &baData);
+
+    bool m_bStreamingUnpack;
+
 private:
+    struct STREAM_CONTEXT {
+        posix_header header;
+        qint64 nHeaderOffset;
+        qint64 nPayloadLeft;
+        qint64 nPaddingLeft;
+        bool bUnpacked;
+        bool bEnd;  // The end-of-archive header has been read
+    };
+
+    bool _streamRead(char *pBuffer, qint64 nSize);
+    bool _streamSkip(qint64 nSize, PDSTRUCT *pPdStruct);
+    bool _streamReadHeader(STREAM_CONTEXT *pContext, qint64 nHeaderOffset);
+
     INTERNAL_INFO m_internalInfo;
 };
 
@@ -537,6 +537,8 @@ bool XUDF::finishUnpack(UNPACK_STATE *pState, PDSTRUCT *pPdStruct)
 {
     Q_UNUSED(pPdStruct)
 
+    _freeDecompressSession(pState);
+
     bool bResult = false;
 
     if (pState && pState->pContext) {
@@ -19,9 +19,25 @@
  * SOFTWARE.
  */
 #include "xwim.h"
+#include "Algos/xlzmsdecoder.h"
 #include "Algos/xlzxdecoder.h"
 #include "Algos/xxpressdecoder.h"
 
+#include <QBuffer>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
 static XBinary::XCONVERT _TABLE_XWIM_STRUCTID[] = {{XWIM::STRUCTID_UNKNOWN, "Unknown", QObject::tr("Unknown")},
                                                    {XWIM::STRUCTID_WIM_HEADER, "WIM_HEADER", QString("WIM header")}};
 
@@ -64,6 +80,95 @@ static quint64 read_uint64_le(const QByteArray &baData, qint64 nOffset)
     return nResult;
 }
 
+namespace {
+
+const qint64 WIM_TASK_SIZE = 0x80000;              // Uncompressed bytes decoded by one task (at least one chunk)
+const qint64 WIM_CHUNK_CACHE_SIZE = 0x10000000;       // Decoded solid-resource chunks kept between streams
+const qint64 WIM_STREAM_CACHE_SIZE = 0x8000000;       // Decoded streams that more than one record refers to
+const qint64 WIM_STREAM_CACHE_ITEM_SIZE = 0x2000000;  // Larger shared streams are decoded again instead
+
+typedef bool (*WIM_CHUNK_DECODER)(const QByteArray &baCompressed, QByteArray *pbaUncompressed, qint32 nUncompressedSize);
+
+class WIMChunkRunnable : public QRunnable {
+public:
+    WIMChunkRunnable(const QByteArray *pbaInput, WIM_CHUNK_DECODER pDecoder) : m_pbaInput(pbaInput), m_pDecoder(pDecoder), m_bSuccess(false)
+    {
+        setAutoDelete(false);
+    }
+
+    void addChunk(qint64 nChunkIndex, qint64 nOffset, qint32 nCompressedSize, qint32 nUncompressedSize)
+    {
+        CHUNK chunk = {};
+        chunk.nChunkIndex = nChunkIndex;
+        chunk.nOffset = nOffset;
+        chunk.nCompressedSize = nCompressedSize;
+        chunk.nUncompressedSize = nUncompressedSize;
+
+        m_listChunks.append(chunk);
+    }
+
+    qint32 getNumberOfChunks() const
+    {
+        return m_listChunks.count();
+    }
+
+    qint64 getChunkIndex(qint32 nIndex) const
+    {
+        return m_listChunks.at(nIndex).nChunkIndex;
+    }
+
+    QByteArray getOutput(qint32 nIndex) const
+    {
+        return m_listOutputs.value(nIndex);
+    }
+
+    bool isSuccess() const
+    {
+        return m_bSuccess;
+    }
+
+    void run() override
+    {
+        m_bSuccess = true;
+
+        for (qint32 i = 0; (i < m_listChunks.count()) && m_bSuccess; i++) {
+            const CHUNK &chunk = m_listChunks.at(i);
+            const char *pChunk = m_pbaInput->constData() + chunk.nOffset;
+            QByteArray baChunkOut;
+
+            if (chunk.nCompressedSize >= chunk.nUncompressedSize) {
+                // Stored chunk (incompressible): copied verbatim
+                baChunkOut = QByteArray(pChunk, chunk.nUncompressedSize);
+            } else if (m_pDecoder) {
+                QByteArray baChunk = QByteArray::fromRawData(pChunk, chunk.nCompressedSize);
+
+                m_bSuccess = m_pDecoder(baChunk, &baChunkOut, chunk.nUncompressedSize);
+            } else {
+                m_bSuccess = false;
+            }
+
+            m_bSuccess = m_bSuccess && (baChunkOut.size() == chunk.nUncompressedSize);
+            m_listOutputs.append(baChunkOut);
+        }
+    }
+
+private:
+    struct CHUNK {
+        qint64 nChunkIndex;
+        qint64 nOffset;
+        qint32 nCompressedSize;
+        qint32 nUncompressedSize;
+    };
+
+    const QByteArray *m_pbaInput;
+    WIM_CHUNK_DECODER m_pDecoder;
+    QList<CHUNK> m_listChunks;
+    QList<QByteArray> m_listOutputs;
+    bool m_bSuccess;
+};
+
+}  // namespace
+
 static XBinary::PM_INFO createPMInfo(XBinary::HANDLE_METHOD hm0, XBinary::HANDLE_METHOD hm1 = XBinary::HANDLE_METHOD_UNKNOWN,
                                      XBinary::HANDLE_METHOD hm2 = XBinary::HANDLE_METHOD_UNKNOWN, XBinary::HANDLE_METHOD hm3 = XBinary::HANDLE_METHOD_UNKNOWN)
 {
@@ -488,13 +593,30 @@ bool XWIM::initUnpack(UNPACK_STATE *pState, const QMap<UNPACK_PROP, QVariant> &m
     WIM_HEADER header = readWIMHeader();
     pContext->nHeaderFlags = header.nFlags;
     pContext->nChunkSize = header.nChunkSize;
-    QList<STREAM_INFO> listStreams = _readStreamInfoList(header, pPdStruct);
+    pContext->chunkCache.nCachedSize = 0;
+    pContext->nDecodedSize = 0;
+    QList<STREAM_INFO> listStreams = _readStreamInfoList(header, &(pContext->listSolidGroups), pPdStruct);
 
     for (qint32 i = 0; (i < listStreams.count()) && XBinary::isPdStructNotCanceled(pPdStruct); i++) {
         const STREAM_INFO &streamInfo = listStreams.at(i);
 
         if (streamInfo.resourceInfo.nFlags & RESOURCE_FLAG_METADATA) {
-            QByteArray baMetadata = _readResource(streamInfo.resourceInfo, header.nFlags, header.nChunkSize, pPdStruct);
+            QByteArray baMetadata;
+
+            if (streamInfo.nSolidIndex == -1) {
+                baMetadata = _readResource(streamInfo.resourceInfo, header.nFlags, header.nChunkSize, pPdStruct);
+            } else if ((streamInfo.nSolidIndex < pContext->listSolidGroups.count()) && (streamInfo.resourceInfo.nUnpackSize <= (quint64)INT_MAX)) {
+                QBuffer buffer(&baMetadata);
+
+                if (buffer.open(QIODevice::WriteOnly)) {
+                    if (!_readSolidStream(pContext->listSolidGroups.at(streamInfo.nSolidIndex), (qint64)streamInfo.resourceInfo.nOffset,
+                                          (qint64)streamInfo.resourceInfo.nUnpackSize, &buffer, &(pContext->chunkCache), pPdStruct)) {
+                        baMetadata.clear();
+                    }
+
+                    buffer.close();
+                }
+            }
 
             if (!baMetadata.isEmpty()) {
                 if (_parseMetadata(baMetadata, listStreams, &(pContext->listRecords))) {
@@ -517,12 +639,36 @@ bool XWIM::initUnpack(UNPACK_STATE *pState, const QMap<UNPACK_PROP, QVariant> &m
                 record.nUncompressedSize = (qint64)streamInfo.resourceInfo.nUnpackSize;
                 record.resourceInfo = streamInfo.resourceInfo;
                 record.handleMethod = _isResourceStored(streamInfo.resourceInfo) ? HANDLE_METHOD_STORE : HANDLE_METHOD_UNKNOWN;
+                record.nSolidIndex = streamInfo.nSolidIndex;
+
+                if (!_isEmptyHash(streamInfo.baHash)) {
+                    record.baHash = streamInfo.baHash;
+                }
 
                 pContext->listRecords.append(record);
             }
         }
     }
 
+    // Streams inside solid resources have no file region of their own; report their solid resource instead
+    for (qint32 i = 0; i < pContext->listRecords.count(); i++) {
+        WIM_RECORD &record = pContext->listRecords[i];
+
+        if (!record.baHash.isEmpty()) {
+            pContext->mapHashRefs[record.baHash]++;
+        }
+
+        if ((record.nSolidIndex >= 0) && (record.nSolidIndex < pContext->listSolidGroups.count())) {
+            const SOLID_GROUP &solidGroup = pContext->listSolidGroups.at(record.nSolidIndex);
+
+            if (!solidGroup.listResources.isEmpty()) {
+                const CHUNKED_RESOURCE &chunkedResource = solidGroup.listResources.first();
+                record.nStreamOffset = chunkedResource.nDataOffset;
+                record.nStreamSize = chunkedResource.listChunkOffsets.isEmpty() ? 0 : chunkedResource.listChunkOffsets.last();
+            }
+        }
+    }
+
     if (!pContext->listRecords.isEmpty()) {
         pState->nCurrentOffset = 0;
         pState->nTotalSize = getSize();
@@ -597,15 +743,62 @@ bool XWIM::unpackCurrent(UNPACK_STATE *pState, QIODevice *pDevice, PDSTRUCT *pPd
         return true;  // Empty file
     }
 
-    QByteArray baData = _readResource(record.resourceInfo, pContext->nHeaderFlags, pContext->nChunkSize, pPdStruct);
+    if ((quint64)record.nUncompressedSize != record.resourceInfo.nUnpackSize) {
+        return false;
+    }
 
-    if (baData.isEmpty() || (baData.size() != record.nUncompressedSize)) {
+    if ((record.nSolidIndex >= 0) && (record.nSolidIndex >= pContext->listSolidGroups.count())) {
         return false;
     }
 
-    qint64 nWritten = pDevice->write(baData);
+    // Streams shared by several records (same hash) are decoded once and served from memory while they stay cached
+    if (!record.baHash.isEmpty() && pContext->mapDecodedStreams.contains(record.baHash)) {
+        const QByteArray baData = pContext->mapDecodedStreams.value(record.baHash);
+
+        pContext->listDecodedOrder.removeOne(record.baHash);
+        pContext->listDecodedOrder.append(record.baHash);
+
+        return (pDevice->write(baData) == baData.size());
+    }
+
+    bool bCache = (pContext->mapHashRefs.value(record.baHash, 0) > 1) && (record.nUncompressedSize <= WIM_STREAM_CACHE_ITEM_SIZE);
+    QByteArray baData;
+    QBuffer buffer(&baData);
+    QIODevice *pTarget = pDevice;
+
+    if (bCache && buffer.open(QIODevice::WriteOnly)) {
+        pTarget = &buffer;
+    } else {
+        bCache = false;
+    }
+
+    bool bResult = false;
 
-    return (nWritten == (qint64)baData.size());
+    if (record.nSolidIndex >= 0) {
+        bResult = _readSolidStream(pContext->listSolidGroups.at(record.nSolidIndex), (qint64)record.resourceInfo.nOffset, record.nUncompressedSize, pTarget,
+                                   &(pContext->chunkCache), pPdStruct);
+    } else {
+        bResult = _readResourceToDevice(record.resourceInfo, pContext->nHeaderFlags, pContext->nChunkSize, pTarget, pPdStruct);
+    }
+
+    if (bCache) {
+        buffer.close();
+
+        if (bResult) {
+            bResult = (pDevice->write(baData) == baData.size());
+
+            pContext->mapDecodedStreams.insert(record.baHash, baData);
+            pContext->listDecodedOrder.append(record.baHash);
+            pContext->nDecodedSize += baData.size();
+
+            while ((pContext->nDecodedSize > WIM_STREAM_CACHE_SIZE) && (pContext->listDecodedOrder.count() > 1)) {
+                QByteArray baKey = pContext->listDecodedOrder.takeFirst();
+                pContext->nDecodedSize -= pContext->mapDecodedStreams.take(baKey).size();
+            }
+        }
+    }
+
+    return bResult;
 }
 
 bool XWIM::moveToNext(UNPACK_STATE *pState, PDSTRUCT *pPdStruct)
@@ -626,6 +819,8 @@ bool XWIM::finishUnpack(UNPACK_STATE *pState, PDSTRUCT *pPdStruct)
 {
     Q_UNUSED(pPdStruct)
 
+    _freeDecompressSession(pState);
+
     if (!pState) {
         return false;
     }
@@ -660,6 +855,90 @@ QList<XBinary::FPART_PROP> XWIM::getAvailableFPARTProperties()
     return listResult;
 }
 
+bool XWIM::extractToFolder(const QString &sResultFolder, PDSTRUCT *pPdStruct)
+{
+    PDSTRUCT pdStructEmpty = XBinary::createPdStruct();
+
+    if (!pPdStruct) {
+        pPdStruct = &pdStructEmpty;
+    }
+
+    UNPACK_STATE state = {};
+
+    if (!initUnpack(&state, getDefaultUnpackProperties(), pPdStruct)) {
+        return false;
+    }
+
+    WIM_UNPACK_CONTEXT *pContext = (WIM_UNPACK_CONTEXT *)state.pContext;
+
+    const QString sCanonicalRoot = XArchive::_normalizeOutputPath(QDir(sResultFolder).absolutePath());
+    XBinary::createDirectory(sCanonicalRoot);
+
+    QString sCanonicalRootForCheck = QFileInfo(sCanonicalRoot).canonicalFilePath();
+
+    if (sCanonicalRootForCheck.isEmpty()) {
+        sCanonicalRootForCheck = sCanonicalRoot;
+    }
+
+    QMap<QByteArray, QString> mapExtracted;  // Stream hash -> first file written with that content
+    bool bResult = true;
+
+    qint32 _nFreeIndex = XBinary::getFreeIndex(pPdStruct);
+    XBinary::setPdStructInit(pPdStruct, _nFreeIndex, state.nNumberOfRecords);
+
+    for (qint32 i = 0; (i < state.nNumberOfRecords) && XBinary::isPdStructNotCanceled(pPdStruct); i++) {
+        const WIM_RECORD &record = pContext->listRecords.at(i);
+        QString sResultFileName = XArchive::_normalizeOutputPath(QDir(sCanonicalRoot).absoluteFilePath(record.sFileName));
+
+        XBinary::setPdStructCurrent(pPdStruct, _nFreeIndex, i);
+
+        if (!XArchive::_isSafeChildPath(sResultFileName, sCanonicalRootForCheck)) {
+            bResult = false;
+            continue;
+        }
+
+        if (record.bIsFolder) {
+            XBinary::createDirectory(sResultFileName);
+            continue;
+        }
+
+        XBinary::createDirectory(QFileInfo(sResultFileName).absolutePath());
+
+        QString sFirstFileName = mapExtracted.value(record.baHash);
+
+        if (!sFirstFileName.isEmpty() && _linkOrCopyFile(sFirstFileName, sResultFileName)) {
+            continue;
+        }
+
+        QFile file(sResultFileName);
+
+        if (!file.open(QIODevice::WriteOnly)) {
+            bResult = false;
+            continue;
+        }
+
+        state.nCurrentIndex = i;
+
+        bool bUnpacked = unpackCurrent(&state, &file, pPdStruct);
+
+        file.close();
+
+        if (bUnpacked) {
+            if (!record.baHash.isEmpty() && !mapExtracted.contains(record.baHash)) {
+                mapExtracted.insert(record.baHash, sResultFileName);
+            }
+        } else {
+            bResult = false;
+        }
+    }
+
+    XBinary::setPdStructFinished(pPdStruct, _nFreeIndex);
+
+    finishUnpack(&state, pPdStruct);
+
+    return bResult && XBinary::isPdStructNotCanceled(pPdStruct);
+}
+
 XWIM::WIM_HEADER XWIM::readWIMHeader(qint64 nOffset)
 {
     WIM_HEADER result = {};
@@ -856,113 +1135,391 @@ QByteArray XWIM::_readResource(const RESOURCE_INFO &resourceInfo, quint32 nHeade
         return read_array((qint64)resourceInfo.nOffset, (qint64)resourceInfo.nPackSize);
     }
 
-    WIM_COMPRESSION compression = _getCompressionType(nHeaderFlags);
+    // In-memory reads are for tables and metadata; large streams go through _readResourceToDevice
+    if ((resourceInfo.nUnpackSize == 0) || (resourceInfo.nUnpackSize > (quint64)INT_MAX)) {
+        return QByteArray();
+    }
+
+    QByteArray baResult;
+    baResult.reserve((qint32)resourceInfo.nUnpackSize);
+
+    QBuffer buffer(&baResult);
+
+    if (buffer.open(QIODevice::WriteOnly)) {
+        bool bResult = _readResourceToDevice(resourceInfo, nHeaderFlags, nChunkSize, &buffer, pPdStruct);
+
+        buffer.close();
 
-    if ((compression == WIM_COMPRESSION_LZX) || (compression == WIM_COMPRESSION_XPRESS)) {
-        return _decompressChunkedResource(resourceInfo, compression, _getChunkSize(nChunkSize), pPdStruct);
+        if (bResult) {
+            return baResult;
+        }
     }
 
-    // LZMS and unknown compression are not yet supported
     return QByteArray();
 }
 
-QByteArray XWIM::_decompressChunkedResource(const RESOURCE_INFO &resourceInfo, WIM_COMPRESSION compression, qint32 nChunkSize, PDSTRUCT *pPdStruct)
+bool XWIM::_readResourceToDevice(const RESOURCE_INFO &resourceInfo, quint32 nHeaderFlags, quint32 nChunkSize, QIODevice *pDevice, PDSTRUCT *pPdStruct)
 {
-    QByteArray baResult;
+    if (_isResourceStored(resourceInfo) || (resourceInfo.nPackSize == resourceInfo.nUnpackSize)) {
+        quint64 nFileSize = (quint64)getSize();
 
-    quint64 nUnpackSize = resourceInfo.nUnpackSize;
-    quint64 nPackSize = resourceInfo.nPackSize;
+        if ((resourceInfo.nPackSize == 0) || (resourceInfo.nOffset >= nFileSize) || (resourceInfo.nPackSize > nFileSize - resourceInfo.nOffset)) {
+            return false;
+        }
 
-    if ((nUnpackSize == 0) || (nUnpackSize > (quint64)INT_MAX) || (nPackSize == 0) || (nPackSize > (quint64)INT_MAX)) {
-        return baResult;
+        const qint64 nBufferSize = 0x100000;
+        qint64 nOffset = (qint64)resourceInfo.nOffset;
+        qint64 nRemaining = (qint64)resourceInfo.nPackSize;
+
+        while ((nRemaining > 0) && XBinary::isPdStructNotCanceled(pPdStruct)) {
+            QByteArray baBuffer = read_array(nOffset, (std::min)(nRemaining, nBufferSize));
+
+            if (baBuffer.isEmpty() || (pDevice->write(baBuffer) != baBuffer.size())) {
+                return false;
+            }
+
+            nOffset += baBuffer.size();
+            nRemaining -= baBuffer.size();
+        }
+
+        return (nRemaining == 0);
     }
 
-    if ((resourceInfo.nOffset >= (quint64)getSize()) || (resourceInfo.nOffset + nPackSize > (quint64)getSize())) {
-        return baResult;
+    WIM_COMPRESSION compression = _getCompressionType(nHeaderFlags);
+
+    if (compression == WIM_COMPRESSION_NONE) {
+        return false;
     }
 
-    qint64 nNumChunks = (qint64)((nUnpackSize + (quint64)nChunkSize - 1) / (quint64)nChunkSize);
-    if (nNumChunks <= 0) {
-        return baResult;
+    CHUNKED_RESOURCE chunkedResource = {};
+
+    if (!_readChunkTable(resourceInfo, compression, _getChunkSize(nChunkSize), &chunkedResource)) {
+        return false;
+    }
+
+    return _decompressChunkedResource(chunkedResource, pDevice, 0, -1, nullptr, pPdStruct);
+}
+
+bool XWIM::_readChunkTable(const RESOURCE_INFO &resourceInfo, WIM_COMPRESSION compression, qint32 nChunkSize, CHUNKED_RESOURCE *pResult)
+{
+    quint64 nUnpackSize = resourceInfo.nUnpackSize;
+    quint64 nPackSize = resourceInfo.nPackSize;
+    quint64 nFileSize = (quint64)getSize();
+
+    if ((nUnpackSize == 0) || (nPackSize == 0) || (nChunkSize <= 0) || (resourceInfo.nOffset >= nFileSize) || (nPackSize > nFileSize - resourceInfo.nOffset)) {
+        return false;
     }
 
+    qint64 nNumChunks = (qint64)((nUnpackSize + (quint64)nChunkSize - 1) / (quint64)nChunkSize);
+
     // Chunk-offset table: (nNumChunks - 1) entries, each 4 bytes (resource < 4GB) or 8 bytes.
     qint32 nEntrySize = (nUnpackSize > 0xFFFFFFFFULL) ? 8 : 4;
     qint64 nTableSize = (nNumChunks - 1) * nEntrySize;
 
     if ((quint64)nTableSize >= nPackSize) {
-        return baResult;
+        return false;
     }
 
-    QByteArray baResource = read_array((qint64)resourceInfo.nOffset, (qint64)nPackSize);
-    if ((quint64)baResource.size() != nPackSize) {
-        return baResult;
+    QByteArray baTable = read_array((qint64)resourceInfo.nOffset, nTableSize);
+
+    if (baTable.size() != nTableSize) {
+        return false;
     }
 
-    // Chunk[i] compressed-data offsets, relative to the end of the chunk table.
-    QList<qint64> listOffsets;
-    listOffsets.append(0);
-    for (qint64 i = 0; i < nNumChunks - 1; i++) {
-        qint64 nEntryOffset = i * nEntrySize;
-        quint64 nValue = 0;
-        for (qint32 b = 0; b < nEntrySize; b++) {
-            nValue |= (quint64)(quint8)baResource.at((int)(nEntryOffset + b)) << (8 * b);
+    qint64 nCompressedTotal = (qint64)nPackSize - nTableSize;
+
+    pResult->nDataOffset = (qint64)resourceInfo.nOffset + nTableSize;
+    pResult->nUncompressedSize = (qint64)nUnpackSize;
+    pResult->nChunkSize = nChunkSize;
+    pResult->compression = compression;
+    pResult->listChunkOffsets.clear();
+    pResult->listChunkOffsets.reserve((qint32)(nNumChunks + 1));
+    pResult->listChunkOffsets.append(0);
+
+    for (qint64 i = 1; i < nNumChunks; i++) {
+        qint64 nEntryOffset = (i - 1) * nEntrySize;
+        qint64 nValue = (nEntrySize == 8) ? (qint64)read_uint64_le(baTable, nEntryOffset) : (qint64)read_uint32_le(baTable, nEntryOffset);
+
+        if ((nValue <= pResult->listChunkOffsets.last()) || (nValue >= nCompressedTotal)) {
+            return false;
         }
-        listOffsets.append((qint64)nValue);
+
+        pResult->listChunkOffsets.append(nValue);
     }
 
-    qint64 nCompressedBase = nTableSize;
-    qint64 nCompressedTotal = (qint64)nPackSize - nTableSize;
+    pResult->listChunkOffsets.append(nCompressedTotal);
 
-    baResult.reserve((int)nUnpackSize);
+    return true;
+}
 
-    for (qint64 i = 0; (i < nNumChunks) && XBinary::isPdStructNotCanceled(pPdStruct); i++) {
-        qint64 nChunkStart = listOffsets.at((int)i);
-        qint64 nChunkEnd = (i + 1 < nNumChunks) ? listOffsets.at((int)(i + 1)) : nCompressedTotal;
+bool XWIM::_readSolidChunkTable(const RESOURCE_INFO &resourceInfo, CHUNKED_RESOURCE *pResult)
+{
+    quint64 nPackSize = resourceInfo.nPackSize;
+    quint64 nFileSize = (quint64)getSize();
 
-        if ((nChunkStart < 0) || (nChunkEnd <= nChunkStart) || (nChunkEnd > nCompressedTotal)) {
-            return QByteArray();
+    if ((nPackSize < (quint64)WIM_SOLID_HEADER_SIZE) || (resourceInfo.nOffset >= nFileSize) || (nPackSize > nFileSize - resourceInfo.nOffset)) {
+        return false;
+    }
+
+    // Solid resources carry their own header: uncompressed size, chunk size and compression format
+    QByteArray baHeader = read_array((qint64)resourceInfo.nOffset, WIM_SOLID_HEADER_SIZE);
+
+    if (baHeader.size() != WIM_SOLID_HEADER_SIZE) {
+        return false;
+    }
+
+    quint64 nUnpackSize = read_uint64_le(baHeader, 0);
+    quint32 nChunkSize = read_uint32_le(baHeader, 8);
+    quint32 nFormat = read_uint32_le(baHeader, 12);
+
+    if ((nChunkSize == 0) || (nChunkSize > 0x40000000) || (nUnpackSize > (quint64)LLONG_MAX)) {
+        return false;
+    }
+
+    if (nFormat == 0) {
+        pResult->compression = WIM_COMPRESSION_NONE;
+    } else if (nFormat == 1) {
+        pResult->compression = WIM_COMPRESSION_XPRESS;
+    } else if (nFormat == 2) {
+        pResult->compression = WIM_COMPRESSION_LZX;
+    } else if (nFormat == 3) {
+        pResult->compression = WIM_COMPRESSION_LZMS;
+    } else {
+        return false;
+    }
+
+    qint64 nNumChunks = (qint64)((nUnpackSize + nChunkSize - 1) / nChunkSize);
+
+    // Unlike the regular table, entries are the 4-byte compressed sizes of all chunks
+    qint64 nTableSize = nNumChunks * 4;
+
+    if ((quint64)(WIM_SOLID_HEADER_SIZE + nTableSize) > nPackSize) {
+        return false;
+    }
+
+    QByteArray baTable = read_array((qint64)resourceInfo.nOffset + WIM_SOLID_HEADER_SIZE, nTableSize);
+
+    if (baTable.size() != nTableSize) {
+        return false;
+    }
+
+    qint64 nCompressedTotal = (qint64)nPackSize - WIM_SOLID_HEADER_SIZE - nTableSize;
+
+    pResult->nDataOffset = (qint64)resourceInfo.nOffset + WIM_SOLID_HEADER_SIZE + nTableSize;
+    pResult->nUncompressedSize = (qint64)nUnpackSize;
+    pResult->nChunkSize = (qint32)nChunkSize;
+    pResult->listChunkOffsets.clear();
+    pResult->listChunkOffsets.reserve((qint32)(nNumChunks + 1));
+    pResult->listChunkOffsets.append(0);
+
+    for (qint64 i = 0; i < nNumChunks; i++) {
+        quint32 nCompressedSize = read_uint32_le(baTable, i * 4);
+        qint64 nNext = pResult->listChunkOffsets.last() + nCompressedSize;
+
+        if ((nCompressedSize == 0) || (nNext > nCompressedTotal)) {
+            return false;
         }
 
-        qint32 nChunkCompressed = (qint32)(nChunkEnd - nChunkStart);
-        qint32 nChunkUncompressed = (qint32)qMin<qint64>(nChunkSize, (qint64)nUnpackSize - (qint64)baResult.size());
+        pResult->listChunkOffsets.append(nNext);
+    }
 
-        QByteArray baChunk = baResource.mid((int)(nCompressedBase + nChunkStart), nChunkCompressed);
+    return true;
+}
 
-        if (nChunkCompressed >= nChunkUncompressed) {
-            // Stored chunk (incompressible): copied verbatim
-            baResult.append(baChunk.left(nChunkUncompressed));
-        } else {
-            QByteArray baChunkOut;
-            bool bChunkResult = false;
+bool XWIM::_decompressChunkedResource(const CHUNKED_RESOURCE &chunkedResource, QIODevice *pDevice, qint64 nOffset, qint64 nSize, CHUNK_CACHE *pCache,
+                                      PDSTRUCT *pPdStruct)
+{
+    qint64 nNumChunks = chunkedResource.listChunkOffsets.count() - 1;
+    qint64 nChunkSize = chunkedResource.nChunkSize;
+
+    if (nSize == -1) {
+        nSize = chunkedResource.nUncompressedSize - nOffset;
+    }
+
+    if ((nOffset < 0) || (nSize < 0) || ((nOffset + nSize) > chunkedResource.nUncompressedSize)) {
+        return false;
+    }
+
+    if (nSize == 0) {
+        return true;
+    }
+
+    if ((nNumChunks <= 0) || (nChunkSize <= 0)) {
+        return false;
+    }
+
+    WIM_CHUNK_DECODER pDecoder = nullptr;
+
+    if (chunkedResource.compression == WIM_COMPRESSION_XPRESS) {
+        pDecoder = &XXPressDecoder::decompressHuffman;
+    } else if (chunkedResource.compression == WIM_COMPRESSION_LZX) {
+        pDecoder = &XLZXDecoder::decompressWIMChunk;
+    } else if (chunkedResource.compression == WIM_COMPRESSION_LZMS) {
+        pDecoder = &XLZMSDecoder::decompressChunk;
+    }
+
+    // Only the chunks covering the requested window are read and decoded
+    qint64 nFirstChunk = nOffset / nChunkSize;
+    qint64 nLastChunk = (nOffset + nSize - 1) / nChunkSize;
+    qint64 nEnd = nOffset + nSize;
+
+    qint32 nNumberOfThreads = (std::max)(QThread::idealThreadCount(), 1);
+    qint64 nChunksPerTask = (std::max)(WIM_TASK_SIZE / nChunkSize, (qint64)1);
+    qint64 nBatchChunks = nNumberOfThreads * nChunksPerTask;
 
-            if (compression == WIM_COMPRESSION_LZX) {
-                bChunkResult = XLZXDecoder::decompressWIMChunk(baChunk, &baChunkOut, nChunkUncompressed);
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(nNumberOfThreads);
+
+    bool bResult = true;
+
+    for (qint64 nBatchStart = nFirstChunk; (nBatchStart <= nLastChunk) && bResult && XBinary::isPdStructNotCanceled(pPdStruct); nBatchStart += nBatchChunks) {
+        qint64 nBatchEnd = (std::min)(nBatchStart + nBatchChunks, nLastChunk + 1);
+        QMap<qint64, QByteArray> mapOutputs;
+        QList<qint64> listMissing;
+
+        // Chunks still cached from an earlier stream of the same solid resource are not decoded again
+        for (qint64 i = nBatchStart; i < nBatchEnd; i++) {
+            qint64 nKey = chunkedResource.nDataOffset + chunkedResource.listChunkOffsets.at((qint32)i);
+
+            if (pCache && pCache->mapChunks.contains(nKey)) {
+                mapOutputs.insert(i, pCache->mapChunks.value(nKey));
+                pCache->listOrder.removeOne(nKey);
+                pCache->listOrder.append(nKey);
             } else {
-                bChunkResult = XXPressDecoder::decompressHuffman(baChunk, &baChunkOut, nChunkUncompressed);
+                listMissing.append(i);
             }
+        }
+
+        if (!listMissing.isEmpty()) {
+            qint64 nInputStart = chunkedResource.listChunkOffsets.at((qint32)listMissing.first());
+            qint64 nInputEnd = chunkedResource.listChunkOffsets.at((qint32)(listMissing.last() + 1));
+
+            if ((nInputEnd - nInputStart) > (qint64)INT_MAX) {
+                bResult = false;
+                break;
+            }
+
+            QByteArray baInput = read_array(chunkedResource.nDataOffset + nInputStart, nInputEnd - nInputStart);
 
-            if (!bChunkResult || (baChunkOut.size() != nChunkUncompressed)) {
-                return QByteArray();
+            if (baInput.size() != (nInputEnd - nInputStart)) {
+                bResult = false;
+                break;
             }
 
-            baResult.append(baChunkOut);
+            QList<WIMChunkRunnable *> listTasks;
+
+            for (qint32 j = 0; j < listMissing.count(); j++) {
+                qint64 i = listMissing.at(j);
+                qint64 nChunkStart = chunkedResource.listChunkOffsets.at((qint32)i);
+                qint64 nChunkEnd = chunkedResource.listChunkOffsets.at((qint32)(i + 1));
+                qint64 nChunkUncompressed = (std::min)(nChunkSize, chunkedResource.nUncompressedSize - i * nChunkSize);
+
+                if ((j % nChunksPerTask) == 0) {
+                    listTasks.append(new WIMChunkRunnable(&baInput, pDecoder));
+                }
+
+                listTasks.last()->addChunk(i, nChunkStart - nInputStart, (qint32)qMin<qint64>(nChunkEnd - nChunkStart, INT_MAX), (qint32)nChunkUncompressed);
+            }
+
+            if (listTasks.count() == 1) {
+                listTasks.first()->run();  // Not worth a thread hop, e.g. small metadata resources
+            } else {
+                for (qint32 j = 0; j < listTasks.count(); j++) {
+                    threadPool.start(listTasks.at(j));
+                }
+
+                threadPool.waitForDone();
+            }
+
+            for (qint32 j = 0; j < listTasks.count(); j++) {
+                WIMChunkRunnable *pTask = listTasks.at(j);
+
+                if (pTask->isSuccess()) {
+                    for (qint32 k = 0; k < pTask->getNumberOfChunks(); k++) {
+                        qint64 nChunkIndex = pTask->getChunkIndex(k);
+                        QByteArray baOutput = pTask->getOutput(k);
+
+                        mapOutputs.insert(nChunkIndex, baOutput);
+
+                        if (pCache) {
+                            qint64 nKey = chunkedResource.nDataOffset + chunkedResource.listChunkOffsets.at((qint32)nChunkIndex);
+
+                            pCache->mapChunks.insert(nKey, baOutput);
+                            pCache->listOrder.append(nKey);
+                            pCache->nCachedSize += baOutput.size();
+                        }
+                    }
+                } else {
+                    bResult = false;
+                }
+
+                delete pTask;
+            }
+
+            if (pCache) {
+                while ((pCache->nCachedSize > WIM_CHUNK_CACHE_SIZE) && (pCache->listOrder.count() > 1)) {
+                    qint64 nKey = pCache->listOrder.takeFirst();
+                    pCache->nCachedSize -= pCache->mapChunks.take(nKey).size();
+                }
+            }
+        }
+
+        // Write the decoded chunks in order, trimmed to the window
+        for (qint64 i = nBatchStart; (i < nBatchEnd) && bResult; i++) {
+            const QByteArray baOutput = mapOutputs.value(i);
+            qint64 nOutputPos = i * nChunkSize;
+            qint64 nFrom = (std::max)(nOffset, nOutputPos);
+            qint64 nTo = (std::min)(nEnd, nOutputPos + baOutput.size());
+
+            if ((nTo <= nFrom) || (pDevice->write(baOutput.constData() + (nFrom - nOutputPos), nTo - nFrom) != (nTo - nFrom))) {
+                bResult = false;
+            }
         }
     }
 
-    if ((quint64)baResult.size() != nUnpackSize) {
-        return QByteArray();
+    return bResult && XBinary::isPdStructNotCanceled(pPdStruct);
+}
+
+bool XWIM::_readSolidStream(const SOLID_GROUP &solidGroup, qint64 nOffset, qint64 nSize, QIODevice *pDevice, CHUNK_CACHE *pCache, PDSTRUCT *pPdStruct)
+{
+    if (!solidGroup.bValid || (nOffset < 0) || (nSize < 0)) {
+        return false;
     }
 
-    return baResult;
+    // Stream offsets index the concatenated data of the group, so a stream may span resources
+    qint64 nEnd = nOffset + nSize;
+    qint64 nBase = 0;
+    qint64 nWritten = 0;
+
+    for (qint32 i = 0; (i < solidGroup.listResources.count()) && (nBase < nEnd); i++) {
+        const CHUNKED_RESOURCE &chunkedResource = solidGroup.listResources.at(i);
+        qint64 nResourceEnd = nBase + chunkedResource.nUncompressedSize;
+        qint64 nFrom = (std::max)(nOffset, nBase);
+        qint64 nTo = (std::min)(nEnd, nResourceEnd);
+
+        if (nTo > nFrom) {
+            if (!_decompressChunkedResource(chunkedResource, pDevice, nFrom - nBase, nTo - nFrom, pCache, pPdStruct)) {
+                return false;
+            }
+
+            nWritten += nTo - nFrom;
+        }
+
+        nBase = nResourceEnd;
+    }
+
+    return (nWritten == nSize);
 }
 
-QList<XWIM::STREAM_INFO> XWIM::_readStreamInfoList(const WIM_HEADER &header, PDSTRUCT *pPdStruct)
+QList<XWIM::STREAM_INFO> XWIM::_readStreamInfoList(const WIM_HEADER &header, QList<SOLID_GROUP> *pListSolidGroups, PDSTRUCT *pPdStruct)
 {
     QList<STREAM_INFO> listResult;
+    QList<QList<RESOURCE_INFO>> listSolidResources;
 
     QByteArray baOffsetTable = _readResource(header.offsetTableResource, header.nFlags, header.nChunkSize, pPdStruct);
     qint32 nNumberOfStreams = baOffsetTable.size() / WIM_STREAM_INFO_SIZE;
+    bool bSolidRun = false;
+    bool bSolidRunHasStreams = false;
 
     for (qint32 i = 0; i < nNumberOfStreams; i++) {
         qint64 nOffset = (qint64)i * WIM_STREAM_INFO_SIZE;
@@ -976,10 +1533,50 @@ QList<XWIM::STREAM_INFO> XWIM::_readStreamInfoList(const WIM_HEADER &header, PDS
         streamInfo.nPartNumber = read_uint16_le(baOffsetTable, nOffset + 24);
         streamInfo.nRefCount = read_uint32_le(baOffsetTable, nOffset + 26);
         streamInfo.baHash = baOffsetTable.mid(nOffset + 30, WIM_HASH_SIZE);
+        streamInfo.nSolidIndex = -1;
+
+        // A run of consecutive solid entries holds the solid resources themselves (marked by a magic
+        // size) and the streams inside them, whose offsets index the resources' concatenated data.
+        // A resource entry after the streams of a run opens the next run, even without a non-solid
+        // entry in between.
+        if (streamInfo.resourceInfo.nFlags & RESOURCE_FLAG_SOLID) {
+            bool bIsResource = (streamInfo.resourceInfo.nUnpackSize == WIM_SOLID_RESOURCE_MAGIC);
+
+            if (!bSolidRun || (bIsResource && bSolidRunHasStreams)) {
+                listSolidResources.append(QList<RESOURCE_INFO>());
+                bSolidRun = true;
+                bSolidRunHasStreams = false;
+            }
+
+            if (bIsResource) {
+                listSolidResources.last().append(streamInfo.resourceInfo);
+                continue;
+            }
+
+            streamInfo.nSolidIndex = listSolidResources.count() - 1;
+            bSolidRunHasStreams = true;
+        } else {
+            bSolidRun = false;
+        }
 
         listResult.append(streamInfo);
     }
 
+    if (pListSolidGroups) {
+        for (qint32 i = 0; (i < listSolidResources.count()) && XBinary::isPdStructNotCanceled(pPdStruct); i++) {
+            SOLID_GROUP solidGroup = {};
+            solidGroup.bValid = !listSolidResources.at(i).isEmpty();
+
+            for (qint32 j = 0; (j < listSolidResources.at(i).count()) && solidGroup.bValid; j++) {
+                CHUNKED_RESOURCE chunkedResource = {};
+                solidGroup.bValid = _readSolidChunkTable(listSolidResources.at(i).at(j), &chunkedResource);
+                solidGroup.listResources.append(chunkedResource);
+            }
+
+            pListSolidGroups->append(solidGroup);
+        }
+    }
+
     return listResult;
 }
 
@@ -1145,6 +1742,7 @@ XWIM::WIM_RECORD XWIM::_createRecordFromMetadataItem(const QByteArray &baMetadat
     record.nStreamSize = 0;
     record.nUncompressedSize = 0;
     record.handleMethod = HANDLE_METHOD_STORE;
+    record.nSolidIndex = -1;
     record.mtDateTime = winFileTimeToQDateTime(read_uint64_le(baMetadata, nOffset + 0x38));
 
     QByteArray baHash = baMetadata.mid(nOffset + 0x40, WIM_HASH_SIZE);
@@ -1156,6 +1754,8 @@ XWIM::WIM_RECORD XWIM::_createRecordFromMetadataItem(const QByteArray &baMetadat
         record.nUncompressedSize = (qint64)streamInfo.resourceInfo.nUnpackSize;
         record.resourceInfo = streamInfo.resourceInfo;
         record.handleMethod = _isResourceStored(streamInfo.resourceInfo) ? HANDLE_METHOD_STORE : HANDLE_METHOD_UNKNOWN;
+        record.nSolidIndex = streamInfo.nSolidIndex;
+        record.baHash = baHash;
     }
 
     return record;
@@ -1188,6 +1788,27 @@ bool XWIM::_isEmptyHash(const QByteArray &baHash)
     return true;
 }
 
+bool XWIM::_linkOrCopyFile(const QString &sSourceFileName, const QString &sTargetFileName)
+{
+    if (QFile::exists(sTargetFileName)) {
+        QFile::remove(sTargetFileName);
+    }
+
+    // A hard link shares the data of the first extracted copy; fall back to a copy across
+    // file systems, on file systems without hard links, or when the link limit is reached
+#ifdef Q_OS_WIN
+    if (CreateHardLinkW((LPCWSTR)sTargetFileName.utf16(), (LPCWSTR)sSourceFileName.utf16(), nullptr)) {
+        return true;
+    }
+#else
+    if (::link(QFile::encodeName(sSourceFileName).constData(), QFile::encodeName(sTargetFileName).constData()) == 0) {
+        return true;
+    }
+#endif
+
+    return QFile::copy(sSourceFileName, sTargetFileName);
+}
+
 QList<QString> XWIM::getSearchSignatures()
 {
     QList<QString> listResult;
@@ -114,6 +114,10 @@ public:
     virtual bool finishUnpack(UNPACK_STATE *pState, PDSTRUCT *pPdStruct = nullptr) override;
     virtual QList<FPART_PROP> getAvailableFPARTProperties() override;
 
+    // Extracts every record to sResultFolder, decoding each unique stream (by hash) once;
+    // further files with the same content are hard-linked to the first one, or copied.
+    bool extractToFolder(const QString &sResultFolder, PDSTRUCT *pPdStruct = nullptr);
+
     WIM_HEADER readWIMHeader(qint64 nOffset = 0);
     RESOURCE_INFO readResourceInfo(qint64 nOffset);
     QString compressionMethodToString();
@@ -126,6 +130,8 @@ private:
     static const qint32 WIM_STREAM_INFO_SIZE = 50;
     static const qint32 WIM_HASH_SIZE = 20;
     static const qint32 WIM_DIR_ENTRY_SIZE = 0x66;
+    static const qint32 WIM_SOLID_HEADER_SIZE = 16;
+    static const quint64 WIM_SOLID_RESOURCE_MAGIC = 0x100000000ULL;
 
     enum RESOURCE_FLAG {
         RESOURCE_FLAG_METADATA = 1 << 1,
@@ -138,6 +144,7 @@ private:
         quint16 nPartNumber;
         quint32 nRefCount;
         QByteArray baHash;
+        qint32 nSolidIndex;  // Index of the solid group holding the stream, -1 if it has its own resource
     };
 
     enum WIM_COMPRESSION {
@@ -147,6 +154,25 @@ private:
         WIM_COMPRESSION_LZMS
     };
 
+    struct CHUNKED_RESOURCE {
+        qint64 nDataOffset;  // File offset of the first chunk
+        qint64 nUncompressedSize;
+        qint32 nChunkSize;
+        WIM_COMPRESSION compression;
+        QList<qint64> listChunkOffsets;  // Chunk boundaries relative to nDataOffset, one more than the number of chunks
+    };
+
+    struct SOLID_GROUP {
+        QList<CHUNKED_RESOURCE> listResources;
+        bool bValid;
+    };
+
+    struct CHUNK_CACHE {
+        QMap<qint64, QByteArray> mapChunks;  // Decoded chunks by file offset of the compressed chunk
+        QList<qint64> listOrder;             // Least recently used first
+        qint64 nCachedSize;
+    };
+
     struct WIM_RECORD {
         QString sFileName;
         bool bIsFolder;
@@ -156,12 +182,20 @@ private:
         HANDLE_METHOD handleMethod;
         QDateTime mtDateTime;
         RESOURCE_INFO resourceInfo;
+        qint32 nSolidIndex;
+        QByteArray baHash;  // Stream hash (SHA-1), empty if the record has no data
     };
 
     struct WIM_UNPACK_CONTEXT {
         QList<WIM_RECORD> listRecords;
         quint32 nHeaderFlags;
         quint32 nChunkSize;
+        QList<SOLID_GROUP> listSolidGroups;
+        CHUNK_CACHE chunkCache;  // Shared by all streams of the solid groups
+        QMap<QByteArray, qint32> mapHashRefs;           // Records per stream hash
+        QMap<QByteArray, QByteArray> mapDecodedStreams;  // Recently decoded shared streams by hash
+        QList<QByteArray> listDecodedOrder;              // Least recently used first
+        qint64 nDecodedSize;
     };
 
     bool _isSupportedVersion(quint32 nVersion, quint32 nHeaderSize) const;
@@ -171,14 +205,21 @@ private:
     WIM_COMPRESSION _getCompressionType(quint32 nHeaderFlags) const;
     qint32 _getChunkSize(quint32 nChunkSize) const;
     QByteArray _readResource(const RESOURCE_INFO &resourceInfo, quint32 nHeaderFlags, quint32 nChunkSize, PDSTRUCT *pPdStruct);
-    QByteArray _decompressChunkedResource(const RESOURCE_INFO &resourceInfo, WIM_COMPRESSION compression, qint32 nChunkSize, PDSTRUCT *pPdStruct);
-    QList<STREAM_INFO> _readStreamInfoList(const WIM_HEADER &header, PDSTRUCT *pPdStruct);
+    bool _readResourceToDevice(const RESOURCE_INFO &resourceInfo, quint32 nHeaderFlags, quint32 nChunkSize, QIODevice *pDevice, PDSTRUCT *pPdStruct);
+    bool _readChunkTable(const RESOURCE_INFO &resourceInfo, WIM_COMPRESSION compression, qint32 nChunkSize, CHUNKED_RESOURCE *pResult);
+    bool _readSolidChunkTable(const RESOURCE_INFO &resourceInfo, CHUNKED_RESOURCE *pResult);
+    // Decodes the chunks covering [nOffset, nOffset + nSize) of the resource (nSize -1: up to the end) on a thread pool
+    bool _decompressChunkedResource(const CHUNKED_RESOURCE &chunkedResource, QIODevice *pDevice, qint64 nOffset, qint64 nSize, CHUNK_CACHE *pCache,
+                                    PDSTRUCT *pPdStruct);
+    bool _readSolidStream(const SOLID_GROUP &solidGroup, qint64 nOffset, qint64 nSize, QIODevice *pDevice, CHUNK_CACHE *pCache, PDSTRUCT *pPdStruct);
+    QList<STREAM_INFO> _readStreamInfoList(const WIM_HEADER &header, QList<SOLID_GROUP> *pListSolidGroups, PDSTRUCT *pPdStruct);
     bool _parseMetadata(const QByteArray &baMetadata, const QList<STREAM_INFO> &listStreams, QList<WIM_RECORD> *pListRecords);
     bool _parseMetadataDir(const QByteArray &baMetadata, qint64 nOffset, const QString &sParent, const QMap<QByteArray, STREAM_INFO> &mapStreams,
                            QList<WIM_RECORD> *pListRecords, QSet<qint64> *pStVisited);
     WIM_RECORD _createRecordFromMetadataItem(const QByteArray &baMetadata, qint64 nOffset, const QString &sParent, const QMap<QByteArray, STREAM_INFO> &mapStreams);
     QString _readUTF16LEString(const QByteArray &baData, qint64 nOffset, qint32 nSize);
     static bool _isEmptyHash(const QByteArray &baHash);
+    static bool _linkOrCopyFile(const QString &sSourceFileName, const QString &sTargetFileName);
 private:
     INTERNAL_INFO m_internalInfo;
 };
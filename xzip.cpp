@@ -19,7 +19,12 @@
  * SOFTWARE.
  */
 #include "xzip.h"
+#include <QRunnable>
 #include <QSet>
+#include <QTemporaryFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QtEndian>
 #include <QUuid>
 #include "Algos/xdeflatedecoder.h"
 #include "Algos/ximplodedecoder.h"
@@ -91,8 +96,374 @@ static XBinary::PM_INFO createPMInfo(XBinary::HANDLE_METHOD hm0, XBinary::HANDLE
     return result;
 }
 
+// Sizes from this value on are stored in a ZIP64 extra field. The margin keeps a slightly
+// expanded deflate stream within the field reserved before compression.
+static const quint64 ZIP64_SIZE_THRESHOLD = 0xFF000000;
+
+static bool _isZip64SizesRequired(qint64 nUncompressedSize, qint64 nCompressedSize)
+{
+    return ((quint64)nUncompressedSize >= ZIP64_SIZE_THRESHOLD) || ((quint64)nCompressedSize >= 0xFFFFFFFF);
+}
+
+// Replaces 0xFFFFFFFF header values by the ZIP64 extended information extra field values.
+// The field holds only the sentinel values, in the order uncompressed, compressed, offset.
+static void _readZip64ExtraField(const char *pData, qint32 nSize, quint64 *pnUncompressedSize, quint64 *pnCompressedSize, quint64 *pnLocalHeaderOffset)
+{
+    qint32 nOffset = 0;
+
+    while ((nOffset + 4) <= nSize) {
+        quint16 nHeaderID = qFromLittleEndian<quint16>(pData + nOffset);
+        quint16 nDataSize = qFromLittleEndian<quint16>(pData + nOffset + 2);
+
+        if ((nOffset + 4 + (qint32)nDataSize) > nSize) {
+            break;
+        }
+
+        if (nHeaderID == XZip::ZIP64_EXTRA_FIELD_HEADER_ID) {
+            const char *pField = pData + nOffset + 4;
+            qint32 nFieldOffset = 0;
+            quint64 *pValues[3] = {pnUncompressedSize, pnCompressedSize, pnLocalHeaderOffset};
+
+            for (qint32 i = 0; i < 3; i++) {
+                if (pValues[i] && (*pValues[i] == 0xFFFFFFFF) && ((nFieldOffset + 8) <= nDataSize)) {
+                    *pValues[i] = qFromLittleEndian<quint64>(pField + nFieldOffset);
+                    nFieldOffset += 8;
+                }
+            }
+
+            break;
+        }
+
+        nOffset += 4 + nDataSize;
+    }
+}
+
+static QByteArray _createZip64ExtraField(const QList<quint64> &listValues)
+{
+    QByteArray baResult;
+
+    if (!listValues.isEmpty()) {
+        baResult.resize(4 + 8 * listValues.count());
+        char *pData = baResult.data();
+
+        qToLittleEndian<quint16>(XZip::ZIP64_EXTRA_FIELD_HEADER_ID, pData);
+        qToLittleEndian<quint16>((quint16)(8 * listValues.count()), pData + 2);
+
+        for (qint32 i = 0; i < listValues.count(); i++) {
+            qToLittleEndian<quint64>(listValues.at(i), pData + 4 + 8 * i);
+        }
+    }
+
+    return baResult;
+}
+
+namespace {
+// Staged output per packed file: in memory up to ZIP_PACK_SPILL_LIMIT, then in a temporary file
+const qint64 ZIP_PACK_SPILL_LIMIT = 0x200000;
+
+// Read-through device that updates the CRC32 of everything read from the wrapped input,
+// so a file is checksummed by the same read that compresses it
+class XZipCRC32InputDevice : public QIODevice {
+public:
+    explicit XZipCRC32InputDevice(QIODevice *pInputDevice) : m_pInputDevice(pInputDevice), m_nCRC32(0xFFFFFFFF)
+    {
+    }
+
+    bool isSequential() const override
+    {
+        return false;
+    }
+
+    qint64 size() const override
+    {
+        return m_pInputDevice->size();
+    }
+
+    // Only rewinding is supported; it restarts the checksum
+    bool seek(qint64 nPos) override
+    {
+        bool bResult = (nPos == 0) && QIODevice::seek(0) && m_pInputDevice->seek(0);
+
+        if (bResult) {
+            m_nCRC32 = 0xFFFFFFFF;
+        }
+
+        return bResult;
+    }
+
+    quint32 getCRC32() const
+    {
+        return m_nCRC32 ^ 0xFFFFFFFF;
+    }
+
+protected:
+    qint64 readData(char *pData, qint64 nMaxSize) override
+    {
+        qint64 nRead = m_pInputDevice->read(pData, nMaxSize);
+
+        if (nRead > 0) {
+            m_nCRC32 = XBinary::_getCRC32(pData, (qint32)nRead, m_nCRC32, XBinary::_getCRC32Table_EDB88320());
+        }
+
+        return nRead;
+    }
+
+    qint64 writeData(const char *pData, qint64 nMaxSize) override
+    {
+        Q_UNUSED(pData)
+        Q_UNUSED(nMaxSize)
+
+        return -1;
+    }
+
+private:
+    QIODevice *m_pInputDevice;
+    quint32 m_nCRC32;
+};
+
+// Append-only staging device: written once, then read back from the start
+class XZipSpillDevice : public QIODevice {
+public:
+    XZipSpillDevice() : m_pFile(nullptr)
+    {
+    }
+
+    ~XZipSpillDevice() override
+    {
+        delete m_pFile;
+    }
+
+    bool isSequential() const override
+    {
+        return false;
+    }
+
+    qint64 size() const override
+    {
+        return m_pFile ? m_pFile->size() : m_baData.size();
+    }
+
+protected:
+    qint64 readData(char *pData, qint64 nMaxSize) override
+    {
+        qint64 nResult = 0;
+
+        if (m_pFile) {
+            nResult = m_pFile->seek(pos()) ? m_pFile->read(pData, nMaxSize) : -1;
+        } else {
+            nResult = qMin(nMaxSize, (qint64)m_baData.size() - pos());
+
+            if (nResult > 0) {
+                memcpy(pData, m_baData.constData() + pos(), nResult);
+            }
+        }
+
+        return nResult;
+    }
+
+    qint64 writeData(const char *pData, qint64 nMaxSize) override
+    {
+        if ((!m_pFile) && ((m_baData.size() + nMaxSize) > ZIP_PACK_SPILL_LIMIT)) {
+            m_pFile = new QTemporaryFile();
+
+            if ((!m_pFile->open()) || (m_pFile->write(m_baData) != m_baData.size())) {
+                delete m_pFile;
+                m_pFile = nullptr;
+
+                return -1;
+            }
+
+            m_baData = QByteArray();
+        }
+
+        qint64 nResult = nMaxSize;
+
+        if (m_pFile) {
+            nResult = m_pFile->seek(m_pFile->size()) ? m_pFile->write(pData, nMaxSize) : -1;
+        } else {
+            m_baData.append(pData, (qint32)nMaxSize);
+        }
+
+        return nResult;
+    }
+
+private:
+    QByteArray m_baData;
+    QTemporaryFile *m_pFile;
+};
+
+// Compresses (and encrypts) one file into a staging device on a pool thread
+class ZipPackRunnable : public QRunnable {
+public:
+    ZipPackRunnable(const XZip::ZIP_PACK_JOB &job, XBinary::PDSTRUCT *pPdStruct)
+        : m_job(job), m_pPdStruct(pPdStruct), m_pOutput(new XZipSpillDevice), m_nCRC32(0), m_bSuccess(false), m_bParallel(false)
+    {
+        setAutoDelete(false);
+    }
+
+    ~ZipPackRunnable() override
+    {
+        delete m_pOutput;
+    }
+
+    QIODevice *getOutput() const
+    {
+        return m_pOutput;
+    }
+
+    quint32 getCRC32() const
+    {
+        return m_nCRC32;
+    }
+
+    bool isSuccess() const
+    {
+        return m_bSuccess;
+    }
+
+    // Only a task that runs alone may split its deflate stream over the pool
+    void setParallel(bool bParallel)
+    {
+        m_bParallel = bParallel;
+    }
+
+    void run() override
+    {
+        qint64 nFileSize = m_job.record.nUncompressedSize;
+
+        QFile file(m_job.sFilePath);
+
+        if (file.open(QIODevice::ReadOnly)) {
+            XZipCRC32InputDevice crcDevice(&file);
+
+            if (crcDevice.open(QIODevice::ReadOnly | QIODevice::Unbuffered) && m_pOutput->open(QIODevice::ReadWrite | QIODevice::Unbuffered)) {
+                if (m_job.record.method == XZip::CMETHOD_DEFLATE) {
+                    XBinary::DATAPROCESS_STATE compressState = {};
+                    compressState.pDeviceInput = &crcDevice;
+                    compressState.pDeviceOutput = m_pOutput;
+                    compressState.nInputOffset = 0;
+                    compressState.nInputLimit = nFileSize;
+
+                    m_bSuccess = XDeflateDecoder::compress(&compressState, m_pPdStruct, m_job.nCompressionLevel, m_bParallel);
+                } else {
+                    m_bSuccess = true;
+
+                    for (qint64 nOffset = 0; (nOffset < nFileSize) && m_bSuccess && XBinary::isPdStructNotCanceled(m_pPdStruct);) {
+                        QByteArray baBuffer = crcDevice.read(qMin((qint64)0x10000, nFileSize - nOffset));
+
+                        m_bSuccess = (!baBuffer.isEmpty()) && (m_pOutput->write(baBuffer) == baBuffer.size());
+                        nOffset += baBuffer.size();
+                    }
+                }
+
+                m_nCRC32 = crcDevice.getCRC32();
+            }
+
+            file.close();
+        }
+
+        // ZipCrypto seeds its header with the CRC, so it runs over the staged output
+        if (m_bSuccess && (m_job.record.nFlags & 0x01)) {
+            XZipSpillDevice *pEncrypted = new XZipSpillDevice;
+
+            m_bSuccess = false;
+
+            if (pEncrypted->open(QIODevice::ReadWrite | QIODevice::Unbuffered)) {
+                XBinary::DATAPROCESS_STATE encryptState = {};
+                encryptState.pDeviceInput = m_pOutput;
+                encryptState.pDeviceOutput = pEncrypted;
+                encryptState.nInputOffset = 0;
+                encryptState.nInputLimit = m_pOutput->size();
+
+                m_bSuccess = XZipCryptoDecoder::encrypt(&encryptState, m_job.sPassword, m_nCRC32, m_pPdStruct);
+            }
+
+            delete m_pOutput;
+            m_pOutput = pEncrypted;
+        }
+
+        m_bSuccess = m_bSuccess && XBinary::isPdStructNotCanceled(m_pPdStruct);
+    }
+
+private:
+    XZip::ZIP_PACK_JOB m_job;
+    XBinary::PDSTRUCT *m_pPdStruct;
+    XZipSpillDevice *m_pOutput;
+    quint32 m_nCRC32;
+    bool m_bSuccess;
+    bool m_bParallel;
+};
+
+// Returns the header size, or -1 on a write error
+qint64 _writeLocalFileHeader(QIODevice *pDest, XZip::ZIPFILE_RECORD *pRecord)
+{
+    bool bZip64 = _isZip64SizesRequired(pRecord->nUncompressedSize, pRecord->nCompressedSize);
+    QByteArray baExtraField;
+
+    if (bZip64) {
+        baExtraField = _createZip64ExtraField(QList<quint64>() << (quint64)pRecord->nUncompressedSize << (quint64)pRecord->nCompressedSize);
+        pRecord->nMinVersion = 45;
+    }
+
+    QPair<quint16, quint16> dosDateTime = XBinary::qDateTimeToDosDateTime(pRecord->dtTime);
+    QByteArray baFileName = pRecord->sFileName.toUtf8();
+
+    XZip::LOCALFILEHEADER localFileHeader = {};
+    localFileHeader.nSignature = XZip::SIGNATURE_LFD;
+    localFileHeader.nMinVersion = pRecord->nMinVersion;
+    localFileHeader.nMinOS = pRecord->nMinOS;
+    localFileHeader.nFlags = pRecord->nFlags;
+    localFileHeader.nMethod = pRecord->method;
+    localFileHeader.nLastModTime = dosDateTime.second;
+    localFileHeader.nLastModDate = dosDateTime.first;
+    localFileHeader.nCRC32 = pRecord->nCRC32;
+    localFileHeader.nCompressedSize = bZip64 ? 0xFFFFFFFF : (quint32)pRecord->nCompressedSize;
+    localFileHeader.nUncompressedSize = bZip64 ? 0xFFFFFFFF : (quint32)pRecord->nUncompressedSize;
+    localFileHeader.nFileNameLength = baFileName.size();
+    localFileHeader.nExtraFieldLength = baExtraField.size();
+
+    qint64 nResult = -1;
+
+    if ((pDest->write((char *)&localFileHeader, sizeof(localFileHeader)) == sizeof(localFileHeader)) && (pDest->write(baFileName) == baFileName.size()) &&
+        (pDest->write(baExtraField) == baExtraField.size())) {
+        nResult = sizeof(localFileHeader) + baFileName.size() + baExtraField.size();
+    }
+
+    return nResult;
+}
+
+bool _copyPackData(QIODevice *pSource, QIODevice *pDest, qint64 nSize, XBinary::PDSTRUCT *pPdStruct, quint32 *pnCRC32 = nullptr)
+{
+    bool bResult = true;
+    quint32 nCRC32 = 0xFFFFFFFF;
+
+    for (qint64 nOffset = 0; (nOffset < nSize) && bResult && XBinary::isPdStructNotCanceled(pPdStruct);) {
+        QByteArray baBuffer = pSource->read(qMin((qint64)0x10000, nSize - nOffset));
+
+        bResult = (!baBuffer.isEmpty()) && (pDest->write(baBuffer) == baBuffer.size());
+
+        if (pnCRC32) {
+            nCRC32 = XBinary::_getCRC32(baBuffer.constData(), baBuffer.size(), nCRC32, XBinary::_getCRC32Table_EDB88320());
+        }
+
+        nOffset += baBuffer.size();
+    }
+
+    if (pnCRC32) {
+        *pnCRC32 = nCRC32 ^ 0xFFFFFFFF;
+    }
+
+    return bResult && XBinary::isPdStructNotCanceled(pPdStruct);
+}
+}  // namespace
+
 XZip::XZip(QIODevice *pDevice) : XArchive(pDevice)
 {
+    m_cdTable.bIsParsed = false;
+    m_cdTable.nECDOffset = -1;
+    m_cdTable.nECD64Offset = -1;
+    m_cdTable.nCentralDirectoryOffset = 0;
+    m_cdTable.nCentralDirectorySize = 0;
 }
 
 bool XZip::isValid(PDSTRUCT *pPdStruct)
@@ -123,12 +494,12 @@ QString XZip::getVersion()
 {
     QString sResult;
 
-    qint64 nECDOffset = findECDOffset(nullptr);
+    const CD_TABLE *pTable = getCentralDirectoryTable(nullptr);
 
     quint16 nVersion = 0;
 
-    if (nECDOffset != -1) {
-        qint64 nOffset = read_uint32(nECDOffset + offsetof(ENDOFCENTRALDIRECTORYRECORD, nOffsetToCentralDirectory));
+    if (pTable->nECDOffset != -1) {
+        qint64 nOffset = pTable->nCentralDirectoryOffset;
 
         quint32 nSignature = read_uint32(nOffset + offsetof(CENTRALDIRECTORYFILEHEADER, nSignature));
 
@@ -156,38 +527,18 @@ QString XZip::getVersion()
 bool XZip::isEncrypted()
 {
     qint64 nTotalSize = getSize();
-    qint64 nECDOffset = findECDOffset(nullptr);
+    const CD_TABLE *pTable = getCentralDirectoryTable(nullptr);
 
-    if ((nECDOffset >= 0) && ((nECDOffset + (qint64)sizeof(ENDOFCENTRALDIRECTORYRECORD)) <= nTotalSize)) {
-        qint64 nOffset = read_uint32(nECDOffset + offsetof(ENDOFCENTRALDIRECTORYRECORD, nOffsetToCentralDirectory));
-        quint16 nNumberOfRecords = read_uint16(nECDOffset + offsetof(ENDOFCENTRALDIRECTORYRECORD, nTotalNumberOfRecords));
-        bool bCentralDirectoryFound = false;
+    if (pTable->nECDOffset != -1) {
+        for (qint32 i = 0; i < pTable->listEntries.count(); i++) {
+            const CD_ENTRY &entry = pTable->listEntries.at(i);
 
-        for (quint16 i = 0; i < nNumberOfRecords; i++) {
-            if ((nOffset < 0) || ((nOffset + (qint64)sizeof(CENTRALDIRECTORYFILEHEADER)) > nTotalSize) || (read_uint32(nOffset) != SIGNATURE_CFD)) {
-                break;
-            }
-
-            CENTRALDIRECTORYFILEHEADER cdfh = read_CENTRALDIRECTORYFILEHEADER(nOffset, nullptr);
-            bCentralDirectoryFound = true;
-
-            if ((cdfh.nFlags & 0x0001) || (cdfh.nMethod == CMETHOD_AES)) {
+            if ((entry.nFlags & 0x0001) || (entry.nMethod == CMETHOD_AES)) {
                 return true;
             }
-
-            qint64 nRecordSize = sizeof(CENTRALDIRECTORYFILEHEADER) + (qint64)cdfh.nFileNameLength + (qint64)cdfh.nExtraFieldLength +
-                                 (qint64)cdfh.nFileCommentLength;
-
-            if ((nRecordSize <= 0) || (nRecordSize > (nTotalSize - nOffset))) {
-                break;
-            }
-
-            nOffset += nRecordSize;
         }
 
-        if (bCentralDirectoryFound || (nNumberOfRecords == 0)) {
-            return false;
-        }
+        return false;
     }
 
     qint64 nOffset = 0;
@@ -199,9 +550,13 @@ bool XZip::isEncrypted()
             return true;
         }
 
-        qint64 nRecordSize = sizeof(LOCALFILEHEADER) + (qint64)lfh.nFileNameLength + (qint64)lfh.nExtraFieldLength + (qint64)lfh.nCompressedSize;
+        quint64 nUncompressedSize = 0;
+        quint64 nCompressedSize = 0;
+        _readLocalZip64Sizes(nOffset, lfh, &nUncompressedSize, &nCompressedSize);
+
+        qint64 nRecordSize = sizeof(LOCALFILEHEADER) + (qint64)lfh.nFileNameLength + (qint64)lfh.nExtraFieldLength + (qint64)nCompressedSize;
 
-        if ((nRecordSize <= 0) || (nRecordSize > (nTotalSize - nOffset))) {
+        if ((nCompressedSize > (quint64)nTotalSize) || (nRecordSize <= 0) || (nRecordSize > (nTotalSize - nOffset))) {
             break;
         }
 
@@ -250,28 +605,16 @@ QString XZip::getCompressMethodString()
 
     QSet<HANDLE_METHOD> stMethods;
 
-    qint64 nECDOffset = findECDOffset(nullptr);
-
-    if (nECDOffset != -1) {
-        qint64 nOffset = read_uint32(nECDOffset + offsetof(ENDOFCENTRALDIRECTORYRECORD, nOffsetToCentralDirectory));
-
-        for (int i = 0; i < 20; i++) {
-            quint32 nSignature = read_uint32(nOffset + offsetof(CENTRALDIRECTORYFILEHEADER, nSignature));
+    const CD_TABLE *pTable = getCentralDirectoryTable(nullptr);
 
-            if (nSignature == SIGNATURE_CFD) {
-                quint16 nMethod = read_uint16(nOffset + offsetof(CENTRALDIRECTORYFILEHEADER, nMethod));
-                quint16 nFlags = read_uint16(nOffset + offsetof(CENTRALDIRECTORYFILEHEADER, nFlags));
-                quint32 nUncompressedSize = read_uint32(nOffset + offsetof(CENTRALDIRECTORYFILEHEADER, nUncompressedSize));
+    if (pTable->nECDOffset != -1) {
+        qint32 nNumberOfRecords = qMin(pTable->listEntries.count(), 20);
 
-                if (nUncompressedSize > 0) {
-                    stMethods.insert(zipToCompressMethod(nMethod, nFlags));
-                }
+        for (qint32 i = 0; i < nNumberOfRecords; i++) {
+            const CD_ENTRY &entry = pTable->listEntries.at(i);
 
-                nOffset += (sizeof(CENTRALDIRECTORYFILEHEADER) + read_uint16(nOffset + offsetof(CENTRALDIRECTORYFILEHEADER, nFileNameLength)) +
-                            read_uint16(nOffset + offsetof(CENTRALDIRECTORYFILEHEADER, nExtraFieldLength)) +
-                            read_uint16(nOffset + offsetof(CENTRALDIRECTORYFILEHEADER, nFileCommentLength)));
-            } else {
-                break;
+            if (entry.nUncompressedSize > 0) {
+                stMethods.insert(zipToCompressMethod(entry.nMethod, entry.nFlags));
             }
         }
     } else {
@@ -444,6 +787,19 @@ bool XZip::addLocalFileRecord(QIODevice *pSource, QIODevice *pDest, ZIPFILE_RECO
 
     pZipFileRecord->nHeaderOffset = pDest->pos();
 
+    // The compressed size is not known yet, so ZIP64 is decided by the uncompressed size
+    bool bZip64 = _isZip64SizesRequired(pZipFileRecord->nUncompressedSize, 0);
+    QByteArray baExtraField;
+
+    if (bZip64) {
+        // A local ZIP64 extra field holds both sizes; the compressed one is patched below
+        baExtraField = _createZip64ExtraField(QList<quint64>() << (quint64)pZipFileRecord->nUncompressedSize << 0);
+
+        if (pZipFileRecord->nMinVersion < 45) {
+            pZipFileRecord->nMinVersion = 45;
+        }
+    }
+
     XZip::LOCALFILEHEADER localFileHeader = {};
     localFileHeader.nSignature = XZip::SIGNATURE_LFD;
     localFileHeader.nMinVersion = pZipFileRecord->nMinVersion;
@@ -452,12 +808,12 @@ bool XZip::addLocalFileRecord(QIODevice *pSource, QIODevice *pDest, ZIPFILE_RECO
     localFileHeader.nLastModTime = 0;  // TODO
     localFileHeader.nLastModDate = 0;  // TODO
     localFileHeader.nCRC32 = pZipFileRecord->nCRC32;
-    localFileHeader.nCompressedSize = 0;
-    localFileHeader.nUncompressedSize = pZipFileRecord->nUncompressedSize;
+    localFileHeader.nCompressedSize = bZip64 ? 0xFFFFFFFF : 0;
+    localFileHeader.nUncompressedSize = bZip64 ? 0xFFFFFFFF : (quint32)pZipFileRecord->nUncompressedSize;
     QByteArray baFileName = pZipFileRecord->sFileName.toUtf8();
 
     localFileHeader.nFileNameLength = baFileName.size();
-    localFileHeader.nExtraFieldLength = 0;
+    localFileHeader.nExtraFieldLength = baExtraField.size();
 
     if (pDest->write((char *)&localFileHeader, sizeof(localFileHeader)) != sizeof(localFileHeader)) {
         return false;
@@ -467,6 +823,10 @@ bool XZip::addLocalFileRecord(QIODevice *pSource, QIODevice *pDest, ZIPFILE_RECO
         return false;
     }
 
+    if (pDest->write(baExtraField.data(), baExtraField.size()) != baExtraField.size()) {
+        return false;
+    }
+
     pZipFileRecord->nDataOffset = pDest->pos();
 
     if (XArchive::_compress(XArchive::HANDLE_METHOD_DEFLATE, pSource, pDest, pPdStruct) != XArchive::COMPRESS_RESULT_OK) {
@@ -477,15 +837,33 @@ bool XZip::addLocalFileRecord(QIODevice *pSource, QIODevice *pDest, ZIPFILE_RECO
 
     pZipFileRecord->nCompressedSize = (nEndPosition) - (pZipFileRecord->nDataOffset);
 
-    if (!pDest->seek(pZipFileRecord->nHeaderOffset + offsetof(XZip::LOCALFILEHEADER, nCompressedSize))) {
-        return false;
-    }
+    if (bZip64) {
+        // Second value of the ZIP64 extra field
+        if (!pDest->seek(pZipFileRecord->nHeaderOffset + sizeof(XZip::LOCALFILEHEADER) + baFileName.size() + 4 + 8)) {
+            return false;
+        }
 
-    char szCompressedSize[sizeof(quint32)] = {};
-    XBinary::_write_uint32(szCompressedSize, (quint32)pZipFileRecord->nCompressedSize);
+        char szCompressedSize[sizeof(quint64)] = {};
+        qToLittleEndian<quint64>((quint64)pZipFileRecord->nCompressedSize, szCompressedSize);
 
-    if (pDest->write(szCompressedSize, sizeof(szCompressedSize)) != sizeof(szCompressedSize)) {
-        return false;
+        if (pDest->write(szCompressedSize, sizeof(szCompressedSize)) != sizeof(szCompressedSize)) {
+            return false;
+        }
+    } else {
+        if ((quint64)pZipFileRecord->nCompressedSize >= 0xFFFFFFFF) {
+            return false;
+        }
+
+        if (!pDest->seek(pZipFileRecord->nHeaderOffset + offsetof(XZip::LOCALFILEHEADER, nCompressedSize))) {
+            return false;
+        }
+
+        char szCompressedSize[sizeof(quint32)] = {};
+        XBinary::_write_uint32(szCompressedSize, (quint32)pZipFileRecord->nCompressedSize);
+
+        if (pDest->write(szCompressedSize, sizeof(szCompressedSize)) != sizeof(szCompressedSize)) {
+            return false;
+        }
     }
 
     if (!pDest->seek(nEndPosition)) {
@@ -502,50 +880,109 @@ bool XZip::addCentralDirectory(QIODevice *pDest, QList<XZip::ZIPFILE_RECORD> *pL
     qint32 nNumberOfRecords = pListZipFileRecords->count();
 
     for (qint32 i = 0; i < nNumberOfRecords; i++) {
+        const ZIPFILE_RECORD &record = pListZipFileRecords->at(i);
+
+        // Values that do not fit are moved to a ZIP64 extra field, in the order the format defines
+        bool bZip64Sizes = _isZip64SizesRequired(record.nUncompressedSize, record.nCompressedSize);
+        bool bZip64Offset = ((quint64)record.nHeaderOffset >= 0xFFFFFFFF);
+        QList<quint64> listZip64Values;
+
+        if (bZip64Sizes) {
+            listZip64Values.append((quint64)record.nUncompressedSize);
+            listZip64Values.append((quint64)record.nCompressedSize);
+        }
+
+        if (bZip64Offset) {
+            listZip64Values.append((quint64)record.nHeaderOffset);
+        }
+
+        QByteArray baExtraField = _createZip64ExtraField(listZip64Values);
+
         XZip::CENTRALDIRECTORYFILEHEADER cdFileHeader = {};
 
         cdFileHeader.nSignature = SIGNATURE_CFD;
-        cdFileHeader.nVersion = pListZipFileRecords->at(i).nVersion;
-        cdFileHeader.nOS = pListZipFileRecords->at(i).nOS;
-        cdFileHeader.nMinVersion = pListZipFileRecords->at(i).nMinVersion;
-        cdFileHeader.nMinOS = pListZipFileRecords->at(i).nMinOS;
-        cdFileHeader.nFlags = pListZipFileRecords->at(i).nFlags;
-        cdFileHeader.nMethod = (quint16)pListZipFileRecords->at(i).method;
+        cdFileHeader.nVersion = record.nVersion;
+        cdFileHeader.nOS = record.nOS;
+        cdFileHeader.nMinVersion = record.nMinVersion;
+        cdFileHeader.nMinOS = record.nMinOS;
+        cdFileHeader.nFlags = record.nFlags;
+        cdFileHeader.nMethod = (quint16)record.method;
         cdFileHeader.nLastModTime = 0;  // TODO
         cdFileHeader.nLastModDate = 0;  // TODO
-        cdFileHeader.nCRC32 = pListZipFileRecords->at(i).nCRC32;
-        cdFileHeader.nCompressedSize = (quint32)pListZipFileRecords->at(i).nCompressedSize;
-        cdFileHeader.nUncompressedSize = (quint32)pListZipFileRecords->at(i).nUncompressedSize;
-        cdFileHeader.nFileNameLength = (quint16)pListZipFileRecords->at(i).sFileName.toUtf8().size();
-        cdFileHeader.nExtraFieldLength = 0;
+        cdFileHeader.nCRC32 = record.nCRC32;
+        cdFileHeader.nCompressedSize = bZip64Sizes ? 0xFFFFFFFF : (quint32)record.nCompressedSize;
+        cdFileHeader.nUncompressedSize = bZip64Sizes ? 0xFFFFFFFF : (quint32)record.nUncompressedSize;
+        cdFileHeader.nFileNameLength = (quint16)record.sFileName.toUtf8().size();
+        cdFileHeader.nExtraFieldLength = baExtraField.size();
         cdFileHeader.nFileCommentLength = 0;
         cdFileHeader.nStartDisk = 0;
         cdFileHeader.nInternalFileAttributes = 0;
-        cdFileHeader.nExternalFileAttributes = pListZipFileRecords->at(i).nExternalFileAttributes;
-        cdFileHeader.nOffsetToLocalFileHeader = (quint32)pListZipFileRecords->at(i).nHeaderOffset;
+        cdFileHeader.nExternalFileAttributes = record.nExternalFileAttributes;
+        cdFileHeader.nOffsetToLocalFileHeader = bZip64Offset ? 0xFFFFFFFF : (quint32)record.nHeaderOffset;
+
+        if (!listZip64Values.isEmpty() && (cdFileHeader.nMinVersion < 45)) {
+            cdFileHeader.nMinVersion = 45;
+        }
 
         if (pDest->write((char *)&cdFileHeader, sizeof(cdFileHeader)) != sizeof(cdFileHeader)) {
             return false;
         }
 
-        QByteArray baFileName = pListZipFileRecords->at(i).sFileName.toUtf8();
+        QByteArray baFileName = record.sFileName.toUtf8();
 
         if (pDest->write(baFileName.data(), baFileName.size()) != baFileName.size()) {
             return false;
         }
+
+        if (pDest->write(baExtraField.data(), baExtraField.size()) != baExtraField.size()) {
+            return false;
+        }
     }
 
-    qint64 nCentralDirectorySize = pDest->pos() - nStartPosition;
+    qint64 nEndPosition = pDest->pos();
+    qint64 nCentralDirectorySize = nEndPosition - nStartPosition;
+
+    bool bZip64 = (nNumberOfRecords >= 0xFFFF) || ((quint64)nCentralDirectorySize >= 0xFFFFFFFF) || ((quint64)nStartPosition >= 0xFFFFFFFF);
+
+    if (bZip64) {
+        ENDOFCENTRALDIRECTORYRECORD64 endofCD64 = {};
+
+        endofCD64.nSignature = SIGNATURE_ECD64;
+        endofCD64.nSizeOfRecord = sizeof(ENDOFCENTRALDIRECTORYRECORD64) - 12;
+        endofCD64.nVersion = 45;
+        endofCD64.nMinVersion = 45;
+        endofCD64.nDiskNumber = 0;
+        endofCD64.nStartDisk = 0;
+        endofCD64.nDiskNumberOfRecords = nNumberOfRecords;
+        endofCD64.nTotalNumberOfRecords = nNumberOfRecords;
+        endofCD64.nSizeOfCentralDirectory = nCentralDirectorySize;
+        endofCD64.nOffsetToCentralDirectory = nStartPosition;
+
+        if (pDest->write((char *)&endofCD64, sizeof(endofCD64)) != sizeof(endofCD64)) {
+            return false;
+        }
+
+        ENDOFCENTRALDIRECTORYLOCATOR64 locator64 = {};
+
+        locator64.nSignature = SIGNATURE_ECD64_LOCATOR;
+        locator64.nStartDisk = 0;
+        locator64.nOffsetToECD64 = nEndPosition;
+        locator64.nTotalDisks = 1;
+
+        if (pDest->write((char *)&locator64, sizeof(locator64)) != sizeof(locator64)) {
+            return false;
+        }
+    }
 
     ENDOFCENTRALDIRECTORYRECORD endofCD = {};
 
     endofCD.nSignature = SIGNATURE_ECD;
     endofCD.nDiskNumber = 0;
     endofCD.nStartDisk = 0;
-    endofCD.nDiskNumberOfRecords = nNumberOfRecords;
-    endofCD.nTotalNumberOfRecords = nNumberOfRecords;
-    endofCD.nSizeOfCentralDirectory = nCentralDirectorySize;
-    endofCD.nOffsetToCentralDirectory = nStartPosition;
+    endofCD.nDiskNumberOfRecords = (nNumberOfRecords >= 0xFFFF) ? 0xFFFF : nNumberOfRecords;
+    endofCD.nTotalNumberOfRecords = endofCD.nDiskNumberOfRecords;
+    endofCD.nSizeOfCentralDirectory = ((quint64)nCentralDirectorySize >= 0xFFFFFFFF) ? 0xFFFFFFFF : (quint32)nCentralDirectorySize;
+    endofCD.nOffsetToCentralDirectory = ((quint64)nStartPosition >= 0xFFFFFFFF) ? 0xFFFFFFFF : (quint32)nStartPosition;
     QByteArray baComment = sComment.toUtf8();
 
     endofCD.nCommentLength = baComment.size();
@@ -661,9 +1098,51 @@ XZip::AES_EXTRA_FIELD XZip::read_AES_EXTRA_FIELD(qint64 nOffset, PDSTRUCT *pPdSt
     return result;
 }
 
+static XZip::CENTRALDIRECTORYFILEHEADER _bufferToCENTRALDIRECTORYFILEHEADER(const char *pData)
+{
+    XZip::CENTRALDIRECTORYFILEHEADER result = {};
+
+    result.nSignature = qFromLittleEndian<quint32>(pData + offsetof(XZip::CENTRALDIRECTORYFILEHEADER, nSignature));
+    result.nVersion = (quint8)pData[offsetof(XZip::CENTRALDIRECTORYFILEHEADER, nVersion)];
+    result.nOS = (quint8)pData[offsetof(XZip::CENTRALDIRECTORYFILEHEADER, nOS)];
+    result.nMinVersion = (quint8)pData[offsetof(XZip::CENTRALDIRECTORYFILEHEADER, nMinVersion)];
+    result.nMinOS = (quint8)pData[offsetof(XZip::CENTRALDIRECTORYFILEHEADER, nMinOS)];
+    result.nFlags = qFromLittleEndian<quint16>(pData + offsetof(XZip::CENTRALDIRECTORYFILEHEADER, nFlags));
+    result.nMethod = qFromLittleEndian<quint16>(pData + offsetof(XZip::CENTRALDIRECTORYFILEHEADER, nMethod));
+    result.nLastModTime = qFromLittleEndian<quint16>(pData + offsetof(XZip::CENTRALDIRECTORYFILEHEADER, nLastModTime));
+    result.nLastModDate = qFromLittleEndian<quint16>(pData + offsetof(XZip::CENTRALDIRECTORYFILEHEADER, nLastModDate));
+    result.nCRC32 = qFromLittleEndian<quint32>(pData + offsetof(XZip::CENTRALDIRECTORYFILEHEADER, nCRC32));
+    result.nCompressedSize = qFromLittleEndian<quint32>(pData + offsetof(XZip::CENTRALDIRECTORYFILEHEADER, nCompressedSize));
+    result.nUncompressedSize = qFromLittleEndian<quint32>(pData + offsetof(XZip::CENTRALDIRECTORYFILEHEADER, nUncompressedSize));
+    result.nFileNameLength = qFromLittleEndian<quint16>(pData + offsetof(XZip::CENTRALDIRECTORYFILEHEADER, nFileNameLength));
+    result.nExtraFieldLength = qFromLittleEndian<quint16>(pData + offsetof(XZip::CENTRALDIRECTORYFILEHEADER, nExtraFieldLength));
+    result.nFileCommentLength = qFromLittleEndian<quint16>(pData + offsetof(XZip::CENTRALDIRECTORYFILEHEADER, nFileCommentLength));
+    result.nStartDisk = qFromLittleEndian<quint16>(pData + offsetof(XZip::CENTRALDIRECTORYFILEHEADER, nStartDisk));
+    result.nInternalFileAttributes = qFromLittleEndian<quint16>(pData + offsetof(XZip::CENTRALDIRECTORYFILEHEADER, nInternalFileAttributes));
+    result.nExternalFileAttributes = qFromLittleEndian<quint32>(pData + offsetof(XZip::CENTRALDIRECTORYFILEHEADER, nExternalFileAttributes));
+    result.nOffsetToLocalFileHeader = qFromLittleEndian<quint32>(pData + offsetof(XZip::CENTRALDIRECTORYFILEHEADER, nOffsetToLocalFileHeader));
+
+    return result;
+}
+
 qint64 XZip::findECDOffset(PDSTRUCT *pPdStruct)
 {
-    qint64 nResult = -1;
+    return getCentralDirectoryTable(pPdStruct)->nECDOffset;
+}
+
+const XZip::CD_TABLE *XZip::getCentralDirectoryTable(PDSTRUCT *pPdStruct)
+{
+    if (m_cdTable.bIsParsed) {
+        return &m_cdTable;
+    }
+
+    m_cdTable.nECDOffset = -1;
+    m_cdTable.nECD64Offset = -1;
+    m_cdTable.nCentralDirectoryOffset = 0;
+    m_cdTable.nCentralDirectorySize = 0;
+    m_cdTable.listEntries.clear();
+    m_cdTable.baNames.clear();
+
     qint64 nSize = getSize();
 
     if (nSize >= 22)  // 22 is minimum size [0x50,0x4B,0x05,0x06,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00]
@@ -689,57 +1168,131 @@ qint64 XZip::findECDOffset(PDSTRUCT *pPdStruct)
                 continue;
             }
 
-            quint16 nDiskNumber = read_uint16(nCurrent + offsetof(ENDOFCENTRALDIRECTORYRECORD, nDiskNumber));
-            quint16 nStartDisk = read_uint16(nCurrent + offsetof(ENDOFCENTRALDIRECTORYRECORD, nStartDisk));
-            quint16 nDiskRecords = read_uint16(nCurrent + offsetof(ENDOFCENTRALDIRECTORYRECORD, nDiskNumberOfRecords));
-            quint16 nTotalRecords = read_uint16(nCurrent + offsetof(ENDOFCENTRALDIRECTORYRECORD, nTotalNumberOfRecords));
-            quint32 nCentralDirectorySize = read_uint32(nCurrent + offsetof(ENDOFCENTRALDIRECTORYRECORD, nSizeOfCentralDirectory));
+            quint64 nTotalRecords = read_uint16(nCurrent + offsetof(ENDOFCENTRALDIRECTORYRECORD, nTotalNumberOfRecords));
+            quint64 nCentralDirectorySize = read_uint32(nCurrent + offsetof(ENDOFCENTRALDIRECTORYRECORD, nSizeOfCentralDirectory));
             qint64 nOffsetToCentralDirectory = read_uint32(nCurrent + offsetof(ENDOFCENTRALDIRECTORYRECORD, nOffsetToCentralDirectory));
+            qint64 nCentralDirectoryEnd = nCurrent;
+            qint64 nECD64Offset = -1;
+
+            // A ZIP64 locator directly precedes the ECD and points to the ZIP64 ECD record,
+            // which follows the central directory and holds the 64-bit counts and offsets.
+            qint64 nLocatorOffset = nCurrent - (qint64)sizeof(ENDOFCENTRALDIRECTORYLOCATOR64);
+
+            if ((nLocatorOffset >= (qint64)sizeof(ENDOFCENTRALDIRECTORYRECORD64)) && (read_uint32(nLocatorOffset) == SIGNATURE_ECD64_LOCATOR)) {
+                quint32 nLocatorStartDisk = read_uint32(nLocatorOffset + offsetof(ENDOFCENTRALDIRECTORYLOCATOR64, nStartDisk));
+                quint32 nTotalDisks = read_uint32(nLocatorOffset + offsetof(ENDOFCENTRALDIRECTORYLOCATOR64, nTotalDisks));
+                quint64 nOffsetToECD64 = read_uint64(nLocatorOffset + offsetof(ENDOFCENTRALDIRECTORYLOCATOR64, nOffsetToECD64));
+
+                if ((nLocatorStartDisk != 0) || (nTotalDisks > 1) ||
+                    (nOffsetToECD64 > (quint64)(nLocatorOffset - (qint64)sizeof(ENDOFCENTRALDIRECTORYRECORD64)))) {
+                    continue;
+                }
+
+                nECD64Offset = (qint64)nOffsetToECD64;
+
+                quint64 nSizeOfRecord = read_uint64(nECD64Offset + offsetof(ENDOFCENTRALDIRECTORYRECORD64, nSizeOfRecord));
+                quint32 nDiskNumber = read_uint32(nECD64Offset + offsetof(ENDOFCENTRALDIRECTORYRECORD64, nDiskNumber));
+                quint32 nStartDisk = read_uint32(nECD64Offset + offsetof(ENDOFCENTRALDIRECTORYRECORD64, nStartDisk));
+                quint64 nDiskRecords = read_uint64(nECD64Offset + offsetof(ENDOFCENTRALDIRECTORYRECORD64, nDiskNumberOfRecords));
+
+                nTotalRecords = read_uint64(nECD64Offset + offsetof(ENDOFCENTRALDIRECTORYRECORD64, nTotalNumberOfRecords));
+                nCentralDirectorySize = read_uint64(nECD64Offset + offsetof(ENDOFCENTRALDIRECTORYRECORD64, nSizeOfCentralDirectory));
+
+                quint64 nOffsetToCentralDirectory64 = read_uint64(nECD64Offset + offsetof(ENDOFCENTRALDIRECTORYRECORD64, nOffsetToCentralDirectory));
 
-            // Multi-disk and ZIP64 archives need different record layouts and
-            // are not implemented by this reader. Do not reinterpret their
-            // sentinel values as ordinary 32-bit offsets/counts.
-            if ((nDiskNumber != 0) || (nStartDisk != 0) || (nDiskRecords != nTotalRecords) ||
-                (nTotalRecords == 0xFFFF) || (nCentralDirectorySize == 0xFFFFFFFF) ||
-                (nOffsetToCentralDirectory == 0xFFFFFFFF)) {
+                // The record, including its extensible data, ends at the locator
+                if ((read_uint32(nECD64Offset) != SIGNATURE_ECD64) || (nSizeOfRecord != (quint64)(nLocatorOffset - nECD64Offset - 12)) ||
+                    (nDiskNumber != 0) || (nStartDisk != 0) || (nDiskRecords != nTotalRecords) || (nOffsetToCentralDirectory64 > (quint64)nECD64Offset)) {
+                    continue;
+                }
+
+                nOffsetToCentralDirectory = (qint64)nOffsetToCentralDirectory64;
+                nCentralDirectoryEnd = nECD64Offset;
+            } else {
+                quint16 nDiskNumber = read_uint16(nCurrent + offsetof(ENDOFCENTRALDIRECTORYRECORD, nDiskNumber));
+                quint16 nStartDisk = read_uint16(nCurrent + offsetof(ENDOFCENTRALDIRECTORYRECORD, nStartDisk));
+                quint16 nDiskRecords = read_uint16(nCurrent + offsetof(ENDOFCENTRALDIRECTORYRECORD, nDiskNumberOfRecords));
+
+                // Multi-disk archives are not implemented by this reader. Sentinel
+                // values without a ZIP64 locator must not be reinterpreted as
+                // ordinary 32-bit offsets/counts.
+                if ((nDiskNumber != 0) || (nStartDisk != 0) || (nDiskRecords != nTotalRecords) ||
+                    (nTotalRecords == 0xFFFF) || (nCentralDirectorySize == 0xFFFFFFFF) ||
+                    (nOffsetToCentralDirectory == 0xFFFFFFFF)) {
+                    continue;
+                }
+
+                if (nTotalRecords == 0) {
+                    if ((nCurrent == 0) && (nCentralDirectorySize == 0) && (nOffsetToCentralDirectory == 0)) {
+                        m_cdTable.nECDOffset = nCurrent;
+                        m_cdTable.nECD64Offset = -1;
+                        m_cdTable.nCentralDirectoryOffset = 0;
+                        m_cdTable.nCentralDirectorySize = 0;
+                        m_cdTable.listEntries.clear();
+                        m_cdTable.baNames.clear();
+                    }
+                    continue;
+                }
+            }
+
+            if ((nOffsetToCentralDirectory < 0) || (nOffsetToCentralDirectory > nCentralDirectoryEnd) ||
+                (nCentralDirectorySize != (quint64)(nCentralDirectoryEnd - nOffsetToCentralDirectory))) {
                 continue;
             }
 
-            if (nTotalRecords == 0) {
-                if ((nCurrent == 0) && (nCentralDirectorySize == 0) && (nOffsetToCentralDirectory == 0)) {
-                    nResult = nCurrent;
-                }
+            // The directory is parsed in memory, and every record takes at least a fixed header
+            if ((nTotalRecords == 0) || (nCentralDirectorySize > 0x7FFFFFFF) ||
+                (nTotalRecords > (nCentralDirectorySize / sizeof(CENTRALDIRECTORYFILEHEADER)))) {
                 continue;
             }
 
-            if ((nOffsetToCentralDirectory < 0) || (nOffsetToCentralDirectory > nCurrent) ||
-                ((qint64)nCentralDirectorySize != (nCurrent - nOffsetToCentralDirectory))) {
+            // The whole central directory is read with one call and parsed in memory
+            QByteArray baCentralDirectory = read_array(nOffsetToCentralDirectory, (qint64)nCentralDirectorySize);
+
+            if (baCentralDirectory.size() != (qint32)nCentralDirectorySize) {
                 continue;
             }
 
-            qint64 nCurrentHeaderOffset = nOffsetToCentralDirectory;
+            const char *pCentralDirectory = baCentralDirectory.constData();
+            qint64 nCurrentHeaderOffset = 0;
             bool bValid = true;
             QSet<qint64> setLocalHeaderOffsets;
+            QVector<CD_ENTRY> listEntries;
+            QByteArray baNames;
 
-            for (quint32 i = 0; i < nTotalRecords; i++) {
-                if (((nCurrent - nCurrentHeaderOffset) < (qint64)sizeof(CENTRALDIRECTORYFILEHEADER)) ||
-                    (read_uint32(nCurrentHeaderOffset) != SIGNATURE_CFD)) {
+            listEntries.reserve((qint32)nTotalRecords);
+
+            for (quint64 i = 0; i < nTotalRecords; i++) {
+                if ((((qint64)nCentralDirectorySize - nCurrentHeaderOffset) < (qint64)sizeof(CENTRALDIRECTORYFILEHEADER)) ||
+                    (qFromLittleEndian<quint32>(pCentralDirectory + nCurrentHeaderOffset) != SIGNATURE_CFD)) {
                     bValid = false;
                     break;
                 }
 
-                CENTRALDIRECTORYFILEHEADER cdfh = read_CENTRALDIRECTORYFILEHEADER(nCurrentHeaderOffset, pPdStruct);
+                CENTRALDIRECTORYFILEHEADER cdfh = _bufferToCENTRALDIRECTORYFILEHEADER(pCentralDirectory + nCurrentHeaderOffset);
                 qint64 nRecordSize = sizeof(CENTRALDIRECTORYFILEHEADER) + (qint64)cdfh.nFileNameLength + (qint64)cdfh.nExtraFieldLength +
                                      (qint64)cdfh.nFileCommentLength;
 
-                if ((cdfh.nStartDisk != 0) || (nRecordSize > (nCurrent - nCurrentHeaderOffset))) {
+                if ((cdfh.nStartDisk != 0) || (nRecordSize > ((qint64)nCentralDirectorySize - nCurrentHeaderOffset))) {
+                    bValid = false;
+                    break;
+                }
+
+                const char *pFileName = pCentralDirectory + nCurrentHeaderOffset + sizeof(CENTRALDIRECTORYFILEHEADER);
+                quint64 nUncompressedSize = cdfh.nUncompressedSize;
+                quint64 nCompressedSize = cdfh.nCompressedSize;
+                quint64 nOffsetToLocalFileHeader = cdfh.nOffsetToLocalFileHeader;
+
+                _readZip64ExtraField(pFileName + cdfh.nFileNameLength, cdfh.nExtraFieldLength, &nUncompressedSize, &nCompressedSize,
+                                     &nOffsetToLocalFileHeader);
+
+                if (nOffsetToLocalFileHeader > (quint64)nOffsetToCentralDirectory) {
                     bValid = false;
                     break;
                 }
 
-                qint64 nLocalHeaderOffset = cdfh.nOffsetToLocalFileHeader;
-                if ((nLocalHeaderOffset < 0) ||
-                    ((nOffsetToCentralDirectory - nLocalHeaderOffset) < (qint64)sizeof(LOCALFILEHEADER)) ||
+                qint64 nLocalHeaderOffset = (qint64)nOffsetToLocalFileHeader;
+                if (((nOffsetToCentralDirectory - nLocalHeaderOffset) < (qint64)sizeof(LOCALFILEHEADER)) ||
                     (read_uint32(nLocalHeaderOffset) != SIGNATURE_LFD) || setLocalHeaderOffsets.contains(nLocalHeaderOffset)) {
                     bValid = false;
                     break;
@@ -750,58 +1303,84 @@ qint64 XZip::findECDOffset(PDSTRUCT *pPdStruct)
                 qint64 nLocalDataOffset =
                     nLocalHeaderOffset + sizeof(LOCALFILEHEADER) + (qint64)lfh.nFileNameLength + (qint64)lfh.nExtraFieldLength;
 
+                // A ZIP64 sentinel on either side defers the size to the extra fields
+                auto isSizeMismatch = [](quint32 nLocalSize, quint32 nCentralSize) -> bool {
+                    return (nLocalSize != 0xFFFFFFFF) && (nCentralSize != 0xFFFFFFFF) && (nLocalSize != nCentralSize);
+                };
+
                 if ((lfh.nFlags != cdfh.nFlags) || (lfh.nMethod != cdfh.nMethod) ||
                     (lfh.nFileNameLength != cdfh.nFileNameLength) || (nLocalDataOffset > nOffsetToCentralDirectory) ||
-                    ((qint64)cdfh.nCompressedSize > (nOffsetToCentralDirectory - nLocalDataOffset)) ||
+                    (nCompressedSize > (quint64)(nOffsetToCentralDirectory - nLocalDataOffset)) ||
                     (read_array(nLocalHeaderOffset + sizeof(LOCALFILEHEADER), lfh.nFileNameLength) !=
-                     read_array(nCurrentHeaderOffset + sizeof(CENTRALDIRECTORYFILEHEADER), cdfh.nFileNameLength)) ||
+                     QByteArray::fromRawData(pFileName, cdfh.nFileNameLength)) ||
                     (!(lfh.nFlags & 0x0008) &&
-                     ((lfh.nCRC32 != cdfh.nCRC32) || (lfh.nCompressedSize != cdfh.nCompressedSize) ||
-                      (lfh.nUncompressedSize != cdfh.nUncompressedSize)))) {
+                     ((lfh.nCRC32 != cdfh.nCRC32) || isSizeMismatch(lfh.nCompressedSize, cdfh.nCompressedSize) ||
+                      isSizeMismatch(lfh.nUncompressedSize, cdfh.nUncompressedSize)))) {
                     bValid = false;
                     break;
                 }
 
+                CD_ENTRY entry = {};
+                entry.nLocalHeaderOffset = nLocalHeaderOffset;
+                entry.nCompressedSize = (qint64)nCompressedSize;
+                entry.nUncompressedSize = (qint64)nUncompressedSize;
+                entry.nCRC32 = cdfh.nCRC32;
+                entry.nMethod = cdfh.nMethod;
+                entry.nFlags = cdfh.nFlags;
+                entry.nNameOffset = baNames.size();
+                entry.nNameSize = cdfh.nFileNameLength;
+
+                baNames.append(pFileName, cdfh.nFileNameLength);
+                listEntries.append(entry);
+
                 nCurrentHeaderOffset += nRecordSize;
             }
 
             // The optional central-directory digital-signature and archive-extra
             // records are not files and are not included in the EOCD entry count.
-            while (bValid && (nCurrentHeaderOffset < nCurrent)) {
-                if ((nCurrent - nCurrentHeaderOffset) < 6) {
+            while (bValid && (nCurrentHeaderOffset < (qint64)nCentralDirectorySize)) {
+                if (((qint64)nCentralDirectorySize - nCurrentHeaderOffset) < 6) {
                     bValid = false;
                     break;
                 }
 
-                quint32 nSignature = read_uint32(nCurrentHeaderOffset);
+                quint32 nSignature = qFromLittleEndian<quint32>(pCentralDirectory + nCurrentHeaderOffset);
                 qint64 nRecordSize = 0;
                 if (nSignature == 0x05054B50) {  // central-directory digital signature
-                    nRecordSize = 6 + (qint64)read_uint16(nCurrentHeaderOffset + 4);
+                    nRecordSize = 6 + (qint64)qFromLittleEndian<quint16>(pCentralDirectory + nCurrentHeaderOffset + 4);
                 } else if (nSignature == 0x08064B50) {  // archive extra data record
-                    if ((nCurrent - nCurrentHeaderOffset) < 8) {
+                    if (((qint64)nCentralDirectorySize - nCurrentHeaderOffset) < 8) {
                         bValid = false;
                         break;
                     }
-                    nRecordSize = 8 + (qint64)read_uint32(nCurrentHeaderOffset + 4);
+                    nRecordSize = 8 + (qint64)qFromLittleEndian<quint32>(pCentralDirectory + nCurrentHeaderOffset + 4);
                 } else {
                     bValid = false;
                     break;
                 }
 
-                if ((nRecordSize <= 0) || (nRecordSize > (nCurrent - nCurrentHeaderOffset))) {
+                if ((nRecordSize <= 0) || (nRecordSize > ((qint64)nCentralDirectorySize - nCurrentHeaderOffset))) {
                     bValid = false;
                     break;
                 }
                 nCurrentHeaderOffset += nRecordSize;
             }
 
-            if (bValid && (nCurrentHeaderOffset == nCurrent)) {
-                nResult = nCurrent;
+            if (bValid && (nCurrentHeaderOffset == (qint64)nCentralDirectorySize)) {
+                m_cdTable.nECDOffset = nCurrent;
+                m_cdTable.nECD64Offset = nECD64Offset;
+                m_cdTable.nCentralDirectoryOffset = nOffsetToCentralDirectory;
+                m_cdTable.nCentralDirectorySize = (qint64)nCentralDirectorySize;
+                m_cdTable.listEntries = listEntries;
+                m_cdTable.baNames = baNames;
             }
         }
     }
 
-    return nResult;
+    // A cancelled scan is incomplete, so it is repeated on the next request
+    m_cdTable.bIsParsed = XBinary::isPdStructNotCanceled(pPdStruct);
+
+    return &m_cdTable;
 }
 
 bool XZip::isAPK(qint64 nECDOffset, PDSTRUCT *pPdStruct)
@@ -1126,9 +1705,10 @@ QList<XBinary::FPART> XZip::getFileParts(quint32 nFileParts, qint32 nLimit, PDST
     if (nECDOffset != -1) {
         if ((nTotalSize >= (qint64)sizeof(ENDOFCENTRALDIRECTORYRECORD)) &&
             (nECDOffset <= (nTotalSize - (qint64)sizeof(ENDOFCENTRALDIRECTORYRECORD)))) {
-            quint16 nTotalNumberOfRecords = read_uint16(nECDOffset + offsetof(ENDOFCENTRALDIRECTORYRECORD, nTotalNumberOfRecords));
-            quint32 nSizeOfCentralDirectory = read_uint32(nECDOffset + offsetof(ENDOFCENTRALDIRECTORYRECORD, nSizeOfCentralDirectory));
-            quint32 nOffsetToCentralDirectory = read_uint32(nECDOffset + offsetof(ENDOFCENTRALDIRECTORYRECORD, nOffsetToCentralDirectory));
+            const CD_TABLE *pTable = getCentralDirectoryTable(pPdStruct);
+            qint32 nTotalNumberOfRecords = pTable->listEntries.count();
+            qint64 nSizeOfCentralDirectory = pTable->nCentralDirectorySize;
+            qint64 nOffsetToCentralDirectory = pTable->nCentralDirectoryOffset;
             quint16 nCommentLength = read_uint16(nECDOffset + offsetof(ENDOFCENTRALDIRECTORYRECORD, nCommentLength));
 
             nMaxOffset = qMin(nECDOffset + (qint64)sizeof(ENDOFCENTRALDIRECTORYRECORD) + (qint64)nCommentLength, nTotalSize);
@@ -1146,8 +1726,7 @@ QList<XBinary::FPART> XZip::getFileParts(quint32 nFileParts, qint32 nLimit, PDST
             }
 
             if ((nFileParts & FILEPART_HEADER) || (nFileParts & FILEPART_STREAM)) {
-                if (((qint64)nOffsetToCentralDirectory < nECDOffset) &&
-                    ((qint64)nSizeOfCentralDirectory <= (nECDOffset - (qint64)nOffsetToCentralDirectory))) {
+                if ((nOffsetToCentralDirectory < nECDOffset) && (nSizeOfCentralDirectory <= (nECDOffset - nOffsetToCentralDirectory))) {
                     qint64 nOffset = nOffsetToCentralDirectory;
 
                     for (qint32 i = 0; i < nTotalNumberOfRecords && XBinary::isPdStructNotCanceled(pPdStruct); i++) {
@@ -1169,7 +1748,8 @@ QList<XBinary::FPART> XZip::getFileParts(quint32 nFileParts, qint32 nLimit, PDST
                                     listResult.append(record);
                                 }
 
-                                qint64 nLocalOffset = cdh.nOffsetToLocalFileHeader;
+                                const CD_ENTRY &entry = pTable->listEntries.at(i);
+                                qint64 nLocalOffset = entry.nLocalHeaderOffset;
 
                                 if (nLocalOffset < nECDOffset) {
                                     LOCALFILEHEADER lfh = read_LOCALFILEHEADER(nLocalOffset, pPdStruct);
@@ -1197,13 +1777,13 @@ QList<XBinary::FPART> XZip::getFileParts(quint32 nFileParts, qint32 nLimit, PDST
 
                                                 record.filePart = FILEPART_STREAM;
                                                 record.nFileOffset = nLocalOffset + sizeof(LOCALFILEHEADER) + lfh.nFileNameLength + lfh.nExtraFieldLength;
-                                                record.nFileSize = cdh.nCompressedSize;
+                                                record.nFileSize = entry.nCompressedSize;
                                                 record.nVirtualAddress = -1;
                                                 record.sName = sName;
                                                 record.mapProperties.insert(FPART_PROP_ORIGINALNAME, sOriginalName);
                                                 record.mapProperties.insert(FPART_PROP_HANDLEMETHOD, zipToCompressMethod(cdh.nMethod, cdh.nFlags));
-                                                record.mapProperties.insert(FPART_PROP_COMPRESSEDSIZE, cdh.nCompressedSize);
-                                                record.mapProperties.insert(FPART_PROP_UNCOMPRESSEDSIZE, cdh.nUncompressedSize);
+                                                record.mapProperties.insert(FPART_PROP_COMPRESSEDSIZE, entry.nCompressedSize);
+                                                record.mapProperties.insert(FPART_PROP_UNCOMPRESSEDSIZE, entry.nUncompressedSize);
 
                                                 qint64 nExtraFieldOffset = nOffset + sizeof(CENTRALDIRECTORYFILEHEADER) + cdh.nFileNameLength;
                                                 bool bHasUsableCRC = !((cdh.nMethod == CMETHOD_AES) &&
@@ -1239,8 +1819,12 @@ QList<XBinary::FPART> XZip::getFileParts(quint32 nFileParts, qint32 nLimit, PDST
         for (qint32 i = 0; i < nCount && XBinary::isPdStructNotCanceled(pPdStruct); i++) {
             if ((nOffset >= 0) && ((nTotalSize - nOffset) >= (qint64)sizeof(LOCALFILEHEADER))) {
                 LOCALFILEHEADER lfh = read_LOCALFILEHEADER(nOffset, pPdStruct);
+                quint64 nUncompressedSize = 0;
+                quint64 nCompressedSize = 0;
 
                 if (lfh.nSignature == SIGNATURE_LFD) {
+                    _readLocalZip64Sizes(nOffset, lfh, &nUncompressedSize, &nCompressedSize);
+
                     if ((nFileParts & FILEPART_HEADER) || (nFileParts & FILEPART_STREAM)) {
                         QString sOriginalName = read_ansiString(nOffset + sizeof(LOCALFILEHEADER), lfh.nFileNameLength);
 
@@ -1260,12 +1844,12 @@ QList<XBinary::FPART> XZip::getFileParts(quint32 nFileParts, qint32 nLimit, PDST
 
                             record.filePart = FILEPART_STREAM;
                             record.nFileOffset = nOffset + sizeof(LOCALFILEHEADER) + lfh.nFileNameLength + lfh.nExtraFieldLength;
-                            record.nFileSize = lfh.nCompressedSize;
+                            record.nFileSize = (qint64)nCompressedSize;
                             record.nVirtualAddress = -1;
                             record.mapProperties.insert(FPART_PROP_ORIGINALNAME, sOriginalName);
                             record.mapProperties.insert(FPART_PROP_HANDLEMETHOD, zipToCompressMethod(lfh.nMethod, lfh.nFlags));
-                            record.mapProperties.insert(FPART_PROP_COMPRESSEDSIZE, lfh.nCompressedSize);
-                            record.mapProperties.insert(FPART_PROP_UNCOMPRESSEDSIZE, lfh.nUncompressedSize);
+                            record.mapProperties.insert(FPART_PROP_COMPRESSEDSIZE, (qint64)nCompressedSize);
+                            record.mapProperties.insert(FPART_PROP_UNCOMPRESSEDSIZE, (qint64)nUncompressedSize);
 
                             qint64 nExtraFieldOffset = nOffset + sizeof(LOCALFILEHEADER) + lfh.nFileNameLength;
                             bool bHasUsableCRC = !(lfh.nFlags & 0x0008) &&
@@ -1283,7 +1867,7 @@ QList<XBinary::FPART> XZip::getFileParts(quint32 nFileParts, qint32 nLimit, PDST
                     break;
                 }
 
-                nOffset += (sizeof(LOCALFILEHEADER) + lfh.nFileNameLength + lfh.nExtraFieldLength + lfh.nCompressedSize);
+                nOffset += (sizeof(LOCALFILEHEADER) + lfh.nFileNameLength + lfh.nExtraFieldLength + (qint64)nCompressedSize);
 #ifdef QT_DEBUG
                 qDebug("Offset: %llX", nOffset);
 #endif
@@ -1331,55 +1915,44 @@ bool XZip::_isRecordNamePresent(qint64 nECDOffset, QString sRecordName1, QString
     qint32 nRecordNameSize2 = sRecordName2.size();
 
     if (nECDOffset != -1) {
-        qint32 nNumberOfRecords = read_uint16(nECDOffset + offsetof(ENDOFCENTRALDIRECTORYRECORD, nTotalNumberOfRecords));
+        // Names come from the cached central directory; nECDOffset is the value of findECDOffset
+        const CD_TABLE *pTable = getCentralDirectoryTable(pPdStruct);
 
-        if (nLimit != -1) {
-            nNumberOfRecords = qMin(nNumberOfRecords, nLimit);
+        if (pTable->nECDOffset != nECDOffset) {
+            return false;
         }
 
-        qint64 nOffset = read_uint32(nECDOffset + offsetof(ENDOFCENTRALDIRECTORYRECORD, nOffsetToCentralDirectory));
+        QByteArray baRecordName1 = sRecordName1.toUtf8();
+        QByteArray baRecordName2 = sRecordName2.toUtf8();
+        const char *pNames = pTable->baNames.constData();
+        qint32 nNumberOfRecords = pTable->listEntries.count();
 
-        for (qint32 i = 0; i < (nNumberOfRecords) && XBinary::isPdStructNotCanceled(pPdStruct); i++) {
-            CENTRALDIRECTORYFILEHEADER cdh = read_CENTRALDIRECTORYFILEHEADER(nOffset, pPdStruct);
+        if (nLimit != -1) {
+            nNumberOfRecords = qMin(nNumberOfRecords, nLimit);
+        }
 
-            if (cdh.nSignature != SIGNATURE_CFD) {
-                break;
-            }
+        for (qint32 i = 0; (i < nNumberOfRecords) && XBinary::isPdStructNotCanceled(pPdStruct); i++) {
+            const CD_ENTRY &entry = pTable->listEntries.at(i);
+            const char *pName = pNames + entry.nNameOffset;
 
             if (!bStartWith) {
-                if ((cdh.nFileNameLength == nRecordNameSize1) && (nRecordNameSize1 == nRecordNameSize2)) {
-                    QString sRecordName = read_ansiString(nOffset + sizeof(CENTRALDIRECTORYFILEHEADER), cdh.nFileNameLength);
-
-                    if ((sRecordName == sRecordName1) || (sRecordName == sRecordName2)) {
-                        return true;
-                    }
+                if ((entry.nNameSize == baRecordName1.size()) && (memcmp(pName, baRecordName1.constData(), entry.nNameSize) == 0)) {
+                    return true;
                 }
 
-                if (cdh.nFileNameLength == nRecordNameSize1) {
-                    if (read_ansiString(nOffset + sizeof(CENTRALDIRECTORYFILEHEADER), cdh.nFileNameLength) == sRecordName1) {
-                        return true;
-                    }
-                }
-                if ((nRecordNameSize2) && (cdh.nFileNameLength == nRecordNameSize2)) {
-                    if (read_ansiString(nOffset + sizeof(CENTRALDIRECTORYFILEHEADER), cdh.nFileNameLength) == sRecordName2) {
-                        return true;
-                    }
+                if ((nRecordNameSize2) && (entry.nNameSize == baRecordName2.size()) && (memcmp(pName, baRecordName2.constData(), entry.nNameSize) == 0)) {
+                    return true;
                 }
             } else {
-                if (cdh.nFileNameLength >= nRecordNameSize1) {
-                    if (read_ansiString(nOffset + sizeof(CENTRALDIRECTORYFILEHEADER), nRecordNameSize1) == sRecordName1) {
-                        return true;
-                    }
+                if ((entry.nNameSize >= baRecordName1.size()) && (memcmp(pName, baRecordName1.constData(), baRecordName1.size()) == 0)) {
+                    return true;
                 }
 
-                if ((nRecordNameSize2) && (cdh.nFileNameLength >= nRecordNameSize2)) {
-                    if (read_ansiString(nOffset + sizeof(CENTRALDIRECTORYFILEHEADER), nRecordNameSize2) == sRecordName2) {
-                        return true;
-                    }
+                if ((nRecordNameSize2) && (entry.nNameSize >= baRecordName2.size()) &&
+                    (memcmp(pName, baRecordName2.constData(), baRecordName2.size()) == 0)) {
+                    return true;
                 }
             }
-
-            nOffset += (sizeof(CENTRALDIRECTORYFILEHEADER) + cdh.nFileNameLength + cdh.nExtraFieldLength + cdh.nFileCommentLength);
         }
     } else {
         // if no ECD, only the first record
@@ -1435,7 +2008,15 @@ bool XZip::_isRecordNamePresent(qint64 nECDOffset, QString sRecordName1, QString
                 }
             }
 
-            nOffset += sizeof(LOCALFILEHEADER) + lfh.nFileNameLength + lfh.nExtraFieldLength + lfh.nCompressedSize;
+            quint64 nUncompressedSize = 0;
+            quint64 nCompressedSize = 0;
+            _readLocalZip64Sizes(nOffset, lfh, &nUncompressedSize, &nCompressedSize);
+
+            if (nCompressedSize > (quint64)nTotalSize) {
+                break;
+            }
+
+            nOffset += sizeof(LOCALFILEHEADER) + lfh.nFileNameLength + lfh.nExtraFieldLength + (qint64)nCompressedSize;
         }
     }
 
@@ -1456,16 +2037,22 @@ qint32 XZip::_getNumberOfLocalFileHeaders(qint64 nOffset, qint64 nSize, qint64 *
                 break;
             }
 
-            quint32 nLocalSignature = read_uint32(nCurrentOffset + offsetof(LOCALFILEHEADER, nSignature));
-            quint32 nLocalFileNameSize = read_uint16(nCurrentOffset + offsetof(LOCALFILEHEADER, nFileNameLength));
-            quint32 nLocalExtraFieldSize = read_uint16(nCurrentOffset + offsetof(LOCALFILEHEADER, nExtraFieldLength));
-            quint32 nCompressedSize = read_uint32(nCurrentOffset + offsetof(LOCALFILEHEADER, nCompressedSize));
+            LOCALFILEHEADER lfh = read_LOCALFILEHEADER(nCurrentOffset, pPdStruct);
+
+            if (lfh.nSignature != SIGNATURE_LFD) {
+                break;
+            }
+
+            quint64 nUncompressedSize = 0;
+            quint64 nCompressedSize = 0;
+            _readLocalZip64Sizes(nCurrentOffset, lfh, &nUncompressedSize, &nCompressedSize);
 
-            if (nLocalSignature != SIGNATURE_LFD) {
+            qint64 nHeaderSize = sizeof(LOCALFILEHEADER) + (qint64)lfh.nFileNameLength + (qint64)lfh.nExtraFieldLength;
+            if ((nHeaderSize > (nEndOffset - nCurrentOffset)) || (nCompressedSize > (quint64)(nEndOffset - nCurrentOffset - nHeaderSize))) {
                 break;
             }
 
-            qint64 nRecordSize = sizeof(LOCALFILEHEADER) + (qint64)nLocalFileNameSize + (qint64)nLocalExtraFieldSize + (qint64)nCompressedSize;
+            qint64 nRecordSize = nHeaderSize + (qint64)nCompressedSize;
             if ((nRecordSize <= 0) || (nRecordSize > (nEndOffset - nCurrentOffset))) {
                 break;
             }
@@ -1491,6 +2078,17 @@ bool XZip::_isECDSignaturePresent(qint64 nOffset, PDSTRUCT *pPdStruct)
     return find_uint32(nOffset, nTotalSize - nOffset, SIGNATURE_ECD, false, pPdStruct) != -1;
 }
 
+void XZip::_readLocalZip64Sizes(qint64 nOffset, const LOCALFILEHEADER &lfh, quint64 *pnUncompressedSize, quint64 *pnCompressedSize)
+{
+    *pnUncompressedSize = lfh.nUncompressedSize;
+    *pnCompressedSize = lfh.nCompressedSize;
+
+    if ((lfh.nUncompressedSize == 0xFFFFFFFF) || (lfh.nCompressedSize == 0xFFFFFFFF)) {
+        QByteArray baExtraField = read_array(nOffset + sizeof(LOCALFILEHEADER) + lfh.nFileNameLength, lfh.nExtraFieldLength);
+        _readZip64ExtraField(baExtraField.constData(), baExtraField.size(), pnUncompressedSize, pnCompressedSize, nullptr);
+    }
+}
+
 XArchive::HANDLE_METHOD XZip::zipToCompressMethod(quint16 nZipMethod, quint32 nFlags)
 {
     HANDLE_METHOD result = HANDLE_METHOD_UNKNOWN;
@@ -1551,6 +2149,8 @@ bool XZip::initPack(PACK_STATE *pState, QIODevice *pDevice, const QMap<PACK_PROP
     ZIP_PACK_CONTEXT *pContext = new ZIP_PACK_CONTEXT();
     pContext->pListZipFileRecords = new QList<ZIPFILE_RECORD>();
 
+    m_listPackFailedFiles.clear();
+
     pState->pContext = (void *)pContext;
 
     return true;
@@ -1563,7 +2163,10 @@ bool XZip::addFile(PACK_STATE *pState, const QString &sFilePath, PDSTRUCT *pPdSt
     }
 
     ZIP_PACK_CONTEXT *pContext = (ZIP_PACK_CONTEXT *)pState->pContext;
-    QList<ZIPFILE_RECORD> *pListZipFileRecords = pContext->pListZipFileRecords;
+
+    if (pContext->bIsDeviceError) {
+        return false;
+    }
 
     // Check if file exists and is readable
     QFileInfo fileInfo(sFilePath);
@@ -1572,6 +2175,18 @@ bool XZip::addFile(PACK_STATE *pState, const QString &sFilePath, PDSTRUCT *pPdSt
         return false;
     }
 
+    // The file is packed later in a batch; opening it now reports the common failure to the caller right away
+    {
+        QFile file(sFilePath);
+
+        if (!file.open(QIODevice::ReadOnly)) {
+            _errorMessage(QString("%1: %2").arg(tr("Cannot open file"), sFilePath), pPdStruct);
+            m_listPackFailedFiles.append(sFilePath);
+
+            return false;
+        }
+    }
+
     // Determine file path to store in archive based on PATH_MODE
     QString sStoredPath;
     PATH_MODE pathMode = (PATH_MODE)pState->mapProperties.value(PACK_PROP_PATHMODE, PATH_MODE_BASENAME).toInt();
@@ -1625,239 +2240,141 @@ bool XZip::addFile(PACK_STATE *pState, const QString &sFilePath, PDSTRUCT *pPdSt
     QFile::Permissions permissions = fileInfo.permissions();
     zipFileRecord.nExternalFileAttributes = filePermissionsToExternalAttributes(permissions);
 
-    // Calculate CRC32
-    QFile file(sFilePath);
-    if (!file.open(QIODevice::ReadOnly)) {
-        return false;
-    }
-    zipFileRecord.nCRC32 = XBinary::_getCRC32(&file);
-    file.close();
-
-    // Convert QDateTime to DOS date/time
-    QPair<quint16, quint16> dosDateTime = XBinary::qDateTimeToDosDateTime(zipFileRecord.dtTime);
-    quint16 nDosDate = dosDateTime.first;
-    quint16 nDosTime = dosDateTime.second;
-
     // Check if encryption is needed
     bool bEncrypt = !sPassword.isEmpty() && (cryptoMethod == XBinary::CRYPTO_METHOD_ZIPCRYPTO);
     if (bEncrypt) {
         zipFileRecord.nFlags |= 0x01;  // Set encryption flag
     }
 
-    // Write local file header
-    zipFileRecord.nHeaderOffset = pState->nCurrentOffset;
-
-    LOCALFILEHEADER localFileHeader = {};
-    localFileHeader.nSignature = SIGNATURE_LFD;
-    localFileHeader.nMinVersion = zipFileRecord.nMinVersion;
-    localFileHeader.nMinOS = zipFileRecord.nMinOS;
-    localFileHeader.nFlags = zipFileRecord.nFlags;
-    localFileHeader.nMethod = zipFileRecord.method;
-    localFileHeader.nLastModTime = nDosTime;
-    localFileHeader.nLastModDate = nDosDate;
-    localFileHeader.nCRC32 = zipFileRecord.nCRC32;
-    localFileHeader.nCompressedSize = zipFileRecord.nUncompressedSize;  // STORE: compressed = uncompressed
-    localFileHeader.nUncompressedSize = zipFileRecord.nUncompressedSize;
-    localFileHeader.nFileNameLength = zipFileRecord.sFileName.toUtf8().size();
-    localFileHeader.nExtraFieldLength = 0;
-
-    if (pState->pDevice->write((char *)&localFileHeader, sizeof(localFileHeader)) != sizeof(localFileHeader)) {
-        return false;
-    }
+    // The CRC is taken while packing, by the same read that compresses the file
+    ZIP_PACK_JOB job = {};
+    job.sFilePath = sFilePath;
+    job.record = zipFileRecord;
+    job.nCompressionLevel = nCompressionLevel;
 
-    QByteArray baFileName = zipFileRecord.sFileName.toUtf8();
-    if (pState->pDevice->write(baFileName.data(), localFileHeader.nFileNameLength) != localFileHeader.nFileNameLength) {
-        return false;
+    if (bEncrypt) {
+        job.sPassword = sPassword;
     }
 
-    pState->nCurrentOffset += sizeof(localFileHeader) + localFileHeader.nFileNameLength;
-    zipFileRecord.nDataOffset = pState->nCurrentOffset;
+    pContext->listPackJobs.append(job);
 
-    // Write file data (with optional compression)
-    if (!file.open(QIODevice::ReadOnly)) {
-        return false;
-    }
+    bool bResult = true;
 
-    qint64 nBytesWritten = 0;
-    qint64 nFileSize = fileInfo.size();
+    // Files are packed in batches. A file that fails while packing is reported, recorded in
+    // getPackFailedFiles() and skipped; only a device error makes a later addFile or finishPack fail
+    if (pContext->listPackJobs.count() >= 2 * qMax(1, QThread::idealThreadCount())) {
+        bResult = _flushPackJobs(pState, pPdStruct);
+    }
 
-    if (zipFileRecord.method == CMETHOD_STORE) {
-        // No compression - direct copy (with optional encryption)
-        if (bEncrypt) {
-            // Encrypt the file data
-            QBuffer dataBuffer;
-            if (!dataBuffer.open(QIODevice::WriteOnly)) {
-                file.close();
-                return false;
-            }
+    return bResult;
+}
 
-            // First, read all data to a buffer for encryption
-            QByteArray baFileData = file.readAll();
-            file.close();
+bool XZip::_flushPackJobs(PACK_STATE *pState, PDSTRUCT *pPdStruct)
+{
+    ZIP_PACK_CONTEXT *pContext = (ZIP_PACK_CONTEXT *)pState->pContext;
 
-            if (baFileData.size() != nFileSize) {
-                return false;
-            }
+    QList<ZIP_PACK_JOB> listJobs = pContext->listPackJobs;
+    pContext->listPackJobs.clear();
 
-            // Prepare encryption
-            QBuffer inputBuffer(&baFileData);
-            if (!inputBuffer.open(QIODevice::ReadOnly)) {
-                file.close();
-                return false;
-            }
+    qint32 nNumberOfJobs = listJobs.count();
 
-            XBinary::DATAPROCESS_STATE encryptState = {};
-            encryptState.pDeviceInput = &inputBuffer;
-            encryptState.pDeviceOutput = &dataBuffer;
-            encryptState.nInputOffset = 0;
-            encryptState.nInputLimit = nFileSize;
+    // 1. Compress the batch in parallel; unencrypted STORE goes straight to the archive in step 2
+    QList<ZipPackRunnable *> listTasks;
+    qint32 nNumberOfTasks = 0;
 
-            bool bEncryptResult = XZipCryptoDecoder::encrypt(&encryptState, sPassword, zipFileRecord.nCRC32, pPdStruct);
+    for (qint32 i = 0; i < nNumberOfJobs; i++) {
+        const ZIP_PACK_JOB &job = listJobs.at(i);
+        ZipPackRunnable *pTask = nullptr;
 
-            if (bEncryptResult) {
-                dataBuffer.close();
-                QByteArray baEncrypted = dataBuffer.data();
+        if ((job.record.method != CMETHOD_STORE) || (job.record.nFlags & 0x01)) {
+            pTask = new ZipPackRunnable(job, pPdStruct);
+            nNumberOfTasks++;
+        }
 
-                if (pState->pDevice->write(baEncrypted) != baEncrypted.size()) {
-                    return false;
-                }
+        listTasks.append(pTask);
+    }
 
-                nBytesWritten = baEncrypted.size();
-                zipFileRecord.nCompressedSize = nBytesWritten;  // Encrypted size (original + 12 byte header)
-            } else {
-                return false;
+    if (nNumberOfTasks == 1) {
+        for (qint32 i = 0; i < nNumberOfJobs; i++) {
+            if (listTasks.at(i)) {
+                listTasks.at(i)->setParallel(true);
+                listTasks.at(i)->run();
             }
-        } else {
-            // No encryption - direct copy
-            while (nBytesWritten < nFileSize && XBinary::isPdStructNotCanceled(pPdStruct)) {
-                QByteArray baBuffer = file.read(qMin((qint64)0x10000, nFileSize - nBytesWritten));
-
-                if (baBuffer.isEmpty() && nBytesWritten < nFileSize) {
-                    file.close();
-                    return false;
-                }
-
-                if (pState->pDevice->write(baBuffer) != baBuffer.size()) {
-                    file.close();
-                    return false;
-                }
+        }
+    } else if (nNumberOfTasks > 1) {
+        QThreadPool threadPool;
+        threadPool.setMaxThreadCount(QThread::idealThreadCount());
 
-                nBytesWritten += baBuffer.size();
+        for (qint32 i = 0; i < nNumberOfJobs; i++) {
+            if (listTasks.at(i)) {
+                threadPool.start(listTasks.at(i));
             }
-
-            file.close();
-            zipFileRecord.nCompressedSize = nFileSize;  // STORE: compressed = uncompressed
         }
-    } else if (zipFileRecord.method == CMETHOD_DEFLATE) {
-        // Compress data using DEFLATE (with optional encryption)
-        QBuffer compressedBuffer;
-        if (!compressedBuffer.open(QIODevice::WriteOnly)) {
-            file.close();
-            return false;
-        }
-
-        XBinary::DATAPROCESS_STATE compressState = {};
-        compressState.pDeviceInput = &file;
-        compressState.pDeviceOutput = &compressedBuffer;
-        compressState.nInputOffset = 0;
-        compressState.nInputLimit = nFileSize;
 
-        bool bCompress = XDeflateDecoder::compress(&compressState, pPdStruct, nCompressionLevel);
-
-        if (bCompress) {
-            compressedBuffer.close();
-            QByteArray baCompressed = compressedBuffer.data();
-
-            if (bEncrypt) {
-                // Encrypt the compressed data
-                QBuffer encryptedBuffer;
-                if (!encryptedBuffer.open(QIODevice::WriteOnly)) {
-                    file.close();
-                    return false;
-                }
+        threadPool.waitForDone();
+    }
 
-                QBuffer inputBuffer(&baCompressed);
-                if (!inputBuffer.open(QIODevice::ReadOnly)) {
-                    file.close();
-                    return false;
-                }
+    // 2. Sequencer: local headers and data are written in queue order, with final sizes and CRCs.
+    // A member that fails is rewound and skipped; only a device that cannot be rewound stops the batch.
+    bool bResult = true;
 
-                XBinary::DATAPROCESS_STATE encryptState = {};
-                encryptState.pDeviceInput = &inputBuffer;
-                encryptState.pDeviceOutput = &encryptedBuffer;
-                encryptState.nInputOffset = 0;
-                encryptState.nInputLimit = baCompressed.size();
+    for (qint32 i = 0; (i < nNumberOfJobs) && bResult && XBinary::isPdStructNotCanceled(pPdStruct); i++) {
+        ZIPFILE_RECORD record = listJobs.at(i).record;
+        ZipPackRunnable *pTask = listTasks.at(i);
 
-                bool bEncryptResult = XZipCryptoDecoder::encrypt(&encryptState, sPassword, zipFileRecord.nCRC32, pPdStruct);
+        record.nHeaderOffset = pState->nCurrentOffset;
 
-                if (bEncryptResult) {
-                    encryptedBuffer.close();
-                    QByteArray baEncrypted = encryptedBuffer.data();
+        if (pTask) {
+            QIODevice *pOutput = pTask->getOutput();
 
-                    if (pState->pDevice->write(baEncrypted) != baEncrypted.size()) {
-                        file.close();
-                        return false;
-                    }
+            record.nCRC32 = pTask->getCRC32();
+            record.nCompressedSize = pOutput->size();
 
-                    nBytesWritten = baEncrypted.size();
-                    zipFileRecord.nCompressedSize = nBytesWritten;
-                } else {
-                    file.close();
-                    return false;
-                }
-            } else {
-                // No encryption
-                if (pState->pDevice->write(baCompressed) != baCompressed.size()) {
-                    file.close();
-                    return false;
-                }
+            qint64 nHeaderSize = pTask->isSuccess() ? _writeLocalFileHeader(pState->pDevice, &record) : -1;
 
-                nBytesWritten = compressState.nCountOutput;
-                zipFileRecord.nCompressedSize = nBytesWritten;
-            }
+            bResult = (nHeaderSize != -1) && pOutput->seek(0) && _copyPackData(pOutput, pState->pDevice, record.nCompressedSize, pPdStruct);
+            record.nDataOffset = record.nHeaderOffset + nHeaderSize;
         } else {
-            file.close();
-            return false;
-        }
+            // The CRC is patched into the header once the data is copied
+            QFile file(listJobs.at(i).sFilePath);
 
-        file.close();
-    } else {
-        // Unsupported compression method
-        file.close();
-        return false;
-    }
+            record.nCompressedSize = record.nUncompressedSize;
 
-    file.close();
+            qint64 nHeaderSize = file.open(QIODevice::ReadOnly) ? _writeLocalFileHeader(pState->pDevice, &record) : -1;
 
-    if (!XBinary::isPdStructNotCanceled(pPdStruct)) {
-        return false;
-    }
+            bResult = (nHeaderSize != -1) && _copyPackData(&file, pState->pDevice, record.nUncompressedSize, pPdStruct, &record.nCRC32);
+            record.nDataOffset = record.nHeaderOffset + nHeaderSize;
 
-    // Update local file header with compressed size
-    localFileHeader.nCompressedSize = zipFileRecord.nCompressedSize;
-    localFileHeader.nMethod = zipFileRecord.method;
+            file.close();
 
-    // Write updated local file header
-    if (!pState->pDevice->seek(zipFileRecord.nHeaderOffset)) {
-        return false;
-    }
+            if (bResult) {
+                char szCRC32[sizeof(quint32)] = {};
+                XBinary::_write_uint32(szCRC32, record.nCRC32);
 
-    if (pState->pDevice->write((char *)&localFileHeader, sizeof(localFileHeader)) != sizeof(localFileHeader)) {
-        return false;
-    }
+                bResult = pState->pDevice->seek(record.nHeaderOffset + offsetof(XZip::LOCALFILEHEADER, nCRC32)) &&
+                          (pState->pDevice->write(szCRC32, sizeof(szCRC32)) == sizeof(szCRC32)) &&
+                          pState->pDevice->seek(record.nDataOffset + record.nCompressedSize);
+            }
+        }
 
-    // Update current offset to point to end of written data
-    pState->nCurrentOffset += zipFileRecord.nCompressedSize;
+        if (bResult) {
+            pState->nCurrentOffset = record.nDataOffset + record.nCompressedSize;
 
-    // Seek to end of data
-    if (!pState->pDevice->seek(pState->nCurrentOffset)) {
-        return false;
+            // Store the record for later when writing central directory
+            pContext->pListZipFileRecords->append(record);
+        } else if (XBinary::isPdStructNotCanceled(pPdStruct)) {
+            // The next member overwrites what was written of this one
+            _errorMessage(QString("%1: %2").arg(tr("Cannot pack file"), listJobs.at(i).sFilePath), pPdStruct);
+            m_listPackFailedFiles.append(listJobs.at(i).sFilePath);
+
+            bResult = pState->pDevice->seek(pState->nCurrentOffset);
+            pContext->bIsDeviceError = !bResult;
+        }
     }
 
-    // Store the record for later when writing central directory
-    pListZipFileRecords->append(zipFileRecord);
+    qDeleteAll(listTasks);
 
-    return true;
+    return bResult && XBinary::isPdStructNotCanceled(pPdStruct);
 }
 
 bool XZip::addFolder(PACK_STATE *pState, const QString &sDirectoryPath, PDSTRUCT *pPdStruct)
@@ -1872,6 +2389,7 @@ bool XZip::addFolder(PACK_STATE *pState, const QString &sDirectoryPath, PDSTRUCT
     }
 
     ZIP_PACK_CONTEXT *pContext = (ZIP_PACK_CONTEXT *)pState->pContext;
+    bool bResult = true;
 
     // Set base path for relative path calculation if not already set
     QString sOriginalBasePath;
@@ -1902,12 +2420,14 @@ bool XZip::addFolder(PACK_STATE *pState, const QString &sDirectoryPath, PDSTRUCT
             continue;
         }
 
-        // Add file to archive
+        // A file that cannot be packed is recorded in getPackFailedFiles() and the others are still
+        // added; only an archive device error stops the folder
         if (!addFile(pState, sFilePath, pPdStruct)) {
-            if (bRestoreBasePath) {
-                pState->mapProperties[PACK_PROP_BASEPATH] = sOriginalBasePath;
+            bResult = false;
+
+            if (pContext->bIsDeviceError) {
+                break;
             }
-            return false;
         }
     }
 
@@ -1916,13 +2436,11 @@ bool XZip::addFolder(PACK_STATE *pState, const QString &sDirectoryPath, PDSTRUCT
         pState->mapProperties[PACK_PROP_BASEPATH] = sOriginalBasePath;
     }
 
-    return true;
+    return bResult && XBinary::isPdStructNotCanceled(pPdStruct);
 }
 
 bool XZip::finishPack(PACK_STATE *pState, PDSTRUCT *pPdStruct)
 {
-    Q_UNUSED(pPdStruct)
-
     if (!pState || !pState->pDevice || !pState->pContext) {
         return false;
     }
@@ -1930,8 +2448,22 @@ bool XZip::finishPack(PACK_STATE *pState, PDSTRUCT *pPdStruct)
     ZIP_PACK_CONTEXT *pContext = (ZIP_PACK_CONTEXT *)pState->pContext;
     QList<ZIPFILE_RECORD> *pListZipFileRecords = pContext->pListZipFileRecords;
 
-    // Write central directory and end of central directory record
-    bool bResult = addCentralDirectory(pState->pDevice, pListZipFileRecords, "");
+    // Pack what is still queued, then write central directory and end of central directory record.
+    // The central directory lists the members that were written, also after a failed batch.
+    bool bResult = _flushPackJobs(pState, pPdStruct);
+
+    if (pState->pDevice->seek(pState->nCurrentOffset) && addCentralDirectory(pState->pDevice, pListZipFileRecords, "")) {
+        // Drop the remains of a skipped last member behind the end of central directory record
+        qint64 nArchiveSize = pState->pDevice->pos();
+
+        if ((pState->pDevice->size() > nArchiveSize) && !XBinary::resize(pState->pDevice, nArchiveSize)) {
+            bResult = false;
+        }
+    } else {
+        bResult = false;
+    }
+
+    bResult = bResult && m_listPackFailedFiles.isEmpty();
 
     // Clean up context
     delete pListZipFileRecords;
@@ -1941,6 +2473,11 @@ bool XZip::finishPack(PACK_STATE *pState, PDSTRUCT *pPdStruct)
     return bResult;
 }
 
+QList<QString> XZip::getPackFailedFiles() const
+{
+    return m_listPackFailedFiles;
+}
+
 QList<XBinary::PM_INFO> XZip::unpackImplemented()
 {
     QList<XBinary::PM_INFO> listResult;
@@ -2028,22 +2565,20 @@ bool XZip::initUnpack(UNPACK_STATE *pState, const QMap<UNPACK_PROP, QVariant> &m
     pState->nNumberOfRecords = 0;
     pState->pContext = nullptr;
 
-    // Try to get number of records from end of central directory
-    qint64 nECDOffset = findECDOffset(pPdStruct);
+    // Try to get number of records from the (ZIP64) end of central directory
+    const CD_TABLE *pTable = getCentralDirectoryTable(pPdStruct);
+    qint64 nECDOffset = pTable->nECDOffset;
     bool bIsECD = false;
     qint64 nCDFHOffset = 0;
 
-    if (nECDOffset != -1) {
-        nCDFHOffset = (qint64)read_uint32(nECDOffset + offsetof(ENDOFCENTRALDIRECTORYRECORD, nOffsetToCentralDirectory));
-
-        if (read_uint32(nCDFHOffset) == SIGNATURE_CFD) {
-            bIsECD = true;
-        }
+    if ((nECDOffset != -1) && !pTable->listEntries.isEmpty()) {
+        nCDFHOffset = pTable->nCentralDirectoryOffset;
+        bIsECD = true;
     }
 
     if (bIsECD) {
         pState->nCurrentOffset = nCDFHOffset;
-        pState->nNumberOfRecords = read_uint16(nECDOffset + offsetof(ENDOFCENTRALDIRECTORYRECORD, nTotalNumberOfRecords));
+        pState->nNumberOfRecords = pTable->listEntries.count();
         bResult = (pState->nNumberOfRecords > 0);
     } else if (nECDOffset == -1) {
         // Fallback: count complete local file records only when no authenticated
@@ -2060,7 +2595,7 @@ bool XZip::initUnpack(UNPACK_STATE *pState, const QMap<UNPACK_PROP, QVariant> &m
         ZIP_UNPACK_CONTEXT *pContext = new ZIP_UNPACK_CONTEXT();
         pContext->bIsECD = bIsECD;
         pContext->nCentralDirectoryOffset = bIsECD ? nCDFHOffset : 0;
-        pContext->nCentralDirectoryEnd = bIsECD ? nECDOffset : 0;
+        pContext->nCentralDirectoryEnd = bIsECD ? (nCDFHOffset + pTable->nCentralDirectorySize) : 0;
         pState->pContext = pContext;
     }
 
@@ -2087,8 +2622,8 @@ XBinary::ARCHIVERECORD XZip::infoCurrent(UNPACK_STATE *pState, PDSTRUCT *pPdStru
         quint16 nLastModTime = 0;
         quint16 nLastModDate = 0;
         quint32 nCRC32 = 0;
-        quint32 nCompressedSize = 0;
-        quint32 nUncompressedSize = 0;
+        quint64 nCompressedSize = 0;
+        quint64 nUncompressedSize = 0;
         quint32 nExternalFileAttributes = 0;
         // Extra field and file comment information
         qint64 nExtraFieldOffset = 0;
@@ -2106,9 +2641,20 @@ XBinary::ARCHIVERECORD XZip::infoCurrent(UNPACK_STATE *pState, PDSTRUCT *pPdStru
             CENTRALDIRECTORYFILEHEADER cdfh = read_CENTRALDIRECTORYFILEHEADER(pState->nCurrentOffset, pPdStruct);
             qint64 nCentralRecordSize = sizeof(CENTRALDIRECTORYFILEHEADER) + (qint64)cdfh.nFileNameLength +
                                        (qint64)cdfh.nExtraFieldLength + (qint64)cdfh.nFileCommentLength;
-            if ((nCentralRecordSize > (pContext->nCentralDirectoryEnd - pState->nCurrentOffset)) ||
-                ((qint64)cdfh.nOffsetToLocalFileHeader >
-                 (pContext->nCentralDirectoryOffset - (qint64)sizeof(LOCALFILEHEADER)))) {
+            if (nCentralRecordSize > (pContext->nCentralDirectoryEnd - pState->nCurrentOffset)) {
+                return XBinary::ARCHIVERECORD();
+            }
+
+            nCompressedSize = cdfh.nCompressedSize;
+            nUncompressedSize = cdfh.nUncompressedSize;
+            quint64 nOffsetToLocalFileHeader = cdfh.nOffsetToLocalFileHeader;
+
+            QByteArray baExtraField =
+                read_array(pState->nCurrentOffset + sizeof(CENTRALDIRECTORYFILEHEADER) + cdfh.nFileNameLength, cdfh.nExtraFieldLength);
+            _readZip64ExtraField(baExtraField.constData(), baExtraField.size(), &nUncompressedSize, &nCompressedSize, &nOffsetToLocalFileHeader);
+
+            if ((pContext->nCentralDirectoryOffset < (qint64)sizeof(LOCALFILEHEADER)) ||
+                (nOffsetToLocalFileHeader > (quint64)(pContext->nCentralDirectoryOffset - (qint64)sizeof(LOCALFILEHEADER)))) {
                 return XBinary::ARCHIVERECORD();
             }
 
@@ -2121,11 +2667,9 @@ XBinary::ARCHIVERECORD XZip::infoCurrent(UNPACK_STATE *pState, PDSTRUCT *pPdStru
             nLastModTime = cdfh.nLastModTime;
             nLastModDate = cdfh.nLastModDate;
             nCRC32 = cdfh.nCRC32;
-            nCompressedSize = cdfh.nCompressedSize;
-            nUncompressedSize = cdfh.nUncompressedSize;
             sFileName = read_ansiString(pState->nCurrentOffset + sizeof(CENTRALDIRECTORYFILEHEADER), cdfh.nFileNameLength);
 
-            nLocalHeaderOffset = cdfh.nOffsetToLocalFileHeader;
+            nLocalHeaderOffset = (qint64)nOffsetToLocalFileHeader;
             nExternalFileAttributes = cdfh.nExternalFileAttributes;
 
             nExtraFieldOffset = pState->nCurrentOffset + sizeof(CENTRALDIRECTORYFILEHEADER) + cdfh.nFileNameLength;
@@ -2145,8 +2689,12 @@ XBinary::ARCHIVERECORD XZip::infoCurrent(UNPACK_STATE *pState, PDSTRUCT *pPdStru
 
         qint64 nLocalDataOffset =
             nLocalHeaderOffset + sizeof(LOCALFILEHEADER) + (qint64)lfh.nFileNameLength + (qint64)lfh.nExtraFieldLength;
-        quint32 nValidatedCompressedSize = bIsECD ? nCompressedSize : lfh.nCompressedSize;
-        if ((nLocalDataOffset > nLocalLimit) || ((qint64)nValidatedCompressedSize > (nLocalLimit - nLocalDataOffset))) {
+
+        if (!bIsECD) {
+            _readLocalZip64Sizes(nLocalHeaderOffset, lfh, &nUncompressedSize, &nCompressedSize);
+        }
+
+        if ((nLocalDataOffset > nLocalLimit) || (nCompressedSize > (quint64)(nLocalLimit - nLocalDataOffset))) {
             return XBinary::ARCHIVERECORD();
         }
 
@@ -2158,8 +2706,6 @@ XBinary::ARCHIVERECORD XZip::infoCurrent(UNPACK_STATE *pState, PDSTRUCT *pPdStru
             nMethod = lfh.nMethod;
             nLastModTime = lfh.nLastModTime;
             nLastModDate = lfh.nLastModDate;
-            nCompressedSize = lfh.nCompressedSize;
-            nUncompressedSize = lfh.nUncompressedSize;
             sFileName = read_ansiString(nLocalHeaderOffset + sizeof(LOCALFILEHEADER), lfh.nFileNameLength);
 
             nExtraFieldOffset = nLocalHeaderOffset + sizeof(LOCALFILEHEADER) + lfh.nFileNameLength;
@@ -2183,7 +2729,7 @@ XBinary::ARCHIVERECORD XZip::infoCurrent(UNPACK_STATE *pState, PDSTRUCT *pPdStru
 
         result.mapProperties.insert(XBinary::FPART_PROP_ISFOLDER, bIsFolder);
 
-        result.nStreamSize = nCompressedSize;
+        result.nStreamSize = (qint64)nCompressedSize;
         result.nStreamOffset = nLocalDataOffset;
 
         result.mapProperties.insert(XBinary::FPART_PROP_ORIGINALNAME, sFileName);
@@ -2203,8 +2749,8 @@ XBinary::ARCHIVERECORD XZip::infoCurrent(UNPACK_STATE *pState, PDSTRUCT *pPdStru
         }
 
         // Sizes
-        result.mapProperties.insert(XBinary::FPART_PROP_COMPRESSEDSIZE, nCompressedSize);
-        result.mapProperties.insert(XBinary::FPART_PROP_UNCOMPRESSEDSIZE, nUncompressedSize);
+        result.mapProperties.insert(XBinary::FPART_PROP_COMPRESSEDSIZE, (qint64)nCompressedSize);
+        result.mapProperties.insert(XBinary::FPART_PROP_UNCOMPRESSEDSIZE, (qint64)nUncompressedSize);
 
         // Date/Time
         QDateTime dateTime = dosDateTimeToQDateTime(nLastModDate, nLastModTime);
@@ -2360,9 +2906,16 @@ bool XZip::moveToNext(UNPACK_STATE *pState, PDSTRUCT *pPdStruct)
                 return false;
             }
             LOCALFILEHEADER lfh = read_LOCALFILEHEADER(pState->nCurrentOffset, pPdStruct);
-            qint64 nRecordSize =
-                sizeof(LOCALFILEHEADER) + (qint64)lfh.nFileNameLength + (qint64)lfh.nExtraFieldLength + (qint64)lfh.nCompressedSize;
-            if (nRecordSize > (pState->nTotalSize - pState->nCurrentOffset)) return false;
+            quint64 nUncompressedSize = 0;
+            quint64 nCompressedSize = 0;
+            _readLocalZip64Sizes(pState->nCurrentOffset, lfh, &nUncompressedSize, &nCompressedSize);
+
+            qint64 nHeaderSize = sizeof(LOCALFILEHEADER) + (qint64)lfh.nFileNameLength + (qint64)lfh.nExtraFieldLength;
+            if ((nHeaderSize > (pState->nTotalSize - pState->nCurrentOffset)) ||
+                (nCompressedSize > (quint64)(pState->nTotalSize - pState->nCurrentOffset - nHeaderSize))) {
+                return false;
+            }
+            qint64 nRecordSize = nHeaderSize + (qint64)nCompressedSize;
             pState->nCurrentOffset += nRecordSize;
         }
 
@@ -2378,6 +2931,8 @@ bool XZip::finishUnpack(UNPACK_STATE *pState, PDSTRUCT *pPdStruct)
 {
     Q_UNUSED(pPdStruct)
 
+    _freeDecompressSession(pState);
+
     if (pState && pState->pContext) {
         ZIP_UNPACK_CONTEXT *pZipUnpackContext = (ZIP_UNPACK_CONTEXT *)pState->pContext;
         delete pZipUnpackContext;
@@ -22,6 +22,7 @@
 #define XZIP_H
 
 #include "xarchive.h"
+#include <QVector>
 
 // TODO OSNAME
 class XZip : public XArchive {
@@ -39,7 +40,9 @@ public:
     enum SIGNATURE {
         SIGNATURE_ECD = 0x06054B50,
         SIGNATURE_CFD = 0x02014B50,
-        SIGNATURE_LFD = 0x04034B50
+        SIGNATURE_LFD = 0x04034B50,
+        SIGNATURE_ECD64 = 0x06064B50,
+        SIGNATURE_ECD64_LOCATOR = 0x07064B50
     };
 
     enum STRUCTID {
@@ -107,6 +110,9 @@ public:
     static const quint16 ZIP_AES_EXTRA_FIELD_DATA_SIZE = 0x0007;
     static const quint16 ZIP_AES_VENDOR_ID_AE = 0x4541;  // 'AE' in little-endian
 
+    // ZIP64 extended information extra field header ID
+    static const quint16 ZIP64_EXTRA_FIELD_HEADER_ID = 0x0001;
+
 #pragma pack(push)
 #pragma pack(1)
     struct LOCALFILEHEADER {
@@ -138,6 +144,27 @@ public:
         // Comment
     };
 
+    struct ENDOFCENTRALDIRECTORYRECORD64 {
+        quint32 nSignature;     // SIGNATURE_ECD64
+        quint64 nSizeOfRecord;  // Without nSignature and nSizeOfRecord
+        quint16 nVersion;
+        quint16 nMinVersion;
+        quint32 nDiskNumber;
+        quint32 nStartDisk;
+        quint64 nDiskNumberOfRecords;
+        quint64 nTotalNumberOfRecords;
+        quint64 nSizeOfCentralDirectory;
+        quint64 nOffsetToCentralDirectory;
+        // Extensible data
+    };
+
+    struct ENDOFCENTRALDIRECTORYLOCATOR64 {
+        quint32 nSignature;  // SIGNATURE_ECD64_LOCATOR
+        quint32 nStartDisk;
+        quint64 nOffsetToECD64;
+        quint32 nTotalDisks;
+    };
+
     struct CENTRALDIRECTORYFILEHEADER {
         quint32 nSignature;  // SIGNATURE_CFD
         quint8 nVersion;
@@ -199,8 +226,18 @@ public:
         // TODO Comment!!!
     };
 
+    // A file queued by addFile; queued files are packed in parallel batches
+    struct ZIP_PACK_JOB {
+        QString sFilePath;
+        ZIPFILE_RECORD record;  // CRC32 and compressed size are filled in by the packing
+        qint32 nCompressionLevel;
+        QString sPassword;
+    };
+
     struct ZIP_PACK_CONTEXT {
         QList<ZIPFILE_RECORD> *pListZipFileRecords;
+        QList<ZIP_PACK_JOB> listPackJobs;
+        bool bIsDeviceError;  // The archive device could not be rewound past a failed member; packing cannot go on
     };
 
     // Format-specific context structures
@@ -210,6 +247,28 @@ public:
         qint64 nCentralDirectoryEnd;
     };
 
+    struct CD_ENTRY {
+        qint64 nLocalHeaderOffset;
+        qint64 nCompressedSize;
+        qint64 nUncompressedSize;
+        quint32 nCRC32;
+        quint16 nMethod;
+        quint16 nFlags;
+        qint32 nNameOffset;  // Offset in CD_TABLE::baNames
+        qint32 nNameSize;
+    };
+
+    // Validated central directory, parsed once per instance
+    struct CD_TABLE {
+        bool bIsParsed;
+        qint64 nECDOffset;  // -1 if there is no valid ECD
+        qint64 nECD64Offset;  // -1 if the archive is not ZIP64
+        qint64 nCentralDirectoryOffset;
+        qint64 nCentralDirectorySize;
+        QVector<CD_ENTRY> listEntries;
+        QByteArray baNames;  // Record names, back to back
+    };
+
     explicit XZip(QIODevice *pDevice = nullptr);
     virtual bool isValid(PDSTRUCT *pPdStruct = nullptr) override;
     static bool isValid(QIODevice *pDevice, PDSTRUCT *pPdStruct = nullptr);
@@ -235,6 +294,7 @@ public:
     LOCALFILEHEADER read_LOCALFILEHEADER(qint64 nOffset, PDSTRUCT *pPdStruct);
     AES_EXTRA_FIELD read_AES_EXTRA_FIELD(qint64 nOffset, PDSTRUCT *pPdStruct);
     qint64 findECDOffset(PDSTRUCT *pPdStruct);
+    const CD_TABLE *getCentralDirectoryTable(PDSTRUCT *pPdStruct);
 
     bool isAPK(qint64 nECDOffset, PDSTRUCT *pPdStruct);
     bool isIPA(qint64 nECDOffset, PDSTRUCT *pPdStruct);
@@ -258,6 +318,8 @@ public:
     virtual bool addFile(PACK_STATE *pState, const QString &sFilePath, PDSTRUCT *pPdStruct = nullptr) override;
     virtual bool addFolder(PACK_STATE *pState, const QString &sDirectoryPath, PDSTRUCT *pPdStruct = nullptr) override;
     virtual bool finishPack(PACK_STATE *pState, PDSTRUCT *pPdStruct = nullptr) override;
+    // Files left out of the archive by the last pack session, in the order they failed; kept after finishPack
+    QList<QString> getPackFailedFiles() const;
     virtual QList<PM_INFO> unpackImplemented() override;
     virtual QList<PM_INFO> packImplemented() override;
 
@@ -283,8 +345,13 @@ protected:
     bool _isRecordNamePresent(qint64 nECDOffset, QString sRecordName1, QString sRecordName2, PDSTRUCT *pPdStruct, bool bStartWith);
     qint32 _getNumberOfLocalFileHeaders(qint64 nOffset, qint64 nSize, qint64 *pnRealSize, PDSTRUCT *pPdStruct);
     bool _isECDSignaturePresent(qint64 nOffset, PDSTRUCT *pPdStruct);
+    void _readLocalZip64Sizes(qint64 nOffset, const LOCALFILEHEADER &lfh, quint64 *pnUncompressedSize, quint64 *pnCompressedSize);
 private:
+    bool _flushPackJobs(PACK_STATE *pState, PDSTRUCT *pPdStruct);
+
     INTERNAL_INFO m_internalInfo;
+    CD_TABLE m_cdTable;
+    QList<QString> m_listPackFailedFiles;
 };
 
 #endif  // XZIP_H
@@ -505,6 +505,8 @@ bool XZlib::finishUnpack(UNPACK_STATE *pState, PDSTRUCT *pPdStruct)
 {
     Q_UNUSED(pPdStruct)
 
+    _freeDecompressSession(pState);
+
     if (!pState) {
         return false;
     }
@@ -629,7 +631,7 @@ bool XZlib::addDevice(PACK_STATE *pState, QIODevice *pDevice, PDSTRUCT *pPdStruc
 
     qint32 nCompressionLevel = pState->mapProperties.value(PACK_PROP_COMPRESSIONLEVEL, 6).toInt();
 
-    bool bCompress = XDeflateDecoder::compress(&compressState, pPdStruct, nCompressionLevel);
+    bool bCompress = XDeflateDecoder::compress(&compressState, pPdStruct, nCompressionLevel, true);
 
     inputBuffer.close();
 